@@ -11,7 +11,8 @@ env.AddCustomTarget(
     title="Publish OTA",
     dependencies="$BUILD_DIR/${PROGNAME}.bin",
     actions=[
-        f"aws --profile eric s3 cp $SOURCE s3://enry-weather-nodes-fmw-update/{env['PIOENV']}-{short_hash}.bin --region eu-north-1",
+        f"aws --profile eric s3 cp $SOURCE s3://enry-weather-nodes-fmw-update/{env['PIOENV']}-{short_hash}.bin --region eu-north-1 --metadata sha256=$$(sha256sum $SOURCE | cut -d' ' -f1)",
+        f"python3 ota_delta.py publish {env['PIOENV']} {short_hash} $SOURCE",
         f"echo 'target_version = {short_hash}'",
         f"echo -n {short_hash} | xsel -ib"
     ],
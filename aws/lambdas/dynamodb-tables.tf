@@ -57,6 +57,33 @@ resource "aws_dynamodb_table" "measurements" {
   }
 }
 
+resource "aws_dynamodb_table" "measurement_buckets" {
+  name           = "measurement_buckets"
+  billing_mode   = "PAY_PER_REQUEST"
+  hash_key       = "device_id"
+  range_key      = "bucket_utc"
+
+  attribute {
+    name = "device_id"
+    type = "S"
+  }
+
+  attribute {
+    name = "bucket_utc"
+    type = "S"
+  }
+
+  ttl {
+    attribute_name = "ttl"
+    enabled        = true
+  }
+
+  tags = {
+    Name = "Measurement buckets"
+    Environment = "prod"
+  }
+}
+
 resource "aws_dynamodb_table" "device_configs" {
   name           = "device_configs"
   billing_mode   = "PAY_PER_REQUEST"
@@ -16,6 +16,8 @@ resource "aws_lambda_function" "get_display_lambda" {
   architectures    = ["arm64"]
   runtime          = "python3.13"
   role             = aws_iam_role.iam_for_get_display_lambda.arn
+  # Rendering frames takes longer than the JSON response
+  timeout          = 10
 }
 
 resource "aws_lambda_function_url" "get_display_lambda_url" {
@@ -64,7 +66,7 @@ resource "aws_iam_policy" "get_display_lambda_policy" {
         Action = [
           "dynamodb:Query"
         ],
-        Resource = aws_dynamodb_table.measurements.arn
+        Resource = aws_dynamodb_table.measurement_buckets.arn
       }
     ]
   })
@@ -1,6 +1,16 @@
 from typing import Dict, Any
 
+import base64
+import hashlib
+import json
 import logging
+import math
+import os
+import re
+import struct
+import subprocess
+import time
+import zlib
 from datetime import datetime, timedelta, timezone
 from zoneinfo import ZoneInfo
 
@@ -8,6 +18,7 @@ import boto3
 from boto3.dynamodb.types import TypeDeserializer, TypeSerializer
 from botocore.exceptions import ClientError
 
+import buckets
 from auth import extract_api_key, authenticate_api_key
 from dynamodb import dynamo_to_python
 
@@ -17,6 +28,55 @@ dynamodb = boto3.client("dynamodb")
 deserializer = TypeDeserializer()
 serializer = TypeSerializer()
 
+# Sparklines: one byte per half hour over 24h, 0-254 from lowest to highest
+# mean, 255 where there was no measurement
+TREND_POINTS = 48
+TREND_MAX = 254
+TREND_GAP = 255
+TREND_MEASUREMENTS = ["temperature"]
+
+# Devices asking for schema 2 get strict JSON with numbers as numbers, others
+# the original Python repr with every number as a string
+WIRE_SCHEMA = 2
+LOCATION_NUMBERS = ["latitude", "longitude"]
+
+# Bits of the fields parameter, set by displays for each part of the response
+# they render (Model::Field in the firmware). Without it everything is sent.
+FIELD_BME680 = 1 << 0
+FIELD_SHT31D = 1 << 1
+FIELD_BATTERY = 1 << 2
+FIELD_MIN_MAX = 1 << 3
+FIELD_TREND = 1 << 4
+FIELD_BAD_STATUS = 1 << 5
+FIELD_STATUS = 1 << 6
+FIELD_VERSION = 1 << 7
+SENSOR_FIELDS = {"bme680": FIELD_BME680, "sht31d": FIELD_SHT31D}
+SENSOR_MEASUREMENTS = ["temperature", "humidity", "pressure"]
+
+# Response fields that change on every call without changing the display
+ETAG_EXCLUDED = ["timestamp_local", "timestamp_utc"]
+# Nodes are shown with their age past this, as MAX_STALE_SECONDS in the
+# firmware's config.h
+MAX_STALE_SECONDS = 30 * 60
+# Decimals of the values as EPDView2 shows them, from single precision floats
+SHOWN_DECIMALS = {"temperature": 1, "humidity": 1, "pressure": 0}
+# Steps of the battery gauge, as Model::batteryLevelToChar
+BATTERY_STEPS = 8
+ETAG_PATTERN = re.compile(r'"[0-9a-f]{16}"')
+
+# Displays built with SERVER_RENDERED_FRAME get their screen rendered by the
+# firmware's own layout code, built for the host by build_frame_renderer.py:
+# frame=1 for a whole frame, frame=2 when the part that changed since the frame
+# of their ETag is enough
+FRAME_RENDERER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "render_frame")
+# Frames served lately by the lambda instance, by ETag, to work out what
+# changed. A whole frame is sent when the previous one is not there.
+FRAME_CACHE = "/tmp/frames"
+FRAME_CACHE_SECONDS = 24 * 3600
+# Displays inflate JSON responses as they download, keeping only the last
+# 2^DEFLATE_WINDOW_BITS bytes for back references (see lib/inflate/inflater.h)
+DEFLATE_WINDOW_BITS = 11
+
 
 def lambda_handler(event: Dict[str, Any], context: Any) -> Dict[str, Any]:
     ctx = event.get("requestContext") or {}
@@ -37,9 +97,29 @@ def lambda_handler(event: Dict[str, Any], context: Any) -> Dict[str, Any]:
     if method != "GET":
         return {"statusCode": 405, "body": "Method not allowed"}
 
+    query = event.get("queryStringParameters") or {}
+    try:
+        schema = int(query.get("schema", "1"))
+    except ValueError:
+        schema = 1
+    typed = schema >= WIRE_SCHEMA
+    try:
+        fields = int(query["fields"]) if "fields" in query else None
+    except ValueError:
+        fields = None
+    frame = query.get("frame") if query.get("frame") in ["1", "2"] else None
+    if frame is not None:
+        if not os.path.exists(FRAME_RENDERER):
+            return {"statusCode": 501, "body": "Frame rendering not available"}
+        # Frames are laid out from whole typed responses
+        typed = True
+        fields = None
+
     response = {
         "device_id": device_id,
     }
+    if typed:
+        response["schema"] = WIRE_SCHEMA
 
     # Get device config
     device_config_response = dynamodb.get_item(
@@ -65,24 +145,209 @@ def lambda_handler(event: Dict[str, Any], context: Any) -> Dict[str, Any]:
     timestamp_utc = now_utc.isoformat(timespec="seconds")
     response["timestamp_utc"] = timestamp_utc
 
-    addLocationToResponse(response, device_config, local_now)
+    addLocationToResponse(response, device_config, local_now, typed)
+
+    # Devices keeping a full day of history locally ask to skip the min/max
+    # aggregation
+    with_min_max = query.get("min_max") != "0"
+    if fields is not None:
+        with_min_max = with_min_max and fields & (FIELD_MIN_MAX | FIELD_TREND) != 0
 
     # Get details for nodes this device should display
     if "nodes" in device_config:
         response["nodes"] = {}
         nodes = response["nodes"]
         for node in device_config["nodes"]:
-            addNodeDataToResponse(nodes, node, now_utc)
+            addNodeDataToResponse(nodes, node, now_utc, with_min_max, typed)
+            if fields is not None:
+                projectNode(nodes[node["device_id"]], fields)
+
+    etag = contentETag(response, local_now, now_utc, with_min_max, frame is not None)
+    headers = event.get("headers") or {}
+    if headers.get("if-none-match") == etag:
+        return {
+            "statusCode": 304,
+            "headers": {
+                "ETag": etag,
+            },
+        }
 
+    if frame is not None:
+        previous_etag = headers.get("if-none-match") if frame == "2" else None
+        try:
+            body = renderFrame(response, etag, previous_etag)
+        except (OSError, subprocess.SubprocessError, RuntimeError) as err:
+            logger.error("Couldn't render frame: %s", err)
+            return {"statusCode": 500, "body": "Frame rendering failed"}
+        return {
+            "statusCode": 200,
+            "headers": {
+                "Content-Type": "application/octet-stream",
+                "ETag": etag,
+            },
+            "isBase64Encoded": True,
+            "body": base64.b64encode(body).decode("ascii"),
+        }
+
+    if typed:
+        content_type = "application/json"
+        body = json.dumps(response, separators=(",", ":"), default=str)
+    else:
+        content_type = "text/plain"
+        body = str(response)
+    if typed and "deflate" in headers.get("accept-encoding", ""):
+        return {
+            "statusCode": 200,
+            "headers": {
+                "Content-Type": content_type,
+                "Content-Encoding": "deflate",
+                "Vary": "Accept-Encoding",
+                "ETag": etag,
+            },
+            "isBase64Encoded": True,
+            "body": base64.b64encode(deflate(body.encode())).decode("ascii"),
+        }
     return {
         "statusCode": 200,
         "headers": {
-            "Content-Type": "text/plain",
+            "Content-Type": content_type,
+            "ETag": etag,
         },
-        "body": str(response),
+        "body": body,
     }
 
-def addNodeDataToResponse(nodes, node, now_utc):
+def deflate(data):
+    # zlib format, which is what HTTP calls deflate, with a window the
+    # displays can hold
+    compressor = zlib.compressobj(9, zlib.DEFLATED, DEFLATE_WINDOW_BITS)
+    return compressor.compress(data) + compressor.flush()
+
+def contentETag(response, local_now, now_utc, with_min_max, framed=False):
+    # Version of what the device renders from the response: everything but
+    # the timestamps, plus the local date that the date line and sun/moon
+    # times depend on
+    content = {k: v for k, v in response.items() if k not in ETAG_EXCLUDED}
+    content["local_date"] = local_now.date().isoformat()
+    if framed:
+        content["frame"] = True
+    # Nodes post every few minutes, only what the device shows of them counts:
+    # their values as rounded on screen, and how old they are once stale
+    nodes = response.get("nodes")
+    if nodes is not None:
+        content["nodes"] = {device_id: shownNode(node) for device_id, node in nodes.items()}
+    stale = {}
+    for device_id, node in (nodes or {}).items():
+        state = staleState(node, now_utc)
+        if state is not None:
+            stale[device_id] = state
+    if stale:
+        content["stale"] = stale
+    if not with_min_max:
+        # The device's own 24h min/max and sparklines move on with time
+        # alone, have it rebuild them at least once per trend point
+        bucket_seconds = 24 * 3600 // TREND_POINTS
+        content["trend_slot"] = int(now_utc.timestamp()) // bucket_seconds
+    digest = hashlib.sha256(
+        json.dumps(content, sort_keys=True, default=str).encode("utf-8")
+    ).hexdigest()
+    return f'"{digest[:16]}"'
+
+def shownNode(node):
+    # The node as the device shows it, without its timestamp (see staleState)
+    shown = {k: v for k, v in node.items() if k != "timestamp_utc"}
+    if "measurements_v2" in node:
+        measurements = {}
+        for device, values in node["measurements_v2"].items():
+            if device == "battery":
+                if "battery_percentage" in values:
+                    measurements[device] = batteryStep(values["battery_percentage"])
+            elif device != "wifi":
+                measurements[device] = {name: shownValue(name, value)
+                                        for name, value in values.items()
+                                        if name in SENSOR_MEASUREMENTS}
+        shown["measurements_v2"] = measurements
+    if "measurements_min_max" in node:
+        shown["measurements_min_max"] = {
+            device: {name: {bound: shownValue(name, value) for bound, value in stats.items()}
+                     for name, stats in values.items()}
+            for device, values in node["measurements_min_max"].items()
+        }
+    return shown
+
+def shownValue(name, value):
+    try:
+        number = struct.unpack("f", struct.pack("f", float(value)))[0]
+    except (ValueError, TypeError, OverflowError):
+        return value
+    return f"{number:.{SHOWN_DECIMALS.get(name, 1)}f}"
+
+def batteryStep(percentage):
+    try:
+        step = float(percentage) / 100 * BATTERY_STEPS
+    except (ValueError, TypeError):
+        return None
+    if not math.isfinite(step):
+        return None
+    return math.floor(min(max(step, 0), BATTERY_STEPS) + 0.5)
+
+def staleState(node, now_utc):
+    # What Model::addNodeStaleState shows of the node's age, None when fresh
+    timestamp = node.get("timestamp_utc")
+    if timestamp is None:
+        return None
+    try:
+        when = datetime.fromisoformat(str(timestamp))
+    except ValueError:
+        return None
+    if when.tzinfo is None:
+        when = when.replace(tzinfo=timezone.utc)
+    age = (now_utc - when).total_seconds()
+    if age < 0:
+        return "future"
+    if age > MAX_STALE_SECONDS:
+        return round(age / 60)
+    return None
+
+def framePath(etag):
+    return os.path.join(FRAME_CACHE, etag.strip('"') + ".pbm")
+
+def renderFrame(response, etag, previous_etag=None):
+    # The coded frame of the response, only the window around what changed
+    # when the frame of previous_etag is still cached
+    os.makedirs(FRAME_CACHE, exist_ok=True)
+    now = time.time()
+    for name in os.listdir(FRAME_CACHE):
+        path = os.path.join(FRAME_CACHE, name)
+        if now - os.path.getmtime(path) > FRAME_CACHE_SECONDS:
+            os.remove(path)
+
+    command = [FRAME_RENDERER, "--save", framePath(etag)]
+    if (previous_etag is not None and ETAG_PATTERN.fullmatch(previous_etag)
+            and os.path.exists(framePath(previous_etag))):
+        command += ["--previous", framePath(previous_etag)]
+    result = subprocess.run(
+        command,
+        input=json.dumps(response, separators=(",", ":"), default=str).encode("utf-8"),
+        capture_output=True,
+        timeout=10,
+    )
+    if result.returncode != 0:
+        raise RuntimeError(result.stderr.decode("utf-8", errors="replace")[-200:])
+    return result.stdout
+
+def wireNumber(value, typed):
+    # None when a value meant to be a number is not one
+    if not typed:
+        return str(value)
+    try:
+        number = float(value)
+    except (ValueError, TypeError):
+        return None
+    if not math.isfinite(number):
+        return None
+    return int(number) if number.is_integer() else number
+
+def addNodeDataToResponse(nodes, node, now_utc, with_min_max=True, typed=False):
     node_device_id = node["device_id"]
     node_display_name = node["display_name"]
     try:
@@ -113,11 +378,14 @@ def addNodeDataToResponse(nodes, node, now_utc):
                 if m_version == "measurements_v2":
                     nodes[node_device_id][m_version][k] = {}
                     for sk, sv in v.items():
-                        nodes[node_device_id][m_version][k][sk] = str(sv)
+                        value = wireNumber(sv, typed)
+                        if value is not None:
+                            nodes[node_device_id][m_version][k][sk] = value
                 else:
                     nodes[node_device_id][m_version][k] = str(v)
 
-    addMinMaxToResponse(nodes, node_device_id, now_utc)
+    if with_min_max:
+        addMinMaxToResponse(nodes, node_device_id, now_utc, typed)
 
     if "timestamp_utc" in latest_measurement:
         nodes[node_device_id]["timestamp_utc"] = latest_measurement["timestamp_utc"]
@@ -127,69 +395,104 @@ def addNodeDataToResponse(nodes, node, now_utc):
     if "version" in latest_measurement:
         nodes[node_device_id]["version"] = str(latest_measurement["version"])
 
-def addLocationToResponse(response, device_config, local_now):
+def projectNode(node_data, fields):
+    # Leaves out what the display doesn't render
+    measurements = {}
+    for device, values in node_data.get("measurements_v2", {}).items():
+        if device == "battery" and fields & FIELD_BATTERY and "battery_percentage" in values:
+            measurements[device] = {"battery_percentage": values["battery_percentage"]}
+        elif fields & SENSOR_FIELDS.get(device, 0):
+            measurements[device] = {k: v for k, v in values.items() if k in SENSOR_MEASUREMENTS}
+    if measurements:
+        node_data["measurements_v2"] = measurements
+    else:
+        node_data.pop("measurements_v2", None)
+
+    for key, field in [("measurements_min_max", FIELD_MIN_MAX), ("trend", FIELD_TREND)]:
+        if key not in node_data:
+            continue
+        kept = {device: values for device, values in node_data[key].items()
+                if fields & field and fields & SENSOR_FIELDS.get(device, 0)}
+        if kept:
+            node_data[key] = kept
+        else:
+            del node_data[key]
+
+    if "status" in node_data and not fields & FIELD_STATUS:
+        bad = {k: v for k, v in node_data["status"].items() if v != "ok"}
+        if fields & FIELD_BAD_STATUS and bad:
+            node_data["status"] = bad
+        else:
+            del node_data["status"]
+
+    if not fields & FIELD_VERSION:
+        node_data.pop("version", None)
+
+def addLocationToResponse(response, device_config, local_now, typed=False):
     if "location" in device_config:
         response["config"] = {}
         response["config"]["location"] = {}
         response["config"]["location"]["utc_offset_seconds"] = int(local_now.utcoffset().total_seconds())
         for k, v in device_config["location"].items():
-            response["config"]["location"][k] = str(v)
+            if k in LOCATION_NUMBERS:
+                value = wireNumber(v, typed)
+                if value is not None:
+                    response["config"]["location"][k] = value
+            else:
+                response["config"]["location"][k] = str(v)
 
-def addMinMaxToResponse(nodes, node_device_id, now_utc):
-    now_minus_24h = (now_utc - timedelta(hours=24)).isoformat(timespec="seconds")
+def addMinMaxToResponse(nodes, node_device_id, now_utc, typed=False):
+    # Merges the half hour buckets send-measurement keeps up to date instead of
+    # scanning the day's measurements
     try:
-        measurements_today_response = dynamodb.query(
-            TableName="measurements",
-            KeyConditionExpression="device_id = :device_id AND timestamp_utc >= :start_timestamp_utc",
-            ExpressionAttributeValues={
-                ":device_id": {"S": node_device_id},
-                ":start_timestamp_utc": {"S": now_minus_24h},
-            },
-        )
+        window = buckets.query_window(dynamodb, node_device_id, now_utc)
     except ClientError as err:
         logger.error(
-            "Couldn't query measurements: %s: %s",
+            "Couldn't query measurement buckets: %s: %s",
             err.response["Error"]["Code"],
             err.response["Error"]["Message"],
         )
         raise
-    if "Items" in measurements_today_response:
-        measurements_today = [
-            dynamo_to_python(item) for item in measurements_today_response["Items"]
-        ]
-    else:
-        measurements_today = []
 
-    if len(measurements_today) == 0:
+    if len(window) == 0:
         return
 
-    min_max = {}
-    for measurement in measurements_today:
-        if "measurements_v2" in measurement:
-            for device, device_measurements in measurement["measurements_v2"].items():
-                if device not in min_max:
-                    min_max[device] = {}
-                for measurement_name, measurement_value in device_measurements.items():
-                    if measurement_name not in ["temperature", "humidity", "pressure"]:
-                        continue
-                    try:
-                        value_as_float = float(measurement_value)
-                    except (ValueError, TypeError):
-                        continue
-                    if measurement_name not in min_max[device]:
-                        min_max[device][measurement_name] = {"min": value_as_float, "max": value_as_float}
-                    else:
-                        if value_as_float < min_max[device][measurement_name]["min"]:
-                            min_max[device][measurement_name]["min"] = value_as_float
-                        if value_as_float > min_max[device][measurement_name]["max"]:
-                            min_max[device][measurement_name]["max"] = value_as_float
-
+    min_max = buckets.merge_min_max(window)
     nodes[node_device_id]["measurements_min_max"] = {}
     for device, device_measurements in min_max.items():
         if device_measurements is not None and len(device_measurements) > 0:
             nodes[node_device_id]["measurements_min_max"][device] = {}
         for measurement_name, measurement_value in device_measurements.items():
             nodes[node_device_id]["measurements_min_max"][device][measurement_name] = {
-                "min": str(measurement_value["min"]),
-                "max": str(measurement_value["max"]),
+                "min": wireNumber(measurement_value["min"], typed),
+                "max": wireNumber(measurement_value["max"], typed),
             }
+
+    trends = buildTrends(window, min_max, now_utc)
+    if len(trends) > 0:
+        nodes[node_device_id]["trend"] = trends
+
+def buildTrends(window, min_max, now_utc):
+    start = now_utc - timedelta(hours=24)
+    bucket_seconds = 24 * 3600 / TREND_POINTS
+    trends = {}
+    for device, device_measurements in min_max.items():
+        for measurement_name in TREND_MEASUREMENTS:
+            if measurement_name not in device_measurements:
+                continue
+            means = [None] * TREND_POINTS
+            for bucket_start, mean in buckets.bucket_means(window, device, measurement_name):
+                point = int((bucket_start - start).total_seconds() // bucket_seconds)
+                means[min(max(point, 0), TREND_POINTS - 1)] = mean
+            present = [mean for mean in means if mean is not None]
+            if len(present) < 2:
+                continue
+            low, high = min(present), max(present)
+            points = bytes(
+                TREND_GAP if mean is None
+                else TREND_MAX // 2 if high == low
+                else round((mean - low) / (high - low) * TREND_MAX)
+                for mean in means
+            )
+            trends.setdefault(device, {})[measurement_name] = base64.b64encode(points).decode("ascii")
+    return trends
@@ -55,9 +55,18 @@ resource "aws_iam_policy" "send_measurement_lambda_policy" {
       {
         Effect = "Allow",
         Action = [
-          "dynamodb:PutItem"
+          "dynamodb:PutItem",
+          "dynamodb:BatchWriteItem"
         ],
         Resource = aws_dynamodb_table.measurements.arn
+      },
+      {
+        Effect = "Allow",
+        Action = [
+          "dynamodb:GetItem",
+          "dynamodb:PutItem"
+        ],
+        Resource = aws_dynamodb_table.measurement_buckets.arn
       }
     ]
   })
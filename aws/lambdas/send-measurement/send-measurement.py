@@ -11,10 +11,13 @@ from boto3.dynamodb.types import TypeDeserializer, TypeSerializer
 from botocore.exceptions import ClientError
 from botocore.config import Config
 
+import buckets
 from auth import extract_api_key, authenticate_api_key
 from dynamodb import dynamo_to_python
 
 logger = logging.getLogger(__name__)
+# Nodes' uploaded logs go out at INFO
+logger.setLevel(logging.INFO)
 
 dynamodb = boto3.client("dynamodb")
 deserializer = TypeDeserializer()
@@ -55,12 +58,44 @@ def lambda_handler(event: Dict[str, Any], context: Any) -> Dict[str, Any]:
 
     input = json.loads(body, parse_float=Decimal)
 
-    # Prepare the response
+    # Prepare the response, including the time so nodes can date readings they
+    # have to log while offline
+    now_utc = datetime.now(timezone.utc)
     response = {
         "device_id": device_id,
         "status": "ok",
+        "timestamp_utc": now_utc.isoformat(timespec="seconds"),
     }
 
+    # Readings logged while the node was offline only go to the history
+    if "backfill" in input:
+        store_backfill(device_id, input["backfill"], now_utc)
+        response["backfilled"] = len(input["backfill"])
+        return {
+            "statusCode": 200,
+            "headers": {
+                "Content-Type": "text/plain",
+            },
+            "body": str(response),
+        }
+
+    # Records of the node's last wake cycles, sent when asked for below
+    if "logs" in input:
+        for line in input["logs"]:
+            logger.info("%s: %s", device_id, line)
+        response["logs"] = len(input["logs"])
+        return {
+            "statusCode": 200,
+            "headers": {
+                "Content-Type": "text/plain",
+            },
+            "body": str(response),
+        }
+
+    # Set upload_logs on the node's api_keys item to collect its logs
+    if api_key_response_item.get("upload_logs"):
+        response["upload_logs"] = 1
+
     check_for_ota_update(api_key_response_item, input, response)
     if "ota_update" in response:
         if "status" not in input:
@@ -68,7 +103,7 @@ def lambda_handler(event: Dict[str, Any], context: Any) -> Dict[str, Any]:
         input["status"]["firmware_up_to_date"] = "no"
 
     # Prepare the measurements record to store
-    timestamp_utc = datetime.now(timezone.utc).isoformat(timespec="seconds")
+    timestamp_utc = now_utc.isoformat(timespec="seconds")
     item = {
         "device_id": serializer.serialize(device_id),
         "timestamp_utc": serializer.serialize(timestamp_utc),
@@ -90,7 +125,7 @@ def lambda_handler(event: Dict[str, Any], context: Any) -> Dict[str, Any]:
         raise
 
     # Then store the item in the measurements table
-    ttl = datetime.now(timezone.utc) + timedelta(days=90)
+    ttl = now_utc + timedelta(days=90)
     item["ttl"] = serializer.serialize(int(ttl.timestamp()))
 
     try:
@@ -103,7 +138,9 @@ def lambda_handler(event: Dict[str, Any], context: Any) -> Dict[str, Any]:
         )
         raise
 
-
+    # Keep the rolling 24h aggregates the display reads up to date
+    if "measurements_v2" in input:
+        update_buckets(device_id, [(now_utc, input["measurements_v2"])], now_utc)
 
     return {
         "statusCode": 200,
@@ -113,22 +150,125 @@ def lambda_handler(event: Dict[str, Any], context: Any) -> Dict[str, Any]:
         "body": str(response),
     }
 
+def store_backfill(device_id, backfill, now_utc):
+    # Items are keyed by (device_id, timestamp_utc), so a batch resent after a
+    # partial failure overwrites rather than duplicates, and the buckets skip
+    # the readings they already hold
+    items = []
+    readings = []
+    for entry in backfill:
+        try:
+            timestamp = datetime.fromisoformat(entry["timestamp_utc"])
+        except (KeyError, ValueError, TypeError):
+            continue
+        if timestamp.tzinfo is None:
+            timestamp = timestamp.replace(tzinfo=timezone.utc)
+        timestamp = timestamp.astimezone(timezone.utc)
+        ttl = timestamp + timedelta(days=90)
+        item = {
+            "device_id": serializer.serialize(device_id),
+            "timestamp_utc": serializer.serialize(timestamp.isoformat(timespec="seconds")),
+            "ttl": serializer.serialize(int(ttl.timestamp())),
+        }
+        if "measurements_v2" in entry:
+            item["measurements_v2"] = serializer.serialize(entry["measurements_v2"])
+            readings.append((timestamp, entry["measurements_v2"]))
+        items.append({"PutRequest": {"Item": item}})
+
+    # batch_write_item takes at most 25 items
+    for start in range(0, len(items), 25):
+        request = {"measurements": items[start:start + 25]}
+        try:
+            while request:
+                result = dynamodb.batch_write_item(RequestItems=request)
+                request = result.get("UnprocessedItems") or {}
+        except ClientError as err:
+            logger.error(
+                "Couldn't save backfilled measurements: %s: %s",
+                err.response["Error"]["Code"],
+                err.response["Error"]["Message"],
+            )
+            raise
+
+    update_buckets(device_id, readings, now_utc, backfill=True)
+
+def update_buckets(device_id, readings, now_utc, backfill=False):
+    try:
+        buckets.add_readings(dynamodb, device_id, readings, now_utc, backfill)
+    except ClientError as err:
+        logger.error(
+            "Couldn't update measurement buckets: %s: %s",
+            err.response["Error"]["Code"],
+            err.response["Error"]["Message"],
+        )
+        raise
+
 def check_for_ota_update(api_key_response_item, input, response):
     if "ota_update" in api_key_response_item and "version" in input:
         ota_update = api_key_response_item["ota_update"]
         if "target_version" in ota_update and input["version"] != ota_update["target_version"]:
-            response["ota_update"] = {}
             s3 = boto3.client("s3", config=Config(signature_version="s3v4"), region_name="eu-north-1")
+            bucket = ota_update["s3_bucket"]
+            key = ota_update["s3_key"].format(target_version=ota_update["target_version"])
             try:
+                # Nodes resume interrupted downloads and check the image against
+                # the digest recorded when it was published, ignoring images
+                # without one
+                head = s3.head_object(Bucket=bucket, Key=key)
+                if "sha256" not in head.get("Metadata", {}):
+                    logger.error(
+                        "No sha256 metadata on s3://%s/%s, republish it with publish_ota",
+                        bucket,
+                        key,
+                    )
+                    return
                 presigned_url = s3.generate_presigned_url(
                     "get_object",
                     Params={
-                        "Bucket": ota_update["s3_bucket"],
-                        "Key": ota_update["s3_key"].format(target_version=ota_update["target_version"]),
+                        "Bucket": bucket,
+                        "Key": key,
                     },
                     ExpiresIn=3600, # seconds
                 )
-                response["ota_update"]["url"] = presigned_url
+                response["ota_update"] = {
+                    "url": presigned_url,
+                    "size": head["ContentLength"],
+                    "sha256": head["Metadata"]["sha256"],
+                }
             except ClientError as e:
                 logger.error(f"Error generating presigned URL: {e}")
                 response["ota_update"] = {"error": "Could not generate download URL"}
+                return
+            add_ota_patch(s3, ota_update, bucket, input["version"], response)
+
+def add_ota_patch(s3, ota_update, bucket, from_version, response):
+    # Patches from the version the node runs, published by ota_delta.py
+    if "s3_patch_key" not in ota_update:
+        return
+    key = ota_update["s3_patch_key"].format(
+        from_version=from_version, target_version=ota_update["target_version"]
+    )
+    try:
+        head = s3.head_object(Bucket=bucket, Key=key)
+    except ClientError:
+        # No patch from this version
+        return
+    if "sha256" not in head.get("Metadata", {}):
+        return
+    try:
+        presigned_url = s3.generate_presigned_url(
+            "get_object",
+            Params={
+                "Bucket": bucket,
+                "Key": key,
+            },
+            ExpiresIn=3600, # seconds
+        )
+    except ClientError as e:
+        logger.error(f"Error generating presigned patch URL: {e}")
+        return
+    response["ota_update"]["patch"] = {
+        "url": presigned_url,
+        "size": head["ContentLength"],
+        "sha256": head["Metadata"]["sha256"],
+    }
@@ -0,0 +1 @@
+from .buckets import *
@@ -0,0 +1,178 @@
+"""
+Rolling 24h aggregates of the measurements, kept up to date by send-measurement
+so get-display doesn't have to scan a day of raw measurements per node.
+
+Each item of the measurement_buckets table holds one half hour of a node's
+readings: min, max, sum and count per sensor and metric. Half hours rather
+than hours so the same buckets give the sparkline points.
+"""
+from datetime import datetime, timedelta, timezone
+from decimal import Decimal, InvalidOperation
+
+from boto3.dynamodb.types import TypeDeserializer, TypeSerializer
+from botocore.exceptions import ClientError
+
+TABLE = "measurement_buckets"
+BUCKET_SECONDS = 1800
+WINDOW = timedelta(hours=24)
+MEASUREMENTS = ["temperature", "humidity", "pressure"]
+# Buckets are only read over the last day
+TTL = timedelta(days=2)
+# Attempts at a bucket update racing with another one
+UPDATE_ATTEMPTS = 3
+
+deserializer = TypeDeserializer()
+serializer = TypeSerializer()
+
+
+def bucket_start(timestamp: datetime) -> datetime:
+    epoch = int(timestamp.timestamp())
+    return datetime.fromtimestamp(epoch - epoch % BUCKET_SECONDS, timezone.utc)
+
+
+def bucket_key(timestamp: datetime) -> str:
+    return bucket_start(timestamp).isoformat(timespec="seconds")
+
+
+def _number(value):
+    try:
+        number = Decimal(str(value))
+    except InvalidOperation:
+        return None
+    return number if number.is_finite() else None
+
+
+def _add(metrics, measurements_v2):
+    for device, device_measurements in measurements_v2.items():
+        if not isinstance(device_measurements, dict):
+            continue
+        for name in MEASUREMENTS:
+            if name not in device_measurements:
+                continue
+            value = _number(device_measurements[name])
+            if value is None:
+                continue
+            stats = metrics.setdefault(device, {}).get(name)
+            if stats is None:
+                metrics[device][name] = {"min": value, "max": value, "sum": value, "count": 1}
+            else:
+                stats["min"] = min(stats["min"], value)
+                stats["max"] = max(stats["max"], value)
+                stats["sum"] += value
+                stats["count"] += 1
+
+
+def add_readings(dynamodb, device_id, readings, now_utc, backfill=False):
+    """Adds (timestamp, measurements_v2) readings to their buckets, one read
+    and one conditional write per bucket touched. Readings older than the
+    window are left out.
+
+    Backfilled readings can be sent again after a partial failure. Each bucket
+    records the latest backfilled reading it holds, backfilled readings up to
+    it are skipped."""
+    by_bucket = {}
+    for timestamp, measurements_v2 in readings:
+        if now_utc - timestamp > WINDOW or not measurements_v2:
+            continue
+        by_bucket.setdefault(bucket_key(timestamp), []).append((timestamp, measurements_v2))
+
+    for key, bucket_readings in by_bucket.items():
+        bucket_readings.sort(key=lambda entry: entry[0])
+        for attempt in range(UPDATE_ATTEMPTS):
+            try:
+                _update_bucket(dynamodb, device_id, key, bucket_readings, backfill)
+                break
+            except ClientError as err:
+                if (err.response["Error"]["Code"] != "ConditionalCheckFailedException"
+                        or attempt == UPDATE_ATTEMPTS - 1):
+                    raise
+
+
+def _update_bucket(dynamodb, device_id, key, bucket_readings, backfill):
+    item_key = {
+        "device_id": serializer.serialize(device_id),
+        "bucket_utc": serializer.serialize(key),
+    }
+    result = dynamodb.get_item(TableName=TABLE, Key=item_key, ConsistentRead=True)
+    backfilled = None
+    if "Item" in result:
+        revision = int(deserializer.deserialize(result["Item"]["revision"]))
+        metrics = deserializer.deserialize(result["Item"]["metrics"])
+        if "backfilled_utc" in result["Item"]:
+            backfilled = datetime.fromisoformat(
+                deserializer.deserialize(result["Item"]["backfilled_utc"]))
+        condition = {
+            "ConditionExpression": "revision = :revision",
+            "ExpressionAttributeValues": {":revision": serializer.serialize(revision)},
+        }
+    else:
+        revision = 0
+        metrics = {}
+        condition = {"ConditionExpression": "attribute_not_exists(device_id)"}
+
+    added = False
+    for timestamp, measurements_v2 in bucket_readings:
+        if backfill:
+            if backfilled is not None and timestamp <= backfilled:
+                continue
+            backfilled = timestamp
+        _add(metrics, measurements_v2)
+        added = True
+    if not added or not metrics:
+        return
+
+    ttl = datetime.fromisoformat(key) + TTL
+    item = dict(item_key)
+    item["metrics"] = serializer.serialize(metrics)
+    item["revision"] = serializer.serialize(revision + 1)
+    item["ttl"] = serializer.serialize(int(ttl.timestamp()))
+    if backfilled is not None:
+        item["backfilled_utc"] = serializer.serialize(backfilled.isoformat(timespec="seconds"))
+    dynamodb.put_item(TableName=TABLE, Item=item, **condition)
+
+
+def query_window(dynamodb, device_id, now_utc):
+    """Returns [(bucket start, metrics)] for the last 24h, oldest first."""
+    buckets = []
+    request = {
+        "TableName": TABLE,
+        "KeyConditionExpression": "device_id = :device_id AND bucket_utc >= :start",
+        "ExpressionAttributeValues": {
+            ":device_id": {"S": device_id},
+            ":start": {"S": bucket_key(now_utc - WINDOW)},
+        },
+    }
+    while True:
+        result = dynamodb.query(**request)
+        for item in result.get("Items", []):
+            start = datetime.fromisoformat(item["bucket_utc"]["S"])
+            buckets.append((start, deserializer.deserialize(item["metrics"])))
+        if "LastEvaluatedKey" not in result:
+            return buckets
+        request["ExclusiveStartKey"] = result["LastEvaluatedKey"]
+
+
+def merge_min_max(buckets):
+    """{device: {metric: {"min", "max"}}} over the buckets, as floats."""
+    min_max = {}
+    for _, metrics in buckets:
+        for device, device_metrics in metrics.items():
+            for name, stats in device_metrics.items():
+                low, high = float(stats["min"]), float(stats["max"])
+                merged = min_max.setdefault(device, {}).get(name)
+                if merged is None:
+                    min_max[device][name] = {"min": low, "max": high}
+                else:
+                    merged["min"] = min(merged["min"], low)
+                    merged["max"] = max(merged["max"], high)
+    return min_max
+
+
+def bucket_means(buckets, device, name):
+    """[(bucket start, mean)] of a metric."""
+    means = []
+    for start, metrics in buckets:
+        stats = metrics.get(device, {}).get(name)
+        if stats is not None and int(stats["count"]) > 0:
+            means.append((start, float(stats["sum"]) / int(stats["count"])))
+    return means
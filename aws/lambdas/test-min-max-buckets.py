@@ -0,0 +1,427 @@
+#!/usr/bin/env python3
+"""
+Local test of the rolling 24h min/max buckets, against an in-memory stand-in
+for DynamoDB.
+
+Feeds a day of readings from a few nodes through send-measurement, checks the
+buckets give get-display the same min/max as scanning the raw measurements
+did, and compares the cost of both for one display GET. Also checks that
+backfill resent after a failure is counted once, and that display GETs are
+answered 304 Not Modified until what the display shows changes.
+
+Needs boto3 for its type (de)serializers, makes no AWS calls.
+
+    python3 test-min-max-buckets.py [nodes] [minutes between readings]
+"""
+
+import importlib.util
+import json
+import math
+import os
+import re
+import sys
+import time
+from datetime import datetime, timedelta, timezone
+from decimal import Decimal
+
+import boto3
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# Rough DynamoDB costs for the simulated time: a round trip per request, plus
+# the transfer and unmarshalling of what is read
+REQUEST_MS = 5.0
+PER_KB_MS = 0.05
+# Query pages stop at 1MB
+PAGE_BYTES = 1024 * 1024
+
+KEYS = {
+    "api_keys": ("api_key", None),
+    "device_configs": ("device_id", None),
+    "latest_measurements": ("device_id", None),
+    "measurements": ("device_id", "timestamp_utc"),
+    "measurement_buckets": ("device_id", "bucket_utc"),
+}
+
+
+class ConditionalCheckFailed(Exception):
+    def __init__(self):
+        super().__init__("The conditional request failed")
+        self.response = {"Error": {"Code": "ConditionalCheckFailedException",
+                                   "Message": "The conditional request failed"}}
+
+
+class DynamoDBStandIn:
+    """The calls the lambdas make, on items kept in their wire format."""
+
+    def __init__(self):
+        self.tables = {name: {} for name in KEYS}
+        self.reset_stats()
+
+    def reset_stats(self):
+        self.requests = 0
+        self.items_read = 0
+        self.bytes_read = 0
+
+    def simulated_ms(self):
+        return self.requests * REQUEST_MS + self.bytes_read / 1024 * PER_KB_MS
+
+    def _key(self, table, item):
+        hash_key, range_key = KEYS[table]
+        return (item[hash_key]["S"], item[range_key]["S"] if range_key else None)
+
+    def _read(self, items):
+        self.items_read += len(items)
+        self.bytes_read += sum(len(json.dumps(item)) for item in items)
+
+    def get_item(self, TableName, Key, ConsistentRead=False):
+        self.requests += 1
+        item = self.tables[TableName].get(self._key(TableName, Key))
+        if item is None:
+            return {}
+        self._read([item])
+        return {"Item": json.loads(json.dumps(item))}
+
+    def put_item(self, TableName, Item, ConditionExpression=None,
+                 ExpressionAttributeValues=None):
+        self.requests += 1
+        key = self._key(TableName, Item)
+        existing = self.tables[TableName].get(key)
+        if ConditionExpression is not None:
+            if ConditionExpression.startswith("attribute_not_exists("):
+                ok = existing is None
+            else:
+                match = re.fullmatch(r"(\w+) = (:\w+)", ConditionExpression)
+                value = ExpressionAttributeValues[match.group(2)]
+                ok = existing is not None and existing.get(match.group(1)) == value
+            if not ok:
+                raise ConditionalCheckFailed()
+        self.tables[TableName][key] = json.loads(json.dumps(Item))
+        return {}
+
+    def batch_write_item(self, RequestItems):
+        self.requests += 1
+        for table, requests in RequestItems.items():
+            for request in requests:
+                item = request["PutRequest"]["Item"]
+                self.tables[table][self._key(table, item)] = item
+        return {}
+
+    def query(self, TableName, KeyConditionExpression, ExpressionAttributeValues,
+              ExclusiveStartKey=None):
+        self.requests += 1
+        match = re.fullmatch(r"(\w+) = (:\w+) AND (\w+) >= (:\w+)", KeyConditionExpression)
+        hash_value = ExpressionAttributeValues[match.group(2)]["S"]
+        start = ExpressionAttributeValues[match.group(4)]["S"]
+        after = self._key(TableName, ExclusiveStartKey) if ExclusiveStartKey else None
+        keys = sorted(key for key in self.tables[TableName]
+                      if key[0] == hash_value and key[1] >= start
+                      and (after is None or key > after))
+        page = []
+        size = 0
+        for key in keys:
+            item = self.tables[TableName][key]
+            page.append(json.loads(json.dumps(item)))
+            size += len(json.dumps(item))
+            if size >= PAGE_BYTES:
+                break
+        self._read(page)
+        result = {"Items": page, "Count": len(page)}
+        if len(page) < len(keys):
+            hash_key, range_key = KEYS[TableName]
+            result["LastEvaluatedKey"] = {hash_key: page[-1][hash_key],
+                                          range_key: page[-1][range_key]}
+        return result
+
+
+STAND_IN = DynamoDBStandIn()
+boto3.client = lambda service, **kwargs: STAND_IN
+
+
+def load_lambda(directory, name):
+    sys.path.insert(0, os.path.join(HERE, directory))
+    spec = importlib.util.spec_from_file_location(
+        name.replace("-", "_"), os.path.join(HERE, directory, name + ".py"))
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+send_measurement = load_lambda("send-measurement", "send-measurement")
+get_display = load_lambda("get-display", "get-display")
+from dynamodb import dynamo_to_python  # noqa: E402  (after the lambda paths)
+
+
+class Clock:
+    now = datetime(2026, 1, 15, 12, 0, tzinfo=timezone.utc)
+
+
+class FakeDatetime(datetime):
+    @classmethod
+    def now(cls, tz=None):
+        return Clock.now if tz is None else Clock.now.astimezone(tz)
+
+
+send_measurement.datetime = FakeDatetime
+get_display.datetime = FakeDatetime
+
+
+def reading(node, t):
+    # A daily temperature cycle per node, with some noise in the humidity
+    hours = t.hour + t.minute / 60
+    temperature = 12 + node + 6 * math.sin((hours - 9) / 24 * 2 * math.pi)
+    humidity = 60 + 15 * math.cos((hours + node) / 24 * 2 * math.pi) + (t.minute % 7) / 10
+    return {
+        "sht31d": {"temperature": f"{temperature:.2f}", "humidity": f"{humidity:.1f}"},
+        "wifi": {"rssi": "-67"},
+    }
+
+
+def post(node, t, measurements_v2=None):
+    Clock.now = t
+    if measurements_v2 is None:
+        measurements_v2 = reading(node, t)
+    event = {
+        "requestContext": {"http": {"method": "POST"}},
+        "headers": {"x-api-key": f"key-{node}"},
+        "isBase64Encoded": False,
+        "body": json.dumps({"measurements_v2": measurements_v2, "version": "test"}),
+    }
+    result = send_measurement.lambda_handler(event, None)
+    assert result["statusCode"] == 200, result
+
+
+def post_backfill(node, entries):
+    event = {
+        "requestContext": {"http": {"method": "POST"}},
+        "headers": {"x-api-key": f"key-{node}"},
+        "isBase64Encoded": False,
+        "body": json.dumps({"backfill": entries}),
+    }
+    return send_measurement.lambda_handler(event, None)
+
+
+def check_backfill_resend(now_utc):
+    # Two hours of readings logged offline by a node of its own, the buckets
+    # update failing after the first bucket and the whole segment sent again
+    node = "backfill"
+    STAND_IN.tables["api_keys"][(f"key-{node}", None)] = {
+        "api_key": {"S": f"key-{node}"}, "device_id": {"S": f"node-{node}"}}
+    start = now_utc - timedelta(hours=3)
+    entries = [{"timestamp_utc": (start + timedelta(minutes=5 * i)).isoformat(timespec="seconds"),
+                "measurements_v2": reading(0, start + timedelta(minutes=5 * i))}
+               for i in range(24)]
+    put_item = STAND_IN.put_item
+    bucket_puts = []
+
+    def failing_put_item(TableName, Item, **kwargs):
+        if TableName == "measurement_buckets":
+            bucket_puts.append(Item)
+            if len(bucket_puts) > 1:
+                raise ConditionalCheckFailed()
+        return put_item(TableName, Item, **kwargs)
+
+    Clock.now = now_utc
+    STAND_IN.put_item = failing_put_item
+    try:
+        post_backfill(node, entries)
+        print("FAIL backfill: the bucket update did not fail")
+        return 1
+    except ConditionalCheckFailed:
+        pass
+    finally:
+        STAND_IN.put_item = put_item
+    for _ in range(2):
+        result = post_backfill(node, entries)
+        if result["statusCode"] != 200:
+            print(f"FAIL backfill: {result}")
+            return 1
+
+    failures = 0
+    expected = {}
+    for entry in entries:
+        key = get_display.buckets.bucket_key(datetime.fromisoformat(entry["timestamp_utc"]))
+        expected[key] = expected.get(key, 0) + 1
+    for key, count in expected.items():
+        item = STAND_IN.tables["measurement_buckets"].get((f"node-{node}", key))
+        got = 0
+        if item is not None:
+            got = int(dynamo_to_python(item)["metrics"]["sht31d"]["temperature"]["count"])
+        if got != count:
+            print(f"FAIL backfill {key}: {got} readings, sent {count}")
+            failures += 1
+    return failures
+
+
+def check_etag(now_utc):
+    # A display of a node of its own, posting within one bucket so that no
+    # sparkline shows
+    node = "etag"
+    STAND_IN.tables["api_keys"][(f"key-{node}", None)] = {
+        "api_key": {"S": f"key-{node}"}, "device_id": {"S": f"node-{node}"}}
+    STAND_IN.tables["api_keys"][("key-etag-display", None)] = {
+        "api_key": {"S": "key-etag-display"}, "device_id": {"S": "etag-display"}}
+    STAND_IN.tables["device_configs"][("etag-display", None)] = {
+        "device_id": {"S": "etag-display"},
+        "nodes": {"L": [{"M": {"device_id": {"S": f"node-{node}"},
+                                "display_name": {"S": "ETag"}}}]},
+    }
+
+    def get(etag):
+        event = {
+            "requestContext": {"http": {"method": "GET"}},
+            "headers": {"x-api-key": "key-etag-display", "if-none-match": etag},
+            "queryStringParameters": {"schema": "2"},
+        }
+        return get_display.lambda_handler(event, None)
+
+    def sensors(temperature, humidity, rssi):
+        return {"sht31d": {"temperature": temperature, "humidity": humidity},
+                "wifi": {"rssi": rssi}}
+
+    start = get_display.buckets.bucket_start(now_utc + timedelta(hours=1))
+    post(node, start, sensors("21.52", "55.04", "-67"))
+    etag = get("").get("headers", {}).get("ETag")
+    steps = [
+        # Same values on screen, the wifi signal not being shown
+        (5, sensors("21.54", "54.96", "-71"), 304),
+        (10, sensors("21.46", "55.01", "-58"), 304),
+        # 21.55 is 21.549999 as a float, shown as 21.5
+        (15, sensors("21.55", "55.04", "-67"), 304),
+        (20, sensors("21.66", "55.04", "-67"), 200),
+        # Stale from 30 minutes without posts
+        (60, None, 200),
+    ]
+    failures = 0
+    for minutes, measurements_v2, status in steps:
+        Clock.now = start + timedelta(minutes=minutes)
+        if measurements_v2 is not None:
+            post(node, Clock.now, measurements_v2)
+        result = get(etag)
+        if result["statusCode"] != status:
+            print(f"FAIL ETag after {minutes} minutes: {result['statusCode']}, expected {status}")
+            failures += 1
+        etag = result["headers"]["ETag"]
+    Clock.now = now_utc
+    return failures
+
+
+def scan_min_max(node_device_id, now_utc):
+    # What get-display did before: query and scan the day's raw measurements
+    start = (now_utc - timedelta(hours=24)).isoformat(timespec="seconds")
+    request = {
+        "TableName": "measurements",
+        "KeyConditionExpression": "device_id = :device_id AND timestamp_utc >= :start_timestamp_utc",
+        "ExpressionAttributeValues": {
+            ":device_id": {"S": node_device_id},
+            ":start_timestamp_utc": {"S": start},
+        },
+    }
+    items = []
+    while True:
+        result = STAND_IN.query(**request)
+        items += [dynamo_to_python(item) for item in result["Items"]]
+        if "LastEvaluatedKey" not in result:
+            break
+        request["ExclusiveStartKey"] = result["LastEvaluatedKey"]
+    min_max = {}
+    for item in items:
+        for device, values in item.get("measurements_v2", {}).items():
+            for name in ["temperature", "humidity", "pressure"]:
+                if name not in values:
+                    continue
+                value = float(values[name])
+                stats = min_max.setdefault(device, {}).setdefault(name, {"min": value, "max": value})
+                stats["min"] = min(stats["min"], value)
+                stats["max"] = max(stats["max"], value)
+    return min_max
+
+
+def main(argv):
+    node_count = int(argv[1]) if len(argv) > 1 else 6
+    interval = timedelta(minutes=int(argv[2]) if len(argv) > 2 else 5)
+
+    nodes = [f"node-{i}" for i in range(node_count)]
+    for i, node in enumerate(nodes):
+        STAND_IN.tables["api_keys"][(f"key-{i}", None)] = {
+            "api_key": {"S": f"key-{i}"}, "device_id": {"S": node}}
+    STAND_IN.tables["api_keys"][("key-display", None)] = {
+        "api_key": {"S": "key-display"}, "device_id": {"S": "display"}}
+    STAND_IN.tables["device_configs"][("display", None)] = {
+        "device_id": {"S": "display"},
+        "nodes": {"L": [{"M": {"device_id": {"S": node}, "display_name": {"S": node}}}
+                        for node in nodes]},
+    }
+
+    # A day and a bit of readings, the oldest ones out of the window
+    end = Clock.now
+    t = end - timedelta(hours=26)
+    posts = 0
+    while t <= end:
+        for i in range(node_count):
+            post(i, t)
+            posts += 1
+        t += interval
+    print(f"{posts} readings from {node_count} nodes, one every {interval}")
+
+    now_utc = end + timedelta(minutes=1)
+    Clock.now = now_utc
+    failures = 0
+
+    STAND_IN.reset_stats()
+    started = time.perf_counter()
+    scanned = {node: scan_min_max(node, now_utc) for node in nodes}
+    scan_ms = (time.perf_counter() - started) * 1000
+    scan_stats = (STAND_IN.requests, STAND_IN.items_read, STAND_IN.bytes_read, STAND_IN.simulated_ms())
+
+    STAND_IN.reset_stats()
+    started = time.perf_counter()
+    merged = {}
+    for node in nodes:
+        response = {node: {}}
+        get_display.addMinMaxToResponse(response, node, now_utc, typed=True)
+        merged[node] = response[node]
+    bucket_ms = (time.perf_counter() - started) * 1000
+    bucket_stats = (STAND_IN.requests, STAND_IN.items_read, STAND_IN.bytes_read, STAND_IN.simulated_ms())
+
+    for node in nodes:
+        expected = scanned[node]
+        got = merged[node].get("measurements_min_max", {})
+        # The oldest bucket reaches up to half an hour before the window
+        for device, metrics in expected.items():
+            for name, stats in metrics.items():
+                actual = got.get(device, {}).get(name)
+                if actual is None or actual["max"] < stats["max"] - 1e-9 or actual["min"] > stats["min"] + 1e-9:
+                    print(f"FAIL {node} {device} {name}: buckets {actual}, scan {stats}")
+                    failures += 1
+        if "sht31d" not in merged[node].get("trend", {}):
+            print(f"FAIL {node}: no sparkline")
+            failures += 1
+
+    failures += check_backfill_resend(now_utc)
+    failures += check_etag(now_utc)
+
+    # A whole display GET through the lambda
+    STAND_IN.reset_stats()
+    event = {
+        "requestContext": {"http": {"method": "GET"}},
+        "headers": {"x-api-key": "key-display"},
+        "queryStringParameters": {"schema": "2"},
+    }
+    result = get_display.lambda_handler(event, None)
+    if result["statusCode"] != 200 or len(json.loads(result["body"])["nodes"]) != node_count:
+        print(f"FAIL display GET: {result}")
+        failures += 1
+
+    print(f"{'':8}{'requests':>10}{'items':>8}{'KB read':>10}{'Python ms':>11}{'simulated ms':>14}")
+    for name, stats, python_ms in [("scan", scan_stats, scan_ms), ("buckets", bucket_stats, bucket_ms)]:
+        requests, items, read, simulated = stats
+        print(f"{name:8}{requests:>10}{items:>8}{read / 1024:>10.1f}{python_ms:>11.1f}{simulated:>14.1f}")
+    print(f"Display GET: {STAND_IN.requests} requests, {STAND_IN.items_read} items")
+
+    print("OK" if failures == 0 else f"{failures} failures")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
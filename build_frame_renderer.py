@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+
+# Builds render_frame.cpp into the get-display lambda, which serves display
+# nodes built with SERVER_RENDERED_FRAME the frames laid out by the firmware's
+# own EPDView2. Run again after changing the layout code, then deploy the
+# lambda; the nodes need no update.
+#
+# The lambda runs on arm64 Linux, cross compilers can be given with CC and CXX:
+#   CC=aarch64-linux-gnu-gcc CXX=aarch64-linux-gnu-g++ ./build_frame_renderer.py
+#
+# Frames are drawn with the display node's own Adafruit GFX, U8g2 for Adafruit
+# GFX and fonts (pio pkg install -e indoor_display_node), only the Arduino core
+# and the panel driver are stood in for by host/. ArduinoJson and fmt are those
+# of the native environment (pio pkg install -e native).
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+OUTPUT = 'aws/lambdas/get-display/render_frame'
+GFX = '.pio/libdeps/indoor_display_node/Adafruit GFX Library'
+U8G2 = '.pio/libdeps/indoor_display_node/U8g2_for_Adafruit_GFX/src'
+SOURCES = [
+    'render_frame.cpp',
+    'lib/frame/framedecoder.cpp',
+    'lib/views/epd_view_2.cpp',
+    'lib/views/display_view.cpp',
+    'lib/views/node_layout.cpp',
+    'lib/controller/controller.cpp',
+    'lib/arena/jsonarena.cpp',
+    'lib/model/model.cpp',
+    'lib/datetime/datetime.cpp',
+    'lib/SunMoonCalc/SunMoonCalc.cpp',
+    'lib/sunandmoon/sunmooncache.cpp',
+    'lib/sunandmoon/ephemeristable.cpp',
+    'lib/history/measurementhistory.cpp',
+    'lib/history/trend.cpp',
+    'lib/logging/logging.cpp',
+    f'{GFX}/Adafruit_GFX.cpp',
+    f'{U8G2}/U8g2_for_Adafruit_GFX.cpp',
+]
+C_SOURCES = [f'{U8G2}/u8g2_fonts.c']
+INCLUDES = [
+    'host', GFX, U8G2, 'lib/frame', 'lib/views', 'lib/controller', 'lib/arena', 'lib/sensors', 'lib/fonts',
+    'lib/model', 'lib/datetime', 'lib/SunMoonCalc', 'lib/sunandmoon',
+    'lib/history', 'lib/logging', 'lib/config',
+    '.pio/libdeps/native/ArduinoJson/src',
+    '.pio/libdeps/native/fmt/include',
+]
+# Same layout options as the display node
+DEFINES = ['UNIT_TEST', 'FMT_HEADER_ONLY', 'INDOOR_DISPLAY_NODE', 'SUN_MOON_CALC_FLOAT']
+# Adafruit GFX wants an Arduino core, which has none of the types ArduinoJson
+# would then support
+DEFINES += [
+    'ARDUINO=10812', 'ARDUINOJSON_ENABLE_ARDUINO_STRING=0',
+    'ARDUINOJSON_ENABLE_ARDUINO_STREAM=0', 'ARDUINOJSON_ENABLE_ARDUINO_PRINT=0',
+    'ARDUINOJSON_ENABLE_PROGMEM=0',
+]
+# The U8g2 font file holds every font, only those the layout uses are linked
+SECTIONS = ['-ffunction-sections', '-fdata-sections']
+
+
+def build(output):
+    compiler = os.environ.get('CXX') or shutil.which('c++') or shutil.which('g++')
+    c_compiler = os.environ.get('CC') or shutil.which('cc') or shutil.which('gcc')
+    if compiler is None or c_compiler is None:
+        print('build_frame_renderer: no compiler')
+        return False
+    with tempfile.TemporaryDirectory() as objects:
+        commands = []
+        c_objects = []
+        for source in C_SOURCES:
+            c_object = os.path.join(objects, os.path.basename(source) + '.o')
+            commands.append([c_compiler, '-O2', '-c'] + SECTIONS +
+                            ['-o', c_object, source])
+            c_objects.append(c_object)
+        command = [compiler, '-std=c++11', '-O2', '-static', '-Wl,--gc-sections',
+                   '-include', 'host/Arduino.h'] + SECTIONS
+        command += [f'-I{path}' for path in INCLUDES]
+        command += [f'-D{define}' for define in DEFINES]
+        commands.append(command + ['-o', output] + SOURCES + c_objects)
+        try:
+            for command in commands:
+                subprocess.check_call(command)
+        except (OSError, subprocess.CalledProcessError) as e:
+            print(f'build_frame_renderer: {e}')
+            return False
+    print(f'{output}: {os.path.getsize(output)} bytes')
+    return True
+
+if __name__ == '__main__':
+    os.chdir(os.path.dirname(os.path.abspath(__file__)))
+    sys.exit(0 if build(sys.argv[1] if len(sys.argv) > 1 else OUTPUT) else 1)
@@ -0,0 +1,54 @@
+// Host side of generate_ephemeris_table.py: prints the ephemeris_data.h
+// header for a location and range of years.
+//
+// usage: generate_ephemeris_table <latitude> <longitude> <first year> <last year>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "datetime.h"
+#include "ephemeristable.h"
+
+int main(int argc, char** argv) {
+  if (argc != 5) {
+    fprintf(stderr,
+            "usage: %s <latitude> <longitude> <first year> <last year>\n",
+            argv[0]);
+    return 2;
+  }
+  double latitude = atof(argv[1]);
+  double longitude = atof(argv[2]);
+  int first_year = atoi(argv[3]);
+  int last_year = atoi(argv[4]);
+
+  int32_t first_day = DateTime::daysFromCivil(first_year, 1, 1);
+  int32_t days = DateTime::daysFromCivil(last_year + 1, 1, 1) - first_day;
+  if (last_year < first_year || days > UINT16_MAX) {
+    fprintf(stderr, "invalid year range %d-%d\n", first_year, last_year);
+    return 2;
+  }
+
+  std::vector<EphemerisDay> entries;
+  EphemerisTable::generate(latitude, longitude, first_day, days, entries);
+
+  // Same rounding as SunMoonCache::makeKey()
+  printf("// Generated by generate_ephemeris_table.py, do not edit\n");
+  printf("// location %s %s, years %d-%d\n", argv[1], argv[2], first_year,
+         last_year);
+  printf("#ifndef EPHEMERIS_DATA_H\n#define EPHEMERIS_DATA_H\n\n");
+  printf("constexpr EphemerisDay EPHEMERIS_DAYS[] = {\n");
+  for (const EphemerisDay& day : entries) {
+    printf("    {%d, %d, %d, %d, %d, %d, %u},\n", day.sun_rise, day.sun_transit,
+           day.sun_set, day.moon_rise, day.moon_transit, day.moon_set,
+           day.moon_age);
+  }
+  printf("};\n\n");
+  printf("constexpr EphemerisTableData EPHEMERIS_TABLE_DATA = {\n");
+  printf("    %ld, %ld, %ld, %ld, EPHEMERIS_DAYS};\n\n",
+         lround(latitude * 1e6), lround(longitude * 1e6),
+         static_cast<long>(first_day), static_cast<long>(days));
+  printf("#endif  // EPHEMERIS_DATA_H\n");
+  return 0;
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+
+# Precomputes the daily sun and moon events of the display node's location into
+# lib/config/ephemeris_data.h, see lib/sunandmoon/ephemeristable.h. The table
+# is calculated by SunMoonCalc itself, built for the host.
+#
+# Configured per environment in platformio.ini:
+#   custom_ephemeris_location = <latitude>, <longitude>
+#   custom_ephemeris_years = <first year>-<last year>
+# Outside of PlatformIO:
+#   generate_ephemeris_table.py <latitude> <longitude> <first year> <last year>
+#
+# Without a host compiler the firmware falls back to calculating the events.
+
+import hashlib
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HEADER = 'lib/config/ephemeris_data.h'
+SOURCES = [
+    'generate_ephemeris_table.cpp',
+    'lib/sunandmoon/ephemeristable.cpp',
+    'lib/sunandmoon/ephemeristable.h',
+    'lib/datetime/datetime.h',
+    'lib/SunMoonCalc/SunMoonCalc.cpp',
+    'lib/SunMoonCalc/SunMoonCalc.h',
+]
+
+
+def inputs_hash(args):
+    digest = hashlib.sha1(' '.join(args).encode())
+    for source in SOURCES:
+        with open(source, 'rb') as f:
+            digest.update(f.read())
+    return digest.hexdigest()
+
+
+def generate_ephemeris_table(latitude, longitude, first_year, last_year):
+    args = [latitude, longitude, first_year, last_year]
+    stamp = f'// inputs {inputs_hash(args)}\n'
+
+    # Check current header to avoid unnecessary rebuilds
+    try:
+        with open(HEADER, 'r') as f:
+            if f.readline() == stamp:
+                return True
+    except FileNotFoundError:
+        pass
+
+    compiler = shutil.which('c++') or shutil.which('g++') or shutil.which('clang++')
+    if compiler is None:
+        print('generate_ephemeris_table: no host compiler, sun/moon events will be calculated')
+        return False
+
+    with tempfile.TemporaryDirectory() as tmp:
+        tool = os.path.join(tmp, 'generate_ephemeris_table')
+        # The Arduino mock from the native tests stands in for the framework
+        build = [compiler, '-std=c++11', '-O2', '-DUNIT_TEST', '-Itest/mocks',
+                 '-Ilib/datetime', '-Ilib/sunandmoon', '-Ilib/SunMoonCalc', '-o', tool,
+                 'generate_ephemeris_table.cpp', 'lib/sunandmoon/ephemeristable.cpp',
+                 'lib/SunMoonCalc/SunMoonCalc.cpp']
+        try:
+            subprocess.check_call(build)
+            table = subprocess.check_output([tool] + args).decode()
+        except (OSError, subprocess.CalledProcessError) as e:
+            print(f'generate_ephemeris_table: {e}, sun/moon events will be calculated')
+            return False
+
+    with open(HEADER, 'w') as f:
+        f.write(stamp + table)
+    return True
+
+
+def configure(env):
+    location = env.GetProjectOption('custom_ephemeris_location', '')
+    years = env.GetProjectOption('custom_ephemeris_years', '')
+    if not location or not years:
+        return
+    latitude, longitude = [part.strip() for part in location.split(',')]
+    first_year, last_year = [part.strip() for part in years.split('-')]
+    if generate_ephemeris_table(latitude, longitude, first_year, last_year):
+        env.Append(CPPDEFINES=['EPHEMERIS_TABLE'])
+
+
+try:
+    Import('env')
+except NameError:
+    env = None
+
+if env is not None:
+    configure(env)
+elif len(sys.argv) != 5:
+    sys.exit(f'usage: {sys.argv[0]} <latitude> <longitude> <first year> <last year>')
+elif not generate_ephemeris_table(*sys.argv[1:]):
+    sys.exit(1)
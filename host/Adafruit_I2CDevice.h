@@ -0,0 +1,5 @@
+// Adafruit_GFX.h includes BusIO for the displays it drives itself, the frame
+// renderer only draws into memory
+#ifndef HOST_ADAFRUIT_I2CDEVICE_H
+#define HOST_ADAFRUIT_I2CDEVICE_H
+#endif  // HOST_ADAFRUIT_I2CDEVICE_H
@@ -0,0 +1,24 @@
+// Arduino core for the frame renderer, see build_frame_renderer.py
+//
+// The native test core, plus what Adafruit_GFX and U8g2_for_Adafruit_GFX take
+// from the ESP32 core.
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../test/mocks/Arduino.h"
+
+// Flash is ordinary memory on the host
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const unsigned char*)(addr))
+#define pgm_read_word(addr) (*(const unsigned short*)(addr))
+#define pgm_read_dword(addr) (*(const unsigned long*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+
+class __FlashStringHelper;
+
+#include "Print.h"
+
+#endif  // HOST_ARDUINO_H
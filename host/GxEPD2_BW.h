@@ -0,0 +1,168 @@
+// GxEPD2 panel driver for the frame renderer, see build_frame_renderer.py
+//
+// Drawing goes through the real Adafruit_GFX and U8g2_for_Adafruit_GFX. In
+// place of the panel, GxEPD2_BW keeps the whole frame in memory for
+// render_frame.cpp to encode, with the real driver's windows: the partial
+// window is widened to whole bytes and bounds both fillScreen() and drawing.
+#ifndef HOST_GXEPD2_BW_H
+#define HOST_GXEPD2_BW_H
+
+#include <Adafruit_GFX.h>
+
+#include <algorithm>
+#include <vector>
+
+#define GxEPD_BLACK 0x0000
+#define GxEPD_WHITE 0xFFFF
+
+class GxEPD2_750_T7 {
+ public:
+  static const uint16_t WIDTH = 800;
+  static const uint16_t WIDTH_VISIBLE = WIDTH;
+  static const uint16_t HEIGHT = 480;
+
+  GxEPD2_750_T7(int16_t cs, int16_t dc, int16_t rst, int16_t busy) {}
+
+  void init(uint32_t serial_diag_bitrate = 0) {}
+  void hibernate() {}
+  void powerOff() {}
+  void setBusyCallback(void (*busyCallback)(const void*),
+                       const void* busy_callback_parameter = 0) {}
+};
+
+template <typename GxEPD2_Type, uint16_t page_height>
+class GxEPD2_BW : public Adafruit_GFX {
+ public:
+  GxEPD2_Type epd2;
+
+  GxEPD2_BW(GxEPD2_Type epd2_instance)
+      : Adafruit_GFX(GxEPD2_Type::WIDTH_VISIBLE, GxEPD2_Type::HEIGHT),
+        epd2(epd2_instance),
+        frame_((GxEPD2_Type::WIDTH_VISIBLE + 7) / 8 * GxEPD2_Type::HEIGHT, 0) {
+    setFullWindow();
+    lastInstance() = this;
+  }
+
+  ~GxEPD2_BW() {
+    if (lastInstance() == this) {
+      lastInstance() = nullptr;
+    }
+  }
+
+  // Most recently constructed display, for render_frame.cpp to reach the
+  // frame of the display owned by the view
+  static GxEPD2_BW*& lastInstance() {
+    static GxEPD2_BW* instance = nullptr;
+    return instance;
+  }
+
+  void init(uint32_t serial_diag_bitrate = 0) {
+    epd2.init(serial_diag_bitrate);
+  }
+  void init(uint32_t serial_diag_bitrate, bool initial,
+            uint16_t reset_duration = 10, bool pulldown_rst_mode = false) {
+    epd2.init(serial_diag_bitrate);
+  }
+
+  void setFullWindow() {
+    pw_x_ = 0;
+    pw_y_ = 0;
+    pw_w_ = WIDTH;
+    pw_h_ = HEIGHT;
+  }
+
+  void setPartialWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    pw_x_ = std::min<uint16_t>(x, width());
+    pw_y_ = std::min<uint16_t>(y, height());
+    pw_w_ = std::min<uint16_t>(w, width() - pw_x_);
+    pw_h_ = std::min<uint16_t>(h, height() - pw_y_);
+    rotate(pw_x_, pw_y_, pw_w_, pw_h_);
+    pw_w_ += pw_x_ % 8;
+    if (pw_w_ % 8 > 0) {
+      pw_w_ += 8 - pw_w_ % 8;
+    }
+    pw_x_ -= pw_x_ % 8;
+  }
+
+  // The whole frame fits in one page
+  void firstPage() { fillScreen(GxEPD_WHITE); }
+  bool nextPage() { return false; }
+
+  void hibernate() { epd2.hibernate(); }
+  void powerOff() { epd2.powerOff(); }
+
+  // Fills the current window only, as the real driver fills its buffer
+  void fillScreen(uint16_t color) override {
+    for (uint16_t y = pw_y_; y < pw_y_ + pw_h_; y++) {
+      for (uint16_t x = pw_x_; x < pw_x_ + pw_w_; x++) {
+        setBit(x, y, color);
+      }
+    }
+  }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    if (x < 0 || x >= width() || y < 0 || y >= height()) {
+      return;
+    }
+    switch (getRotation()) {
+      case 1:
+        std::swap(x, y);
+        x = WIDTH - x - 1;
+        break;
+      case 2:
+        x = WIDTH - x - 1;
+        y = HEIGHT - y - 1;
+        break;
+      case 3:
+        std::swap(x, y);
+        y = HEIGHT - y - 1;
+        break;
+    }
+    if (x < pw_x_ || x >= pw_x_ + pw_w_ || y < pw_y_ || y >= pw_y_ + pw_h_) {
+      return;
+    }
+    setBit(x, y, color);
+  }
+
+  // The frame in panel orientation, 1 bit per pixel with bit set = black,
+  // rows padded to whole bytes
+  const std::vector<uint8_t>& getFrameBuffer() const { return frame_; }
+
+ private:
+  uint16_t pw_x_;
+  uint16_t pw_y_;
+  uint16_t pw_w_;
+  uint16_t pw_h_;
+  std::vector<uint8_t> frame_;
+
+  void setBit(uint16_t x, uint16_t y, uint16_t color) {
+    uint8_t& byte = frame_[y * ((WIDTH + 7) / 8) + x / 8];
+    uint8_t bit = 0x80 >> (x & 7);
+    if (color == GxEPD_WHITE) {
+      byte &= ~bit;
+    } else {
+      byte |= bit;
+    }
+  }
+
+  void rotate(uint16_t& x, uint16_t& y, uint16_t& w, uint16_t& h) {
+    switch (getRotation()) {
+      case 1:
+        std::swap(x, y);
+        std::swap(w, h);
+        x = WIDTH - x - w;
+        break;
+      case 2:
+        x = WIDTH - x - w;
+        y = HEIGHT - y - h;
+        break;
+      case 3:
+        std::swap(x, y);
+        std::swap(w, h);
+        y = HEIGHT - y - h;
+        break;
+    }
+  }
+};
+
+#endif  // HOST_GXEPD2_BW_H
@@ -0,0 +1,7 @@
+// File system for the frame renderer, that of the native tests
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "../test/mocks/LittleFS.h"
+
+#endif  // HOST_LITTLEFS_H
@@ -0,0 +1,116 @@
+// Print for the frame renderer's Arduino core
+//
+// Formats into write(), which Adafruit_GFX and U8g2_for_Adafruit_GFX
+// implement to draw the text.
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "Arduino.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print {
+ public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (written < size && write(buffer[written]) == 1) {
+      written++;
+    }
+    return written;
+  }
+  size_t write(const char* str) {
+    if (str == nullptr) {
+      return 0;
+    }
+    return write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+  }
+  size_t write(const char* buffer, size_t size) {
+    return write(reinterpret_cast<const uint8_t*>(buffer), size);
+  }
+
+  __attribute__((format(printf, 2, 3))) size_t printf(const char* format,
+                                                      ...) {
+    char buffer[64];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) {
+      return 0;
+    }
+    if (static_cast<size_t>(length) < sizeof(buffer)) {
+      return write(buffer, length);
+    }
+    std::vector<char> text(length + 1);
+    va_start(args, format);
+    vsnprintf(text.data(), text.size(), format, args);
+    va_end(args);
+    return write(text.data(), length);
+  }
+
+  size_t print(const __FlashStringHelper* str) {
+    return write(reinterpret_cast<const char*>(str));
+  }
+  size_t print(const String& str) { return write(str.c_str(), str.size()); }
+  size_t print(const char* str) { return write(str); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(unsigned char n, int base = DEC) {
+    return print(static_cast<unsigned long>(n), base);
+  }
+  size_t print(int n, int base = DEC) {
+    return print(static_cast<long>(n), base);
+  }
+  size_t print(unsigned int n, int base = DEC) {
+    return print(static_cast<unsigned long>(n), base);
+  }
+  size_t print(long n, int base = DEC) {
+    if (base == DEC && n < 0) {
+      return print('-') + printNumber(0UL - n, base);
+    }
+    return printNumber(n, base);
+  }
+  size_t print(unsigned long n, int base = DEC) {
+    return printNumber(n, base);
+  }
+  size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    return print(value) + println();
+  }
+  template <typename T>
+  size_t println(const T& value, int format) {
+    return print(value, format) + println();
+  }
+
+ private:
+  size_t printNumber(unsigned long n, int base) {
+    if (base < 2) {
+      base = DEC;
+    }
+    char digits[8 * sizeof(n) + 1];
+    char* digit = &digits[sizeof(digits) - 1];
+    *digit = '\0';
+    do {
+      unsigned long remainder = n % base;
+      n /= base;
+      *--digit = remainder < 10 ? '0' + remainder : 'A' + remainder - 10;
+    } while (n != 0);
+    return write(digit);
+  }
+};
+
+#endif  // HOST_PRINT_H
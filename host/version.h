@@ -0,0 +1,8 @@
+// Version for the frame renderer, that of the native tests: the lambda is
+// deployed on its own, apart from the firmware
+#ifndef HOST_VERSION_H
+#define HOST_VERSION_H
+
+#include "../test/mocks/version.h"
+
+#endif  // HOST_VERSION_H
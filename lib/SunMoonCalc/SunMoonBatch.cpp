@@ -0,0 +1,167 @@
+#include "SunMoonBatch.h"
+
+#include <math.h>
+
+/** Seconds in one day. */
+static const double SECONDS_PER_DAY = 86400;
+
+constexpr double SunMoonBatch::NODE_STEP;
+constexpr int SunMoonBatch::HALF_NODES;
+constexpr int SunMoonBatch::NODES;
+
+void SunMoonBatch::calculate(const time_t *instants, const size_t dates, const double *latitudes,
+                             const double *longitudes, const size_t locations, SunMoonTable &table) {
+  table.dates = dates;
+  table.locations = locations;
+  std::vector<time_t> *events[] = {&table.sunRise, &table.sunTransit, &table.sunSet,
+                                   &table.moonRise, &table.moonTransit, &table.moonSet};
+  for (std::vector<time_t> *event : events) {
+    event->assign(dates * locations, 0);
+  }
+  table.moonAge.assign(dates, 0);
+  table.moonPhase.assign(dates, 0);
+
+  Observers observers;
+  observers.lon.resize(locations);
+  observers.sinLat.resize(locations);
+  observers.cosLat.resize(locations);
+  for (size_t i = 0; i < locations; i++) {
+    observers.lon[i] = radians(longitudes[i]);
+    observers.sinLat[i] = sin(radians(latitudes[i]));
+    observers.cosLat[i] = cos(radians(latitudes[i]));
+  }
+
+  // Julian days of the events being refined, one array per event
+  std::vector<double> rise(locations), set(locations), transit(locations), step(locations);
+  Track track;
+
+  for (size_t d = 0; d < dates; d++) {
+    SunMoonCalc calc(instants[d], 0, 0);
+    const double jd = calc.jd_UT;
+    const SunMoonCalc::TWILIGHT twilight = calc.twilight;
+
+    // Positions at the instant, exactly as SunMoonCalc does for a single observer
+    const SunMoonCalc::EquatorialData sun = calc.toEquatorial(calc.getSunPosition());
+    const SunMoonCalc::EquatorialData moon = calc.toEquatorial(calc.getMoonPosition());
+    table.moonAge[d] = calc.moonAge;
+    table.moonPhase[d] = calc.calculateMoonPhase(calc.moonAge).index;
+
+    for (int body = 0; body < 2; body++) {
+      const bool isSun = body == 0;
+      const SunMoonCalc::EquatorialData &now = isSun ? sun : moon;
+      for (size_t i = 0; i < locations; i++) {
+        SunMoonCalc::EphemerisData out = SunMoonCalc::localEphemeris(now, jd, observers.lon[i], observers.sinLat[i],
+                                                                     observers.cosLat[i], twilight);
+        rise[i] = out.rise;
+        set[i] = out.set;
+        transit[i] = out.transit;
+      }
+
+      // Same number of iterations as SunMoonCalc::calculateSunAndMoonData()
+      const int iterations = isSun ? 3 : 5;
+      resetTrack(track, isSun, jd);
+      refine(calc, track, observers, SunMoonCalc::EVENT_RISE, iterations, rise.data(), step.data());
+      refine(calc, track, observers, SunMoonCalc::EVENT_SET, iterations, set.data(), step.data());
+      refine(calc, track, observers, SunMoonCalc::EVENT_TRANSIT, iterations, transit.data(), step.data());
+
+      std::vector<time_t> &riseOut = isSun ? table.sunRise : table.moonRise;
+      std::vector<time_t> &setOut = isSun ? table.sunSet : table.moonSet;
+      std::vector<time_t> &transitOut = isSun ? table.sunTransit : table.moonTransit;
+      for (size_t i = 0; i < locations; i++) {
+        riseOut[table.index(d, i)] = calc.fromJulian(rise[i]);
+        setOut[table.index(d, i)] = calc.fromJulian(set[i]);
+        transitOut[table.index(d, i)] = calc.fromJulian(transit[i]);
+      }
+    }
+  }
+}
+
+void SunMoonBatch::resetTrack(Track &track, const bool sun, const double jd) {
+  track.sun = sun;
+  track.start = jd - HALF_NODES * NODE_STEP;
+  for (int k = 0; k < NODES; k++) {
+    track.computed[k] = false;
+  }
+}
+
+SunMoonCalc::EquatorialData SunMoonBatch::position(SunMoonCalc &calc, const double jd, const bool sun) {
+  calc.setUTDate(jd);
+  // The Moon position depends on the Sun anomaly and longitude at the same time
+  SunMoonCalc::PositionalData position = calc.getSunPosition();
+  if (!sun) {
+    position = calc.getMoonPosition();
+  }
+  return calc.toEquatorial(position);
+}
+
+/**
+ * Four point Lagrange interpolation between the nodes around jd. Errors are well under a second of arc, the Moon's
+ * position being the least smooth.
+ */
+SunMoonCalc::EquatorialData SunMoonBatch::interpolate(SunMoonCalc &calc, Track &track, const double jd) {
+  double u = (jd - track.start) / NODE_STEP;
+  int k = (int) floor(u) - 1;
+  if (k < 0 || k + 3 >= NODES) {
+    return position(calc, jd, track.sun);
+  }
+  for (int n = k; n < k + 4; n++) {
+    if (!track.computed[n]) {
+      track.node[n] = position(calc, track.start + n * NODE_STEP, track.sun);
+      track.computed[n] = true;
+    }
+  }
+
+  // s is the offset from node k + 1, nodes being at -1, 0, 1 and 2
+  double s = u - (k + 1);
+  double w[4] = {
+          -s * (s - 1) * (s - 2) / 6,
+          (s + 1) * (s - 1) * (s - 2) / 2,
+          -(s + 1) * s * (s - 2) / 2,
+          (s + 1) * s * (s - 1) / 6};
+  SunMoonCalc::EquatorialData body = {0, 0, 0, 0};
+  for (int n = 0; n < 4; n++) {
+    const SunMoonCalc::EquatorialData &node = track.node[k + n];
+    body.x += w[n] * node.x;
+    body.y += w[n] * node.y;
+    body.z += w[n] * node.z;
+    body.angularRadius += w[n] * node.angularRadius;
+  }
+  return body;
+}
+
+/**
+ * Same iteration as SunMoonCalc::obtainAccurateRiseSetTransit(), for all observers at once. Each pass first
+ * gathers the body's position at every observer's current estimate, then runs the observer dependent part over
+ * the arrays.
+ */
+void SunMoonBatch::refine(SunMoonCalc &calc, Track &track, const Observers &observers, const SunMoonCalc::EVENT event,
+                          const int niter, double *jd, double *step) {
+  const size_t n = observers.lon.size();
+  std::vector<SunMoonCalc::EquatorialData> bodies(n);
+  for (size_t i = 0; i < n; i++) {
+    step[i] = -1;
+  }
+
+  for (int iter = 0; iter < niter; iter++) {
+    for (size_t i = 0; i < n; i++) {
+      if (jd[i] != -1) {
+        bodies[i] = interpolate(calc, track, jd[i]);
+      }
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (jd[i] == -1) continue; // -1 means no rise/set from that location
+      SunMoonCalc::EphemerisData out = SunMoonCalc::localEphemeris(bodies[i], jd[i], observers.lon[i],
+                                                                   observers.sinLat[i], observers.cosLat[i],
+                                                                   calc.twilight);
+      double next = event == SunMoonCalc::EVENT_RISE ? out.rise
+                  : event == SunMoonCalc::EVENT_SET ? out.set : out.transit;
+      step[i] = fabs(jd[i] - next);
+      jd[i] = next;
+    }
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    // did not converge => without rise/set/transit in this date
+    if (step[i] > 1.0 / SECONDS_PER_DAY) jd[i] = -1;
+  }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <stddef.h>
+#include <time.h>
+#include <vector>
+#include "SunMoonCalc.h"
+
+/**
+ * Rise, transit and set times for a set of dates and observers, as given by SunMoonBatch. Per observer values are
+ * indexed by index(date, location), per date values by date.
+ */
+typedef struct SunMoonTable {
+    size_t dates = 0;
+    size_t locations = 0;
+
+    std::vector<time_t> sunRise;
+    std::vector<time_t> sunTransit;
+    std::vector<time_t> sunSet;
+    std::vector<time_t> moonRise;
+    std::vector<time_t> moonTransit;
+    std::vector<time_t> moonSet;
+
+    // The Moon's age and phase do not depend on the observer
+    std::vector<double> moonAge;
+    std::vector<uint8_t> moonPhase;
+
+    size_t index(size_t date, size_t location) const { return date * locations + location; }
+} SunMoonTable;
+
+/**
+ * Computes the same events as SunMoonCalc::calculateSunAndMoonData() for many dates and observers at once.
+ *
+ * For each date the Sun and Moon positions are only calculated once and shared over all observers: at the
+ * requested instant exactly, and while refining rise/set/transit times by interpolating positions sampled every
+ * few hours around it. Only the observer dependent part (sidereal time, parallax, horizon) runs per location, in
+ * loops over arrays laid out one per quantity, which the compiler can vectorize where the math library allows.
+ *
+ * Times differ from those of SunMoonCalc by at most a second, the Moon's age and phase are identical.
+ */
+class SunMoonBatch {
+public:
+    /**
+     * @param instants UTC epoch instants, one per date
+     * @param latitudes observer latitudes in degrees
+     * @param longitudes observer longitudes in degrees, as many as latitudes
+     */
+    static void calculate(const time_t *instants, size_t dates, const double *latitudes, const double *longitudes,
+                          size_t locations, SunMoonTable &table);
+
+private:
+    /** Spacing of the interpolation nodes in days. */
+    static constexpr double NODE_STEP = 3.0 / 24.0;
+    /** Nodes either side of the instant, events further away than this are calculated directly. */
+    static constexpr int HALF_NODES = 12;
+    static constexpr int NODES = 2 * HALF_NODES + 1;
+
+    // Positions of one body around the instant of a date, calculated on first use
+    typedef struct Track {
+        bool sun;
+        double start;
+        bool computed[NODES];
+        SunMoonCalc::EquatorialData node[NODES];
+    } Track;
+
+    // Observers, one array per quantity
+    typedef struct Observers {
+        std::vector<double> lon;
+        std::vector<double> sinLat;
+        std::vector<double> cosLat;
+    } Observers;
+
+    static void resetTrack(Track &track, bool sun, double jd);
+    static SunMoonCalc::EquatorialData position(SunMoonCalc &calc, double jd, bool sun);
+    static SunMoonCalc::EquatorialData interpolate(SunMoonCalc &calc, Track &track, double jd);
+    static void refine(SunMoonCalc &calc, Track &track, const Observers &observers, SunMoonCalc::EVENT event,
+                       int niter, double *jd, double *step);
+};
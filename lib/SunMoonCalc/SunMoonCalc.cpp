@@ -27,6 +27,19 @@ This implementation is based on a Java class by T. Alonso Albi from OAN (Spain)
 
 #include "SunMoonCalc.h"
 
+#include <cmath>
+
+// Float overloads when Real is float
+using std::acos;
+using std::asin;
+using std::atan;
+using std::atan2;
+using std::cos;
+using std::fabs;
+using std::sin;
+using std::sqrt;
+using std::tan;
+
 /** Radians to hours. */
 const double RAD_TO_HOUR = 180.0 / (15.0 * PI);
 
@@ -77,6 +90,18 @@ const double LUNAR_CYCLE_DAYS = 29.530588853;
  */
 #define EPOCH_YR 1970            /* EPOCH = Jan 1 1970 00:00:00 */
 
+// Names indexed by MoonPhase::index, kept in flash rather than built as Strings
+constexpr const char* const MOON_PHASE_NAMES[] = {
+        "New Moon",
+        "Waxing Crescent",
+        "First Quarter",
+        "Waxing Gibbous",
+        "Full Moon",
+        "Waning Gibbous",
+        "Last/Third Quarter",
+        "Waning Crescent"
+};
+
 const int _ytab[2][12] = {
         {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31},
         {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}
@@ -126,9 +151,10 @@ time_t timegm(const struct tm *tm) {
  * @param lat latitude for the observer in degrees
  * @param lon longitude for the observer in degrees
  */
-SunMoonCalc::SunMoonCalc(const time_t timestamp, const double lat, const double lon) {
+template <typename Real>
+SunMoonCalcT<Real>::SunMoonCalcT(const time_t timestamp, const double lat, const double lon) {
   struct tm* tm = gmtime(&timestamp);
-  *this = SunMoonCalc(tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, lat, lon);
+  *this = SunMoonCalcT(tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, lat, lon);
 }
 
 /**
@@ -143,7 +169,8 @@ SunMoonCalc::SunMoonCalc(const time_t timestamp, const double lat, const double
  * @param lat latitude for the observer in degrees
  * @param lon longitude for the observer in degrees
  */
-SunMoonCalc::SunMoonCalc(const int16_t year, const uint8_t month, const uint8_t day, const uint8_t hour,
+template <typename Real>
+SunMoonCalcT<Real>::SunMoonCalcT(const int16_t year, const uint8_t month, const uint8_t day, const uint8_t hour,
                          const uint8_t minute, const uint8_t second, const double lat, const double lon) {
 
   setInternalTime(year, month, day, hour, minute, second);
@@ -151,7 +178,8 @@ SunMoonCalc::SunMoonCalc(const int16_t year, const uint8_t month, const uint8_t
   this->lon = radians(lon);
 }
 
-SunMoonCalc::Result SunMoonCalc::calculateSunAndMoonData(){
+template <typename Real>
+typename SunMoonCalcT<Real>::Result SunMoonCalcT<Real>::calculateSunAndMoonData(){
   double jd = this->jd_UT;
 
   Result result;
@@ -159,30 +187,28 @@ SunMoonCalc::Result SunMoonCalc::calculateSunAndMoonData(){
   Moon moon;
 
   // First the Sun
-  double *out = doCalc(getSunPosition());
-  sun.azimuth = out[0];
-  sun.elevation = out[1];
-  sun.riseJd = out[2];
-  sun.setJd = out[3];
-  sun.transitJd = out[4];
-  sun.transitElevation = out[5];
-  sun.distance = out[8];
-  double sa = this->sanomaly, sl = this->slongitude;
-
-  double sunRA = out[6], sunDec = out[7], lst = out[9];
+  EphemerisData out = doCalc(getSunPosition());
+  sun.azimuth = out.azimuth;
+  sun.elevation = out.elevation;
+  sun.riseJd = out.rise;
+  sun.setJd = out.set;
+  sun.transitJd = out.transit;
+  sun.transitElevation = out.transitElevation;
+  sun.distance = out.distance;
+  Real sa = this->sanomaly, sl = this->slongitude;
+
+  Real sunRA = out.ra, sunDec = out.dec, lst = out.lst;
 
   int iterations = 3; // Number of iterations to get accurate rise/set/transit times
-  sun.riseJd = obtainAccurateRiseSetTransit(sun.riseJd, 2, iterations, true);
-  sun.setJd = obtainAccurateRiseSetTransit(sun.setJd, 3, iterations, true);
-  sun.transitJd = obtainAccurateRiseSetTransit(sun.transitJd, 4, iterations, true);
+  sun.riseJd = obtainAccurateRiseSetTransit(sun.riseJd, EVENT_RISE, iterations, true);
+  sun.setJd = obtainAccurateRiseSetTransit(sun.setJd, EVENT_SET, iterations, true);
+  sun.transitJd = obtainAccurateRiseSetTransit(sun.transitJd, EVENT_TRANSIT, iterations, true);
   if (sun.transitJd == -1) {
     sun.transitElevation = 0;
   } else {
     // Update Sun's maximum elevation
     setUTDate(sun.transitJd);
-    delete[] out;
-    out = doCalc(getSunPosition());
-    sun.transitElevation = out[5];
+    sun.transitElevation = doCalc(getSunPosition()).transitElevation;
   }
 
   // Now Moon
@@ -191,48 +217,44 @@ SunMoonCalc::Result SunMoonCalc::calculateSunAndMoonData(){
   this->slongitude = sl;
 
   const PositionalData moonPosition = getMoonPosition();
-  double moonLat = moonPosition.latitude, moonLon = moonPosition.longitude;
-  delete[] out;
+  Real moonLat = moonPosition.latitude, moonLon = moonPosition.longitude;
   out = doCalc(moonPosition);
 
-  moon.azimuth = out[0];
-  moon.elevation = out[1];
-  moon.riseJd = out[2];
-  moon.setJd = out[3];
-  moon.transitJd = out[4];
-  moon.transitElevation = out[5];
-  moon.distance = out[8];
+  moon.azimuth = out.azimuth;
+  moon.elevation = out.elevation;
+  moon.riseJd = out.rise;
+  moon.setJd = out.set;
+  moon.transitJd = out.transit;
+  moon.transitElevation = out.transitElevation;
+  moon.distance = out.distance;
 
   moon.illumination = (1 - cos(this->moonAge / LUNAR_CYCLE_DAYS * 2 * PI)) / 2;
-  double moonRA = out[6], moonDec = out[7];
+  Real moonRA = out.ra, moonDec = out.dec;
 
-  double ma = this->moonAge;
+  Real ma = this->moonAge;
 
   iterations = 5; // Number of iterations to get accurate rise/set/transit times
-  moon.riseJd = obtainAccurateRiseSetTransit(moon.riseJd, 2, iterations, false);
-  moon.setJd = obtainAccurateRiseSetTransit(moon.setJd, 3, iterations, false);
-  moon.transitJd = obtainAccurateRiseSetTransit(moon.transitJd, 4, iterations, false);
+  moon.riseJd = obtainAccurateRiseSetTransit(moon.riseJd, EVENT_RISE, iterations, false);
+  moon.setJd = obtainAccurateRiseSetTransit(moon.setJd, EVENT_SET, iterations, false);
+  moon.transitJd = obtainAccurateRiseSetTransit(moon.transitJd, EVENT_TRANSIT, iterations, false);
   if (moon.transitJd == -1) {
     moon.transitElevation = 0;
   } else {
     // Update Moon's maximum elevation
     setUTDate(moon.transitJd);
     getSunPosition();
-    delete[] out;
-    out = doCalc(getMoonPosition());
-    moon.transitElevation = out[5];
+    moon.transitElevation = doCalc(getMoonPosition()).transitElevation;
   }
   setUTDate(jd);
   this->sanomaly = sa;
   this->slongitude = sl;
   this->moonAge = ma;
   
-  delete[] out;
-  out = getMoonDiskOrientationAngles(lst, sunRA, sunDec, radians(moonLon),radians(moonLat), moonRA, moonDec);
-  moon.axisPositionAngle = out[2];
-  moon.brightLimbAngle = out[3];
-  moon.parallacticAngle = out[4];
-  delete[] out;
+  const DiskOrientation disk =
+          getMoonDiskOrientationAngles(lst, sunRA, sunDec, radians(moonLon),radians(moonLat), moonRA, moonDec);
+  moon.axisPositionAngle = disk.axisPositionAngle;
+  moon.brightLimbAngle = disk.brightLimbAngle;
+  moon.parallacticAngle = disk.parallacticAngle;
   moon.age = ma;
   moon.phase = calculateMoonPhase(moon.age);
 
@@ -242,28 +264,37 @@ SunMoonCalc::Result SunMoonCalc::calculateSunAndMoonData(){
   return translateToHumanReadable(result);
 }
 
-SunMoonCalc::PositionalData SunMoonCalc::getSunPosition() {
+template <typename Real>
+double SunMoonCalcT<Real>::calculateMoonAge() {
+  // The Moon position depends on the Sun anomaly and longitude
+  getSunPosition();
+  getMoonPosition();
+  return this->moonAge;
+}
+
+template <typename Real>
+typename SunMoonCalcT<Real>::PositionalData SunMoonCalcT<Real>::getSunPosition() {
   PositionalData position;
 
   // SUN PARAMETERS (Formulae from "Calendrical Calculations")
   double lon = (280.46645 + 36000.76983 * this->t + .0003032 * this->t * this->t);
   double anom = (357.5291 + 35999.0503 * this->t - .0001559 * this->t * this->t -
                  4.8E-07 * this->t * this->t * this->t);
-  this->sanomaly = anom * DEG_TO_RAD;
-  double c = (1.9146 - .004817 * this->t - .000014 * this->t * this->t) * sin(this->sanomaly);
+  this->sanomaly = toReal(anom * DEG_TO_RAD);
+  Real c = (1.9146 - .004817 * this->t - .000014 * this->t * this->t) * sin(this->sanomaly);
   c = c + (.019993 - .000101 * this->t) * sin(2 * this->sanomaly);
-  c = c + .00029 * sin(3.0 * this->sanomaly); // Correction to the mean ecliptic longitude
+  c = c + .00029 * sin(3 * this->sanomaly); // Correction to the mean ecliptic longitude
 
   // Now, let calculate nutation and aberration
-  double M1 = (124.90 - 1934.134 * this->t + 0.002063 * this->t * this->t) * DEG_TO_RAD;
-  double M2 = (201.11 + 72001.5377 * this->t + 0.00057 * this->t * this->t) * DEG_TO_RAD;
-  double d = -.00569 - .0047785 * sin(M1) - .0003667 * sin(M2);
+  Real M1 = toReal((124.90 - 1934.134 * this->t + 0.002063 * this->t * this->t) * DEG_TO_RAD);
+  Real M2 = toReal((201.11 + 72001.5377 * this->t + 0.00057 * this->t * this->t) * DEG_TO_RAD);
+  Real d = -.00569 - .0047785 * sin(M1) - .0003667 * sin(M2);
 
-  this->slongitude = lon + c + d; // apparent longitude (error<0.003 deg)
-  double slatitude = 0; // Sun's ecliptic latitude is always negligible
-  double ecc = .016708617 - 4.2037E-05 * this->t - 1.236E-07 * this->t * this->t; // Eccentricity
-  double v = this->sanomaly + c * DEG_TO_RAD; // true anomaly
-  double sdistance = 1.000001018 * (1.0 - ecc * ecc) / (1.0 + ecc * cos(v)); // In UA
+  this->slongitude = toRealDegrees(lon + c + d); // apparent longitude (error<0.003 deg)
+  Real slatitude = 0; // Sun's ecliptic latitude is always negligible
+  Real ecc = .016708617 - 4.2037E-05 * this->t - 1.236E-07 * this->t * this->t; // Eccentricity
+  Real v = this->sanomaly + c * DEG_TO_RAD; // true anomaly
+  Real sdistance = 1.000001018 * (1.0 - ecc * ecc) / (1.0 + ecc * cos(v)); // In UA
 
   position.longitude = this->slongitude;
   position.latitude = slatitude;
@@ -273,25 +304,26 @@ SunMoonCalc::PositionalData SunMoonCalc::getSunPosition() {
   return position;
 }
 
-SunMoonCalc::PositionalData SunMoonCalc::getMoonPosition() {
+template <typename Real>
+typename SunMoonCalcT<Real>::PositionalData SunMoonCalcT<Real>::getMoonPosition() {
   PositionalData position;
 
   // MOON PARAMETERS (Formulae from "Calendrical Calculations")
-  double phase = normalizeRadians(
+  Real phase = normalizeRadians(toReal(
           (297.8502042 + 445267.1115168 * this->t - 0.00163 * this->t * this->t + this->t * this->t * this->t / 538841 -
-           this->t * this->t * this->t * this->t / 65194000) * DEG_TO_RAD);
+           this->t * this->t * this->t * this->t / 65194000) * DEG_TO_RAD));
 
   // Anomalistic phase
-  double anomaly = (134.9634114 + 477198.8676313 * this->t + .008997 * this->t * this->t +
-                    this->t * this->t * this->t / 69699 - this->t * this->t * this->t * this->t / 14712000);
-  anomaly = anomaly * DEG_TO_RAD;
+  Real anomaly = toReal((134.9634114 + 477198.8676313 * this->t + .008997 * this->t * this->t +
+                         this->t * this->t * this->t / 69699 - this->t * this->t * this->t * this->t / 14712000) *
+                        DEG_TO_RAD);
 
   // Degrees from ascending node
-  double node = (93.2720993 + 483202.0175273 * this->t - 0.0034029 * this->t * this->t -
-                 this->t * this->t * this->t / 3526000 + this->t * this->t * this->t * this->t / 863310000);
-  node = node * DEG_TO_RAD;
+  Real node = toReal((93.2720993 + 483202.0175273 * this->t - 0.0034029 * this->t * this->t -
+                      this->t * this->t * this->t / 3526000 + this->t * this->t * this->t * this->t / 863310000) *
+                     DEG_TO_RAD);
 
-  double E = 1.0 - (.002495 + 7.52E-06 * (this->t + 1.0)) * (this->t + 1.0);
+  Real E = 1.0 - (.002495 + 7.52E-06 * (this->t + 1.0)) * (this->t + 1.0);
 
   // Now longitude, with the three main correcting terms of evection,
   // variation, and equation of year, plus other terms (error<0.01 deg)
@@ -321,14 +353,14 @@ SunMoonCalc::PositionalData SunMoonCalc::getMoonPosition() {
   double longitude = l;
 
   // Let's add nutation here also
-  double M1 = (124.90 - 1934.134 * this->t + 0.002063 * this->t * this->t) * DEG_TO_RAD;
-  double M2 = (201.11 + 72001.5377 * this->t + 0.00057 * this->t * this->t) * DEG_TO_RAD;
-  double d = -.0047785 * sin(M1) - .0003667 * sin(M2);
+  Real M1 = toReal((124.90 - 1934.134 * this->t + 0.002063 * this->t * this->t) * DEG_TO_RAD);
+  Real M2 = toReal((201.11 + 72001.5377 * this->t + 0.00057 * this->t * this->t) * DEG_TO_RAD);
+  Real d = -.0047785 * sin(M1) - .0003667 * sin(M2);
   longitude += d;
 
   // Get accurate Moon age
   double Psin = LUNAR_CYCLE_DAYS;
-  this->moonAge = normalizeRadians((longitude - this->slongitude) * DEG_TO_RAD) * Psin / TWO_PI;
+  this->moonAge = normalizeRadians(toReal((longitude - this->slongitude) * DEG_TO_RAD)) * Psin / TWO_PI;
 
   // Now Moon parallax
   double parallax = .950724 + .051818 * cos(anomaly) + .009531 * cos(2 * phase - anomaly);
@@ -340,7 +372,7 @@ SunMoonCalc::PositionalData SunMoonCalc::getMoonPosition() {
   parallax += 1.73E-4 * cos(3 * anomaly) + 1.67E-4 * cos(4 * phase - anomaly);
 
   // So Moon distance in Earth radii is, more or less,
-  double distance = 1.0 / sin(parallax * DEG_TO_RAD);
+  Real distance = 1.0 / sin(Real(parallax * DEG_TO_RAD));
 
   // Ecliptic latitude with nodal phase (error<0.01 deg)
   l = 5.128189 * sin(node) + 0.280606 * sin(node + anomaly) + 0.277693 * sin(anomaly - node);
@@ -355,7 +387,7 @@ SunMoonCalc::PositionalData SunMoonCalc::getMoonPosition() {
   l += E * 2.072E-3 * sin(2 * phase - node - this->sanomaly - anomaly);
   double latitude = l;
 
-  position.longitude = longitude;
+  position.longitude = toRealDegrees(longitude);
   position.latitude = latitude;
   position.distance = distance * EARTH_RADIUS / AU;
   position.angularRadius = atan(1737.4 / (distance * EARTH_RADIUS));
@@ -363,21 +395,18 @@ SunMoonCalc::PositionalData SunMoonCalc::getMoonPosition() {
   return position;
 }
 
+template <typename Real>
+typename SunMoonCalcT<Real>::EphemerisData SunMoonCalcT<Real>::doCalc(PositionalData position) {
+  return localEphemeris(toEquatorial(position), this->jd_UT, this->lon, sin(this->lat), cos(this->lat), twilight);
+}
+
 /**
- * Returns a double array with 10 elements:
- * - azimuth
- * - elevation
- * - rise
- * - set
- * - transit
- * - transit elevation
- * - ra
- * - dec
- * - distance
- * - lst
+ * Converts ecliptic coordinates to geocentric rectangular equatorial ones. Only depends on the time, not on the
+ * observer.
  */
-double *SunMoonCalc::doCalc(PositionalData position) {
-  double* arr = new double[10];
+template <typename Real>
+typename SunMoonCalcT<Real>::EquatorialData SunMoonCalcT<Real>::toEquatorial(PositionalData position) const {
+  EquatorialData body;
 
   // Ecliptic to equatorial coordinates
   double t2 = this->t / 100.0;
@@ -385,49 +414,79 @@ double *SunMoonCalc::doCalc(PositionalData position) {
   tmp = t2 * (-249.67 + t2 * (-39.05 + t2 * (7.12 + tmp)));
   tmp = t2 * (-1.55 + t2 * (1999.25 + t2 * (-51.38 + tmp)));
   tmp = (t2 * (-4680.93 + tmp)) / 3600.0;
-  double angle = (23.4392911111111 + tmp) * DEG_TO_RAD; // obliquity
+  Real angle = (23.4392911111111 + tmp) * DEG_TO_RAD; // obliquity
 
   // Add nutation in obliquity
-  double M1 = (124.90 - 1934.134 * this->t + 0.002063 * this->t * this->t) * DEG_TO_RAD;
-  double M2 = (201.11 + 72001.5377 * this->t + 0.00057 * this->t * this->t) * DEG_TO_RAD;
-  double d = .002558 * cos(M1) - .00015339 * cos(M2);
+  Real M1 = toReal((124.90 - 1934.134 * this->t + 0.002063 * this->t * this->t) * DEG_TO_RAD);
+  Real M2 = toReal((201.11 + 72001.5377 * this->t + 0.00057 * this->t * this->t) * DEG_TO_RAD);
+  Real d = .002558 * cos(M1) - .00015339 * cos(M2);
   angle += d * DEG_TO_RAD;
 
   position.longitude *= DEG_TO_RAD;
   position.latitude *= DEG_TO_RAD;
-  double cl = cos(position.latitude);
-  double x = position.distance * cos(position.longitude) * cl;
-  double y = position.distance * sin(position.longitude) * cl;
-  double z = position.distance * sin(position.latitude);
-  tmp = y * cos(angle) - z * sin(angle);
+  Real cl = cos(position.latitude);
+  Real x = position.distance * cos(position.longitude) * cl;
+  Real y = position.distance * sin(position.longitude) * cl;
+  Real z = position.distance * sin(position.latitude);
+  Real yr = y * cos(angle) - z * sin(angle);
   z = y * sin(angle) + z * cos(angle);
-  y = tmp;
+  y = yr;
+
+  body.x = x;
+  body.y = y;
+  body.z = z;
+  body.angularRadius = position.angularRadius;
+
+  return body;
+}
+
+/**
+ * Returns the position and events of a body for an observer at jd, rise/set/transit being Julian
+ * days (-1 if there is none):
+ * - azimuth
+ * - elevation
+ * - rise
+ * - set
+ * - transit
+ * - transit elevation
+ * - ra
+ * - dec
+ * - distance
+ * - lst
+ */
+template <typename Real>
+typename SunMoonCalcT<Real>::EphemerisData SunMoonCalcT<Real>::localEphemeris(const EquatorialData &body,
+                                                                             const double jd, const Real lon,
+                                                                             const Real sinLat, const Real cosLat,
+                                                                             const TWILIGHT twilight) {
+  EphemerisData arr;
+  Real x = body.x, y = body.y, z = body.z, tmp;
 
   // Obtain local apparent sidereal time
-  double jd0 = floor(this->jd_UT - 0.5) + 0.5;
+  double jd0 = floor(jd - 0.5) + 0.5;
   double T0 = (jd0 - J2000) / JULIAN_DAYS_PER_CENTURY;
-  double secs = (this->jd_UT - jd0) * SECONDS_PER_DAY;
+  double secs = (jd - jd0) * SECONDS_PER_DAY;
   double gmst = (((((-6.2e-6 * T0) + 9.3104e-2) * T0) + 8640184.812866) * T0) + 24110.54841;
   double msday =
           1.0 + (((((-1.86e-5 * T0) + 0.186208) * T0) + 8640184.812866) / (SECONDS_PER_DAY * JULIAN_DAYS_PER_CENTURY));
   gmst = (gmst + msday * secs) * (15.0 / 3600.0) * DEG_TO_RAD;
-  double lst = gmst + this->lon;
+  Real lst = toReal(gmst) + lon;
 
   // Obtain topocentric rectangular coordinates
   // Set radiusAU = 0 for geocentric calculations
   // (rise/set/transit will have no sense in this case)
-  double radiusAU = EARTH_RADIUS / AU;
-  double correction[3] = {
-          radiusAU * cos(this->lat) * cos(lst),
-          radiusAU * cos(this->lat) * sin(lst),
-          radiusAU * sin(this->lat)};
-  double xtopo = x - correction[0];
-  double ytopo = y - correction[1];
-  double ztopo = z - correction[2];
+  Real radiusAU = EARTH_RADIUS / AU;
+  Real correction[3] = {
+          radiusAU * cosLat * cos(lst),
+          radiusAU * cosLat * sin(lst),
+          radiusAU * sinLat};
+  Real xtopo = x - correction[0];
+  Real ytopo = y - correction[1];
+  Real ztopo = z - correction[2];
 
   // Obtain topocentric equatorial coordinates
-  double ra = 0.0;
-  double dec = PI_OVER_TWO;
+  Real ra = 0.0;
+  Real dec = PI_OVER_TWO;
   if (ztopo < 0.0) {
     dec = -dec;
   }
@@ -435,85 +494,85 @@ double *SunMoonCalc::doCalc(PositionalData position) {
     ra = atan2(ytopo, xtopo);
     dec = atan2(ztopo / sqrt(xtopo * xtopo + ytopo * ytopo), 1.0);
   }
-  double dist = sqrt(xtopo * xtopo + ytopo * ytopo + ztopo * ztopo);
+  Real dist = sqrt(xtopo * xtopo + ytopo * ytopo + ztopo * ztopo);
 
   // Hour angle
-  double angh = lst - ra;
+  Real angh = lst - ra;
 
   // Obtain azimuth and geometric alt
-  double sinlat = sin(this->lat);
-  double coslat = cos(this->lat);
-  double sindec = sin(dec), cosdec = cos(dec);
-  double h = sinlat * sindec + coslat * cosdec * cos(angh);
-  double alt = asin(h);
-  double azy = sin(angh);
-  double azx = cos(angh) * sinlat - sindec * coslat / cosdec;
-  double azi = PI + atan2(azy, azx); // 0 = north
+  Real sinlat = sinLat;
+  Real coslat = cosLat;
+  Real sindec = sin(dec), cosdec = cos(dec);
+  Real h = sinlat * sindec + coslat * cosdec * cos(angh);
+  Real alt = asin(h);
+  Real azy = sin(angh);
+  Real azx = cos(angh) * sinlat - sindec * coslat / cosdec;
+  Real azi = PI + atan2(azy, azx); // 0 = north
 
   // Get apparent elevation
   if (alt > -3 * DEG_TO_RAD) {
-    double r = 0.016667 * DEG_TO_RAD * fabs(tan(PI_OVER_TWO - (alt * RAD_TO_DEG +  7.31 / (alt * RAD_TO_DEG + 4.4)) * DEG_TO_RAD));
-    double refr = r * ( 0.28 * 1010 / (10 + 273.0)); // Assuming pressure of 1010 mb and T = 10 C
+    Real r = 0.016667 * DEG_TO_RAD * fabs(tan(Real(PI_OVER_TWO - (alt * RAD_TO_DEG +  7.31 / (alt * RAD_TO_DEG + 4.4)) * DEG_TO_RAD)));
+    Real refr = r * ( 0.28 * 1010 / (10 + 273.0)); // Assuming pressure of 1010 mb and T = 10 C
     alt = fmin(alt + refr, PI_OVER_TWO); // This is not accurate, but acceptable
   }
 
-  tmp = calculateTwilightAdjustment(position);
+  tmp = calculateTwilightAdjustment(twilight, body.angularRadius);
 
   // Compute cosine of hour angle
-  tmp = (sin(tmp) - sin(this->lat) * sin(dec)) / (cos(this->lat) * cos(dec));
+  tmp = (sin(tmp) - sinLat * sin(dec)) / (cosLat * cos(dec));
   double celestialHoursToEarthTime = RAD_TO_DAY / SIDEREAL_DAY_LENGTH;
 
   // Make calculations for the meridian
-  double transit_time1 = celestialHoursToEarthTime * normalizeRadians(ra - lst);
-  double transit_time2 = celestialHoursToEarthTime * (normalizeRadians(ra - lst) - TWO_PI);
-  double transit_alt = asin(sin(dec) * sin(this->lat) + cos(dec) * cos(this->lat));
+  Real transit_time1 = celestialHoursToEarthTime * normalizeRadians(ra - lst);
+  Real transit_time2 = celestialHoursToEarthTime * (normalizeRadians(ra - lst) - TWO_PI);
+  Real transit_alt = asin(sin(dec) * sinLat + cos(dec) * cosLat);
   if (transit_alt > -3 * DEG_TO_RAD) {
-    double r = 0.016667 * DEG_TO_RAD * fabs(tan(PI_OVER_TWO - (transit_alt * RAD_TO_DEG +  7.31 / (transit_alt * RAD_TO_DEG + 4.4)) * DEG_TO_RAD));
-    double refr = r * ( 0.28 * 1010 / (10 + 273.0)); // Assuming pressure of 1010 mb and T = 10 C
+    Real r = 0.016667 * DEG_TO_RAD * fabs(tan(Real(PI_OVER_TWO - (transit_alt * RAD_TO_DEG +  7.31 / (transit_alt * RAD_TO_DEG + 4.4)) * DEG_TO_RAD)));
+    Real refr = r * ( 0.28 * 1010 / (10 + 273.0)); // Assuming pressure of 1010 mb and T = 10 C
     transit_alt = fmin(transit_alt + refr, PI_OVER_TWO); // This is not accurate, but acceptable
   }
 
   // Obtain the current event in time
-  double transit_time = transit_time1;
-  double jdToday = floor(this->jd_UT - 0.5) + 0.5;
-  double transitToday2 = floor(this->jd_UT + transit_time2 - 0.5) + 0.5;
+  Real transit_time = transit_time1;
+  double jdToday = floor(jd - 0.5) + 0.5;
+  double transitToday2 = floor(jd + transit_time2 - 0.5) + 0.5;
   // Obtain the transit time. Preference should be given to the closest event
   // in time to the current calculation time
   if (jdToday == transitToday2 && fabs(transit_time2) < fabs(transit_time1)) transit_time = transit_time2;
-  double transit = this->jd_UT + transit_time;
+  double transit = jd + transit_time;
 
   // Make calculations for rise and set
   double rise = -1, set = -1;
   if (fabs(tmp) <= 1.0) {
-    double ang_hor = fabs(acos(tmp));
-    double rise_time1 = celestialHoursToEarthTime * normalizeRadians(ra - ang_hor - lst);
-    double set_time1 = celestialHoursToEarthTime * normalizeRadians(ra + ang_hor - lst);
-    double rise_time2 = celestialHoursToEarthTime * (normalizeRadians(ra - ang_hor - lst) - TWO_PI);
-    double set_time2 = celestialHoursToEarthTime * (normalizeRadians(ra + ang_hor - lst) - TWO_PI);
+    Real ang_hor = fabs(acos(tmp));
+    Real rise_time1 = celestialHoursToEarthTime * normalizeRadians(ra - ang_hor - lst);
+    Real set_time1 = celestialHoursToEarthTime * normalizeRadians(ra + ang_hor - lst);
+    Real rise_time2 = celestialHoursToEarthTime * (normalizeRadians(ra - ang_hor - lst) - TWO_PI);
+    Real set_time2 = celestialHoursToEarthTime * (normalizeRadians(ra + ang_hor - lst) - TWO_PI);
 
     // Obtain the current events in time. Preference should be given to the closest event
     // in time to the current calculation time (so that iteration in other method will converge)
-    double rise_time = rise_time1;
-    double riseToday2 = floor(this->jd_UT + rise_time2 - 0.5) + 0.5;
+    Real rise_time = rise_time1;
+    double riseToday2 = floor(jd + rise_time2 - 0.5) + 0.5;
     if (jdToday == riseToday2 && fabs(rise_time2) < fabs(rise_time1)) rise_time = rise_time2;
 
-    double set_time = set_time1;
-    double setToday2 = floor(this->jd_UT + set_time2 - 0.5) + 0.5;
+    Real set_time = set_time1;
+    double setToday2 = floor(jd + set_time2 - 0.5) + 0.5;
     if (jdToday == setToday2 && fabs(set_time2) < fabs(set_time1)) set_time = set_time2;
-    rise = this->jd_UT + rise_time;
-    set = this->jd_UT + set_time;
+    rise = jd + rise_time;
+    set = jd + set_time;
   }
 
-  arr[0] = azi;
-  arr[1] = alt;
-  arr[2] = rise;
-  arr[3] = set;
-  arr[4] = transit;
-  arr[5] = transit_alt;
-  arr[6] = ra;
-  arr[7] = dec;
-  arr[8] = dist;
-  arr[9] = lst;
+  arr.azimuth = azi;
+  arr.elevation = alt;
+  arr.rise = rise;
+  arr.set = set;
+  arr.transit = transit;
+  arr.transitElevation = transit_alt;
+  arr.ra = ra;
+  arr.dec = dec;
+  arr.distance = dist;
+  arr.lst = lst;
 
   return arr;
 }
@@ -521,7 +580,8 @@ double *SunMoonCalc::doCalc(PositionalData position) {
 /**
  * Initializes the internal time variables t and jd_UT from the UTC timestamp given.
  */
-void SunMoonCalc::setInternalTime(const int16_t year, const uint8_t month, const uint8_t day, const uint8_t hour,
+template <typename Real>
+void SunMoonCalcT<Real>::setInternalTime(const int16_t year, const uint8_t month, const uint8_t day, const uint8_t hour,
                                   const uint8_t minute, const uint8_t second) {
     
   double jd = toJulian(year, month, day, hour, minute, second);
@@ -547,20 +607,22 @@ void SunMoonCalc::setInternalTime(const int16_t year, const uint8_t month, const
   setUTDate(jd);
 }
 
-void SunMoonCalc::setUTDate(const double jd) {
+template <typename Real>
+void SunMoonCalcT<Real>::setUTDate(const double jd) {
   this->jd_UT = jd;
   this->t = (jd + this->TTminusUT / SECONDS_PER_DAY - J2000) / JULIAN_DAYS_PER_CENTURY;
 }
 
-double SunMoonCalc::calculateTwilightAdjustment(PositionalData position) const {
-  double adjustment = 0.0;
+template <typename Real>
+Real SunMoonCalcT<Real>::calculateTwilightAdjustment(const TWILIGHT twilight, const Real angularRadius) {
+  Real adjustment = 0.0;
   switch (twilight) {
     case HORIZON_34arcmin:
       // Rise, set, transit times, taking into account Sun/Moon angular radius (position[3]).
       // The 34' factor is the standard refraction at horizon.
       // Removing angular radius will do calculations for the center of the disk instead
       // of the upper limb.
-      adjustment = -(34.0 / 60.0) * DEG_TO_RAD - position.angularRadius;
+      adjustment = -(34.0 / 60.0) * DEG_TO_RAD - angularRadius;
       break;
     case TWILIGHT_CIVIL:
       adjustment = -6 * DEG_TO_RAD;
@@ -575,112 +637,114 @@ double SunMoonCalc::calculateTwilightAdjustment(PositionalData position) const {
   return adjustment;
 }
 
-double SunMoonCalc::obtainAccurateRiseSetTransit(double riseSetJd, const int index, const int niter, const bool sun) {
+template <typename Real>
+double SunMoonCalcT<Real>::obtainAccurateRiseSetTransit(double riseSetJd, const EVENT event, const int niter, const bool sun) {
   double step = -1;
   for (int i = 0; i < niter; i++) {
     if (riseSetJd == -1) return riseSetJd; // -1 means no rise/set from that location
     setUTDate(riseSetJd);
-    double *out = nullptr;
+    EphemerisData out;
     if (sun) {
       out = doCalc(getSunPosition());
     } else {
       getSunPosition();
       out = doCalc(getMoonPosition());
     }
-    step = fabs(riseSetJd - out[index]);
-    riseSetJd = out[index];
-    delete[] out;
+    double next = event == EVENT_RISE ? out.rise : event == EVENT_SET ? out.set : out.transit;
+    step = fabs(riseSetJd - next);
+    riseSetJd = next;
   }
   if (step > 1.0 / SECONDS_PER_DAY) return -1; // did not converge => without rise/set/transit in this date
   return riseSetJd;
 }
 
 /**
- * Returns double array with 5 elements:
+ * Returns the orientation of the Moon's disk:
  * - optical librations (lp)
  * - lunar coordinates of the centre of the disk (bp)
  * - position angle of axis (p)
  * - bright limb angle (bl)
  * - paralactic angle (par)}
  */
-double *SunMoonCalc::getMoonDiskOrientationAngles(double lst, double sunRA, double sunDec, double moonLon,
-                                                  double moonLat, double moonRA, double moonDec) {
+template <typename Real>
+typename SunMoonCalcT<Real>::DiskOrientation SunMoonCalcT<Real>::getMoonDiskOrientationAngles(Real lst, Real sunRA,
+                                                                                             Real sunDec, Real moonLon,
+                                                                                             Real moonLat, Real moonRA,
+                                                                                             Real moonDec) {
 
-  double* arr = new double[5];
+  DiskOrientation arr;
   
   // Moon's argument of latitude
-  double F = radians(93.2720993 + 483202.0175273 * this->t - 0.0034029 * this->t * this->t -
-                       this->t * this->t * this->t / 3526000.0 + this->t * this->t * this->t * this->t / 863310000.0);
+  Real F = toReal(radians(93.2720993 + 483202.0175273 * this->t - 0.0034029 * this->t * this->t -
+                       this->t * this->t * this->t / 3526000.0 + this->t * this->t * this->t * this->t / 863310000.0));
   // Moon's inclination
-  double I = radians(1.54242);
+  Real I = radians(1.54242);
   // Moon's mean ascending node longitude
-  double omega = radians(125.0445550 - 1934.1361849 * this->t + 0.0020762 * this->t * this->t +
-                           this->t * this->t * this->t / 467410.0 - this->t * this->t * this->t * this->t / 18999000.0);
+  Real omega = toReal(radians(125.0445550 - 1934.1361849 * this->t + 0.0020762 * this->t * this->t +
+                           this->t * this->t * this->t / 467410.0 - this->t * this->t * this->t * this->t / 18999000.0));
   // Obliquity of ecliptic (approx, better formulae up)
-  double eps = radians(23.43929);
+  Real eps = radians(23.43929);
 
   // Obtain optical librations lp and bp
-  double W = moonLon - omega;
-  double sinA = sin(W) * cos(moonLat) * cos(I) - sin(moonLat) * sin(I);
-  double cosA = cos(W) * cos(moonLat);
-  double A = atan2(sinA, cosA);
-  double lp = normalizeRadians(A - F);
-  double sinbp = - sin(W) * cos(moonLat) * sin(I) - sin(moonLat) * cos(I);
-  double bp = asin(sinbp);
+  Real W = moonLon - omega;
+  Real sinA = sin(W) * cos(moonLat) * cos(I) - sin(moonLat) * sin(I);
+  Real cosA = cos(W) * cos(moonLat);
+  Real A = atan2(sinA, cosA);
+  Real lp = normalizeRadians(A - F);
+  Real sinbp = - sin(W) * cos(moonLat) * sin(I) - sin(moonLat) * cos(I);
+  Real bp = asin(sinbp);
 
   // Obtain position angle of axis p
-  double x = sin(I) * sin(omega);
-  double y = sin(I) * cos(omega) * cos(eps) - cos(I) * sin(eps);
-  double w = atan2(x, y);
-  double sinp = sqrt(x*x + y*y) * cos(moonRA - w) / cos(bp);
-  double p = asin(sinp);
+  Real x = sin(I) * sin(omega);
+  Real y = sin(I) * cos(omega) * cos(eps) - cos(I) * sin(eps);
+  Real w = atan2(x, y);
+  Real sinp = sqrt(x*x + y*y) * cos(moonRA - w) / cos(bp);
+  Real p = asin(sinp);
 
   // Compute bright limb angle bl
-  double bl = (PI + atan2(cos(sunDec) * sin(moonRA - sunRA),
+  Real bl = (PI + atan2(cos(sunDec) * sin(moonRA - sunRA),
                           cos(sunDec) * sin(moonDec) * cos(moonRA - sunRA)
                           - sin(sunDec) * cos(moonDec)));
 
   // Paralactic angle par
   y = sin(lst - moonRA);
   x = tan(this->lat) * cos(moonDec) - sin(moonDec) * cos(lst - moonRA);
-  double par = x != 0 ? atan2(y, x) : (y / fabs(y)) * PI / 2;
+  Real par = x != 0 ? atan2(y, x) : (y / fabs(y)) * PI / 2;
 
-  arr[0] = lp;
-  arr[1] = bp;
-  arr[2] = p;
-  arr[3] = bl;
-  arr[4] = par;
+  arr.opticalLibrationLongitude = lp;
+  arr.opticalLibrationLatitude = bp;
+  arr.axisPositionAngle = p;
+  arr.brightLimbAngle = bl;
+  arr.parallacticAngle = par;
 
   return arr;
 }
 
-SunMoonCalc::MoonPhase SunMoonCalc::calculateMoonPhase(double lunarAge) const {
-  MoonPhase moonPhase = SunMoonCalc::MoonPhase();
+template <typename Real>
+typename SunMoonCalcT<Real>::MoonPhase SunMoonCalcT<Real>::calculateMoonPhase(double lunarAge) const {
+  MoonPhase moonPhase = {0, ""};
+  int index = -1;
   if (lunarAge >= 0 && lunarAge <= LUNAR_CYCLE_DAYS
       && (lunarAge < 1 || lunarAge > LUNAR_CYCLE_DAYS - 1)) {
-    moonPhase.index = 0;
-    moonPhase.name = "New Moon";
+    index = 0;
   } else if (lunarAge >= 1 && lunarAge < 6.4) {
-    moonPhase.index = 1;
-    moonPhase.name = "Waxing Crescent";
+    index = 1;
   } else if (lunarAge >= 6.4 && lunarAge < 8.4) {
-    moonPhase.index = 2;
-    moonPhase.name = "First Quarter";
+    index = 2;
   } else if (lunarAge >= 8.4 && lunarAge < 13.8) {
-    moonPhase.index = 3;
-    moonPhase.name = "Waxing Gibbous";
+    index = 3;
   } else if (lunarAge >= 13.8 && lunarAge < 15.8) {
-    moonPhase.index = 4;
-    moonPhase.name = "Full Moon";
+    index = 4;
   } else if (lunarAge >= 15.8 && lunarAge < 21.1) {
-    moonPhase.index = 5;
-    moonPhase.name = "Waning Gibbous";
+    index = 5;
   } else if (lunarAge >= 21.1 && lunarAge < 23.1) {
-    moonPhase.index = 6;
-    moonPhase.name = "Last/Third Quarter";
+    index = 6;
   } else if (lunarAge >= 23.1 && lunarAge <= LUNAR_CYCLE_DAYS - 1) {
-    moonPhase.index = 7;
-    moonPhase.name = "Waning Crescent";
+    index = 7;
+  }
+  if (index >= 0) {
+    moonPhase.index = index;
+    moonPhase.name = MOON_PHASE_NAMES[index];
   }
   return moonPhase;
 }
@@ -688,7 +752,8 @@ SunMoonCalc::MoonPhase SunMoonCalc::calculateMoonPhase(double lunarAge) const {
 /**
  * Reduces an angle in radians to the range (0 - 2 Pi).
  */
-double SunMoonCalc::normalizeRadians(double r) {
+template <typename Real>
+Real SunMoonCalcT<Real>::normalizeRadians(Real r) {
   if (r < 0 && r >= -TWO_PI) return r + TWO_PI;
   if (r >= TWO_PI && r < FOUR_PI) return r - TWO_PI;
   if (r >= 0 && r < TWO_PI) return r;
@@ -699,10 +764,41 @@ double SunMoonCalc::normalizeRadians(double r) {
   return r;
 }
 
+/**
+ * Converts an angle in radians to Real. Nothing to do for double.
+ */
+template <typename Real>
+Real SunMoonCalcT<Real>::toReal(const double r) {
+  return r;
+}
+
+/**
+ * As a float, angles of thousands of radians such as the Moon's mean anomaly lose whole seconds of arc, so they are
+ * reduced to (0 - 2 Pi) in double first.
+ */
+template <>
+float SunMoonCalcT<float>::toReal(const double r) {
+  return r - TWO_PI * floor(r * TWO_PI_INVERSE);
+}
+
+/**
+ * Converts an angle in degrees to Real, reducing it to (0 - 360) first for float.
+ */
+template <typename Real>
+Real SunMoonCalcT<Real>::toRealDegrees(const double degrees) {
+  return degrees;
+}
+
+template <>
+float SunMoonCalcT<float>::toRealDegrees(const double degrees) {
+  return degrees - 360.0 * floor(degrees / 360.0);
+}
+
 /**
  * Transforms a Julian day (rise/set/transit fields) to a common date in UTC.
  */
-time_t SunMoonCalc::fromJulian(double julianDays) const {
+template <typename Real>
+time_t SunMoonCalcT<Real>::fromJulian(double julianDays) const {
   struct tm tm{};
 
   // The conversion formulas are from Meeus, chapter 7.
@@ -740,7 +836,8 @@ time_t SunMoonCalc::fromJulian(double julianDays) const {
   return timegm(&tm);
 }
 
-double SunMoonCalc::toJulian(const int16_t year, const uint8_t month, const uint8_t day, const uint8_t hour,
+template <typename Real>
+double SunMoonCalcT<Real>::toJulian(const int16_t year, const uint8_t month, const uint8_t day, const uint8_t hour,
                              const uint8_t minute, const uint8_t second) const {
   // The conversion formulas are from Meeus, chapter 7.
   bool julian = false;
@@ -765,7 +862,8 @@ double SunMoonCalc::toJulian(const int16_t year, const uint8_t month, const uint
  * Converts the data in the struct to human readable units (km instead of astronomical units, degree instead of
  * radians, epoch instant instead of Julian Days).
  */
-SunMoonCalc::Result SunMoonCalc::translateToHumanReadable(SunMoonCalc::Result result) const {
+template <typename Real>
+typename SunMoonCalcT<Real>::Result SunMoonCalcT<Real>::translateToHumanReadable(Result result) const {
   result.sun.rise = fromJulian(result.sun.riseJd);
   result.sun.transit = fromJulian(result.sun.transitJd);
   result.sun.set = fromJulian(result.sun.setJd);
@@ -782,3 +880,6 @@ SunMoonCalc::Result SunMoonCalc::translateToHumanReadable(SunMoonCalc::Result re
   result.moon.set = fromJulian(result.moon.setJd);
   return result;
 }
+
+template class SunMoonCalcT<float>;
+template class SunMoonCalcT<double>;
@@ -25,7 +25,13 @@ SOFTWARE.
 #include <Arduino.h>
 #include <time.h>
 
-class SunMoonCalc {
+/**
+ * Real is the type used for angles, distances and the trigonometry on them. Julian days and other time values stay
+ * double as a float cannot resolve a Julian day to better than a quarter of a day, and results are returned as double
+ * either way. See SunMoonCalc below for choosing it at build time.
+ */
+template <typename Real>
+class SunMoonCalcT {
 public:
     typedef struct Sun {
         double azimuth;
@@ -42,7 +48,7 @@ public:
 
     typedef struct MoonPhase {
         uint8_t index;
-        String name;
+        const char* name; // points into a static table, never freed
     } MoonPhase;
 
     typedef struct Moon {
@@ -69,13 +75,23 @@ public:
         Moon moon;
     } Result;
 
-    SunMoonCalc(time_t timestamp, double lat, double lon);
-    SunMoonCalc(int16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second, double lat,
-                double lon);
+    SunMoonCalcT(time_t timestamp, double lat, double lon);
+    SunMoonCalcT(int16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second, double lat,
+                 double lon);
 
     Result calculateSunAndMoonData();
 
+    /**
+     * Moon age in days at the instant given to the constructor, without the
+     * rise/set/transit iterations done by calculateSunAndMoonData().
+     */
+    double calculateMoonAge();
+    MoonPhase calculateMoonPhase(double lunarAge) const;
+
 private:
+    // Shares the time dependent terms over many observers
+    friend class SunMoonBatch;
+
     enum TWILIGHT {
         /**
          * Event ID for calculation of rising and setting times for astronomical
@@ -106,34 +122,85 @@ private:
     };
 
     typedef struct PositionalData {
-        double longitude;
-        double latitude;
-        double distance;
-        double angularRadius;
+        Real longitude;
+        Real latitude;
+        Real distance;
+        Real angularRadius;
     } PositionalData;
 
+    // Geocentric rectangular equatorial coordinates in AU
+    typedef struct EquatorialData {
+        Real x;
+        Real y;
+        Real z;
+        Real angularRadius;
+    } EquatorialData;
+
+    // Output of doCalc(), rise/set/transit as Julian days (-1 if none)
+    typedef struct EphemerisData {
+        Real azimuth;
+        Real elevation;
+        double rise;
+        double set;
+        double transit;
+        Real transitElevation;
+        Real ra;
+        Real dec;
+        Real distance;
+        Real lst;
+    } EphemerisData;
+
+    typedef struct DiskOrientation {
+        Real opticalLibrationLongitude; // lp
+        Real opticalLibrationLatitude; // bp
+        Real axisPositionAngle; // p
+        Real brightLimbAngle; // bl
+        Real parallacticAngle; // par
+    } DiskOrientation;
+
+    enum EVENT {
+        EVENT_RISE,
+        EVENT_SET,
+        EVENT_TRANSIT
+    };
+
     double t;
     double jd_UT;
     double TTminusUT;
-    double lat; // internal value is in radians!
-    double lon; // internal value is in radians!
-    double slongitude; // sun longitude
-    double sanomaly; // sun anomaly
-    double moonAge; // this is calculated as a by-product in getMoonPosition()
+    Real lat; // internal value is in radians!
+    Real lon; // internal value is in radians!
+    Real slongitude; // sun longitude
+    Real sanomaly; // sun anomaly
+    Real moonAge; // this is calculated as a by-product in getMoonPosition()
     TWILIGHT twilight = HORIZON_34arcmin;
 
     void setInternalTime(int16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
     void setUTDate(double jd);
     PositionalData getSunPosition();
     PositionalData getMoonPosition();
-    double *doCalc(PositionalData position);
-    double normalizeRadians(double r);
-    double calculateTwilightAdjustment(PositionalData position) const;
-    double obtainAccurateRiseSetTransit(double riseSetJd, int index, int niter, bool sun);
-    double *getMoonDiskOrientationAngles(double lst, double sunRA, double sunDec, double moonLon, double moonLat,
-                                         double moonRA, double moonDec);
-    SunMoonCalc::MoonPhase calculateMoonPhase(double lunarAge) const;
+    EphemerisData doCalc(PositionalData position);
+    EquatorialData toEquatorial(PositionalData position) const;
+    static EphemerisData localEphemeris(const EquatorialData &body, double jd, Real lon, Real sinLat, Real cosLat,
+                                        TWILIGHT twilight);
+    static Real normalizeRadians(Real r);
+    static Real toReal(double r);
+    static Real toRealDegrees(double degrees);
+    static Real calculateTwilightAdjustment(TWILIGHT twilight, Real angularRadius);
+    double obtainAccurateRiseSetTransit(double riseSetJd, EVENT event, int niter, bool sun);
+    DiskOrientation getMoonDiskOrientationAngles(Real lst, Real sunRA, Real sunDec, Real moonLon, Real moonLat,
+                                                 Real moonRA, Real moonDec);
     Result translateToHumanReadable(Result result) const;
     time_t fromJulian(double julianDays) const;
     double toJulian(int16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second) const;
 };
+
+/**
+ * The ESP32 FPU only handles single precision, double arithmetic and trigonometry run in software. Building with
+ * -D SUN_MOON_CALC_FLOAT runs the trigonometry in float. test_sun_moon_calc checks that rise/set/transit times stay
+ * within the minute the display shows of the double version, they are in practice within a second.
+ */
+#ifdef SUN_MOON_CALC_FLOAT
+typedef SunMoonCalcT<float> SunMoonCalc;
+#else
+typedef SunMoonCalcT<double> SunMoonCalc;
+#endif
@@ -0,0 +1,116 @@
+#include "jsonarena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "logging.h"
+
+const size_t JsonArena::SIZE;
+const size_t JsonArena::ALIGNMENT;
+const size_t JsonArena::HEADER_SIZE;
+const size_t JsonArena::NO_BLOCK;
+
+JsonArena* JsonArena::instance() {
+  // Never freed, the block stays put for the life of the program
+  static JsonArena* arena = new JsonArena(SIZE);
+  return arena;
+}
+
+JsonArena::JsonArena(size_t size)
+    : block_(static_cast<uint8_t*>(malloc(size))),
+      size_(block_ != nullptr ? size : 0),
+      used_(0),
+      last_(NO_BLOCK),
+      live_(0),
+      high_water_(0),
+      heap_allocations_(0) {}
+
+JsonArena::~JsonArena() { free(block_); }
+
+bool JsonArena::contains(const void* pointer) const {
+  const uint8_t* byte = static_cast<const uint8_t*>(pointer);
+  return block_ != nullptr && byte >= block_ && byte < block_ + size_;
+}
+
+size_t& JsonArena::sizeOf(void* pointer) {
+  return *reinterpret_cast<size_t*>(static_cast<uint8_t*>(pointer) -
+                                    HEADER_SIZE);
+}
+
+void* JsonArena::allocate(size_t size) {
+  size_t needed = HEADER_SIZE + (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  if (needed > size_ - used_) {
+    heap_allocations_++;
+    return malloc(size);
+  }
+  last_ = used_;
+  used_ += needed;
+  if (used_ > high_water_) {
+    high_water_ = used_;
+  }
+  live_++;
+  void* pointer = block_ + last_ + HEADER_SIZE;
+  sizeOf(pointer) = size;
+  return pointer;
+}
+
+void JsonArena::deallocate(void* pointer) {
+  if (!contains(pointer)) {
+    free(pointer);
+    return;
+  }
+  live_--;
+  // Only the last allocation gives its room back before the reset
+  if (block_ + last_ + HEADER_SIZE == pointer) {
+    used_ = last_;
+    last_ = NO_BLOCK;
+  }
+}
+
+void* JsonArena::reallocate(void* pointer, size_t new_size) {
+  if (pointer == nullptr) {
+    return allocate(new_size);
+  }
+  if (!contains(pointer)) {
+    return realloc(pointer, new_size);
+  }
+  size_t old_size = sizeOf(pointer);
+  if (block_ + last_ + HEADER_SIZE == pointer) {
+    size_t needed =
+        HEADER_SIZE + (new_size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    if (needed <= size_ - last_) {
+      used_ = last_ + needed;
+      if (used_ > high_water_) {
+        high_water_ = used_;
+      }
+      sizeOf(pointer) = new_size;
+      return pointer;
+    }
+  } else if (new_size <= old_size) {
+    sizeOf(pointer) = new_size;
+    return pointer;
+  }
+  void* moved = allocate(new_size);
+  if (moved != nullptr) {
+    memcpy(moved, pointer, old_size < new_size ? old_size : new_size);
+    deallocate(pointer);
+  }
+  return moved;
+}
+
+bool JsonArena::reset() {
+  LOG_DEBUG("JSON arena: %u of %u bytes used at most, %u allocations on "
+            "the heap",
+            (unsigned)high_water_, (unsigned)size_,
+            (unsigned)heap_allocations_);
+  if (live_ > 0) {
+    LOG_WARN("JSON arena: %u allocations still alive, not reset",
+             (unsigned)live_);
+    return false;
+  }
+  used_ = 0;
+  last_ = NO_BLOCK;
+  high_water_ = 0;
+  heap_allocations_ = 0;
+  return true;
+}
@@ -0,0 +1,69 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ArduinoJson.h>
+
+/**
+ * ArduinoJson allocator for the documents that only live through a wake
+ * cycle: the server responses and the models compared against the last
+ * displayed one.
+ *
+ * Allocations are bumped off a block taken from the heap once and kept, and
+ * the whole of it is freed with reset() at the end of the cycle, so parsing
+ * leaves no holes in the heap however many light sleep cycles run. When the
+ * block is full, allocations go to the heap as usual.
+ */
+class JsonArena : public ArduinoJson::Allocator {
+ public:
+  static const size_t SIZE = 32 * 1024;
+  static const size_t ALIGNMENT = 8;
+
+  // The arena of the wake cycle
+  static JsonArena* instance();
+
+  explicit JsonArena(size_t size);
+  ~JsonArena();
+  JsonArena(const JsonArena&) = delete;
+  JsonArena& operator=(const JsonArena&) = delete;
+
+  void* allocate(size_t size) override;
+  void deallocate(void* pointer) override;
+  void* reallocate(void* pointer, size_t new_size) override;
+
+  // Frees the whole arena, unless documents allocated from it are still
+  // alive, in which case it is left as it is and false is returned
+  bool reset();
+
+  size_t capacity() const { return size_; }
+  size_t used() const { return used_; }
+  // Most used since the last reset
+  size_t highWater() const { return high_water_; }
+  // Allocations from the arena not deallocated yet
+  size_t live() const { return live_; }
+  // Allocations that went to the heap since the last reset, the arena being
+  // full
+  size_t heapAllocations() const { return heap_allocations_; }
+
+ private:
+  // Each allocation is preceded by its size, so it can be moved on
+  // reallocation
+  static const size_t HEADER_SIZE = ALIGNMENT;
+  static const size_t NO_BLOCK = SIZE_MAX;
+
+  uint8_t* block_;
+  size_t size_;
+  size_t used_;
+  // Offset of the last allocation, which can grow or be undone in place
+  size_t last_;
+  size_t live_;
+  size_t high_water_;
+  size_t heap_allocations_;
+
+  bool contains(const void* pointer) const;
+  static size_t& sizeOf(void* pointer);
+};
+
+#endif  // JSON_ARENA_H
@@ -15,6 +15,8 @@
 #define HAS_DISPLAY
 #define LIGHT_SLEEP_ENABLED
 #define FORCE_DEEP_SLEEP
+// Light sleep while the e-paper panel is refreshing instead of busy waiting
+#define ASYNC_DISPLAY_REFRESH
 #define SLEEP_SECONDS 900
 // #define SLEEP_SECONDS 120
 #define HAS_BME680
@@ -22,24 +24,30 @@
 #define OTA_UPDATE_ENABLED
 #define DISPLAY_NODE_VERSIONS
 // #define DISPLAY_TIME
+// Show frames rendered by get-display (see build_frame_renderer.py) instead
+// of laying the screen out on the device
+// #define SERVER_RENDERED_FRAME
 #endif
 
 #ifdef OUTDOOR_NODE
 #define HAS_SHT31D
 #define HAS_BATTERY
 #define OTA_UPDATE_ENABLED
+#define OFFLINE_LOG_ENABLED
 #endif
 
 #ifdef SENSOR2_NODE
 #define HAS_SHT31D
 #define HAS_BATTERY
 #define OTA_UPDATE_ENABLED
+#define OFFLINE_LOG_ENABLED
 #endif
 
 #ifdef PROTOTYPE_NODE
 #define HAS_SHT31D
 #define HAS_BATTERY
 #define OTA_UPDATE_ENABLED
+#define OFFLINE_LOG_ENABLED
 #endif
 
 #ifdef DUMMY_NODE
@@ -2,7 +2,13 @@
 
 #include <LittleFS.h>
 
-Controller::Controller(Model& current) : current_(current) {
+#include "jsonarena.h"
+#include "logging.h"
+
+const char* Controller::dataFilePath = "/last-displayed.json";
+const char* Controller::etagFilePath = "/last-displayed.etag";
+
+Model* Controller::loadLastDisplayed() {
   Model* lastDisplayed = nullptr;
   LittleFS.begin(true);
   if (LittleFS.exists(dataFilePath)) {
@@ -12,67 +18,115 @@ Controller::Controller(Model& current) : current_(current) {
       while (file.available()) {
         json_str += (char)file.read();
       }
-      lastDisplayed = new Model(json_str);
+      // Only compared against or read from within the wake cycle
+      lastDisplayed = new Model(json_str, JsonArena::instance());
       if (!lastDisplayed->jsonLoadOK()) {
-        Serial.println("Failed to parse last displayed model from file");
+        LOG_ERROR("Failed to parse last displayed model from file");
       }
     }
   } else {
-    Serial.println("No last displayed model file found");
+    LOG_INFO("No last displayed model file found");
+  }
+  LittleFS.end();
+  return lastDisplayed;
+}
+
+bool Controller::restoreSunMoonCache(const Model* lastDisplayed) {
+  if (lastDisplayed == nullptr) {
+    return false;
+  }
+
+  SunMoonKey key;
+  SunMoonEvents events;
+  bool restored =
+      lastDisplayed->jsonLoadOK() && lastDisplayed->getEphemeris(key, events);
+  if (restored) {
+    SunMoonCache::store(key, events);
+    LOG_INFO("Sun/Moon cache restored for %04d-%02d-%02d", key.year, key.month,
+             key.day);
+  }
+  return restored;
+}
+
+std::string Controller::lastETag() {
+  std::string etag;
+  LittleFS.begin(true);
+  if (LittleFS.exists(etagFilePath)) {
+    File file = LittleFS.open(etagFilePath, "r");
+    while (file && file.available()) {
+      etag += (char)file.read();
+    }
+  }
+  LittleFS.end();
+  return etag;
+}
+
+void Controller::saveETag(const std::string& etag) {
+  LittleFS.begin(true);
+  if (etag.empty()) {
+    LittleFS.remove(etagFilePath);
+  } else {
+    File file = LittleFS.open(etagFilePath, "w");
+    if (file) {
+      file.print(etag.c_str());
+      file.close();
+    } else {
+      LOG_ERROR("Failed to open ETag file for writing");
+    }
   }
   LittleFS.end();
+}
 
+Controller::Controller(Model& current, const Model* lastDisplayed,
+                       bool deferWrite)
+    : current_(current) {
   if (lastDisplayed != nullptr) {
-    Serial.printf("Last displayed model: %s\n",
-                  lastDisplayed->toJsonString().c_str());
+    LOG_DUMP("Last displayed model", lastDisplayed->toJsonString().c_str());
     needRefresh_ = !lastDisplayed->jsonLoadOK() || !(*lastDisplayed == current_);
   } else {
-    Serial.println("No last displayed model, will refresh");
+    LOG_INFO("No last displayed model, will refresh");
     needRefresh_ = true;
   }
 
   if (needRefresh_) {
-    Serial.println(
-        "Current model differs from last displayed model, need refresh");
+    LOG_INFO("Current model differs from last displayed model, need refresh");
     // Only write if we refresh the screen - otherwise display and persisted
     // data may diverge without leading to a refresh
-    writeData();
+    if (!deferWrite) {
+      writeData();
+    }
   } else {
-    Serial.println(
+    LOG_INFO(
         "Current model matches last displayed model, no refresh needed");
   }
-
-  if (lastDisplayed != nullptr) {
-    delete lastDisplayed;
-  }
 }
 
 void Controller::writeData() {
   if (!needRefresh_) {
-    Serial.println("No refresh needed, skipping write");
+    LOG_DEBUG("No refresh needed, skipping write");
     return;
   }
-  Serial.printf("Writing current model to file: %s\n",
-                current_.toJsonString().c_str());
+  LOG_DUMP("Writing current model to file", current_.toJsonString().c_str());
 
   LittleFS.begin(true);
   File file = LittleFS.open(dataFilePath, "w");
   if (!file) {
-    Serial.println("Failed to open file for writing");
+    LOG_ERROR("Failed to open file for writing");
     LittleFS.end();
     return;
   }
   file.print(current_.toJsonString().c_str());
   file.close();
-  Serial.println("Current model written to file");
+  LOG_INFO("Current model written to file");
 
-  Serial.println("Files in /:");
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
   File root = LittleFS.open("/");
   File f = root.openNextFile();
   while (f) {
-    Serial.printf("  %s    %d bytes\n", f.name(), f.size());
+    LOG_DEBUG("File /%s: %u bytes", f.name(), static_cast<unsigned>(f.size()));
     f = root.openNextFile();
   }
+#endif
 
   LittleFS.end();
 }
@@ -4,13 +4,32 @@
 
 class Controller {
  public:
-  Controller(Model& current);
+  // Compares current against the last displayed snapshot from
+  // loadLastDisplayed(), null when there is none. With deferWrite the current
+  // model is only persisted when writeData() is called, e.g. while the display
+  // is busy refreshing.
+  Controller(Model& current, const Model* lastDisplayed,
+             bool deferWrite = false);
   bool needRefresh() const { return needRefresh_; }
+  void writeData();
+
+  // Reads the last displayed snapshot, null when there is none. The caller
+  // deletes it, within the wake cycle as it lives in the JSON arena.
+  static Model* loadLastDisplayed();
+
+  // Seeds the sun/moon cache from the last displayed snapshot, for when RTC
+  // memory was lost (power cycle, reset)
+  static bool restoreSunMoonCache(const Model* lastDisplayed);
+
+  // Content version (ETag) of the server response the last displayed snapshot
+  // was built from, empty when unknown. Sent back so the server can answer
+  // that nothing changed instead of sending the same data again.
+  static std::string lastETag();
+  static void saveETag(const std::string& etag);
 
  private:
-  const char* dataFilePath = "/last-displayed.json";
+  static const char* dataFilePath;
+  static const char* etagFilePath;
   Model& current_;
   bool needRefresh_ = true;
-
-  void writeData();
 };
@@ -1,12 +1,91 @@
 #include "datetime.h"
 
-#include <fmt/core.h>
-
 #include <ctime>
 #include <Arduino.h>
 
+namespace {
+
+const int32_t SECONDS_PER_DAY = 86400;
+
+// As strftime's %A and %B in the "C" locale the firmware runs with
+const char* const WEEKDAYS[] = {"Sunday",   "Monday", "Tuesday", "Wednesday",
+                                "Thursday", "Friday", "Saturday"};
+const char* const MONTHS[] = {"January",   "February", "March",    "April",
+                              "May",       "June",     "July",     "August",
+                              "September", "October",  "November", "December"};
+
+// Writers for the fast paths, p moves along the buffer
+void putTwoDigits(char*& p, int value) {
+  *p++ = '0' + value / 10;
+  *p++ = '0' + value % 10;
+}
+
+void putString(char*& p, const char* s) {
+  while (*s) *p++ = *s++;
+}
+
+void putNumber(char*& p, int value) {
+  char digits[12];
+  int n = 0;
+  unsigned int u = value < 0 ? -static_cast<unsigned int>(value) : value;
+  do {
+    digits[n++] = '0' + u % 10;
+    u /= 10;
+  } while (u > 0);
+  if (value < 0) *p++ = '-';
+  while (n > 0) *p++ = digits[--n];
+}
+
+// Reads 1 to max_digits digits like strptime does for numeric fields, false
+// when there are none or the value is out of [min, max]
+bool readNumber(const char*& p, int max_digits, int min, int max, int& value) {
+  int digits = 0;
+  value = 0;
+  while (digits < max_digits && *p >= '0' && *p <= '9') {
+    value = value * 10 + (*p++ - '0');
+    digits++;
+  }
+  return digits > 0 && value >= min && value <= max;
+}
+
+bool readChar(const char*& p, char c) {
+  if (*p != c) {
+    return false;
+  }
+  p++;
+  return true;
+}
+
+// "Z", "+HH:MM", "+HHMM" or "+HH". Anything else is ignored and taken as UTC,
+// as strptime did before offsets were parsed.
+int readUtcOffset(const char* p) {
+  if (*p == 'Z' || *p == 'z') {
+    return 0;
+  }
+  if (*p != '+' && *p != '-') {
+    return 0;
+  }
+  int sign = *p++ == '-' ? -1 : 1;
+  const char* start = p;
+  int hours;
+  int minutes = 0;
+  if (!readNumber(p, 2, 0, 23, hours) || p - start != 2) {
+    return 0;
+  }
+  readChar(p, ':');
+  start = p;
+  if (*p >= '0' && *p <= '9' &&
+      (!readNumber(p, 2, 0, 59, minutes) || p - start != 2)) {
+    return 0;
+  }
+  return sign * (hours * 3600 + minutes * 60);
+}
+
+}  // namespace
+
 DateTime::DateTime()
-    : timestamp_(""),
+    : epoch_(0),
+      utc_offset_seconds_(0),
       year_(0),
       month_(0),
       day_(0),
@@ -16,36 +95,154 @@ DateTime::DateTime()
   memset(&timeinfo, 0, sizeof(timeinfo));
 }
 
-DateTime::DateTime(std::string timestamp) {
+DateTime::DateTime(const char* timestamp) {
   memset(&timeinfo, 0, sizeof(timeinfo));
-  // NB: %z breaks day of week calculation and TZ offset is not parsed
-  if (strptime(timestamp.c_str(), "%Y-%m-%dT%H:%M:%S", &timeinfo)) {
-    timestamp_ = timestamp;
-    year_ = timeinfo.tm_year + 1900;
-    month_ = timeinfo.tm_mon + 1;
-    day_ = timeinfo.tm_mday;
-    hour_ = timeinfo.tm_hour;
-    minute_ = timeinfo.tm_min;
-    second_ = timeinfo.tm_sec;
-  } else {
+  if (!parse(timestamp)) {
     // Handle invalid timestamp format
     year_ = month_ = day_ = hour_ = minute_ = second_ = 0;
+    epoch_ = 0;
+    utc_offset_seconds_ = 0;
   }
 }
 
+DateTime::DateTime(time_t timestamp) : utc_offset_seconds_(0) {
+  memset(&timeinfo, 0, sizeof(timeinfo));
+  epoch_ = timestamp;
+  // Floored, for instants before 1970
+  time_t days = timestamp / SECONDS_PER_DAY;
+  int32_t seconds = timestamp % SECONDS_PER_DAY;
+  if (seconds < 0) {
+    days--;
+    seconds += SECONDS_PER_DAY;
+  }
+  civilFromDays(days, year_, month_, day_);
+  hour_ = seconds / 3600;
+  minute_ = seconds / 60 % 60;
+  second_ = seconds % 60;
+  setTimeinfo(days);
+}
+
+// Hand written in place of strptime("%Y-%m-%dT%H:%M:%S"), which is slow on
+// newlib and ignores the UTC offset. Accepts what strptime accepted for the
+// timestamps the server sends, without allocating.
+bool DateTime::parse(const char* timestamp) {
+  const char* p = timestamp;
+  if (!readNumber(p, 4, 0, 9999, year_) || !readChar(p, '-') ||
+      !readNumber(p, 2, 1, 12, month_) || !readChar(p, '-') ||
+      !readNumber(p, 2, 1, 31, day_) || !readChar(p, 'T') ||
+      !readNumber(p, 2, 0, 23, hour_) || !readChar(p, ':') ||
+      !readNumber(p, 2, 0, 59, minute_) || !readChar(p, ':') ||
+      !readNumber(p, 2, 0, 60, second_)) {
+    return false;
+  }
+  if (readChar(p, '.')) {
+    while (*p >= '0' && *p <= '9') p++;
+  }
+  utc_offset_seconds_ = readUtcOffset(p);
+
+  int32_t days = daysFromCivil(year_, month_, day_);
+  epoch_ = static_cast<time_t>(days) * SECONDS_PER_DAY + hour_ * 3600 +
+           minute_ * 60 + second_ - utc_offset_seconds_;
+
+  setTimeinfo(days);
+  return true;
+}
+
+// Fields used by strftime, with days as given by daysFromCivil()
+void DateTime::setTimeinfo(int32_t days) {
+  timeinfo.tm_year = year_ - 1900;
+  timeinfo.tm_mon = month_ - 1;
+  timeinfo.tm_mday = day_;
+  timeinfo.tm_hour = hour_;
+  timeinfo.tm_min = minute_;
+  timeinfo.tm_sec = second_;
+  timeinfo.tm_wday = ((days % 7) + 11) % 7;  // 1970-01-01 was a Thursday
+  timeinfo.tm_yday = days - daysFromCivil(year_, 1, 1);
+}
+
+// Inverse of daysFromCivil(), after Howard Hinnant's civil_from_days
+void DateTime::civilFromDays(int32_t days, int& year, int& month, int& day) {
+  days += 719468;
+  const int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const int32_t day_of_era = days - era * 146097;
+  const int32_t year_of_era = (day_of_era - day_of_era / 1460 +
+                               day_of_era / 36524 - day_of_era / 146096) /
+                              365;
+  const int32_t day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  const int32_t month_index = (5 * day_of_year + 2) / 153;
+  day = day_of_year - (153 * month_index + 2) / 5 + 1;
+  month = month_index < 10 ? month_index + 3 : month_index - 9;
+  year = year_of_era + era * 400 + (month <= 2);
+}
+
 bool DateTime::ok() { return year_ != 0; }
 
-std::string DateTime::niceDate() {
-  std::string weekday = safe_strftime("%A", &timeinfo);
-  std::string month = safe_strftime("%B", &timeinfo);
-  return fmt::format("{} {}{} {} {}", weekday, day_, dateSuffix(), month,
-                     year_);
+std::string DateTime::format(const char* fmt) const {
+  char buffer[FORMAT_SIZE];
+  if (format(buffer, sizeof(buffer), fmt) > 0 || *fmt == '\0') {
+    return buffer;
+  }
+  return safe_strftime(fmt, &timeinfo);
+}
+
+size_t DateTime::format(char* buffer, size_t size, const char* fmt) const {
+  if (size == 0) {
+    return 0;
+  }
+  // Fast paths for the times on the display and in the logs
+  char* p = buffer;
+  if (strcmp(fmt, "%H:%M") == 0 && size > 5) {
+    putTwoDigits(p, hour_);
+    *p++ = ':';
+    putTwoDigits(p, minute_);
+  } else if (strcmp(fmt, "%H:%M:%S") == 0 && size > 8) {
+    putTwoDigits(p, hour_);
+    *p++ = ':';
+    putTwoDigits(p, minute_);
+    *p++ = ':';
+    putTwoDigits(p, second_);
+  } else {
+    size_t length = std::strftime(buffer, size, fmt, &timeinfo);
+    if (length == 0) {
+      buffer[0] = '\0';
+    }
+    return length;
+  }
+  *p = '\0';
+  return p - buffer;
+}
+
+std::string DateTime::niceDate() const {
+  char buffer[NICE_DATE_SIZE];
+  niceDate(buffer, sizeof(buffer));
+  return buffer;
+}
+
+size_t DateTime::niceDate(char* buffer, size_t size) const {
+  if (size < NICE_DATE_SIZE) {
+    if (size > 0) buffer[0] = '\0';
+    return 0;
+  }
+  char* p = buffer;
+  // From timeinfo, zeroed for an invalid timestamp like strftime used
+  putString(p, WEEKDAYS[timeinfo.tm_wday]);
+  *p++ = ' ';
+  putNumber(p, day_);
+  putString(p, dateSuffix());
+  *p++ = ' ';
+  putString(p, MONTHS[timeinfo.tm_mon]);
+  *p++ = ' ';
+  putNumber(p, year_);
+  *p = '\0';
+  return p - buffer;
 }
 
 // From https://stackoverflow.com/a/58726549
 // Modified to not use make_unique as we don’t have it in this version of C++
-std::string DateTime::safe_strftime(const char* fmt, const tm* t) {
-  std::size_t len = 30;
+// Only used for formats longer than FORMAT_SIZE
+std::string DateTime::safe_strftime(const char* fmt, const tm* t) const {
+  std::size_t len = FORMAT_SIZE * 2;
   char* buff = new char[len];
   while (std::strftime(buff, len, fmt, t) == 0) {
     delete[] buff;
@@ -1,6 +1,7 @@
 #ifndef DATETIME_H
 #define DATETIME_H
 
+#include <stdint.h>
 #include <time.h>
 
 #include <cstring>
@@ -8,35 +9,57 @@
 
 class DateTime {
  public:
+  // Longest niceDate(), "Wednesday 30th September " and an int year, with
+  // the terminator
+  static const size_t NICE_DATE_SIZE = 40;
+  // Formats that fit in this many bytes are formatted on the stack
+  static const size_t FORMAT_SIZE = 64;
+
   DateTime();
-  DateTime(std::string timestamp);
-  DateTime(time_t timestamp) {
-    struct tm *tm_info = gmtime(&timestamp);
-    memcpy(&timeinfo, tm_info, sizeof(tm));
-    year_ = tm_info->tm_year + 1900;
-    month_ = tm_info->tm_mon + 1;
-    day_ = tm_info->tm_mday;
-    hour_ = tm_info->tm_hour;
-    minute_ = tm_info->tm_min;
-    second_ = tm_info->tm_sec;
-  }
+  // ISO-8601 date and time, "YYYY-MM-DDTHH:MM:SS" optionally followed by
+  // fractional seconds and a "Z" or "+HH:MM" UTC offset
+  DateTime(const char *timestamp);
+  DateTime(const std::string &timestamp) : DateTime(timestamp.c_str()) {}
+  DateTime(time_t timestamp);
   bool ok();
-  std::string format(const char *fmt) { return safe_strftime(fmt, &timeinfo); }
-  std::string niceDate();
+  std::string format(const char *fmt) const;
+  // Formats into buffer without allocating, returns the length written or 0
+  // when it does not fit. "%H:%M" and "%H:%M:%S" skip strftime.
+  size_t format(char *buffer, size_t size, const char *fmt) const;
+  // "Tuesday 21st October 2025"
+  std::string niceDate() const;
+  // Needs NICE_DATE_SIZE bytes, returns the length written or 0
+  size_t niceDate(char *buffer, size_t size) const;
   int year() const { return year_; }
   int month() const { return month_; }
   int day() const { return day_; }
   int hour() const { return hour_; }
   int minute() const { return minute_; }
   int second() const { return second_; }
+  // UTC epoch seconds, the fields above being at utcOffset() from UTC
+  time_t epoch() const { return epoch_; }
+  int utcOffset() const { return utc_offset_seconds_; }
   double diff(const DateTime &other) const {
-    return difftime(mktime(const_cast<tm *>(&timeinfo)),
-                    mktime(const_cast<tm *>(&other.timeinfo)));
+    return static_cast<double>(epoch_ - other.epoch_);
+  }
+
+  // Days since 1970-01-01 in the proleptic Gregorian calendar, after Howard
+  // Hinnant's days_from_civil
+  static int32_t daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    const int32_t era = (year >= 0 ? year : year - 399) / 400;
+    const int32_t year_of_era = year - era * 400;
+    const int32_t day_of_year =
+        (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int32_t day_of_era =
+        year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
   }
 
  private:
-  std::string timestamp_;
   struct tm timeinfo;
+  time_t epoch_;
+  int utc_offset_seconds_;
   int year_;
   int month_;
   int day_;
@@ -44,7 +67,10 @@ class DateTime {
   int minute_;
   int second_;
 
-  std::string safe_strftime(const char *fmt, const tm *t);
+  bool parse(const char *timestamp);
+  void setTimeinfo(int32_t days);
+  static void civilFromDays(int32_t days, int &year, int &month, int &day);
+  std::string safe_strftime(const char *fmt, const tm *t) const;
   const char *dateSuffix() const;
 };
 
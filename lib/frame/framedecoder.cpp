@@ -0,0 +1,181 @@
+#include "framedecoder.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+const uint8_t FRAME_MAGIC[] = {'W', 'F', 'R', '1'};
+// Longest literal or repeat run of a control byte
+const size_t MAX_RUN = 128;
+
+uint16_t readUint16(const uint8_t* data) { return data[0] | (data[1] << 8); }
+
+void writeUint16(std::vector<uint8_t>& out, uint16_t value) {
+  out.push_back(value & 0xFF);
+  out.push_back(value >> 8);
+}
+
+}  // namespace
+
+const size_t FrameDecoder::HEADER_SIZE;
+const uint16_t FrameDecoder::MAX_WIDTH;
+const uint16_t FrameDecoder::BAND_ROWS;
+
+void FrameDecoder::reset() {
+  header_used_ = 0;
+  stage_ = HEADER;
+  x_ = 0;
+  y_ = 0;
+  width_ = 0;
+  height_ = 0;
+  run_left_ = 0;
+  rows_done_ = 0;
+  band_used_ = 0;
+}
+
+bool FrameDecoder::startWindow() {
+  if (memcmp(header_, FRAME_MAGIC, sizeof(FRAME_MAGIC)) != 0) {
+    return false;
+  }
+  x_ = readUint16(header_ + 4);
+  y_ = readUint16(header_ + 6);
+  width_ = readUint16(header_ + 8);
+  height_ = readUint16(header_ + 10);
+  if (x_ % 8 != 0 || width_ % 8 != 0 || x_ + width_ > MAX_WIDTH) {
+    return false;
+  }
+  stage_ = width_ == 0 || height_ == 0 ? DONE : CONTROL;
+  return true;
+}
+
+// Appends count bytes to the band, copied from data or all value when data
+// is null, writing the band out whenever it fills up
+bool FrameDecoder::put(const uint8_t* data, uint8_t value, size_t count,
+                       const WriteBand& write) {
+  while (count > 0) {
+    if (rows_done_ == height_) {
+      // More pixels than the window holds
+      return false;
+    }
+    uint16_t rows = std::min<uint16_t>(BAND_ROWS, height_ - rows_done_);
+    size_t chunk = std::min(count, rows * rowBytes() - band_used_);
+    if (data != nullptr) {
+      memcpy(band_ + band_used_, data, chunk);
+      data += chunk;
+    } else {
+      memset(band_ + band_used_, value, chunk);
+    }
+    band_used_ += chunk;
+    count -= chunk;
+    if (band_used_ == rows * rowBytes()) {
+      if (!write(x_, y_ + rows_done_, width_, rows, band_)) {
+        return false;
+      }
+      rows_done_ += rows;
+      band_used_ = 0;
+    }
+  }
+  return true;
+}
+
+bool FrameDecoder::decode(const uint8_t* data, size_t size,
+                          const WriteBand& write) {
+  size_t i = 0;
+  while (i < size) {
+    switch (stage_) {
+      case HEADER: {
+        size_t chunk = std::min<size_t>(HEADER_SIZE - header_used_, size - i);
+        memcpy(header_ + header_used_, data + i, chunk);
+        header_used_ += chunk;
+        i += chunk;
+        if (header_used_ == HEADER_SIZE && !startWindow()) {
+          return false;
+        }
+        break;
+      }
+
+      case CONTROL: {
+        uint8_t control = data[i++];
+        if (control < MAX_RUN) {
+          run_left_ = control + 1;
+          stage_ = LITERALS;
+        } else if (control > MAX_RUN) {
+          run_left_ = 257 - control;
+          stage_ = REPEAT;
+        }
+        break;
+      }
+
+      case LITERALS: {
+        size_t chunk = std::min<size_t>(run_left_, size - i);
+        if (!put(data + i, 0, chunk, write)) {
+          return false;
+        }
+        i += chunk;
+        run_left_ -= chunk;
+        if (run_left_ == 0) {
+          stage_ = rows_done_ == height_ ? DONE : CONTROL;
+        }
+        break;
+      }
+
+      case REPEAT:
+        if (!put(nullptr, data[i++], run_left_, write)) {
+          return false;
+        }
+        run_left_ = 0;
+        stage_ = rows_done_ == height_ ? DONE : CONTROL;
+        break;
+
+      case DONE:
+        // Trailing data
+        return false;
+    }
+  }
+  return true;
+}
+
+void FrameDecoder::encode(const uint8_t* bits, size_t row_bytes, uint16_t x,
+                          uint16_t y, uint16_t width, uint16_t height,
+                          std::vector<uint8_t>& out) {
+  out.insert(out.end(), FRAME_MAGIC, FRAME_MAGIC + sizeof(FRAME_MAGIC));
+  writeUint16(out, x);
+  writeUint16(out, y);
+  writeUint16(out, width);
+  writeUint16(out, height);
+
+  // The window's bytes, row after row
+  std::vector<uint8_t> window;
+  window.reserve(width / 8 * height);
+  for (uint16_t row = 0; row < height; row++) {
+    const uint8_t* start = bits + (y + row) * row_bytes + x / 8;
+    window.insert(window.end(), start, start + width / 8);
+  }
+
+  size_t i = 0;
+  while (i < window.size()) {
+    size_t run = 1;
+    while (i + run < window.size() && run < MAX_RUN &&
+           window[i + run] == window[i]) {
+      run++;
+    }
+    if (run > 1) {
+      out.push_back(257 - run);
+      out.push_back(window[i]);
+      i += run;
+      continue;
+    }
+    // Literals up to the next run of three, shorter runs cost as much either
+    // way
+    size_t start = i;
+    while (i < window.size() && i - start < MAX_RUN &&
+           !(i + 2 < window.size() && window[i] == window[i + 1] &&
+             window[i] == window[i + 2])) {
+      i++;
+    }
+    out.push_back(i - start - 1);
+    out.insert(out.end(), window.begin() + start, window.begin() + i);
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+/**
+ * Streaming decoder for the panel frames rendered by the server, see
+ * render_frame.cpp.
+ *
+ * A frame is a header followed by the pixels of a window of the panel:
+ *
+ *   "WFR1", then x, y, width and height of the window as little endian
+ *   uint16, x and width multiples of 8
+ *   rows of width / 8 bytes, MSB first, bit set = black, PackBits coded:
+ *     control byte n < 128: n + 1 literal bytes follow
+ *     control byte n > 128: the next byte is repeated 257 - n times
+ *     control byte 128: nothing
+ *
+ * A window smaller than the panel is the part that changed since the frame
+ * the device showed last, an empty one means nothing did.
+ *
+ * Decoded rows are handed over in bands of up to BAND_ROWS rows, so a frame
+ * goes to the panel as it downloads without being held in RAM.
+ */
+class FrameDecoder {
+ public:
+  static const size_t HEADER_SIZE = 12;
+  static const uint16_t MAX_WIDTH = 800;
+  static const uint16_t BAND_ROWS = 16;
+
+  // Writes decoded rows of the window at (x, y), false on failure
+  typedef std::function<bool(uint16_t x, uint16_t y, uint16_t width,
+                             uint16_t rows, const uint8_t* bits)>
+      WriteBand;
+
+  void reset();
+  // Decodes the next size bytes of the frame. Returns false when the frame
+  // is corrupt, wider than MAX_WIDTH or a write failed.
+  bool decode(const uint8_t* data, size_t size, const WriteBand& write);
+
+  bool done() const { return stage_ == DONE; }
+  // Window of the frame, once the header was decoded
+  uint16_t x() const { return x_; }
+  uint16_t y() const { return y_; }
+  uint16_t width() const { return width_; }
+  uint16_t height() const { return height_; }
+
+  // Codes the window of a frame buffer laid out as above with row_bytes per
+  // row, appending the frame to out
+  static void encode(const uint8_t* bits, size_t row_bytes, uint16_t x,
+                     uint16_t y, uint16_t width, uint16_t height,
+                     std::vector<uint8_t>& out);
+
+ private:
+  enum Stage : uint8_t { HEADER, CONTROL, LITERALS, REPEAT, DONE };
+
+  uint8_t header_[HEADER_SIZE];
+  uint8_t header_used_;
+  Stage stage_;
+  uint16_t x_;
+  uint16_t y_;
+  uint16_t width_;
+  uint16_t height_;
+  // Bytes left in the current run
+  uint8_t run_left_;
+  // Rows written so far and bytes of the band being filled
+  uint16_t rows_done_;
+  size_t band_used_;
+  uint8_t band_[MAX_WIDTH / 8 * BAND_ROWS];
+
+  size_t rowBytes() const { return width_ / 8; }
+  bool startWindow();
+  bool put(const uint8_t* data, uint8_t value, size_t count,
+           const WriteBand& write);
+};
+
+#endif  // FRAME_DECODER_H
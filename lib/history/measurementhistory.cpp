@@ -0,0 +1,312 @@
+#include "measurementhistory.h"
+
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "trend.h"
+
+namespace {
+
+// Changes whenever the layout changes, so stale RTC contents from an older
+// firmware are ignored
+const uint32_t HISTORY_MAGIC = 0x48495302;
+
+int16_t quantize(float value) {
+  long tenths = lround(value * 10);
+  if (tenths > INT16_MAX) return INT16_MAX;
+  if (tenths < INT16_MIN) return INT16_MIN;
+  return static_cast<int16_t>(tenths);
+}
+
+struct Slot {
+  uint32_t key;  // 0 for a free slot
+  bool shown;
+  MeasurementSeries series;
+};
+
+struct HistoryStore {
+  uint32_t magic;
+  // Series shown that lost their slot, or never had one
+  uint8_t shown_missing;
+  char local_node[MeasurementHistory::MAX_NODE_NAME];
+  Slot slots[MeasurementHistory::MAX_SERIES];
+};
+
+RTC_DATA_ATTR HistoryStore rtc_history;
+
+HistoryStore& store() {
+  if (rtc_history.magic != HISTORY_MAGIC) {
+    rtc_history.magic = HISTORY_MAGIC;
+    rtc_history.shown_missing = 0;
+    rtc_history.local_node[0] = '\0';
+    for (Slot& slot : rtc_history.slots) {
+      slot.key = 0;
+      slot.shown = false;
+      slot.series.clear();
+    }
+  }
+  return rtc_history;
+}
+
+Slot* findSlot(uint32_t key) {
+  for (Slot& slot : store().slots) {
+    if (slot.key == key) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+const uint16_t MeasurementSeries::CAPACITY;
+const int32_t MeasurementSeries::WINDOW_SECONDS;
+const int32_t MeasurementSeries::MIN_INTERVAL_SECONDS;
+const uint16_t MeasurementSeries::MAX_GAP_MINUTES;
+const uint8_t MeasurementHistory::METRICS_PER_NODE;
+const uint8_t MeasurementHistory::MAX_SERIES;
+const int32_t MeasurementHistory::COVERAGE_SLACK_SECONDS;
+const uint8_t MeasurementHistory::MAX_NODE_NAME;
+const time_t MeasurementHistory::MIN_VALID_EPOCH;
+
+void MeasurementSeries::clear() {
+  newest_epoch_ = 0;
+  span_minutes_ = 0;
+  sum_ = 0;
+  first_ = last_ = min_ = max_ = 0;
+  head_ = 0;
+  count_ = 0;
+}
+
+bool MeasurementSeries::add(time_t when, float value) {
+  int16_t tenths = quantize(value);
+  if (count_ > 0) {
+    if (when < static_cast<time_t>(newest_epoch_) + MIN_INTERVAL_SECONDS) {
+      return false;
+    }
+    if ((when - static_cast<time_t>(newest_epoch_) + 30) / 60 >
+        MAX_GAP_MINUTES) {
+      clear();
+    }
+  }
+
+  if (count_ == 0) {
+    newest_epoch_ = when;
+    first_ = last_ = min_ = max_ = tenths;
+    sum_ = tenths;
+    count_ = 1;
+    return true;
+  }
+  if (count_ == CAPACITY) {
+    dropOldest();
+  }
+
+  int delta = tenths - last_;
+  if (delta > INT8_MAX) delta = INT8_MAX;
+  if (delta < INT8_MIN) delta = INT8_MIN;
+  uint32_t gap = (when - newest_epoch_ + 30) / 60;
+
+  uint16_t index = (head_ + count_) % CAPACITY;
+  delta_[index] = static_cast<int8_t>(delta);
+  gap_minutes_[index] = static_cast<uint8_t>(gap);
+  span_minutes_ += gap;
+  newest_epoch_ = when;
+  last_ += delta;
+  sum_ += last_;
+  if (last_ < min_) min_ = last_;
+  if (last_ > max_) max_ = last_;
+  count_++;
+
+  expire(when);
+  return true;
+}
+
+void MeasurementSeries::expire(time_t now) {
+  time_t start = now - WINDOW_SECONDS;
+  while (count_ > 0 && static_cast<time_t>(newest_epoch_) -
+                               static_cast<time_t>(span_minutes_) * 60 <
+                           start) {
+    dropOldest();
+  }
+}
+
+bool MeasurementSeries::stats(HistoryStats& stats) const {
+  if (count_ == 0) {
+    return false;
+  }
+  stats.count = count_;
+  stats.min = min_ / 10.0f;
+  stats.max = max_ / 10.0f;
+  stats.mean = sum_ / (10.0f * count_);
+  stats.oldest = newest_epoch_ - static_cast<time_t>(span_minutes_) * 60;
+  return true;
+}
+
+bool MeasurementSeries::trend(time_t now, uint8_t* points,
+                              uint8_t count) const {
+  if (count == 0 || count > Trend::POINTS) {
+    return false;
+  }
+  int32_t sums[Trend::POINTS] = {0};
+  uint8_t samples[Trend::POINTS] = {0};
+  time_t start = now - WINDOW_SECONDS;
+  time_t when = newest_epoch_ - static_cast<time_t>(span_minutes_) * 60;
+  int16_t value = first_;
+  for (uint16_t i = 0; i < count_; i++) {
+    if (i > 0) {
+      uint16_t index = (head_ + i) % CAPACITY;
+      when += gap_minutes_[index] * 60;
+      value += delta_[index];
+    }
+    if (when < start || when > now) {
+      continue;
+    }
+    int bucket = std::min<int>((when - start) * count / WINDOW_SECONDS,
+                               count - 1);
+    sums[bucket] += value;
+    samples[bucket]++;
+  }
+
+  float means[Trend::POINTS];
+  bool filled[Trend::POINTS];
+  for (uint8_t i = 0; i < count; i++) {
+    filled[i] = samples[i] > 0;
+    means[i] = filled[i] ? static_cast<float>(sums[i]) / samples[i] : 0;
+  }
+  return Trend::quantize(means, filled, count, points);
+}
+
+void MeasurementSeries::dropOldest() {
+  if (count_ <= 1) {
+    clear();
+    return;
+  }
+  int16_t dropped = first_;
+  uint16_t next = (head_ + 1) % CAPACITY;
+  first_ += delta_[next];
+  span_minutes_ -= gap_minutes_[next];
+  sum_ -= dropped;
+  head_ = next;
+  count_--;
+  if (dropped == min_ || dropped == max_) {
+    rescan();
+  }
+}
+
+void MeasurementSeries::rescan() {
+  int16_t value = first_;
+  min_ = max_ = value;
+  for (uint16_t i = 1; i < count_; i++) {
+    value += delta_[(head_ + i) % CAPACITY];
+    if (value < min_) min_ = value;
+    if (value > max_) max_ = value;
+  }
+}
+
+// FNV-1a over the three names, 0 being kept for free slots
+uint32_t MeasurementHistory::makeKey(const char* node, const char* device,
+                                     const char* metric) {
+  uint32_t hash = 2166136261u;
+  const char* parts[] = {node, device, metric};
+  for (const char* part : parts) {
+    for (const char* c = part; *c; c++) {
+      hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    hash = (hash ^ '/') * 16777619u;
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+bool MeasurementHistory::add(uint32_t key, time_t when, float value) {
+  HistoryStore& history = store();
+  Slot* slot = findSlot(key);
+  if (slot == nullptr) {
+    // A free slot, or else the one updated least recently
+    slot = &history.slots[0];
+    for (Slot& candidate : history.slots) {
+      if (candidate.key == 0) {
+        slot = &candidate;
+        break;
+      }
+      if (candidate.series.newest() < slot->series.newest()) {
+        slot = &candidate;
+      }
+    }
+    if (slot->shown) {
+      history.shown_missing++;
+    }
+    slot->key = key;
+    slot->shown = false;
+    slot->series.clear();
+  }
+
+  return slot->series.add(when, value);
+}
+
+bool MeasurementHistory::stats(uint32_t key, time_t now, HistoryStats& stats) {
+  Slot* slot = findSlot(key);
+  if (slot == nullptr) {
+    return false;
+  }
+  slot->series.expire(now);
+  return slot->series.stats(stats);
+}
+
+bool MeasurementHistory::trend(uint32_t key, time_t now, uint8_t* points,
+                               uint8_t count) {
+  Slot* slot = findSlot(key);
+  return slot != nullptr && slot->series.trend(now, points, count);
+}
+
+void MeasurementHistory::clearShown() {
+  HistoryStore& history = store();
+  history.shown_missing = 0;
+  for (Slot& slot : history.slots) {
+    slot.shown = false;
+  }
+}
+
+void MeasurementHistory::markShown(uint32_t key) {
+  Slot* slot = findSlot(key);
+  if (slot != nullptr) {
+    slot->shown = true;
+  } else if (store().shown_missing < UINT8_MAX) {
+    store().shown_missing++;
+  }
+}
+
+bool MeasurementHistory::coversWindow(time_t now) {
+  HistoryStore& history = store();
+  if (history.shown_missing > 0) {
+    return false;
+  }
+  time_t latest_oldest =
+      now - MeasurementSeries::WINDOW_SECONDS + COVERAGE_SLACK_SECONDS;
+  bool shown = false;
+  for (Slot& slot : history.slots) {
+    if (!slot.shown) {
+      continue;
+    }
+    shown = true;
+    HistoryStats stats;
+    slot.series.expire(now);
+    if (!slot.series.stats(stats) || stats.count < 2 ||
+        stats.oldest > latest_oldest) {
+      return false;
+    }
+  }
+  return shown;
+}
+
+void MeasurementHistory::setLocalNode(const char* node) {
+  HistoryStore& history = store();
+  strncpy(history.local_node, node, MAX_NODE_NAME - 1);
+  history.local_node[MAX_NODE_NAME - 1] = '\0';
+}
+
+const char* MeasurementHistory::localNode() { return store().local_node; }
+
+void MeasurementHistory::clear() { rtc_history.magic = 0; }
@@ -0,0 +1,117 @@
+#ifndef MEASUREMENT_HISTORY_H
+#define MEASUREMENT_HISTORY_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Nodes whose readings are kept, the display's own included. Set with
+// -D HISTORY_NODES=... for the whole build.
+#ifndef HISTORY_NODES
+#define HISTORY_NODES 8
+#endif
+
+/**
+ * Rolling statistics over the samples of a series.
+ */
+struct HistoryStats {
+  uint16_t count;
+  float min;
+  float max;
+  float mean;
+  time_t oldest;  // approximate, to the minute
+};
+
+/**
+ * Fixed size circular buffer of one metric, delta encoded: values are kept in
+ * tenths, as the oldest one plus one signed byte per later sample, and times
+ * as the newest one plus the minutes between samples. A sample takes 2 bytes.
+ *
+ * Min, max and sum are kept up to date as samples come and go, min and max
+ * only being rescanned when the sample holding them is dropped.
+ *
+ * Changes larger than 12.7 between two samples are spread over the following
+ * samples. After more than MAX_GAP_MINUTES without a sample the series starts
+ * over, it could not cover the window anyway.
+ */
+class MeasurementSeries {
+ public:
+  // A day of samples at the display's 15 minute wakes, both ends included
+  static const uint16_t CAPACITY = 97;
+  static const uint16_t MAX_GAP_MINUTES = UINT8_MAX;
+  static const int32_t WINDOW_SECONDS = 24 * 3600;
+  // Samples closer than this to the newest one are ignored, e.g. the same
+  // reading received again on the next wake
+  static const int32_t MIN_INTERVAL_SECONDS = 5 * 60;
+
+  void clear();
+  // Returns false when the sample was ignored
+  bool add(time_t when, float value);
+  // Drops samples older than the window before now
+  void expire(time_t now);
+  bool stats(HistoryStats& stats) const;
+  // Means over count (at most Trend::POINTS) equal parts of the window
+  // before now, as Trend points
+  bool trend(time_t now, uint8_t* points, uint8_t count) const;
+  uint16_t count() const { return count_; }
+  time_t newest() const { return newest_epoch_; }
+
+ private:
+  uint32_t newest_epoch_;
+  uint32_t span_minutes_;  // from the oldest to the newest sample
+  int32_t sum_;
+  int16_t first_;  // oldest value
+  int16_t last_;   // newest value, as decoded
+  int16_t min_;
+  int16_t max_;
+  uint16_t head_;  // index of the oldest sample
+  uint16_t count_;
+  // Per sample, from the previous one. Unused for the oldest sample.
+  uint8_t gap_minutes_[CAPACITY];
+  int8_t delta_[CAPACITY];
+
+  void dropOldest();
+  void rescan();
+};
+
+/**
+ * History of the local and received readings, kept in RTC memory so it
+ * survives deep sleep, so that min/max are available when the GET failed and
+ * the server does not need to aggregate them once a full window is recorded.
+ * Lost on power cycles.
+ *
+ * Series are keyed by node, device and metric, with a slot for each metric
+ * with a min/max of each node. When all slots are used the series updated
+ * least recently is replaced.
+ */
+class MeasurementHistory {
+ public:
+  // Temperature, humidity and pressure
+  static const uint8_t METRICS_PER_NODE = 3;
+  static const uint8_t MAX_SERIES = HISTORY_NODES * METRICS_PER_NODE;
+  // A series covers the window when its oldest sample is at most this late
+  static const int32_t COVERAGE_SLACK_SECONDS = 30 * 60;
+  static const uint8_t MAX_NODE_NAME = 32;
+  // 2020-01-01, clocks before that were never set
+  static const time_t MIN_VALID_EPOCH = 1577836800;
+
+  static uint32_t makeKey(const char* node, const char* device,
+                          const char* metric);
+  static bool add(uint32_t key, time_t when, float value);
+  // Statistics over the window before now, false without samples
+  static bool stats(uint32_t key, time_t now, HistoryStats& stats);
+  static bool trend(uint32_t key, time_t now, uint8_t* points, uint8_t count);
+
+  // The series the display shows, as of the last response
+  static void clearShown();
+  static void markShown(uint32_t key);
+  // Whether every series shown has samples over a whole window up to now
+  static bool coversWindow(time_t now);
+
+  // The node the display's own readings are sent as, so local readings go to
+  // the same series while offline. Empty until a response named it.
+  static void setLocalNode(const char* node);
+  static const char* localNode();
+  static void clear();
+};
+
+#endif  // MEASUREMENT_HISTORY_H
@@ -0,0 +1,89 @@
+#include "trend.h"
+
+#include <math.h>
+
+namespace {
+
+const char BASE64_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int base64Value(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return -1;
+}
+
+}  // namespace
+
+const uint8_t Trend::POINTS;
+const uint8_t Trend::MAX;
+const uint8_t Trend::GAP;
+
+size_t Trend::decode(const char* base64, uint8_t* points, size_t size) {
+  size_t count = 0;
+  uint32_t bits = 0;
+  int pending = 0;
+  for (const char* c = base64; *c && *c != '='; c++) {
+    int value = base64Value(*c);
+    if (value < 0) {
+      return 0;
+    }
+    bits = (bits << 6) | value;
+    pending += 6;
+    if (pending >= 8) {
+      pending -= 8;
+      if (count == size) {
+        return 0;
+      }
+      points[count++] = (bits >> pending) & 0xFF;
+    }
+  }
+  return count;
+}
+
+std::string Trend::encode(const uint8_t* points, size_t count) {
+  std::string base64;
+  base64.reserve((count + 2) / 3 * 4);
+  for (size_t i = 0; i < count; i += 3) {
+    uint32_t bits = points[i] << 16;
+    if (i + 1 < count) bits |= points[i + 1] << 8;
+    if (i + 2 < count) bits |= points[i + 2];
+    base64 += BASE64_CHARS[(bits >> 18) & 0x3F];
+    base64 += BASE64_CHARS[(bits >> 12) & 0x3F];
+    base64 += i + 1 < count ? BASE64_CHARS[(bits >> 6) & 0x3F] : '=';
+    base64 += i + 2 < count ? BASE64_CHARS[bits & 0x3F] : '=';
+  }
+  return base64;
+}
+
+bool Trend::quantize(const float* means, const bool* filled, size_t count,
+                     uint8_t* points) {
+  float min = 0;
+  float max = 0;
+  size_t filled_count = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (!filled[i]) {
+      continue;
+    }
+    if (filled_count == 0 || means[i] < min) min = means[i];
+    if (filled_count == 0 || means[i] > max) max = means[i];
+    filled_count++;
+  }
+  if (filled_count < 2) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (!filled[i]) {
+      points[i] = GAP;
+    } else if (max == min) {
+      points[i] = MAX / 2;
+    } else {
+      points[i] = lroundf((means[i] - min) / (max - min) * MAX);
+    }
+  }
+  return true;
+}
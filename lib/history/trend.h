@@ -0,0 +1,30 @@
+#ifndef TREND_H
+#define TREND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+/**
+ * Compact 24h series for sparklines, as sent by get-display: one byte per
+ * point from 0 (lowest point) to MAX (highest), GAP where there was no
+ * reading, base64 encoded in the JSON response.
+ */
+class Trend {
+ public:
+  // Half an hour per point
+  static const uint8_t POINTS = 48;
+  static const uint8_t MAX = 254;
+  static const uint8_t GAP = 255;
+
+  // Decodes up to size bytes, returns the count decoded or 0 on bad input
+  static size_t decode(const char* base64, uint8_t* points, size_t size);
+  static std::string encode(const uint8_t* points, size_t count);
+  // Scales means to 0..MAX, skipping the buckets without readings. Returns
+  // false when fewer than two buckets have readings.
+  static bool quantize(const float* means, const bool* filled, size_t count,
+                       uint8_t* points);
+};
+
+#endif  // TREND_H
@@ -0,0 +1,355 @@
+#include "inflater.h"
+
+#include <string.h>
+
+const uint8_t Inflater::WINDOW_BITS;
+const size_t Inflater::WINDOW_SIZE;
+const size_t Inflater::INPUT_SIZE;
+
+namespace {
+
+const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,   9,   10,  11, 13,
+                                  15, 17, 19, 23, 27, 31,  35,  43,  51, 59,
+                                  67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                  1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                  4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t DISTANCE_BASE[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                    4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                    9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// Order the code length code lengths are sent in
+const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                       11, 4,  12, 3, 13, 2, 14, 1, 15};
+const uint32_t ADLER_BASE = 65521;
+
+}  // namespace
+
+Inflater::Inflater(const ReadInput& read_input)
+    : read_input_(read_input),
+      input_used_(0),
+      input_size_(0),
+      bit_buffer_(0),
+      bit_count_(0),
+      stage_(ZLIB_HEADER),
+      last_block_(false),
+      stored_left_(0),
+      match_left_(0),
+      match_distance_(0),
+      output_size_(0),
+      adler_a_(1),
+      adler_b_(0) {}
+
+int Inflater::inputByte() {
+  if (input_used_ == input_size_) {
+    input_size_ = read_input_(input_, INPUT_SIZE);
+    input_used_ = 0;
+    if (input_size_ == 0) {
+      return -1;
+    }
+  }
+  return input_[input_used_++];
+}
+
+int32_t Inflater::bits(uint8_t count) {
+  while (bit_count_ < count) {
+    int byte = inputByte();
+    if (byte < 0) {
+      return -1;
+    }
+    bit_buffer_ |= uint32_t(byte) << bit_count_;
+    bit_count_ += 8;
+  }
+  int32_t value = bit_buffer_ & ((1UL << count) - 1);
+  bit_buffer_ >>= count;
+  bit_count_ -= count;
+  return value;
+}
+
+// Codes are sent MSB first, a bit at a time, so walks the lengths until the
+// code read so far falls among the codes of its length
+int Inflater::decodeSymbol(const Huffman& code) {
+  int32_t value = 0;
+  int32_t first = 0;
+  int32_t index = 0;
+  for (uint8_t length = 1; length < 16; length++) {
+    int32_t bit = bits(1);
+    if (bit < 0) {
+      return -1;
+    }
+    value |= bit;
+    int32_t count = code.counts[length];
+    if (value - first < count) {
+      return code.symbols[index + value - first];
+    }
+    index += count;
+    first = (first + count) << 1;
+    value <<= 1;
+  }
+  return -1;
+}
+
+bool Inflater::buildHuffman(Huffman& code, const uint8_t* lengths,
+                            uint16_t count) {
+  memset(code.counts, 0, sizeof(code.counts));
+  for (uint16_t symbol = 0; symbol < count; symbol++) {
+    code.counts[lengths[symbol]]++;
+  }
+  int32_t left = 1;
+  for (uint8_t length = 1; length < 16; length++) {
+    left = (left << 1) - code.counts[length];
+    if (left < 0) {
+      return false;
+    }
+  }
+  uint16_t offsets[16];
+  offsets[1] = 0;
+  for (uint8_t length = 1; length < 15; length++) {
+    offsets[length + 1] = offsets[length] + code.counts[length];
+  }
+  for (uint16_t symbol = 0; symbol < count; symbol++) {
+    if (lengths[symbol] != 0) {
+      code.symbols[offsets[lengths[symbol]]++] = symbol;
+    }
+  }
+  return true;
+}
+
+bool Inflater::readDynamicCodes() {
+  int32_t literal_count = bits(5);
+  int32_t distance_count = bits(5);
+  int32_t code_length_count = bits(4);
+  if (literal_count < 0 || distance_count < 0 || code_length_count < 0) {
+    return false;
+  }
+  literal_count += 257;
+  distance_count += 1;
+  code_length_count += 4;
+  if (literal_count > 286 || distance_count > 30) {
+    return false;
+  }
+
+  uint8_t lengths[286 + 30];
+  memset(lengths, 0, 19);
+  for (int32_t i = 0; i < code_length_count; i++) {
+    int32_t length = bits(3);
+    if (length < 0) {
+      return false;
+    }
+    lengths[CODE_LENGTH_ORDER[i]] = length;
+  }
+  // The literal code is read next, its table holds the code length code
+  // meanwhile
+  if (!buildHuffman(lengths_, lengths, 19)) {
+    return false;
+  }
+
+  int32_t total = literal_count + distance_count;
+  int32_t i = 0;
+  while (i < total) {
+    int symbol = decodeSymbol(lengths_);
+    if (symbol < 0) {
+      return false;
+    }
+    if (symbol < 16) {
+      lengths[i++] = symbol;
+      continue;
+    }
+    uint8_t length = 0;
+    int32_t repeat;
+    if (symbol == 16) {
+      if (i == 0) {
+        return false;
+      }
+      length = lengths[i - 1];
+      repeat = bits(2) + 3;
+    } else if (symbol == 17) {
+      repeat = bits(3) + 3;
+    } else {
+      repeat = bits(7) + 11;
+    }
+    if (repeat < 3 || i + repeat > total) {
+      return false;
+    }
+    while (repeat-- > 0) {
+      lengths[i++] = length;
+    }
+  }
+  // Without an end of block code the block never ends
+  if (lengths[256] == 0) {
+    return false;
+  }
+  return buildHuffman(lengths_, lengths, literal_count) &&
+         buildHuffman(distances_, lengths + literal_count, distance_count);
+}
+
+bool Inflater::startBlock() {
+  int32_t header = bits(3);
+  if (header < 0) {
+    return false;
+  }
+  last_block_ = header & 1;
+  switch (header >> 1) {
+    case 0: {
+      // Stored, from the next byte boundary
+      bits(bit_count_ % 8);
+      int32_t length = bits(16);
+      int32_t complement = bits(16);
+      if (length < 0 || complement < 0 || (length ^ 0xFFFF) != complement) {
+        return false;
+      }
+      stored_left_ = length;
+      stage_ = STORED;
+      return true;
+    }
+    case 1: {
+      uint8_t lengths[288];
+      memset(lengths, 8, 144);
+      memset(lengths + 144, 9, 256 - 144);
+      memset(lengths + 256, 7, 280 - 256);
+      memset(lengths + 280, 8, 288 - 280);
+      buildHuffman(lengths_, lengths, 288);
+      memset(lengths, 5, 30);
+      buildHuffman(distances_, lengths, 30);
+      stage_ = CODES;
+      return true;
+    }
+    case 2:
+      if (!readDynamicCodes()) {
+        return false;
+      }
+      stage_ = CODES;
+      return true;
+    default:
+      return false;
+  }
+}
+
+int Inflater::fail() {
+  stage_ = FAILED;
+  return -1;
+}
+
+uint8_t Inflater::emit(uint8_t byte) {
+  window_[output_size_ % WINDOW_SIZE] = byte;
+  output_size_++;
+  adler_a_ = (adler_a_ + byte) % ADLER_BASE;
+  adler_b_ = (adler_b_ + adler_a_) % ADLER_BASE;
+  return byte;
+}
+
+int Inflater::read() {
+  while (true) {
+    switch (stage_) {
+      case ZLIB_HEADER: {
+        int32_t method = bits(8);
+        int32_t flags = bits(8);
+        if (method < 0 || flags < 0 || (method & 0x0F) != 8 ||
+            (method >> 4) + 8 > WINDOW_BITS || (flags & 0x20) != 0 ||
+            ((method << 8) | flags) % 31 != 0) {
+          return fail();
+        }
+        stage_ = BLOCK_HEADER;
+        break;
+      }
+      case BLOCK_HEADER:
+        if (last_block_) {
+          stage_ = CHECKSUM;
+          return -1;
+        }
+        if (!startBlock()) {
+          return fail();
+        }
+        break;
+      case STORED: {
+        if (stored_left_ == 0) {
+          stage_ = BLOCK_HEADER;
+          break;
+        }
+        int32_t byte = bits(8);
+        if (byte < 0) {
+          return fail();
+        }
+        stored_left_--;
+        return emit(byte);
+      }
+      case CODES: {
+        if (match_left_ > 0) {
+          match_left_--;
+          return emit(window_[(output_size_ - match_distance_) % WINDOW_SIZE]);
+        }
+        int symbol = decodeSymbol(lengths_);
+        if (symbol < 0) {
+          return fail();
+        }
+        if (symbol < 256) {
+          return emit(symbol);
+        }
+        if (symbol == 256) {
+          stage_ = BLOCK_HEADER;
+          break;
+        }
+        symbol -= 257;
+        if (symbol >= 29) {
+          return fail();
+        }
+        int32_t length_extra = bits(LENGTH_EXTRA[symbol]);
+        int distance_symbol = decodeSymbol(distances_);
+        if (length_extra < 0 || distance_symbol < 0 || distance_symbol >= 30) {
+          return fail();
+        }
+        int32_t distance_extra = bits(DISTANCE_EXTRA[distance_symbol]);
+        if (distance_extra < 0) {
+          return fail();
+        }
+        uint32_t distance = DISTANCE_BASE[distance_symbol] + distance_extra;
+        // Further back than what was kept
+        if (distance > output_size_ || distance > WINDOW_SIZE) {
+          return fail();
+        }
+        match_left_ = LENGTH_BASE[symbol] + length_extra;
+        match_distance_ = distance;
+        break;
+      }
+      case CHECKSUM:
+      case DONE:
+      case FAILED:
+        return -1;
+    }
+  }
+}
+
+size_t Inflater::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int byte = read();
+    if (byte < 0) {
+      break;
+    }
+    buffer[count++] = byte;
+  }
+  return count;
+}
+
+bool Inflater::finish() {
+  while (read() >= 0) {
+  }
+  if (stage_ != CHECKSUM) {
+    return stage_ == DONE;
+  }
+  bits(bit_count_ % 8);
+  uint32_t checksum = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    int32_t byte = bits(8);
+    if (byte < 0) {
+      stage_ = FAILED;
+      return false;
+    }
+    checksum = (checksum << 8) | byte;
+  }
+  stage_ = checksum == ((adler_b_ << 16) | adler_a_) ? DONE : FAILED;
+  return stage_ == DONE;
+}
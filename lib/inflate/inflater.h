@@ -0,0 +1,92 @@
+#ifndef INFLATER_H
+#define INFLATER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+/**
+ * Streaming inflate of zlib data (RFC 1950/1951), as sent by get-display
+ * for "Content-Encoding: deflate".
+ *
+ * Output is pulled, a byte or a few at a time, with the read() and
+ * readBytes() ArduinoJson takes from a custom reader, so a response can be
+ * deserialized as it downloads without holding the whole body. Only the last
+ * WINDOW_SIZE bytes of output are kept for back references, the compressor
+ * must use a window that small (zlib wbits <= WINDOW_BITS), which the zlib
+ * header is checked for.
+ */
+class Inflater {
+ public:
+  static const uint8_t WINDOW_BITS = 11;
+  static const size_t WINDOW_SIZE = 1 << WINDOW_BITS;
+  static const size_t INPUT_SIZE = 256;
+
+  // Reads up to size bytes of compressed input, 0 at the end of it
+  typedef std::function<size_t(uint8_t* data, size_t size)> ReadInput;
+
+  explicit Inflater(const ReadInput& read_input);
+
+  // Next byte of output, -1 at the end or on error
+  int read();
+  size_t readBytes(char* buffer, size_t length);
+
+  // Reads what is left up to the checksum, true when the data was complete
+  // and matches it
+  bool finish();
+  bool failed() const { return stage_ == FAILED; }
+
+ private:
+  enum Stage : uint8_t {
+    ZLIB_HEADER,
+    BLOCK_HEADER,
+    STORED,
+    CODES,
+    CHECKSUM,
+    DONE,
+    FAILED
+  };
+
+  // Canonical Huffman code, as counts of codes per length and the symbols
+  // ordered by code
+  struct Huffman {
+    uint16_t counts[16];
+    uint16_t symbols[288];
+  };
+
+  ReadInput read_input_;
+  uint8_t input_[INPUT_SIZE];
+  size_t input_used_;
+  size_t input_size_;
+  uint32_t bit_buffer_;
+  uint8_t bit_count_;
+
+  Stage stage_;
+  bool last_block_;
+  uint16_t stored_left_;
+  Huffman lengths_;
+  Huffman distances_;
+  // Back reference being copied
+  uint16_t match_left_;
+  uint16_t match_distance_;
+
+  uint8_t window_[WINDOW_SIZE];
+  uint32_t output_size_;
+  uint32_t adler_a_;
+  uint32_t adler_b_;
+
+  int inputByte();
+  // Next count bits, LSB first, or -1 when the input ended
+  int32_t bits(uint8_t count);
+  int decodeSymbol(const Huffman& code);
+  // False for a code with more symbols than its lengths allow
+  static bool buildHuffman(Huffman& code, const uint8_t* lengths,
+                           uint16_t count);
+  bool startBlock();
+  bool readDynamicCodes();
+  int fail();
+  uint8_t emit(uint8_t byte);
+};
+
+#endif  // INFLATER_H
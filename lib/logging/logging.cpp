@@ -0,0 +1,429 @@
+#include "logging.h"
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef UNIT_TEST
+#include <esp_ota_ops.h>
+#endif
+
+const size_t LogRecord::MAX_SIZE;
+const uint8_t LogRecord::MAX_ARGS;
+const uint8_t LogRecord::MAX_STRING;
+const size_t LogRecord::HEADER_SIZE;
+const size_t LogBuffer::SIZE;
+const size_t LogBuffer::MAX_LINE;
+
+namespace {
+
+// Changes whenever the layout changes, so stale RTC contents from an older
+// firmware are ignored
+const uint32_t LOG_MAGIC = 0x4C4F4701;
+const char LEVELS[] = "?EWID";
+
+static_assert(LogBuffer::SIZE >= LogRecord::MAX_SIZE &&
+                  LogBuffer::SIZE <= UINT16_MAX,
+              "LOG_BUFFER_SIZE out of range");
+
+struct LogStore {
+  uint32_t magic;
+  uint32_t image;    // firmware the formats are in
+  uint16_t head;     // offset of the oldest record
+  uint16_t used;
+  uint32_t dropped;  // records overwritten since the last flush
+  uint8_t cycle;
+  uint8_t data[LogBuffer::SIZE];
+};
+
+// Not cleared on reboots either, so the records before a crash are kept
+RTC_NOINIT_ATTR LogStore rtc_log_store;
+
+uint32_t imageId() {
+#ifdef UNIT_TEST
+  return 1;
+#else
+  uint32_t id;
+  memcpy(&id, esp_ota_get_app_description()->app_elf_sha256, sizeof(id));
+  return id;
+#endif
+}
+
+LogStore& store() {
+  LogStore& log = rtc_log_store;
+  uint32_t image = imageId();
+  if (log.magic != LOG_MAGIC || log.image != image ||
+      log.head >= LogBuffer::SIZE || log.used > LogBuffer::SIZE) {
+    log.magic = LOG_MAGIC;
+    log.image = image;
+    log.head = 0;
+    log.used = 0;
+    log.dropped = 0;
+    log.cycle = 0;
+  }
+  return log;
+}
+
+// Copies size bytes of the ring from offset on
+void readRing(const LogStore& log, size_t offset, uint8_t* data,
+              size_t size) {
+  size_t first = LogBuffer::SIZE - offset;
+  if (first >= size) {
+    memcpy(data, log.data + offset, size);
+  } else {
+    memcpy(data, log.data + offset, first);
+    memcpy(data + first, log.data, size - first);
+  }
+}
+
+// Drops the oldest record, or all of them when it does not look like one
+void dropOldest(LogStore& log) {
+  uint8_t size = log.data[log.head];
+  if (size < LogRecord::HEADER_SIZE || size > log.used) {
+    log.head = 0;
+    log.used = 0;
+  } else {
+    log.head = (log.head + size) % LogBuffer::SIZE;
+    log.used -= size;
+  }
+  log.dropped++;
+}
+
+// Output of a record being formatted, cut when the line is full
+class Line {
+ public:
+  Line(char* text, size_t size) : text_(text), size_(size), length_(0) {
+    text_[0] = '\0';
+  }
+
+  void append(const char* text, size_t length) {
+    if (length > size_ - 1 - length_) {
+      length = size_ - 1 - length_;
+    }
+    memcpy(text_ + length_, text, length);
+    length_ += length;
+    text_[length_] = '\0';
+  }
+  void append(const char* text) { append(text, strlen(text)); }
+
+  void trimNewline() {
+    while (length_ > 0 && text_[length_ - 1] == '\n') {
+      text_[--length_] = '\0';
+    }
+  }
+
+ private:
+  char* text_;
+  size_t size_;
+  size_t length_;
+};
+
+// The arguments of a record, read in order
+class ArgReader {
+ public:
+  ArgReader(const uint8_t* data, const uint8_t* end, uint8_t count,
+            uint16_t types)
+      : data_(data), end_(end), count_(count), types_(types), index_(0) {}
+
+  // False once all arguments were read
+  bool next(LogRecord::Type& type, uint64_t& integer, double& real,
+            char* text) {
+    if (index_ >= count_) {
+      return false;
+    }
+    type = static_cast<LogRecord::Type>((types_ >> (2 * index_)) & 3);
+    index_++;
+    switch (type) {
+      case LogRecord::INT32: {
+        uint32_t value;
+        if (!read(&value, sizeof(value))) return false;
+        integer = value;
+        return true;
+      }
+      case LogRecord::INT64:
+        return read(&integer, sizeof(integer));
+      case LogRecord::DOUBLE:
+        return read(&real, sizeof(real));
+      case LogRecord::STRING: {
+        uint8_t length;
+        if (!read(&length, 1) || length > LogRecord::MAX_STRING) return false;
+        if (!read(text, length)) return false;
+        text[length] = '\0';
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  const uint8_t* data_;
+  const uint8_t* end_;
+  uint8_t count_;
+  uint16_t types_;
+  uint8_t index_;
+
+  bool read(void* value, size_t size) {
+    if (static_cast<size_t>(end_ - data_) < size) {
+      return false;
+    }
+    memcpy(value, data_, size);
+    data_ += size;
+    return true;
+  }
+};
+
+// Formats one conversion, spec being "%" with its flags, width and precision
+// but no length nor conversion. Prints "?" when the argument does not suit
+// the conversion, rather than reading the wrong type.
+void formatArg(Line& line, const char* spec, char conversion,
+               LogRecord::Type type, uint64_t integer, double real,
+               const char* text) {
+  char format[24];
+  char out[LogBuffer::MAX_LINE];
+  bool is_integer = strchr("diouxXc", conversion) != nullptr;
+  bool is_signed = conversion == 'd' || conversion == 'i';
+  int length = -1;
+  if (conversion == 'p' &&
+      (type == LogRecord::INT32 || type == LogRecord::INT64)) {
+    length = snprintf(out, sizeof(out), "0x%llx",
+                      static_cast<unsigned long long>(integer));
+  } else if (type == LogRecord::INT32 && is_integer) {
+    snprintf(format, sizeof(format), "%s%c", spec, conversion);
+    uint32_t value = static_cast<uint32_t>(integer);
+    length = is_signed || conversion == 'c'
+                 ? snprintf(out, sizeof(out), format,
+                            static_cast<int>(static_cast<int32_t>(value)))
+                 : snprintf(out, sizeof(out), format,
+                            static_cast<unsigned>(value));
+  } else if (type == LogRecord::INT64 && is_integer && conversion != 'c') {
+    snprintf(format, sizeof(format), "%sll%c", spec, conversion);
+    length = is_signed ? snprintf(out, sizeof(out), format,
+                                  static_cast<long long>(integer))
+                       : snprintf(out, sizeof(out), format,
+                                  static_cast<unsigned long long>(integer));
+  } else if (type == LogRecord::DOUBLE &&
+             strchr("fFeEgGaA", conversion) != nullptr) {
+    snprintf(format, sizeof(format), "%s%c", spec, conversion);
+    length = snprintf(out, sizeof(out), format, real);
+  } else if (type == LogRecord::STRING && conversion == 's') {
+    snprintf(format, sizeof(format), "%ss", spec);
+    length = snprintf(out, sizeof(out), format, text);
+  }
+  line.append(length >= 0 ? out : "?");
+}
+
+void formatRecord(const char* format, ArgReader& args, Line& line) {
+  const char* p = format;
+  while (*p != '\0') {
+    if (*p != '%') {
+      const char* next = strchr(p, '%');
+      size_t length = next != nullptr ? next - p : strlen(p);
+      line.append(p, length);
+      p += length;
+      continue;
+    }
+    p++;
+    if (*p == '%') {
+      line.append("%", 1);
+      p++;
+      continue;
+    }
+    char spec[16] = "%";
+    size_t spec_length = 1;
+    while (*p != '\0' && strchr("-+ #0123456789.", *p) != nullptr) {
+      if (spec_length < sizeof(spec) - 1) {
+        spec[spec_length++] = *p;
+        spec[spec_length] = '\0';
+      }
+      p++;
+    }
+    // The stored type says how wide the argument is
+    while (*p != '\0' && strchr("hlLqjzt", *p) != nullptr) {
+      p++;
+    }
+    char conversion = *p;
+    if (conversion == '\0') {
+      break;
+    }
+    p++;
+    LogRecord::Type type;
+    uint64_t integer = 0;
+    double real = 0;
+    char text[LogRecord::MAX_STRING + 1];
+    if (!args.next(type, integer, real, text)) {
+      line.append("?", 1);
+      continue;
+    }
+    formatArg(line, spec, conversion, type, integer, real, text);
+  }
+}
+
+void formatLine(const uint8_t* record, size_t size, char* text) {
+  uint8_t level = record[1] >> 4;
+  uint8_t count = record[1] & 0x0F;
+  uint16_t types;
+  memcpy(&types, record + 2, sizeof(types));
+  uint8_t cycle = record[4];
+  uint32_t ms;
+  memcpy(&ms, record + 5, sizeof(ms));
+  const char* format;
+  memcpy(&format, record + 9, sizeof(format));
+
+  Line line(text, LogBuffer::MAX_LINE);
+  char prefix[32];
+  snprintf(prefix, sizeof(prefix), "%u %u %c ", cycle,
+           static_cast<unsigned>(ms),
+           level < sizeof(LEVELS) - 1 ? LEVELS[level] : '?');
+  line.append(prefix);
+  ArgReader args(record + LogRecord::HEADER_SIZE, record + size, count, types);
+  formatRecord(format, args, line);
+  line.trimNewline();
+}
+
+}  // namespace
+
+LogRecord::LogRecord(uint8_t level, const char* format)
+    : size_(HEADER_SIZE), count_(0), types_(0) {
+  data_[0] = HEADER_SIZE;
+  data_[1] = level << 4;
+  memset(data_ + 2, 0, 2);
+  data_[4] = 0;  // the cycle, set when appended
+  uint32_t ms = millis();
+  memcpy(data_ + 5, &ms, sizeof(ms));
+  memcpy(data_ + 9, &format, sizeof(format));
+}
+
+bool LogRecord::begin(Type type, size_t size) {
+  if (count_ >= MAX_ARGS || size > MAX_SIZE - size_) {
+    return false;
+  }
+  types_ |= static_cast<uint16_t>(type) << (2 * count_);
+  count_++;
+  data_[1] = (data_[1] & 0xF0) | count_;
+  memcpy(data_ + 2, &types_, sizeof(types_));
+  return true;
+}
+
+void LogRecord::putInteger(Type type, uint64_t value) {
+  if (type == INT32) {
+    uint32_t value32 = static_cast<uint32_t>(value);
+    if (begin(INT32, sizeof(value32))) {
+      memcpy(data_ + size_, &value32, sizeof(value32));
+      size_ += sizeof(value32);
+    }
+  } else if (begin(INT64, sizeof(value))) {
+    memcpy(data_ + size_, &value, sizeof(value));
+    size_ += sizeof(value);
+  }
+  data_[0] = size_;
+}
+
+void LogRecord::put(double value) {
+  if (begin(DOUBLE, sizeof(value))) {
+    memcpy(data_ + size_, &value, sizeof(value));
+    size_ += sizeof(value);
+    data_[0] = size_;
+  }
+}
+
+void LogRecord::put(const char* value) {
+  if (value == nullptr) {
+    value = "(null)";
+  }
+  size_t length = strlen(value);
+  if (length > MAX_STRING) {
+    length = MAX_STRING;
+  }
+  if (size_ < MAX_SIZE && length > MAX_SIZE - size_ - 1) {
+    length = MAX_SIZE - size_ - 1;
+  }
+  if (begin(STRING, 1 + length)) {
+    data_[size_++] = length;
+    memcpy(data_ + size_, value, length);
+    size_ += length;
+    data_[0] = size_;
+  }
+}
+
+void LogBuffer::append(const LogRecord& record) {
+  LogStore& log = store();
+  size_t size = record.size();
+  while (SIZE - log.used < size) {
+    dropOldest(log);
+  }
+  size_t offset = (log.head + log.used) % SIZE;
+  size_t first = SIZE - offset;
+  if (first >= size) {
+    memcpy(log.data + offset, record.data(), size);
+  } else {
+    memcpy(log.data + offset, record.data(), first);
+    memcpy(log.data, record.data() + first, size - first);
+  }
+  log.data[(offset + 4) % SIZE] = log.cycle;
+  log.used += size;
+}
+
+void LogBuffer::startCycle() { store().cycle++; }
+
+size_t LogBuffer::flush(const Output& out) {
+  LogStore& log = store();
+  char text[MAX_LINE];
+  if (log.dropped > 0) {
+    snprintf(text, sizeof(text), "%u %u W %u older records overwritten",
+             log.cycle, static_cast<unsigned>(millis()),
+             static_cast<unsigned>(log.dropped));
+    log.dropped = 0;
+    out(text);
+  }
+  size_t count = 0;
+  uint8_t record[LogRecord::MAX_SIZE];
+  while (log.used > 0) {
+    uint8_t size = log.data[log.head];
+    if (size < LogRecord::HEADER_SIZE || size > log.used) {
+      // Not a record, the rest cannot be read
+      log.head = 0;
+      log.used = 0;
+      break;
+    }
+    // Taken off first, records logged while flushing come after it
+    readRing(log, log.head, record, size);
+    log.head = (log.head + size) % SIZE;
+    log.used -= size;
+    formatLine(record, size, text);
+    out(text);
+    count++;
+  }
+  return count;
+}
+
+size_t LogBuffer::flush() {
+  return flush([](const char* line) { Serial.println(line); });
+}
+
+void LogBuffer::dump(const char* label, const char* text) {
+  Serial.printf("%s: %s\n", label, text);
+}
+
+size_t LogBuffer::count() {
+  const LogStore& log = store();
+  size_t count = 0;
+  size_t offset = 0;
+  while (offset < log.used) {
+    uint8_t size = log.data[(log.head + offset) % SIZE];
+    if (size < LogRecord::HEADER_SIZE) {
+      break;
+    }
+    offset += size;
+    count++;
+  }
+  return count;
+}
+
+uint32_t LogBuffer::dropped() { return store().dropped; }
+
+void LogBuffer::clear() {
+  LogStore& log = store();
+  log.head = 0;
+  log.used = 0;
+  log.dropped = 0;
+}
@@ -0,0 +1,183 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Set with -D LOG_LEVEL=... for the whole build, records under it are
+// compiled out along with their arguments
+#ifndef LOG_LEVEL
+#ifdef UNIT_TEST
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#else
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 1024
+#endif
+
+/**
+ * One log record as it is kept: the address of its printf format, which
+ * stays in flash, and its arguments in binary. Formatting waits until the
+ * log is flushed, so writing a record is a few copies.
+ *
+ * Strings are copied, cut to MAX_STRING bytes.
+ */
+class LogRecord {
+ public:
+  static const size_t MAX_SIZE = 255;
+  static const uint8_t MAX_ARGS = 8;
+  static const uint8_t MAX_STRING = 40;
+
+  // Argument types, two bits each
+  enum Type : uint8_t { INT32, INT64, DOUBLE, STRING };
+
+  // Size, level and argument count, argument types, cycle, milliseconds
+  static const size_t HEADER_SIZE = 9 + sizeof(const char*);
+
+  LogRecord(uint8_t level, const char* format);
+
+  void add() {}
+  template <typename T, typename... Rest>
+  void add(T first, Rest... rest) {
+    put(first);
+    add(rest...);
+  }
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  uint8_t data_[MAX_SIZE];
+  size_t size_;
+  uint8_t count_;
+  uint16_t types_;
+
+  void put(bool value) { putInteger(INT32, value ? 1 : 0); }
+  void put(int value) { putInteger(INT32, static_cast<uint32_t>(value)); }
+  void put(unsigned value) { putInteger(INT32, value); }
+  void put(long value) { putInteger(value); }
+  void put(unsigned long value) { putInteger(value); }
+  void put(long long value) { putInteger(value); }
+  void put(unsigned long long value) { putInteger(value); }
+  void put(double value);
+  void put(const char* value);
+  void put(const void* value) {
+    putInteger(reinterpret_cast<uintptr_t>(value));
+  }
+
+  template <typename T>
+  void putInteger(T value) {
+    if (sizeof(T) > 4) {
+      putInteger(INT64, static_cast<uint64_t>(value));
+    } else {
+      putInteger(INT32, static_cast<uint32_t>(value));
+    }
+  }
+  void putInteger(Type type, uint64_t value);
+  bool begin(Type type, size_t size);
+};
+
+/**
+ * Log of the wake cycles, kept in RTC memory as a ring of binary records,
+ * so that logging costs no UART time and what led to a crash or a deep
+ * sleep is still there afterwards. The oldest records are overwritten when
+ * the ring is full.
+ *
+ * Records are only formatted when flushed, to the serial port or for
+ * uploading. A firmware update drops them, their formats belonging to the
+ * old image.
+ *
+ * Use the LOG_ macros rather than write(), so that the formats are checked
+ * and records above LOG_LEVEL cost nothing.
+ */
+class LogBuffer {
+ public:
+  static const size_t SIZE = LOG_BUFFER_SIZE;
+  // A formatted record, longer ones are cut
+  static const size_t MAX_LINE = 160;
+
+  typedef std::function<void(const char* line)> Output;
+
+  template <typename... Args>
+  static void write(uint8_t level, const char* format, Args... args) {
+    LogRecord record(level, format);
+    record.add(args...);
+    append(record);
+  }
+  static void append(const LogRecord& record);
+
+  // Counts the wake cycles, so records can be told apart across light and
+  // deep sleeps
+  static void startCycle();
+
+  // Formats the records, oldest first, and clears the log. Returns the count
+  // of records. Lines look like "12 3456 W message", with the cycle, the
+  // milliseconds since boot and the level.
+  static size_t flush(const Output& out);
+  // To the serial port
+  static size_t flush();
+
+  // Prints text whole to the serial port, see LOG_DUMP
+  static void dump(const char* label, const char* text);
+
+  static size_t count();
+  // Records overwritten before being flushed
+  static uint32_t dropped();
+  static void clear();
+};
+
+// printf format checking only, never called
+inline void logCheckFormat(const char* format, ...)
+    __attribute__((format(printf, 1, 2)));
+inline void logCheckFormat(const char*, ...) {}
+
+#define LOG_RECORD(level, format, ...)                 \
+  do {                                                 \
+    if (false) logCheckFormat(format, ##__VA_ARGS__);  \
+    LogBuffer::write(level, "" format, ##__VA_ARGS__); \
+  } while (0)
+
+#define LOG_NOTHING(...) \
+  do {                   \
+  } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_RECORD(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_RECORD(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_RECORD(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_NOTHING()
+#endif
+
+// Debug builds also print whole payloads, straight to the serial port as
+// they would not fit a record
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_RECORD(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_DUMP(label, text) LogBuffer::dump(label, text)
+#else
+#define LOG_DEBUG(...) LOG_NOTHING()
+#define LOG_DUMP(label, text) LOG_NOTHING()
+#endif
+
+#endif  // LOGGING_H
@@ -1,19 +1,62 @@
 #include <fmt/core.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "model.h"
 #include "config.h"
+#include "logging.h"
+#include "measurementhistory.h"
 #include "sunandmoon.h"
+#include "trend.h"
+
+namespace {
+
+// Metrics with a 24h min/max
+const char* const HISTORY_METRICS[] = {"temperature", "humidity", "pressure"};
+static_assert(sizeof(HISTORY_METRICS) / sizeof(HISTORY_METRICS[0]) ==
+                  MeasurementHistory::METRICS_PER_NODE,
+              "MeasurementHistory sizes its store by the metrics kept");
+// Metrics with a sparkline
+const char* const TREND_METRICS[] = {"temperature"};
+
+// Schema 2 responses carry numbers as JSON numbers, read as is. Older servers
+// send them as strings, which are parsed.
+bool isNumber(JsonVariantConst value) {
+  return value.is<JsonFloat>() || value.is<const char*>();
+}
+
+double readNumber(JsonVariantConst value) {
+  if (value.is<JsonFloat>()) {
+    return value.as<JsonFloat>();
+  }
+  const char* text = value.as<const char*>();
+  return text != nullptr ? strtod(text, nullptr) : 0;
+}
+
+}  // namespace
+
+const int Model::WIRE_SCHEMA;
 
 Model::Model() {
   doc_ = new JsonDocument();
   (*doc_)["nodes"] = JsonDocument();
 }
 
-Model::Model(const std::string& json_str) {
-  doc_ = new JsonDocument();
+Model::Model(const std::string& json_str, ArduinoJson::Allocator* allocator)
+    : allocator_(allocator) {
+  doc_ = newDocument();
   jsonLoadOK_ = fromJsonString(json_str);
 }
 
+Model::Model(ArduinoJson::Allocator* allocator) : allocator_(allocator) {
+  doc_ = newDocument();
+}
+
+JsonDocument* Model::newDocument() const {
+  return allocator_ != nullptr ? new JsonDocument(allocator_)
+                               : new JsonDocument();
+}
+
 Model::~Model() {
   if (doc_ != nullptr) {
     delete doc_;
@@ -40,7 +83,7 @@ Model& Model::operator=(const Model& other) {
       doc_ = nullptr;
     }
     // Create new doc and copy data
-    doc_ = new JsonDocument();
+    doc_ = newDocument();
     if (other.doc_ != nullptr) {
       *doc_ = *other.doc_;
     }
@@ -89,6 +132,45 @@ void Model::setMoonInfo(const std::string& phase,
   (*doc_)["moon"]["set"] = set;
 }
 
+void Model::setEphemeris(const SunMoonKey& key, const SunMoonEvents& events) {
+  JsonObject ephemeris = (*doc_)["ephemeris"].to<JsonObject>();
+  JsonArray k = ephemeris["key"].to<JsonArray>();
+  k.add(key.year);
+  k.add(key.month);
+  k.add(key.day);
+  k.add(key.latitude_e6);
+  k.add(key.longitude_e6);
+  k.add(key.utc_offset_seconds);
+  JsonArray e = ephemeris["events"].to<JsonArray>();
+  e.add(static_cast<long long>(events.sun_rise));
+  e.add(static_cast<long long>(events.sun_transit));
+  e.add(static_cast<long long>(events.sun_set));
+  e.add(static_cast<long long>(events.moon_rise));
+  e.add(static_cast<long long>(events.moon_transit));
+  e.add(static_cast<long long>(events.moon_set));
+}
+
+bool Model::getEphemeris(SunMoonKey& key, SunMoonEvents& events) const {
+  JsonArray k = (*doc_)["ephemeris"]["key"].as<JsonArray>();
+  JsonArray e = (*doc_)["ephemeris"]["events"].as<JsonArray>();
+  if (k.size() != 6 || e.size() != 6) {
+    return false;
+  }
+  key.year = k[0].as<int>();
+  key.month = k[1].as<int>();
+  key.day = k[2].as<int>();
+  key.latitude_e6 = k[3].as<long>();
+  key.longitude_e6 = k[4].as<long>();
+  key.utc_offset_seconds = k[5].as<long>();
+  events.sun_rise = e[0].as<long long>();
+  events.sun_transit = e[1].as<long long>();
+  events.sun_set = e[2].as<long long>();
+  events.moon_rise = e[3].as<long long>();
+  events.moon_transit = e[4].as<long long>();
+  events.moon_set = e[5].as<long long>();
+  return true;
+}
+
 std::string Model::getMoonRise() const { return get("moon", "rise"); }
 
 std::string Model::getMoonSet() const { return get("moon", "set"); }
@@ -101,6 +183,15 @@ char Model::getMoonPhaseLetter() const {
   return get("moon", "phase_letter")[0];
 }
 
+bool Model::isHistoryMetric(const char* metric) {
+  for (const char* history_metric : HISTORY_METRICS) {
+    if (strcmp(metric, history_metric) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 JsonObject Model::getNodeData() const {
   if ((*doc_)["nodes"].is<JsonObject>()) {
     return (*doc_)["nodes"].as<JsonObject>();
@@ -110,6 +201,7 @@ JsonObject Model::getNodeData() const {
 
 void Model::addNodes(JsonObject rawNodes, DateTime& utc_timestamp) {
   JsonObject new_nodes = (*doc_)["nodes"].to<JsonObject>();
+  MeasurementHistory::clearShown();
   for (JsonPair node : rawNodes) {
     addNode(node, utc_timestamp);
   }
@@ -132,7 +224,12 @@ void Model::addNode(JsonPair& raw_node, DateTime& utc_timestamp) {
   addNodeStatusSection(raw_node_data, new_node, node_name.c_str());
   addNodeStaleState(utc_timestamp, raw_node_data, new_node);
   addNodeMeasurementsV2(raw_node_data, new_node);
+  addNodeHistory(raw_node_data, node_name.c_str());
   addNodeMeasurementsMinMax(raw_node_data, new_node);
+  addNodeHistoryMinMax(utc_timestamp, new_node, node_name.c_str());
+  addNodeTrend(raw_node_data, new_node);
+  addNodeHistoryTrend(utc_timestamp, raw_node_data, new_node,
+                      node_name.c_str());
   addNodeVersion(raw_node_data, new_node);
 }
 
@@ -148,8 +245,7 @@ void Model::addNodeMeasurementsV2(JsonObject& raw_node_data,
       if (device.key() != "wifi" && device.key() != "battery") {
         JsonObject new_device = new_measurements[device.key()].to<JsonObject>();
         for (JsonPair metric : device.value().as<JsonObject>()) {
-          double value = metric.value().as<JsonFloat>();
-          new_device[metric.key()] = value;
+          new_device[metric.key()] = readNumber(metric.value());
         }
       }
     }
@@ -171,23 +267,123 @@ void Model::addNodeMeasurementsMinMax(JsonObject& raw_node_data,
         JsonObject new_metric = new_device[metric.key()].to<JsonObject>();
         JsonObject metric_values = metric.value().as<JsonObject>();
         for (JsonPair minmax : metric_values) {
-          double value = minmax.value().as<JsonFloat>();
-          new_metric[minmax.key()] = value;
+          new_metric[minmax.key()] = readNumber(minmax.value());
         }
       }
     }
   }
 }
 
+void Model::addNodeHistory(JsonObject& raw_node_data, const char* node_name) {
+  if (!raw_node_data["measurements_v2"].is<JsonObject>() ||
+      !raw_node_data["timestamp_utc"].is<const char*>()) {
+    return;
+  }
+  DateTime when(raw_node_data["timestamp_utc"].as<const char*>());
+  if (!when.ok()) {
+    return;
+  }
+
+  JsonObject measurements_v2 =
+      raw_node_data["measurements_v2"].as<JsonObject>();
+  for (JsonPair device : measurements_v2) {
+    JsonObject metrics = device.value().as<JsonObject>();
+    for (const char* metric : HISTORY_METRICS) {
+      if (metrics[metric].isNull()) {
+        continue;
+      }
+      uint32_t key =
+          MeasurementHistory::makeKey(node_name, device.key().c_str(), metric);
+      MeasurementHistory::add(key, when.epoch(),
+                              float(readNumber(metrics[metric])));
+      MeasurementHistory::markShown(key);
+    }
+  }
+}
+
+void Model::addNodeHistoryMinMax(DateTime& utc_timestamp, JsonObject& new_node,
+                                 const char* node_name) {
+  // When the server skipped the min/max aggregation, use the local history if
+  // it has more than the current reading
+  if (!utc_timestamp.ok() || !new_node["measurements_v2"].is<JsonObject>() ||
+      new_node["measurements_min_max"].is<JsonObject>()) {
+    return;
+  }
+
+  JsonObject measurements_v2 = new_node["measurements_v2"].as<JsonObject>();
+  for (JsonPair device : measurements_v2) {
+    JsonObject metrics = device.value().as<JsonObject>();
+    for (const char* metric : HISTORY_METRICS) {
+      if (metrics[metric].isNull()) {
+        continue;
+      }
+      HistoryStats stats;
+      uint32_t key =
+          MeasurementHistory::makeKey(node_name, device.key().c_str(), metric);
+      if (!MeasurementHistory::stats(key, utc_timestamp.epoch(), stats) ||
+          stats.count < 2) {
+        continue;
+      }
+      JsonObject min_max = new_node["measurements_min_max"][device.key()]
+                               [metric].to<JsonObject>();
+      min_max["min"] = stats.min;
+      min_max["max"] = stats.max;
+      min_max["mean"] = stats.mean;
+    }
+  }
+}
+
+void Model::addNodeTrend(JsonObject& raw_node_data, JsonObject& new_node) {
+  // Copy the base64 trend points of each device as they are
+  if (raw_node_data["trend"].is<JsonObject>()) {
+    JsonObject new_trend = new_node["trend"].to<JsonObject>();
+    for (JsonPair device : raw_node_data["trend"].as<JsonObject>()) {
+      JsonObject new_device = new_trend[device.key()].to<JsonObject>();
+      for (JsonPair metric : device.value().as<JsonObject>()) {
+        new_device[metric.key()] = metric.value().as<JsonString>();
+      }
+    }
+  }
+}
+
+void Model::addNodeHistoryTrend(DateTime& utc_timestamp,
+                                JsonObject& raw_node_data, JsonObject& new_node,
+                                const char* node_name) {
+  // Trends come with the min/max aggregation, fall back to the local history
+  // when the server skipped it
+  if (!utc_timestamp.ok() || !new_node["measurements_v2"].is<JsonObject>() ||
+      raw_node_data["measurements_min_max"].is<JsonObject>() ||
+      raw_node_data["trend"].is<JsonObject>()) {
+    return;
+  }
+
+  JsonObject measurements_v2 = new_node["measurements_v2"].as<JsonObject>();
+  for (JsonPair device : measurements_v2) {
+    JsonObject metrics = device.value().as<JsonObject>();
+    for (const char* metric : TREND_METRICS) {
+      if (metrics[metric].isNull()) {
+        continue;
+      }
+      uint8_t points[Trend::POINTS];
+      uint32_t key =
+          MeasurementHistory::makeKey(node_name, device.key().c_str(), metric);
+      if (MeasurementHistory::trend(key, utc_timestamp.epoch(), points,
+                                    Trend::POINTS)) {
+        new_node["trend"][device.key()][metric] =
+            Trend::encode(points, Trend::POINTS);
+      }
+    }
+  }
+}
+
 void Model::addNodeStaleState(DateTime& utc_timestamp,
                               JsonObject& raw_node_data, JsonObject& new_node) {
   std::string node_stale = "";
   if (utc_timestamp.ok()) {
     if (raw_node_data["timestamp_utc"].is<JsonString>()) {
-      std::string measurements_timestamp_utc =
-          raw_node_data["timestamp_utc"].as<String>().c_str();
-      struct tm tm_node_utc;
-      DateTime node_utc_dt = DateTime(measurements_timestamp_utc);
+      const char* measurements_timestamp_utc =
+          raw_node_data["timestamp_utc"].as<const char*>();
+      DateTime node_utc_dt(measurements_timestamp_utc);
       if (node_utc_dt.ok()) {
         double diff = utc_timestamp.diff(node_utc_dt);
         if (diff < 0) {
@@ -196,9 +392,8 @@ void Model::addNodeStaleState(DateTime& utc_timestamp,
           node_stale = fmt::format("{:.0f}' old", diff / 60);
         }
       } else {
-        node_stale = fmt::format("(TS:{})", measurements_timestamp_utc.c_str());
-        Serial.printf("Bad timestamp: %s\n",
-                      measurements_timestamp_utc.c_str());
+        node_stale = fmt::format("(TS:{})", measurements_timestamp_utc);
+        LOG_WARN("Bad timestamp: %s", measurements_timestamp_utc);
       }
     }
   } else {
@@ -228,9 +423,9 @@ void Model::addNodeBatteryLevel(JsonObject& raw_node_data,
         raw_node_data["measurements_v2"].as<JsonObject>();
     if (measurements_v2["battery"].is<JsonObject>()) {
       JsonObject battery = measurements_v2["battery"].as<JsonObject>();
-      if (battery["battery_percentage"].is<JsonString>()) {
+      if (isNumber(battery["battery_percentage"])) {
         float battery_percentage =
-            float(battery["battery_percentage"].as<JsonFloat>());
+            float(readNumber(battery["battery_percentage"]));
         JsonString battery_level = JsonString(
             std::string{batteryLevelToChar(battery_percentage)}.c_str());
         new_node["battery_level"] = battery_level;
@@ -270,7 +465,7 @@ bool Model::operator==(const Model& other) const {
     }
 
     if (!(other.doc_)->operator[](key).is<JsonVariant>()) {
-      Serial.printf("Key '%s' not found in other model\n", key);
+      LOG_DEBUG("Key '%s' not found in other model", key);
       return false;
     }
 
@@ -278,33 +473,28 @@ bool Model::operator==(const Model& other) const {
     JsonVariant v2 = (*other.doc_)[key];
     if (v1.is<JsonObject>() && v2.is<JsonObject>()) {
       // Recursively compare objects
-      Model subModel1;
-      Model subModel2;
+      Model subModel1(allocator_);
+      Model subModel2(allocator_);
       subModel1.doc_->set(v1);
       subModel2.doc_->set(v2);
       if (!(subModel1 == subModel2)) {
-        Serial.printf("Map sub-models differ: %s vs %s\n",
-                      subModel1.toJsonString().c_str(),
-                      subModel2.toJsonString().c_str());
+        LOG_DEBUG("Map sub-models differ for key '%s'", key);
         return false;
       }
     } else if (v1.is<JsonArray>() && v2.is<JsonArray>()) {
       // Recursively compare arrays
-      Model subModel1;
-      Model subModel2;
+      Model subModel1(allocator_);
+      Model subModel2(allocator_);
       subModel1.doc_->set(v1);
       subModel2.doc_->set(v2);
       if (!(subModel1 == subModel2)) {
-        Serial.printf("Array sub-models differ: %s vs %s\n",
-                      subModel1.toJsonString().c_str(),
-                      subModel2.toJsonString().c_str());
+        LOG_DEBUG("Array sub-models differ for key '%s'", key);
         return false;
       }
     } else if (v1.is<JsonString>() && v2.is<JsonString>()) {
       if (v1.as<std::string>() != v2.as<std::string>()) {
-        Serial.printf("String values differ: %s vs %s\n",
-                      v1.as<std::string>().c_str(),
-                      v2.as<std::string>().c_str());
+        LOG_DEBUG("String values differ: %s vs %s",
+                  v1.as<std::string>().c_str(), v2.as<std::string>().c_str());
         return false;
       }
     } else if (v1.is<JsonFloat>() && v2.is<JsonFloat>()) {
@@ -314,29 +504,29 @@ bool Model::operator==(const Model& other) const {
       float f2_rounded = round(f2 * 10) / 10.0;
       // Compare rounded values as they match what is displayed
       if (fabs(f1_rounded - f2_rounded) > 0.11) {
-        Serial.printf(
-            "Float values differ: %.3f(%.1f) vs %.3f(%.1f), fabs: %.3f\n", f1,
-            f1_rounded, f2, f2_rounded, fabs(f1_rounded - f2_rounded));
+        LOG_DEBUG("Float values differ: %.3f(%.1f) vs %.3f(%.1f), fabs: %.3f",
+                  f1, f1_rounded, f2, f2_rounded,
+                  fabs(f1_rounded - f2_rounded));
         return false;
       }
     } else if (v1.is<JsonInteger>() && v2.is<JsonInteger>()) {
       if (v1.as<int>() != v2.as<int>()) {
-        Serial.printf("Integer values differ: %d vs %d\n", v1.as<int>(),
-                      v2.as<int>());
+        LOG_DEBUG("Integer values differ: %d vs %d", v1.as<int>(),
+                  v2.as<int>());
         return false;
       }
     } else if (v1.is<bool>() && v2.is<bool>()) {
       if (v1.as<bool>() != v2.as<bool>()) {
-        Serial.printf("Boolean values differ: %s vs %s\n",
-                      v1.as<bool>() ? "true" : "false",
-                      v2.as<bool>() ? "true" : "false");
+        LOG_DEBUG("Boolean values differ: %s vs %s",
+                  v1.as<bool>() ? "true" : "false",
+                  v2.as<bool>() ? "true" : "false");
         return false;
       }
     } else if (v1.isNull() && v2.isNull()) {
       // Both are null, considered equal
     } else {
       // Types differ or unsupported type
-      Serial.printf("Types differ or unsupported type for key '%s'\n", key);
+      LOG_DEBUG("Types differ or unsupported type for key '%s'", key);
       return false;
     }
   }
@@ -364,8 +554,8 @@ char Model::batteryLevelToChar(float battery_percentage) {
   if (level < 0) level = 0;
   if (level >= num_levels) level = num_levels - 1;
   int char_offset = round(level);
-  Serial.printf("Battery percentage: %.1f%%, level: %.1f, char_offset: %d\n",
-                battery_percentage, level, char_offset);
+  LOG_DEBUG("Battery percentage: %.1f%%, level: %.1f, char_offset: %d",
+            battery_percentage, level, char_offset);
   return battery_chars[char_offset];
 }
 
@@ -373,23 +563,32 @@ void Model::buildFromJson(JsonDocument* doc, DateTime utc_timestamp,
                           DateTime local_timestamp) {
   if (doc_ != nullptr) {
     delete doc_;
-    doc_ = new JsonDocument();
+    doc_ = newDocument();
   }
 
   std::string display_date = "(Date unknown)";
   if (local_timestamp.ok()) {
-    Serial.printf("Local date: %s\n",
-                  local_timestamp.format("%A %d %B %Y").c_str());
-    Serial.printf("Local time: %s\n",
-                  local_timestamp.format("%H:%M:%S").c_str());
-    display_date = local_timestamp.niceDate();
-    setTime(local_timestamp.format("%H:%M"));
+    char buffer[DateTime::NICE_DATE_SIZE];
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    local_timestamp.format(buffer, sizeof(buffer), "%A %d %B %Y");
+    LOG_DEBUG("Local date: %s", buffer);
+    local_timestamp.format(buffer, sizeof(buffer), "%H:%M:%S");
+    LOG_DEBUG("Local time: %s", buffer);
+#endif
+    local_timestamp.niceDate(buffer, sizeof(buffer));
+    display_date = buffer;
+    local_timestamp.format(buffer, sizeof(buffer), "%H:%M");
+    setTime(buffer);
     setDate(display_date);
   } else {
-    Serial.println("Local timestamp not OK");
+    LOG_WARN("Local timestamp not OK");
   }
 
   calculateSunAndMoon(local_timestamp, doc);
+  // Local readings go to the series of the node this display posts as
+  if (!current_device_id_.empty()) {
+    MeasurementHistory::setLocalNode(current_device_id_.c_str());
+  }
   addNodes((*doc)["nodes"], utc_timestamp);
 }
 
@@ -402,19 +601,19 @@ void Model::calculateSunAndMoon(DateTime local_timestamp, JsonDocument* doc) {
     JsonObject config = (*doc)["config"].as<JsonObject>();
     if (config["location"].is<JsonObject>()) {
       JsonObject location = config["location"].as<JsonObject>();
-      if (location["latitude"].is<JsonString>()) {
-        latitude = location["latitude"].as<String>().toDouble();
+      if (isNumber(location["latitude"])) {
+        latitude = readNumber(location["latitude"]);
       }
-      if (location["longitude"].is<JsonString>()) {
-        longitude = location["longitude"].as<String>().toDouble();
+      if (isNumber(location["longitude"])) {
+        longitude = readNumber(location["longitude"]);
       }
       if (location["utc_offset_seconds"].is<JsonInteger>()) {
         utc_offset_seconds = location["utc_offset_seconds"].as<int>();
       }
     }
   }
-  Serial.printf("Location: lat %.6f lon %.6f UTC offset %d seconds\n", latitude,
-                longitude, utc_offset_seconds);
+  LOG_DEBUG("Location: lat %.6f lon %.6f UTC offset %d seconds", latitude,
+            longitude, utc_offset_seconds);
 
   SunAndMoon sunAndMoon(local_timestamp.year(), local_timestamp.month(),
                         local_timestamp.day(), local_timestamp.hour(),
@@ -426,4 +625,9 @@ void Model::calculateSunAndMoon(DateTime local_timestamp, JsonDocument* doc) {
               std::string(1, sunAndMoon.getMoonPhaseLetter()),
               sunAndMoon.getMoonRise(), sunAndMoon.getMoonTransit(),
               sunAndMoon.getMoonSet());
+  // Kept in the persisted snapshot to restore the RTC cache after power loss
+  setEphemeris(sunAndMoon.getKey(), sunAndMoon.getEvents());
+  LOG_DEBUG("Sun/Moon events %s", sunAndMoon.fromTable()   ? "from table"
+                                   : sunAndMoon.fromCache() ? "from cache"
+                                                            : "calculated");
 }
\ No newline at end of file
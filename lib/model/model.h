@@ -8,11 +8,35 @@
 #include <ArduinoJson.h>
 
 #include "datetime.h"
+#include "sunmooncache.h"
 
 class Model {
  public:
+  // Newest get-display response schema understood, with native JSON numbers.
+  // Responses with numbers as strings are still accepted.
+  static const int WIRE_SCHEMA = 2;
+
+  // Parts of the get-display response a view renders, requested as a bitmap
+  // so the server leaves the rest out. Same bits as in get-display.py.
+  enum Field : uint32_t {
+    FIELD_BME680 = 1 << 0,      // BME680 temperature, humidity, pressure
+    FIELD_SHT31D = 1 << 1,      // SHT31D temperature, humidity
+    FIELD_BATTERY = 1 << 2,     // Battery percentage
+    FIELD_MIN_MAX = 1 << 3,     // 24h min/max of the sensors requested
+    FIELD_TREND = 1 << 4,       // Sparklines of the sensors requested
+    FIELD_BAD_STATUS = 1 << 5,  // Statuses other than "ok"
+    FIELD_STATUS = 1 << 6,      // All statuses
+    FIELD_VERSION = 1 << 7,     // Node firmware version
+  };
+
+  // Whether the metric's readings are kept in MeasurementHistory
+  static bool isHistoryMetric(const char* metric);
+
   Model();
-  Model(const std::string& json_str);
+  // The document is allocated from allocator when given, e.g. the wake
+  // cycle's JsonArena for a model that does not outlive the cycle
+  Model(const std::string& json_str,
+        ArduinoJson::Allocator* allocator = nullptr);
   ~Model();
   Model(const Model& other);
   Model& operator=(const Model& other);
@@ -34,6 +58,8 @@ class Model {
   std::string getMoonTransit() const;
   std::string getMoonPhase() const;
   char getMoonPhaseLetter() const;
+  void setEphemeris(const SunMoonKey& key, const SunMoonEvents& events);
+  bool getEphemeris(SunMoonKey& key, SunMoonEvents& events) const;
   void addNodes(JsonObject nodes, DateTime& utc_timestamp);
   void addNode(JsonPair& node, DateTime& utc_timestamp);
   void setHttpPostErrorCode(int error_code) {
@@ -45,6 +71,13 @@ class Model {
   void addNodeMeasurementsV2(JsonObject& raw_node_data, JsonObject& new_node);
   void addNodeMeasurementsMinMax(JsonObject& raw_node_data,
                                  JsonObject& new_node);
+  // Records the node's readings in MeasurementHistory
+  void addNodeHistory(JsonObject& raw_node_data, const char* node_name);
+  void addNodeHistoryMinMax(DateTime& utc_timestamp, JsonObject& new_node,
+                            const char* node_name);
+  void addNodeTrend(JsonObject& raw_node_data, JsonObject& new_node);
+  void addNodeHistoryTrend(DateTime& utc_timestamp, JsonObject& raw_node_data,
+                           JsonObject& new_node, const char* node_name);
   void addNodeStaleState(DateTime& utc_timestamp, JsonObject& raw_node_data,
                          JsonObject& new_node);
   void addNodeStatusSection(JsonObject& raw_node_data, JsonObject& new_node,
@@ -62,10 +95,13 @@ class Model {
 
  private:
   JsonDocument* doc_;
+  ArduinoJson::Allocator* allocator_ = nullptr;
   bool jsonLoadOK_ = false;
   int http_post_error_code_ = 0;
   std::string current_device_id_;
   std::string time_;
+  explicit Model(ArduinoJson::Allocator* allocator);
+  JsonDocument* newDocument() const;
   std::string get(std::string key, std::string subkey) const;
   char batteryLevelToChar(float battery_percentage);
 };
@@ -0,0 +1,256 @@
+#include "gorilla.h"
+
+#include <string.h>
+
+namespace {
+
+class BitWriter {
+ public:
+  BitWriter(uint8_t* out, size_t size) : out_(out), size_(size), bits_(0) {}
+
+  void write(uint32_t value, uint8_t count) {
+    for (int i = count - 1; i >= 0; i--) {
+      size_t byte = bits_ / 8;
+      if (byte >= size_) {
+        overflow_ = true;
+        return;
+      }
+      if (bits_ % 8 == 0) {
+        out_[byte] = 0;
+      }
+      if ((value >> i) & 1) {
+        out_[byte] |= 0x80 >> (bits_ % 8);
+      }
+      bits_++;
+    }
+  }
+  // Bytes used, 0 on overflow
+  size_t size() const { return overflow_ ? 0 : (bits_ + 7) / 8; }
+
+ private:
+  uint8_t* out_;
+  size_t size_;
+  size_t bits_;
+  bool overflow_ = false;
+};
+
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, size_t size)
+      : data_(data), size_(size), bits_(0) {}
+
+  uint32_t read(uint8_t count) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      size_t byte = bits_ / 8;
+      if (byte >= size_) {
+        truncated_ = true;
+        return 0;
+      }
+      value = (value << 1) | ((data_[byte] >> (7 - bits_ % 8)) & 1);
+      bits_++;
+    }
+    return value;
+  }
+  bool truncated() const { return truncated_; }
+  size_t size() const { return (bits_ + 7) / 8; }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t bits_;
+  bool truncated_ = false;
+};
+
+// Delta of delta buckets: prefix, prefix length and value bits
+struct Bucket {
+  uint8_t prefix;
+  uint8_t prefix_bits;
+  uint8_t value_bits;
+};
+const Bucket DOD_BUCKETS[] = {{0x2, 2, 7}, {0x6, 3, 9}, {0xE, 4, 12}};
+
+uint32_t floatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+uint8_t leadingZeros(uint32_t value) {
+  uint8_t count = 0;
+  for (uint32_t bit = 0x80000000u; bit != 0 && !(value & bit); bit >>= 1) {
+    count++;
+  }
+  return count;
+}
+
+uint8_t trailingZeros(uint32_t value) {
+  uint8_t count = 0;
+  for (uint32_t bit = 1; bit != 0 && !(value & bit); bit <<= 1) {
+    count++;
+  }
+  return count;
+}
+
+int32_t signExtend(uint32_t value, uint8_t bits) {
+  uint32_t sign = 1u << (bits - 1);
+  return static_cast<int32_t>((value ^ sign) - sign);
+}
+
+}  // namespace
+
+const uint8_t GorillaCodec::MAX_VALUES;
+const size_t GorillaCodec::MAX_RECORD_SIZE;
+
+void GorillaCodec::reset(uint8_t count) {
+  timestamp_ = 0;
+  delta_ = 0;
+  memset(values_, 0, sizeof(values_));
+  memset(leading_, 0, sizeof(leading_));
+  memset(trailing_, 0, sizeof(trailing_));
+  records_ = 0;
+  count_ = count > MAX_VALUES ? MAX_VALUES : count;
+}
+
+size_t GorillaCodec::encode(uint32_t timestamp, const float* values,
+                            uint8_t* out, size_t size) {
+  if (records_ > 0 && timestamp <= timestamp_) {
+    return 0;
+  }
+  BitWriter writer(out, size);
+  const GorillaCodec previous = *this;
+
+  if (records_ == 0) {
+    // The first record is stored as is
+    writer.write(timestamp, 32);
+    for (uint8_t i = 0; i < count_; i++) {
+      values_[i] = floatBits(values[i]);
+      leading_[i] = 0xFF;  // no window yet
+      writer.write(values_[i], 32);
+    }
+  } else {
+    int32_t delta = timestamp - timestamp_;
+    int32_t dod = delta - delta_;
+    if (dod == 0) {
+      writer.write(0, 1);
+    } else {
+      bool written = false;
+      for (const Bucket& bucket : DOD_BUCKETS) {
+        int32_t limit = 1 << (bucket.value_bits - 1);
+        if (dod >= -limit && dod < limit) {
+          uint32_t mask = (1u << bucket.value_bits) - 1;
+          writer.write(bucket.prefix, bucket.prefix_bits);
+          writer.write(static_cast<uint32_t>(dod) & mask, bucket.value_bits);
+          written = true;
+          break;
+        }
+      }
+      if (!written) {
+        writer.write(0xF, 4);
+        writer.write(static_cast<uint32_t>(dod), 32);
+      }
+    }
+    delta_ = delta;
+
+    for (uint8_t i = 0; i < count_; i++) {
+      uint32_t bits = floatBits(values[i]);
+      uint32_t x = bits ^ values_[i];
+      values_[i] = bits;
+      if (x == 0) {
+        writer.write(0, 1);
+        continue;
+      }
+      uint8_t leading = leadingZeros(x);
+      uint8_t trailing = trailingZeros(x);
+      if (leading_[i] != 0xFF && leading >= leading_[i] &&
+          trailing >= trailing_[i]) {
+        // Fits in the previous window
+        writer.write(0x2, 2);
+        writer.write(x >> trailing_[i], 32 - leading_[i] - trailing_[i]);
+      } else {
+        uint8_t meaningful = 32 - leading - trailing;
+        writer.write(0x3, 2);
+        writer.write(leading, 5);
+        writer.write(meaningful - 1, 5);
+        writer.write(x >> trailing, meaningful);
+        leading_[i] = leading;
+        trailing_[i] = trailing;
+      }
+    }
+  }
+
+  size_t written = writer.size();
+  if (written == 0) {
+    // out was too small, leave the state as it was
+    *this = previous;
+    return 0;
+  }
+  timestamp_ = timestamp;
+  records_++;
+  return written;
+}
+
+size_t GorillaCodec::decode(const uint8_t* data, size_t size,
+                            uint32_t& timestamp, float* values) {
+  BitReader reader(data, size);
+  GorillaCodec next = *this;
+
+  if (next.records_ == 0) {
+    next.timestamp_ = reader.read(32);
+    for (uint8_t i = 0; i < count_; i++) {
+      next.values_[i] = reader.read(32);
+      next.leading_[i] = 0xFF;
+    }
+  } else {
+    int32_t dod = 0;
+    if (reader.read(1)) {
+      // "10", "110" and "1110" select a bucket, "1111" a full 32 bits
+      uint8_t ones = 1;
+      while (ones < 4 && reader.read(1)) {
+        ones++;
+      }
+      uint8_t value_bits = ones < 4 ? DOD_BUCKETS[ones - 1].value_bits : 32;
+      uint32_t raw = reader.read(value_bits);
+      dod = value_bits == 32 ? static_cast<int32_t>(raw)
+                             : signExtend(raw, value_bits);
+    }
+    next.delta_ = delta_ + dod;
+    next.timestamp_ = timestamp_ + next.delta_;
+
+    for (uint8_t i = 0; i < count_; i++) {
+      if (reader.read(1) == 0) {
+        continue;
+      }
+      if (reader.read(1) == 1) {
+        uint8_t leading = reader.read(5);
+        uint8_t meaningful = reader.read(5) + 1;
+        if (leading + meaningful > 32) {
+          return 0;  // corrupt
+        }
+        next.leading_[i] = leading;
+        next.trailing_[i] = 32 - leading - meaningful;
+      } else if (next.leading_[i] == 0xFF) {
+        return 0;  // corrupt, no window to reuse
+      }
+      uint8_t meaningful = 32 - next.leading_[i] - next.trailing_[i];
+      next.values_[i] ^= reader.read(meaningful) << next.trailing_[i];
+    }
+  }
+
+  if (reader.truncated()) {
+    return 0;
+  }
+  next.records_++;
+  *this = next;
+  timestamp = timestamp_;
+  for (uint8_t i = 0; i < count_; i++) {
+    values[i] = bitsFloat(values_[i]);
+  }
+  return reader.size();
+}
@@ -0,0 +1,49 @@
+#ifndef GORILLA_H
+#define GORILLA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Record compression after Facebook's Gorilla: timestamps as delta of
+ * deltas, values as the XOR with the previous value of the same channel,
+ * storing only the bits between the leading and trailing zeros.
+ *
+ * A record is a timestamp and a fixed count of float values. Records are
+ * padded to whole bytes so they can be appended to a file one at a time,
+ * and a truncated last record is detected and dropped when decoding.
+ *
+ * The state is plain data, so encoders can be kept in RTC memory across
+ * deep sleep.
+ */
+class GorillaCodec {
+ public:
+  static const uint8_t MAX_VALUES = 8;
+  // Worst case: 36 bits of timestamp and 44 bits per value, or a first
+  // record of raw 32 bit fields
+  static const size_t MAX_RECORD_SIZE = (36 + 44 * MAX_VALUES + 7) / 8;
+
+  void reset(uint8_t count);
+  uint8_t count() const { return count_; }
+  uint16_t records() const { return records_; }
+  uint32_t lastTimestamp() const { return timestamp_; }
+
+  // Encodes a record into out, returns its size or 0 when out is too small
+  // or timestamps do not increase
+  size_t encode(uint32_t timestamp, const float* values, uint8_t* out,
+                size_t size);
+  // Decodes the record at data, returns its size or 0 when it is truncated
+  size_t decode(const uint8_t* data, size_t size, uint32_t& timestamp,
+                float* values);
+
+ private:
+  uint32_t timestamp_;
+  int32_t delta_;
+  uint32_t values_[MAX_VALUES];
+  uint8_t leading_[MAX_VALUES];
+  uint8_t trailing_[MAX_VALUES];
+  uint16_t records_;
+  uint8_t count_;
+};
+
+#endif  // GORILLA_H
@@ -0,0 +1,245 @@
+#include "offlinelog.h"
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <string.h>
+
+#include "logging.h"
+
+namespace {
+
+const uint32_t LOG_MAGIC = 0x4F4C4701;
+const uint8_t SEGMENT_MAGIC[] = {'G', 'L', 'G', '1'};
+// Magic, sequence and channel count, then the channel ids
+const size_t HEADER_SIZE = 9;
+
+struct LogState {
+  uint32_t magic;
+  uint32_t oldest;  // sequence of the oldest segment that may exist
+  uint32_t next;    // sequence of the next segment
+  bool open;        // records can be added to segment next - 1
+  uint16_t size;    // of the open segment
+  uint8_t channels[GorillaCodec::MAX_VALUES];
+  GorillaCodec codec;
+};
+
+RTC_DATA_ATTR LogState rtc_log;
+
+void segmentPath(uint32_t sequence, char* path, size_t size) {
+  snprintf(path, size, "/offline-%u.log",
+           static_cast<unsigned>(sequence % OfflineLog::MAX_SEGMENTS));
+}
+
+uint32_t readUint32(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// Reads a whole segment, false if missing or not the expected sequence
+bool readSegment(uint32_t sequence, uint8_t* data, size_t& size) {
+  char path[24];
+  segmentPath(sequence, path, sizeof(path));
+  if (!LittleFS.exists(path)) {
+    return false;
+  }
+  File file = LittleFS.open(path, "r");
+  if (!file) {
+    return false;
+  }
+  size = file.read(data, OfflineLog::SEGMENT_SIZE);
+  file.close();
+  return size >= HEADER_SIZE && memcmp(data, SEGMENT_MAGIC, 4) == 0 &&
+         readUint32(data + 4) == sequence &&
+         data[8] <= GorillaCodec::MAX_VALUES &&
+         size >= HEADER_SIZE + data[8];
+}
+
+// Rebuilds the sequence range from the segment headers after a power loss
+void recover(LogState& log) {
+  log.magic = LOG_MAGIC;
+  log.oldest = 0;
+  log.next = 0;
+  log.open = false;
+  bool found = false;
+  for (uint8_t i = 0; i < OfflineLog::MAX_SEGMENTS; i++) {
+    char path[24];
+    segmentPath(i, path, sizeof(path));
+    if (!LittleFS.exists(path)) {
+      continue;
+    }
+    File file = LittleFS.open(path, "r");
+    uint8_t header[HEADER_SIZE];
+    if (file && file.read(header, HEADER_SIZE) == HEADER_SIZE &&
+        memcmp(header, SEGMENT_MAGIC, 4) == 0) {
+      uint32_t sequence = readUint32(header + 4);
+      if (!found || sequence < log.oldest) log.oldest = sequence;
+      if (!found || sequence >= log.next) log.next = sequence + 1;
+      found = true;
+    }
+    file.close();
+  }
+  LOG_INFO("Offline log recovered, segments %u to %u",
+           static_cast<unsigned>(log.oldest),
+           static_cast<unsigned>(log.next));
+}
+
+LogState& state() {
+  if (rtc_log.magic != LOG_MAGIC) {
+    recover(rtc_log);
+  }
+  return rtc_log;
+}
+
+bool startSegment(LogState& log, uint32_t timestamp, const uint8_t* channels,
+                  const float* values, uint8_t count) {
+  uint32_t sequence = log.next++;
+  if (sequence - log.oldest >= OfflineLog::MAX_SEGMENTS) {
+    LOG_WARN("Offline log full, dropping the oldest segment");
+    log.oldest = sequence - OfflineLog::MAX_SEGMENTS + 1;
+  }
+
+  uint8_t data[HEADER_SIZE + GorillaCodec::MAX_VALUES +
+               GorillaCodec::MAX_RECORD_SIZE];
+  memcpy(data, SEGMENT_MAGIC, 4);
+  for (int i = 0; i < 4; i++) {
+    data[4 + i] = (sequence >> (8 * i)) & 0xFF;
+  }
+  data[8] = count;
+  memcpy(data + HEADER_SIZE, channels, count);
+  log.codec.reset(count);
+  size_t size = HEADER_SIZE + count;
+  size += log.codec.encode(timestamp, values, data + size, sizeof(data) - size);
+
+  char path[24];
+  segmentPath(sequence, path, sizeof(path));
+  File file = LittleFS.open(path, "w");
+  log.open = file && file.write(data, size) == size;
+  file.close();
+  log.size = size;
+  memcpy(log.channels, channels, count);
+  return log.open;
+}
+
+}  // namespace
+
+const OfflineChannel OfflineLog::CHANNELS[CHANNEL_COUNT] = {
+    {"bme680", "temperature", 2}, {"bme680", "humidity", 2},
+    {"bme680", "pressure", 0},    {"sht31d", "temperature", 2},
+    {"sht31d", "humidity", 2},    {"battery", "battery_voltage", 2},
+    {"battery", "battery_percentage", 0}};
+
+const uint8_t OfflineLog::MAX_SEGMENTS;
+const size_t OfflineLog::SEGMENT_SIZE;
+const size_t OfflineLog::REPLAY_BATCH;
+const uint32_t OfflineLog::MIN_VALID_EPOCH;
+
+bool OfflineLog::append(uint32_t timestamp, const uint8_t* channels,
+                        const float* values, uint8_t count) {
+  if (count == 0 || count > GorillaCodec::MAX_VALUES) {
+    return false;
+  }
+  LittleFS.begin(true);
+  LogState& log = state();
+
+  bool appended = false;
+  if (log.open && log.codec.count() == count &&
+      memcmp(log.channels, channels, count) == 0) {
+    GorillaCodec codec = log.codec;
+    uint8_t record[GorillaCodec::MAX_RECORD_SIZE];
+    size_t size = codec.encode(timestamp, values, record, sizeof(record));
+    if (size > 0 && log.size + size <= SEGMENT_SIZE) {
+      char path[24];
+      segmentPath(log.next - 1, path, sizeof(path));
+      File file = LittleFS.open(path, "a");
+      appended = file && file.write(record, size) == size;
+      file.close();
+      if (appended) {
+        log.codec = codec;
+        log.size += size;
+      } else {
+        // Unknown state, do not append to it again
+        log.open = false;
+      }
+    }
+  }
+  if (!appended) {
+    appended = startSegment(log, timestamp, channels, values, count);
+  }
+
+  LittleFS.end();
+  return appended;
+}
+
+size_t OfflineLog::replay(const ReplayBatch& send, uint8_t max_segments) {
+  LittleFS.begin(true);
+  LogState& log = state();
+
+  size_t sent = 0;
+  uint8_t* data = new uint8_t[SEGMENT_SIZE];
+  OfflineRecord* records = new OfflineRecord[REPLAY_BATCH];
+  for (uint8_t replayed = 0; replayed < max_segments && log.oldest != log.next;
+       replayed++) {
+    uint32_t sequence = log.oldest;
+    if (sequence == log.next - 1) {
+      // Later records go to a new segment
+      log.open = false;
+    }
+
+    size_t size = 0;
+    bool ok = true;
+    if (readSegment(sequence, data, size)) {
+      uint8_t count = data[8];
+      const uint8_t* channels = data + HEADER_SIZE;
+      GorillaCodec codec;
+      codec.reset(count);
+      size_t offset = HEADER_SIZE + count;
+      size_t batch = 0;
+      while (ok) {
+        size_t used = codec.decode(data + offset, size - offset,
+                                   records[batch].timestamp,
+                                   records[batch].values);
+        offset += used;
+        batch += used > 0;
+        if (batch == REPLAY_BATCH || (used == 0 && batch > 0)) {
+          ok = send(channels, count, records, batch);
+          sent += ok ? batch : 0;
+          batch = 0;
+        }
+        if (used == 0) {
+          break;
+        }
+      }
+    }
+    if (!ok) {
+      break;
+    }
+
+    char path[24];
+    segmentPath(sequence, path, sizeof(path));
+    LittleFS.remove(path);
+    log.oldest++;
+  }
+  delete[] records;
+  delete[] data;
+
+  LittleFS.end();
+  return sent;
+}
+
+bool OfflineLog::empty() {
+  LittleFS.begin(true);
+  bool empty = state().oldest == state().next;
+  LittleFS.end();
+  return empty;
+}
+
+void OfflineLog::clear() {
+  LittleFS.begin(true);
+  for (uint8_t i = 0; i < MAX_SEGMENTS; i++) {
+    char path[24];
+    segmentPath(i, path, sizeof(path));
+    LittleFS.remove(path);
+  }
+  rtc_log.magic = 0;
+  LittleFS.end();
+}
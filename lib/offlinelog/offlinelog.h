@@ -0,0 +1,79 @@
+#ifndef OFFLINE_LOG_H
+#define OFFLINE_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+#include "gorilla.h"
+
+/**
+ * What a logged value is, as in the POST payload.
+ */
+struct OfflineChannel {
+  const char* device;
+  const char* metric;
+  uint8_t decimals;
+};
+
+struct OfflineRecord {
+  uint32_t timestamp;
+  float values[GorillaCodec::MAX_VALUES];
+};
+
+/**
+ * Readings taken while the server could not be reached, kept in LittleFS
+ * until they can be sent.
+ *
+ * The log is a ring of MAX_SEGMENTS files of at most SEGMENT_SIZE bytes, so
+ * it never takes more than MAX_SEGMENTS blocks and writes move round the
+ * ring rather than hitting the same file. When the ring is full the oldest
+ * segment is overwritten.
+ *
+ * Each segment starts with a header naming its channels, followed by
+ * Gorilla compressed records. The encoder state is kept in RTC memory
+ * between wakes. When it is lost, or the channels change, a new segment is
+ * started.
+ */
+class OfflineLog {
+ public:
+  // Ids are stored in the log, only add to the end
+  enum ChannelId : uint8_t {
+    BME680_TEMPERATURE,
+    BME680_HUMIDITY,
+    BME680_PRESSURE,
+    SHT31D_TEMPERATURE,
+    SHT31D_HUMIDITY,
+    BATTERY_VOLTAGE,
+    BATTERY_PERCENTAGE,
+    CHANNEL_COUNT
+  };
+  static const OfflineChannel CHANNELS[CHANNEL_COUNT];
+
+  static const uint8_t MAX_SEGMENTS = 8;
+  // One LittleFS block, about 3 days of readings every 10 minutes
+  static const size_t SEGMENT_SIZE = 4096;
+  static const size_t REPLAY_BATCH = 48;
+  // 2020-01-01, clocks before that were never set
+  static const uint32_t MIN_VALID_EPOCH = 1577836800;
+
+  // Called with consecutive records of one segment, returns false when they
+  // could not be sent
+  typedef std::function<bool(const uint8_t* channels, uint8_t channel_count,
+                             const OfflineRecord* records, size_t count)>
+      ReplayBatch;
+
+  static bool append(uint32_t timestamp, const uint8_t* channels,
+                     const float* values, uint8_t count);
+  // Sends up to max_segments segments, oldest first, deleting each one once
+  // all its batches were sent. Returns the count of records sent.
+  //
+  // A segment that failed part way is sent again from its start next time,
+  // so batches must be idempotent on the receiving end.
+  static size_t replay(const ReplayBatch& send, uint8_t max_segments);
+  static bool empty();
+  static void clear();
+};
+
+#endif  // OFFLINE_LOG_H
@@ -0,0 +1,263 @@
+#include "deltapatch.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+const uint8_t PATCH_MAGIC[] = {'W', 'D', 'P', '1'};
+
+uint32_t readUint32(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// New image bytes on their way to flash, written in blocks rather than one
+// run at a time
+class Output {
+ public:
+  static const size_t SIZE = 512;
+
+  Output(uint32_t end, Sha256& hash, const DeltaPatch::WriteNew& write)
+      : end_(end), used_(0), hash_(hash), write_(write) {}
+
+  uint8_t* space() { return buffer_ + used_; }
+  size_t available() const { return SIZE - used_; }
+  bool commit(size_t size) {
+    used_ += size;
+    end_ += size;
+    return used_ < SIZE || flush();
+  }
+  bool flush() {
+    if (used_ == 0) {
+      return true;
+    }
+    bool ok = write_(end_ - used_, buffer_, used_);
+    hash_.update(buffer_, used_);
+    used_ = 0;
+    return ok;
+  }
+
+ private:
+  uint8_t buffer_[SIZE];
+  uint32_t end_;
+  size_t used_;
+  Sha256& hash_;
+  const DeltaPatch::WriteNew& write_;
+};
+
+}  // namespace
+
+const size_t DeltaPatch::HEADER_SIZE;
+
+void DeltaPatch::reset() {
+  header_used_ = 0;
+  stage_ = HEADER;
+  varint_ = 0;
+  shift_ = 0;
+  copy_left_ = 0;
+  extra_left_ = 0;
+  run_left_ = 0;
+  seek_ = 0;
+  old_pos_ = 0;
+  written_ = 0;
+  hash_.reset();
+}
+
+uint32_t DeltaPatch::oldSize() const { return readUint32(header_ + 4); }
+
+uint32_t DeltaPatch::newSize() const {
+  return header_used_ == HEADER_SIZE ? readUint32(header_ + 8) : 0;
+}
+
+bool DeltaPatch::checkOld(const ReadOld& read_old) const {
+  Sha256 hash;
+  hash.reset();
+  uint8_t buffer[256];
+  for (uint32_t offset = 0; offset < oldSize(); offset += sizeof(buffer)) {
+    size_t size = std::min<uint32_t>(sizeof(buffer), oldSize() - offset);
+    if (!read_old(offset, buffer, size)) {
+      return false;
+    }
+    hash.update(buffer, size);
+  }
+  uint8_t digest[Sha256::DIGEST_SIZE];
+  hash.finish(digest);
+  return memcmp(digest, header_ + 12, sizeof(digest)) == 0;
+}
+
+bool DeltaPatch::endOfCopy() {
+  if (extra_left_ > 0) {
+    stage_ = EXTRA;
+    return true;
+  }
+  return endOfOperation();
+}
+
+bool DeltaPatch::endOfOperation() {
+  int64_t position = static_cast<int64_t>(old_pos_) + seek_;
+  if (position < 0 || position > oldSize()) {
+    return false;
+  }
+  old_pos_ = position;
+  stage_ = written_ == newSize() ? DONE : COPY_LENGTH;
+  return true;
+}
+
+bool DeltaPatch::apply(const uint8_t* data, size_t size,
+                       const ReadOld& read_old, const WriteNew& write_new) {
+  Output out(written_, hash_, write_new);
+  // Appends size bytes of the old image to the output, to which the patch
+  // bytes are added if there are any
+  auto copyOld = [&](size_t size, const uint8_t* differences) {
+    if (old_pos_ + size > oldSize() || written_ + size > newSize()) {
+      return false;
+    }
+    while (size > 0) {
+      size_t chunk = std::min(size, out.available());
+      uint8_t* space = out.space();
+      if (!read_old(old_pos_, space, chunk)) {
+        return false;
+      }
+      if (differences != nullptr) {
+        for (size_t i = 0; i < chunk; i++) {
+          space[i] += differences[i];
+        }
+        differences += chunk;
+      }
+      old_pos_ += chunk;
+      written_ += chunk;
+      size -= chunk;
+      if (!out.commit(chunk)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  size_t i = 0;
+  while (i < size) {
+    switch (stage_) {
+      case HEADER: {
+        size_t chunk = std::min<size_t>(HEADER_SIZE - header_used_, size - i);
+        memcpy(header_ + header_used_, data + i, chunk);
+        header_used_ += chunk;
+        i += chunk;
+        if (header_used_ < HEADER_SIZE) {
+          break;
+        }
+        if (memcmp(header_, PATCH_MAGIC, sizeof(PATCH_MAGIC)) != 0 ||
+            !checkOld(read_old)) {
+          return false;
+        }
+        stage_ = newSize() == 0 ? DONE : COPY_LENGTH;
+        break;
+      }
+
+      case LITERALS: {
+        size_t chunk = std::min<size_t>(run_left_, size - i);
+        if (!copyOld(chunk, data + i)) {
+          return false;
+        }
+        i += chunk;
+        run_left_ -= chunk;
+        if (run_left_ == 0 && copy_left_ == 0 && !endOfCopy()) {
+          return false;
+        } else if (run_left_ == 0 && copy_left_ > 0) {
+          stage_ = ZERO_RUN;
+        }
+        break;
+      }
+
+      case EXTRA: {
+        size_t chunk = std::min<size_t>(extra_left_, size - i);
+        if (written_ + chunk > newSize()) {
+          return false;
+        }
+        for (size_t done = 0; done < chunk;) {
+          size_t part = std::min(chunk - done, out.available());
+          memcpy(out.space(), data + i + done, part);
+          written_ += part;
+          done += part;
+          if (!out.commit(part)) {
+            return false;
+          }
+        }
+        i += chunk;
+        extra_left_ -= chunk;
+        if (extra_left_ == 0 && !endOfOperation()) {
+          return false;
+        }
+        break;
+      }
+
+      case DONE:
+        // Trailing data
+        return false;
+
+      default: {
+        uint8_t byte = data[i++];
+        if (shift_ > 28) {
+          return false;
+        }
+        varint_ |= static_cast<uint32_t>(byte & 0x7F) << shift_;
+        shift_ += 7;
+        if (byte & 0x80) {
+          break;
+        }
+        uint32_t value = varint_;
+        varint_ = 0;
+        shift_ = 0;
+
+        if (stage_ == COPY_LENGTH) {
+          copy_left_ = value;
+          stage_ = EXTRA_LENGTH;
+        } else if (stage_ == EXTRA_LENGTH) {
+          extra_left_ = value;
+          stage_ = SEEK;
+        } else if (stage_ == SEEK) {
+          // Zigzag coded
+          seek_ = static_cast<int32_t>(value >> 1) ^
+                  -static_cast<int32_t>(value & 1);
+          if (copy_left_ > 0) {
+            stage_ = ZERO_RUN;
+          } else if (!endOfCopy()) {
+            return false;
+          }
+        } else if (stage_ == ZERO_RUN) {
+          if (value > copy_left_ || !copyOld(value, nullptr)) {
+            return false;
+          }
+          copy_left_ -= value;
+          stage_ = LITERAL_RUN;
+        } else {
+          if (value > copy_left_) {
+            return false;
+          }
+          copy_left_ -= value;
+          run_left_ = value;
+          if (run_left_ > 0) {
+            stage_ = LITERALS;
+          } else if (copy_left_ > 0) {
+            stage_ = ZERO_RUN;
+          } else if (!endOfCopy()) {
+            return false;
+          }
+        }
+        break;
+      }
+    }
+  }
+  return out.flush();
+}
+
+bool DeltaPatch::verify() const {
+  if (stage_ != DONE) {
+    return false;
+  }
+  uint8_t digest[Sha256::DIGEST_SIZE];
+  hash_.finish(digest);
+  return memcmp(digest, header_ + 12 + Sha256::DIGEST_SIZE, sizeof(digest)) ==
+         0;
+}
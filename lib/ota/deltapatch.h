@@ -0,0 +1,85 @@
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+#include "sha256stream.h"
+
+/**
+ * Streaming applier for the firmware patches made by ota_delta.py, which
+ * rebuild a new image from the running one.
+ *
+ * A patch is a header, with the sizes and SHA-256 of both images, followed
+ * by bsdiff style operations:
+ *
+ *   varint copy, varint extra, zigzag varint seek
+ *   copy bytes of the old image plus a difference, the differences coded as
+ *     alternating runs "varint zeros, varint literals, literal bytes"
+ *   extra bytes as is
+ *   then the old position moves by seek
+ *
+ * Code moved around between builds differs from the old code mostly by a
+ * few address bytes, so the differences are mostly zero runs.
+ *
+ * The state is plain data and patch bytes can be fed in pieces of any
+ * size, so a download can be resumed after deep sleep.
+ */
+class DeltaPatch {
+ public:
+  static const size_t HEADER_SIZE = 76;
+
+  // Read from the old image, write to the new one, false on failure
+  typedef std::function<bool(uint32_t offset, uint8_t* data, size_t size)>
+      ReadOld;
+  typedef std::function<bool(uint32_t offset, const uint8_t* data,
+                             size_t size)>
+      WriteNew;
+
+  void reset();
+  // Applies the next size bytes of the patch. Returns false when the patch
+  // is corrupt, does not apply to the old image or I/O failed.
+  bool apply(const uint8_t* data, size_t size, const ReadOld& read_old,
+             const WriteNew& write_new);
+
+  bool done() const { return stage_ == DONE; }
+  uint32_t written() const { return written_; }
+  uint32_t newSize() const;
+  // True when the whole new image was written and its hash matches
+  bool verify() const;
+
+ private:
+  enum Stage : uint8_t {
+    HEADER,
+    COPY_LENGTH,
+    EXTRA_LENGTH,
+    SEEK,
+    ZERO_RUN,
+    LITERAL_RUN,
+    LITERALS,
+    EXTRA,
+    DONE
+  };
+
+  uint8_t header_[HEADER_SIZE];
+  uint8_t header_used_;
+  Stage stage_;
+  uint32_t varint_;
+  uint8_t shift_;
+  uint32_t copy_left_;
+  uint32_t extra_left_;
+  uint32_t run_left_;
+  int32_t seek_;
+  uint32_t old_pos_;
+  uint32_t written_;
+  Sha256 hash_;
+
+  uint32_t oldSize() const;
+  bool checkOld(const ReadOld& read_old) const;
+  bool endOfCopy();
+  bool endOfOperation();
+};
+
+#endif  // DELTA_PATCH_H
@@ -0,0 +1,128 @@
+#include "otaprogress.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+namespace {
+
+const uint32_t PROGRESS_MAGIC = 0x4F544131;
+
+struct Progress {
+  uint32_t magic;
+  uint8_t expected[Sha256::DIGEST_SIZE];
+  uint32_t size;
+  uint32_t partition_address;
+  uint32_t offset;
+  uint16_t resumes;
+  Sha256 hash;
+  DeltaPatch patch;
+};
+
+RTC_DATA_ATTR Progress rtc_progress;
+RTC_DATA_ATTR uint8_t rtc_rejected[Sha256::DIGEST_SIZE];
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+}  // namespace
+
+const size_t OtaProgress::CHUNK_SIZE;
+
+bool OtaProgress::parseDigest(const char* hex, uint8_t* digest) {
+  if (hex == nullptr || strlen(hex) != 2 * Sha256::DIGEST_SIZE) {
+    return false;
+  }
+  for (size_t i = 0; i < Sha256::DIGEST_SIZE; i++) {
+    int high = hexValue(hex[2 * i]);
+    int low = hexValue(hex[2 * i + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+    digest[i] = (high << 4) | low;
+  }
+  return true;
+}
+
+bool OtaProgress::begin(const char* sha256_hex, uint32_t size,
+                        uint32_t partition_address) {
+  uint8_t expected[Sha256::DIGEST_SIZE];
+  if (!parseDigest(sha256_hex, expected)) {
+    return false;
+  }
+
+  Progress& progress = rtc_progress;
+  if (progress.magic == PROGRESS_MAGIC && progress.size == size &&
+      progress.partition_address == partition_address &&
+      memcmp(progress.expected, expected, sizeof(expected)) == 0) {
+    if (progress.offset > 0 && progress.offset < size) {
+      progress.resumes++;
+    }
+    return true;
+  }
+
+  progress.magic = PROGRESS_MAGIC;
+  memcpy(progress.expected, expected, sizeof(expected));
+  progress.size = size;
+  progress.partition_address = partition_address;
+  progress.offset = 0;
+  progress.resumes = 0;
+  progress.hash.reset();
+  progress.patch.reset();
+  return true;
+}
+
+uint32_t OtaProgress::offset() {
+  return rtc_progress.magic == PROGRESS_MAGIC ? rtc_progress.offset : 0;
+}
+
+uint32_t OtaProgress::size() {
+  return rtc_progress.magic == PROGRESS_MAGIC ? rtc_progress.size : 0;
+}
+
+uint16_t OtaProgress::resumes() {
+  return rtc_progress.magic == PROGRESS_MAGIC ? rtc_progress.resumes : 0;
+}
+
+void OtaProgress::restart() {
+  rtc_progress.offset = 0;
+  rtc_progress.hash.reset();
+  rtc_progress.patch.reset();
+}
+
+void OtaProgress::add(const uint8_t* data, size_t size) {
+  if (rtc_progress.magic != PROGRESS_MAGIC) {
+    return;
+  }
+  rtc_progress.hash.update(data, size);
+  rtc_progress.offset += size;
+}
+
+bool OtaProgress::verify() {
+  if (rtc_progress.magic != PROGRESS_MAGIC ||
+      rtc_progress.offset != rtc_progress.size) {
+    return false;
+  }
+  uint8_t digest[Sha256::DIGEST_SIZE];
+  rtc_progress.hash.finish(digest);
+  return memcmp(digest, rtc_progress.expected, sizeof(digest)) == 0;
+}
+
+void OtaProgress::clear() { rtc_progress.magic = 0; }
+
+DeltaPatch& OtaProgress::patch() { return rtc_progress.patch; }
+
+void OtaProgress::reject() {
+  if (rtc_progress.magic == PROGRESS_MAGIC) {
+    memcpy(rtc_rejected, rtc_progress.expected, sizeof(rtc_rejected));
+  }
+}
+
+bool OtaProgress::rejected(const char* sha256_hex) {
+  uint8_t digest[Sha256::DIGEST_SIZE];
+  return parseDigest(sha256_hex, digest) &&
+         memcmp(digest, rtc_rejected, sizeof(digest)) == 0;
+}
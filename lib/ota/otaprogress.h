@@ -0,0 +1,55 @@
+#ifndef OTA_PROGRESS_H
+#define OTA_PROGRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "deltapatch.h"
+#include "sha256stream.h"
+
+/**
+ * Progress of a firmware download, kept in RTC memory so a transfer that
+ * broke off resumes from the last byte written on the next wake, with a
+ * Range request, rather than from the start.
+ *
+ * A download is identified by the SHA-256 and size of the image, as the
+ * URL is presigned afresh on each wake, and by the partition it goes to.
+ * The hash of the bytes written so far is kept along with the offset, so
+ * the image is verified without reading it back from flash. When the
+ * download is a patch, the state of the patch applier is kept too.
+ */
+class OtaProgress {
+ public:
+  // One flash sector, so each chunk erases at most one sector, and large
+  // enough to drain a TLS record in a few reads
+  static const size_t CHUNK_SIZE = 4096;
+
+  // Resumes the download if it is the one in progress, otherwise starts it
+  // from scratch. Returns false if the digest is not 64 hex digits.
+  static bool begin(const char* sha256_hex, uint32_t size,
+                    uint32_t partition_address);
+  static uint32_t offset();
+  static uint32_t size();
+  static bool complete() { return size() > 0 && offset() == size(); }
+  // Times this download was resumed
+  static uint16_t resumes();
+  // Starts the current download over, e.g. when the server ignored the range
+  static void restart();
+  // Accounts for bytes written at offset()
+  static void add(const uint8_t* data, size_t size);
+  // True when complete and the hash matches
+  static bool verify();
+  static void clear();
+
+  // Applier of the download when it is a patch, reset with the download
+  static DeltaPatch& patch();
+  // Remembers that the current download is a patch that did not apply, so
+  // the full image is downloaded instead
+  static void reject();
+  static bool rejected(const char* sha256_hex);
+
+  // Parses 64 hex digits
+  static bool parseDigest(const char* hex, uint8_t* digest);
+};
+
+#endif  // OTA_PROGRESS_H
@@ -0,0 +1,31 @@
+#ifndef SHA256_STREAM_H
+#define SHA256_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * SHA-256 over data fed in pieces.
+ *
+ * Unlike the mbedTLS context, which may live in the hardware accelerator,
+ * the state is plain data, so a partial hash can be kept in RTC memory and
+ * continued after deep sleep.
+ */
+class Sha256 {
+ public:
+  static const size_t DIGEST_SIZE = 32;
+
+  void reset();
+  void update(const uint8_t* data, size_t size);
+  // Writes the digest of the data so far, the state is left as it was
+  void finish(uint8_t* digest) const;
+
+ private:
+  uint32_t state_[8];
+  uint64_t length_;
+  uint8_t buffer_[64];
+
+  static void transform(uint32_t* state, const uint8_t* block);
+};
+
+#endif  // SHA256_STREAM_H
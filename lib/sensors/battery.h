@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 #include "config.h"
+#include "logging.h"
 #include "sensor.h"
 
 #ifdef HAS_BATTERY
@@ -15,8 +16,8 @@ class BatterySensor : public Sensor {
 
   bool init() override {
     // No initialization needed for battery monitoring
-    Serial.printf("Battery voltage: %.2f V (raw %d)\n", getBatteryVoltage(),
-                  getBatteryVoltageRaw());
+    LOG_INFO("Battery voltage: %.2f V (raw %d)", getBatteryVoltage(),
+             getBatteryVoltageRaw());
     return true;
   }
 
@@ -29,8 +30,7 @@ class BatterySensor : public Sensor {
     std::map<std::string, Measurement> data;
     float voltage = getBatteryVoltage();
     float percent = getBatteryPercent();
-    Serial.printf("In read(): Battery voltage: %.2f V, percent: %.0f%%\n",
-                  voltage, percent);
+    LOG_DEBUG("Battery voltage: %.2f V, percent: %.0f%%", voltage, percent);
     data["voltage"] = {voltage, "V"};
     data["percent"] = {percent, "%"};
     return data;
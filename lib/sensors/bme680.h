@@ -6,6 +6,7 @@
 #include <Wire.h>
 
 #include "config.h"
+#include "logging.h"
 #include "sensor.h"
 
 class BME680Sensor : public Sensor {
@@ -21,9 +22,9 @@ class BME680Sensor : public Sensor {
 #ifdef BME680_ENABLE_GAS_HEATER
       bme.setGasHeater(320, 150);  // 320°C for 150 ms
 #endif
-      Serial.println("BME680 sensor initialized");
+      LOG_INFO("BME680 sensor initialized");
     } else {
-      Serial.println("Could not find a valid BME680 sensor, check wiring!");
+      LOG_ERROR("Could not find a valid BME680 sensor, check wiring!");
     }
     return ok_;
   }
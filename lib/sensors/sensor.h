@@ -20,6 +20,11 @@ class Sensor {
   // Report if the sensor is working correctly
   virtual bool ok() const = 0;
 
+  // Called instead of init() on wakes from light sleep, which keep the
+  // sensor's configuration (I2C setup, calibration) as it was. Only a sensor
+  // that failed to initialize is tried again.
+  virtual bool resume() { return ok() || init(); }
+
   // Read measurements from the sensor
   // Returns a map: measurement name -> Measurement struct
   virtual std::map<std::string, Measurement> read() = 0;
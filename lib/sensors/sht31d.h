@@ -6,6 +6,7 @@
 #include <Wire.h>
 
 #include "config.h"
+#include "logging.h"
 #include "sensor.h"
 
 class SHT31DSensor : public Sensor {
@@ -14,9 +15,9 @@ class SHT31DSensor : public Sensor {
 
   bool init() override {
     if ((ok_ = sht31.begin(SHT31D_I2C_ADDR))) {
-      Serial.println("SHT31D sensor initialized");
+      LOG_INFO("SHT31D sensor initialized");
     } else {
-      Serial.println("Could not find a valid SHT31D sensor, check wiring!");
+      LOG_ERROR("Could not find a valid SHT31D sensor, check wiring!");
     }
     return ok_;
   }
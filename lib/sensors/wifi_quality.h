@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "logging.h"
+
 class WiFiSensor : public Sensor {
  public:
   WiFiSensor() {};
@@ -10,7 +12,7 @@ class WiFiSensor : public Sensor {
   bool init() override {
     // No initialization needed for WiFi monitoring
     int8_t dBm = WiFi.RSSI();
-    Serial.printf("WiFi sensor init: %ddBm %d%%\n", dBm, getWifiQuality(dBm));
+    LOG_INFO("WiFi sensor init: %ddBm %d%%", dBm, getWifiQuality(dBm));
     return true;
   }
 
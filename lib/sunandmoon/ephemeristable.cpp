@@ -0,0 +1,107 @@
+#include "ephemeristable.h"
+
+#include <SunMoonCalc.h>
+#include <math.h>
+
+#include "datetime.h"
+
+#ifdef EPHEMERIS_TABLE
+// Written by generate_ephemeris_table.py, defines EPHEMERIS_TABLE_DATA
+#include "ephemeris_data.h"
+#endif
+
+namespace {
+
+const int32_t SECONDS_PER_DAY = 86400;
+const double LUNAR_CYCLE_DAYS = 29.530588853;
+const double MOON_AGE_UNITS_PER_DAY = 2048;
+
+#ifndef EPHEMERIS_TABLE
+const EphemerisTableData EPHEMERIS_TABLE_DATA = {0, 0, 0, 0, nullptr};
+#endif
+
+int16_t encodeEvent(time_t start, double jd, time_t event) {
+  if (jd == -1) {
+    return EphemerisTable::MISSING;
+  }
+  // Rounded down, the display only shows hours and minutes
+  long minutes = static_cast<long>(floor((event - start) / 60.0));
+  if (minutes <= INT16_MIN || minutes > INT16_MAX) {
+    return EphemerisTable::MISSING;
+  }
+  return static_cast<int16_t>(minutes);
+}
+
+time_t decodeEvent(time_t start, int16_t minutes) {
+  if (minutes == EphemerisTable::MISSING) {
+    return EphemerisTable::NO_EVENT;
+  }
+  return start + static_cast<time_t>(minutes) * 60;
+}
+
+}  // namespace
+
+const int16_t EphemerisTable::MISSING;
+const time_t EphemerisTable::NO_EVENT;
+
+const EphemerisTableData& EphemerisTable::builtin() {
+  return EPHEMERIS_TABLE_DATA;
+}
+
+bool EphemerisTable::lookup(const EphemerisTableData& table,
+                            const SunMoonKey& key, int hour, int minute,
+                            int second, SunMoonEvents& events,
+                            double& moon_age) {
+  if (table.days == 0 || key.latitude_e6 != table.latitude_e6 ||
+      key.longitude_e6 != table.longitude_e6) {
+    return false;
+  }
+  int32_t index = DateTime::daysFromCivil(key.year, key.month, key.day) - table.first_day;
+  if (index < 0 || index >= table.days) {
+    return false;
+  }
+
+  const EphemerisDay& today = table.entries[index];
+  time_t start = static_cast<time_t>(table.first_day + index) * SECONDS_PER_DAY;
+  events.sun_rise = decodeEvent(start, today.sun_rise);
+  events.sun_transit = decodeEvent(start, today.sun_transit);
+  events.sun_set = decodeEvent(start, today.sun_set);
+  events.moon_rise = decodeEvent(start, today.moon_rise);
+  events.moon_transit = decodeEvent(start, today.moon_transit);
+  events.moon_set = decodeEvent(start, today.moon_set);
+
+  // The age grows by about a day per day and wraps at each new moon
+  double from = today.moon_age / MOON_AGE_UNITS_PER_DAY;
+  double to = table.entries[index + 1].moon_age / MOON_AGE_UNITS_PER_DAY;
+  if (to < from) {
+    to += LUNAR_CYCLE_DAYS;
+  }
+  double fraction = (hour * 3600 + minute * 60 + second) /
+                    static_cast<double>(SECONDS_PER_DAY);
+  moon_age = fmod(from + (to - from) * fraction, LUNAR_CYCLE_DAYS);
+  return true;
+}
+
+void EphemerisTable::generate(double latitude, double longitude,
+                              int32_t first_day, uint16_t days,
+                              std::vector<EphemerisDay>& entries) {
+  entries.resize(days + 1);
+  for (int32_t i = 0; i <= days; i++) {
+    time_t start = static_cast<time_t>(first_day + i) * SECONDS_PER_DAY;
+    SunMoonCalc calc(start, latitude, longitude);
+    SunMoonCalc::Result result = calc.calculateSunAndMoonData();
+
+    EphemerisDay& day = entries[i];
+    day.sun_rise = encodeEvent(start, result.sun.riseJd, result.sun.rise);
+    day.sun_transit =
+        encodeEvent(start, result.sun.transitJd, result.sun.transit);
+    day.sun_set = encodeEvent(start, result.sun.setJd, result.sun.set);
+    day.moon_rise = encodeEvent(start, result.moon.riseJd, result.moon.rise);
+    day.moon_transit =
+        encodeEvent(start, result.moon.transitJd, result.moon.transit);
+    day.moon_set = encodeEvent(start, result.moon.setJd, result.moon.set);
+    day.moon_age = static_cast<uint16_t>(
+        lround(result.moon.age * MOON_AGE_UNITS_PER_DAY) %
+        lround(LUNAR_CYCLE_DAYS * MOON_AGE_UNITS_PER_DAY));
+  }
+}
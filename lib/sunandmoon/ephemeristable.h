@@ -0,0 +1,70 @@
+#ifndef EPHEMERIS_TABLE_H
+#define EPHEMERIS_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <vector>
+
+#include "sunmooncache.h"
+
+/**
+ * One day of precomputed sun/moon events. Times are minutes from 00:00 of the
+ * local date taken as UTC, which is the instant SunAndMoon hands to
+ * SunMoonCalc, and the moon age is in 1/2048ths of a day at that instant.
+ */
+struct EphemerisDay {
+  int16_t sun_rise;
+  int16_t sun_transit;
+  int16_t sun_set;
+  int16_t moon_rise;
+  int16_t moon_transit;
+  int16_t moon_set;
+  uint16_t moon_age;
+};
+
+/**
+ * Consecutive days of events for one location. entries holds days + 1 rows,
+ * the last one only being there to interpolate the moon age on the last day.
+ */
+struct EphemerisTableData {
+  int32_t latitude_e6;
+  int32_t longitude_e6;
+  int32_t first_day;  // DateTime::daysFromCivil()
+  uint16_t days;
+  const EphemerisDay* entries;
+};
+
+/**
+ * Sun and moon events precomputed at build time by
+ * generate_ephemeris_table.py for the location configured in platformio.ini,
+ * so the display node can skip the ephemeris math on the days it covers.
+ *
+ * Events are those of the first instant of the day, as the SunMoonCache holds
+ * for a node waking every few minutes, to the minute. The moon age is
+ * interpolated between consecutive days.
+ */
+class EphemerisTable {
+ public:
+  // Stored for events SunMoonCalc could not find, decoded as NO_EVENT
+  static const int16_t MISSING = INT16_MIN;
+  static const time_t NO_EVENT = -1;
+
+  // Table compiled into the firmware, empty unless EPHEMERIS_TABLE is defined
+  static const EphemerisTableData& builtin();
+
+  // Events and moon age at the given local time of the key's day, false when
+  // the table does not cover that day and location. The UTC offset of the key
+  // is ignored as events are in UTC.
+  static bool lookup(const EphemerisTableData& table, const SunMoonKey& key,
+                     int hour, int minute, int second, SunMoonEvents& events,
+                     double& moon_age);
+
+  // Rows for days days from first_day, plus the extra last row, as written
+  // into the generated header
+  static void generate(double latitude, double longitude, int32_t first_day,
+                       uint16_t days, std::vector<EphemerisDay>& entries);
+};
+
+#endif  // EPHEMERIS_TABLE_H
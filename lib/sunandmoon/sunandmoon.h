@@ -7,7 +7,15 @@
 #include <string>
 
 #include "datetime.h"
-
+#include "ephemeristable.h"
+#include "sunmooncache.h"
+
+/**
+ * Sun and moon times for the display. Days covered by the build time
+ * EphemerisTable need no calculation at all. Otherwise rise/set/transit come
+ * from the SunMoonCache when the same day and location were already
+ * calculated, in which case only the moon age is recomputed.
+ */
 class SunAndMoon {
  public:
   SunAndMoon(int year, int month, int day, int hour, int minute, int second,
@@ -23,47 +31,45 @@ class SunAndMoon {
         utc_offset_seconds(utc_offset_seconds),
         sunMoonCalc(year, month, day, hour, minute, second, latitude,
                     longitude) {
-    sunMoonCalcResult = sunMoonCalc.calculateSunAndMoonData();
+    key = SunMoonCache::makeKey(year, month, day, latitude, longitude,
+                                utc_offset_seconds);
+    tabulated = EphemerisTable::lookup(EphemerisTable::builtin(), key, hour,
+                                       minute, second, events, moonAge);
+    cached = !tabulated && SunMoonCache::lookup(key, events);
+    if (cached) {
+      moonAge = sunMoonCalc.calculateMoonAge();
+    } else if (!tabulated) {
+      SunMoonCalc::Result result = sunMoonCalc.calculateSunAndMoonData();
+      events.sun_rise = result.sun.rise;
+      events.sun_transit = result.sun.transit;
+      events.sun_set = result.sun.set;
+      events.moon_rise = result.moon.rise;
+      events.moon_transit = result.moon.transit;
+      events.moon_set = result.moon.set;
+      moonAge = result.moon.age;
+      SunMoonCache::store(key, events);
+    }
+    moonPhase = sunMoonCalc.calculateMoonPhase(moonAge);
   }
 
-  std::string getSunrise() {
-    time_t local = sunMoonCalcResult.sun.rise + utc_offset_seconds;
-    return formatTime(local);
-  };
+  std::string getSunrise() { return formatLocal(events.sun_rise); };
 
-  std::string getSunset() {
-    time_t local = sunMoonCalcResult.sun.set + utc_offset_seconds;
-    return formatTime(local);
-  };
+  std::string getSunset() { return formatLocal(events.sun_set); };
 
-  std::string getSunTransit() {
-    time_t local = sunMoonCalcResult.sun.transit + utc_offset_seconds;
-    return formatTime(local);
-  }
+  std::string getSunTransit() { return formatLocal(events.sun_transit); }
 
-  std::string getMoonRise() {
-    time_t local = sunMoonCalcResult.moon.rise + utc_offset_seconds;
-    return formatTime(local);
-  };
+  std::string getMoonRise() { return formatLocal(events.moon_rise); };
 
-  std::string getMoonSet() {
-    time_t local = sunMoonCalcResult.moon.set + utc_offset_seconds;
-    return formatTime(local);
-  }
+  std::string getMoonSet() { return formatLocal(events.moon_set); }
 
-  std::string getMoonTransit() {
-    time_t local = sunMoonCalcResult.moon.transit + utc_offset_seconds;
-    return formatTime(local);
-  }
+  std::string getMoonTransit() { return formatLocal(events.moon_transit); }
 
-  std::string getMoonPhase() {
-    return sunMoonCalcResult.moon.phase.name.c_str();
-  }
+  std::string getMoonPhase() { return moonPhase.name; }
 
-  double getMoonPhaseAge() { return sunMoonCalcResult.moon.age; }
+  double getMoonPhaseAge() { return moonAge; }
 
   char getMoonPhaseLetter() {
-    double lunarAge = sunMoonCalcResult.moon.age;
+    double lunarAge = moonAge;
     if (lunarAge >= 0 && lunarAge <= lunar_cycle_days &&
         (lunarAge < 1 || lunarAge > lunar_cycle_days - 1)) {
       return '0';  // New Moon
@@ -74,9 +80,19 @@ class SunAndMoon {
     return 'A' + index;
   }
 
+  bool fromCache() const { return cached; }
+  bool fromTable() const { return tabulated; }
+  const SunMoonKey& getKey() const { return key; }
+  const SunMoonEvents& getEvents() const { return events; }
+
  private:
   SunMoonCalc sunMoonCalc;
-  SunMoonCalc::Result sunMoonCalcResult;
+  SunMoonKey key;
+  SunMoonEvents events;
+  bool cached;
+  bool tabulated;
+  double moonAge;
+  SunMoonCalc::MoonPhase moonPhase;
   int year;
   int month;
   int day;
@@ -88,9 +104,14 @@ class SunAndMoon {
   int utc_offset_seconds;
   const double lunar_cycle_days = 29.530588853;
 
+  std::string formatLocal(time_t utc) {
+    return formatTime(utc + utc_offset_seconds);
+  }
+
   std::string formatTime(time_t time) {
-    DateTime dt(time);
-    return dt.format("%H:%M");
+    char buffer[6];
+    DateTime(time).format(buffer, sizeof(buffer), "%H:%M");
+    return buffer;
   }
 };
 
@@ -0,0 +1,71 @@
+#include "sunmooncache.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+namespace {
+
+// Changes whenever the entry layout or the calculation changes, so stale RTC
+// contents from an older firmware are ignored
+const uint32_t CACHE_MAGIC = 0x534D4301;
+
+struct CacheEntry {
+  uint32_t magic;
+  SunMoonKey key;
+  SunMoonEvents events;
+};
+
+RTC_DATA_ATTR CacheEntry rtc_entry;
+RTC_DATA_ATTR uint32_t rtc_hits;
+RTC_DATA_ATTR uint32_t rtc_misses;
+
+}  // namespace
+
+SunMoonKey SunMoonCache::makeKey(int year, int month, int day, double latitude,
+                                 double longitude, int utc_offset_seconds) {
+  SunMoonKey key;
+  key.year = year;
+  key.month = month;
+  key.day = day;
+  key.latitude_e6 = static_cast<int32_t>(lround(latitude * 1e6));
+  key.longitude_e6 = static_cast<int32_t>(lround(longitude * 1e6));
+  key.utc_offset_seconds = utc_offset_seconds;
+  return key;
+}
+
+bool SunMoonCache::lookup(const SunMoonKey& key, SunMoonEvents& events) {
+  if (rtc_entry.magic == CACHE_MAGIC && rtc_entry.key == key) {
+    events = rtc_entry.events;
+    rtc_hits++;
+    return true;
+  }
+  rtc_misses++;
+  return false;
+}
+
+void SunMoonCache::store(const SunMoonKey& key, const SunMoonEvents& events) {
+  rtc_entry.magic = CACHE_MAGIC;
+  rtc_entry.key = key;
+  rtc_entry.events = events;
+}
+
+bool SunMoonCache::get(SunMoonKey& key, SunMoonEvents& events) {
+  if (!isValid()) {
+    return false;
+  }
+  key = rtc_entry.key;
+  events = rtc_entry.events;
+  return true;
+}
+
+bool SunMoonCache::isValid() { return rtc_entry.magic == CACHE_MAGIC; }
+
+void SunMoonCache::clear() {
+  rtc_entry.magic = 0;
+  rtc_hits = 0;
+  rtc_misses = 0;
+}
+
+uint32_t SunMoonCache::hits() { return rtc_hits; }
+
+uint32_t SunMoonCache::misses() { return rtc_misses; }
@@ -0,0 +1,64 @@
+#ifndef SUN_MOON_CACHE_H
+#define SUN_MOON_CACHE_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Identifies one day of sun/moon events: local date, location (in millionths
+ * of a degree, to avoid comparing doubles) and UTC offset.
+ */
+struct SunMoonKey {
+  int16_t year;
+  uint8_t month;
+  uint8_t day;
+  int32_t latitude_e6;
+  int32_t longitude_e6;
+  int32_t utc_offset_seconds;
+
+  bool operator==(const SunMoonKey& other) const {
+    return year == other.year && month == other.month && day == other.day &&
+           latitude_e6 == other.latitude_e6 &&
+           longitude_e6 == other.longitude_e6 &&
+           utc_offset_seconds == other.utc_offset_seconds;
+  }
+  bool operator!=(const SunMoonKey& other) const { return !(*this == other); }
+};
+
+/**
+ * Rise, transit and set times as returned by SunMoonCalc (UTC epoch).
+ */
+struct SunMoonEvents {
+  time_t sun_rise;
+  time_t sun_transit;
+  time_t sun_set;
+  time_t moon_rise;
+  time_t moon_transit;
+  time_t moon_set;
+};
+
+/**
+ * Single entry cache of the daily sun/moon events, kept in RTC memory so it
+ * survives deep sleep. Rise/set/transit only change once a day, so wakes
+ * after the first one only need the moon age.
+ *
+ * After a power cycle the entry can be restored from the last displayed
+ * snapshot, see Model::getEphemeris().
+ */
+class SunMoonCache {
+ public:
+  static SunMoonKey makeKey(int year, int month, int day, double latitude,
+                            double longitude, int utc_offset_seconds);
+
+  static bool lookup(const SunMoonKey& key, SunMoonEvents& events);
+  static void store(const SunMoonKey& key, const SunMoonEvents& events);
+  // Returns the cached entry, if any
+  static bool get(SunMoonKey& key, SunMoonEvents& events);
+  static bool isValid();
+  static void clear();
+
+  static uint32_t hits();
+  static uint32_t misses();
+};
+
+#endif  // SUN_MOON_CACHE_H
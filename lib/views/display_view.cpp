@@ -1,5 +1,11 @@
 #include "display_view.h"
 
+#ifndef UNIT_TEST
+#include <sys/time.h>
+#endif
+
+#include "logging.h"
+
 bool DisplayView::buildModel(JsonDocument* doc,
                              const std::map<std::string, Sensor*>& sensors) {
   sensors_ = sensors;
@@ -15,12 +21,45 @@ bool DisplayView::buildModel(JsonDocument* doc,
   utc_timestamp_ = parseTimestampValue(doc, "timestamp_utc");
   local_timestamp_ = parseTimestampValue(doc, "timestamp_local");
 
+#ifndef UNIT_TEST
+  // The RTC keeps counting through deep sleep, so wakes without a response
+  // can still date local readings
+  if (utc_timestamp_.ok()) {
+    struct timeval now = {utc_timestamp_.epoch(), 0};
+    settimeofday(&now, nullptr);
+  }
+#endif
+
+  // Read once for both the sun/moon cache and the refresh decision
+  Model* last_displayed = Controller::loadLastDisplayed();
+  if (!SunMoonCache::isValid()) {
+    Controller::restoreSunMoonCache(last_displayed);
+  }
+
   model_.setHttpPostErrorCode(http_post_error_code_);
   model_.setCurrentDeviceId(current_device_id_);
   model_.buildFromJson(doc, utc_timestamp_, local_timestamp_);
 
-  Controller c = Controller(model_);
-  return c.needRefresh();
+  // The model snapshot is written while the panel refreshes (or after
+  // rendering at the latest) rather than before drawing starts
+  delete pending_controller_;
+  pending_controller_ = new Controller(model_, last_displayed, true);
+  delete last_displayed;
+  bool need_refresh = pending_controller_->needRefresh();
+  if (!need_refresh) {
+    delete pending_controller_;
+    pending_controller_ = nullptr;
+  }
+  return need_refresh;
+}
+
+void DisplayView::runDeferredWork() {
+  if (pending_controller_ == nullptr) {
+    return;
+  }
+  pending_controller_->writeData();
+  delete pending_controller_;
+  pending_controller_ = nullptr;
 }
 
 DateTime DisplayView::parseTimestampValue(JsonDocument* doc,
@@ -38,8 +77,8 @@ DateTime DisplayView::parseTimestamp(const std::string& timestamp,
                                      const String& timestamp_key) {
   DateTime dt(timestamp);
   if (!dt.ok()) {
-    Serial.printf("Failed to parse %s: %s\n", timestamp_key.c_str(),
-                  timestamp.c_str());
+    LOG_WARN("Failed to parse %s: %s", timestamp_key.c_str(),
+             timestamp.c_str());
   }
   return dt;
 }
@@ -17,7 +17,7 @@
  */
 class DisplayView {
  public:
-  virtual ~DisplayView() = default;
+  virtual ~DisplayView() { delete pending_controller_; }
 
   /**
    * Set the HTTP POST error code for display.
@@ -44,6 +44,18 @@ class DisplayView {
    */
   virtual void cleanup() = 0;
 
+  /**
+   * Power the display down for a light sleep, keeping the driver and what
+   * the panel shows for partial updates on the next wake.
+   */
+  virtual void suspend() {}
+
+  /**
+   * Response fields the view renders, a bitmap of Model::Field. The server
+   * leaves the others out.
+   */
+  virtual uint32_t renderedFields() const = 0;
+
  protected:
   bool doc_is_valid_ = false;
   Model model_;
@@ -53,6 +65,15 @@ class DisplayView {
   int http_post_error_code_ = 0;
   std::string current_device_id_;
 
+  // Holds the model snapshot write until the display is busy refreshing
+  Controller* pending_controller_ = nullptr;
+
+  /**
+   * Run work that was deferred until the panel refresh, i.e. persist the
+   * displayed model. Safe to call repeatedly, only the first call does work.
+   */
+  void runDeferredWork();
+
   /**
    * Build the display model from JSON data and sensors.
    * Returns true if display should be refreshed, false otherwise.
@@ -1,11 +1,21 @@
+#include <fmt/core.h>
+
+#include <algorithm>
 #include <vector>
 
 #include "epd_view_2.h"
 
 #include "moon_phases_48pt.h"
 #include "config.h"
+#include "logging.h"
+#include "measurementhistory.h"
 #include "version.h"
 
+#if defined(ASYNC_DISPLAY_REFRESH) && !defined(UNIT_TEST)
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#endif
+
 EPDView2::EPDView2()
     : display_(nullptr),
       u8g2_(),
@@ -23,13 +33,38 @@ void EPDView2::cleanup() {
   }
 }
 
+void EPDView2::suspend() {
+  if (display_ != nullptr) {
+    display_->powerOff();
+  }
+}
+
+uint32_t EPDView2::renderedFields() const {
+  // Sensors and statuses as laid out by layoutNodeMeasurements and
+  // layoutBadStatuses
+  uint32_t fields = Model::FIELD_BME680 | Model::FIELD_SHT31D |
+                    Model::FIELD_BATTERY | Model::FIELD_MIN_MAX |
+                    Model::FIELD_TREND | Model::FIELD_BAD_STATUS;
+#ifdef DISPLAY_NODE_VERSIONS
+  fields |= Model::FIELD_VERSION;
+#endif
+  return fields;
+}
+
 bool EPDView2::render(JsonDocument* doc,
                       const std::map<std::string, Sensor*>& sensors) {
   buildModel(doc, sensors);
+  bool deepSleepNeeded = refresh();
+  // Normally done from the busy callback, catch the case where the panel
+  // was never refreshed
+  runDeferredWork();
+  return deepSleepNeeded;
+}
 
+bool EPDView2::refresh() {
   // First render or invalid data - full refresh
   if (!has_previous_state_ || !doc_is_valid_ || display_ == nullptr) {
-    Serial.println(F("First render or invalid data - performing full refresh"));
+    LOG_INFO("First render or invalid data - performing full refresh");
     has_previous_state_ = true;
     previous_model_ = model_;
     partial_update_count_ = 0;
@@ -39,8 +74,8 @@ bool EPDView2::render(JsonDocument* doc,
   // Force full refresh periodically to prevent ghosting
   bool deepSleepNeeded = false;
   if (partial_update_count_ >= MAX_PARTIAL_UPDATES) {
-    Serial.printf("Max partial updates (%d) reached - forcing full refresh\n",
-                  MAX_PARTIAL_UPDATES);
+    LOG_INFO("Max partial updates (%d) reached - forcing full refresh",
+             MAX_PARTIAL_UPDATES);
     previous_model_ = model_;
     partial_update_count_ = 0;
     deepSleepNeeded = true;
@@ -48,15 +83,15 @@ bool EPDView2::render(JsonDocument* doc,
 
   // Try partial updates
   if (performPartialUpdates()) {
-    Serial.println(F("Partial updates completed successfully"));
+    LOG_INFO("Partial updates completed successfully");
     previous_model_ = model_;
     partial_update_count_++;
     return deepSleepNeeded;
   }
 
   // Fall back to full render if partial updates failed
-  Serial.println(
-      F("Partial updates failed or not applicable - performing full refresh"));
+  LOG_INFO(
+      "Partial updates failed or not applicable - performing full refresh");
   previous_model_ = model_;
   partial_update_count_ = 0;
   fullRender();
@@ -65,7 +100,7 @@ bool EPDView2::render(JsonDocument* doc,
 
 bool EPDView2::performPartialUpdates() {
   if (display_ == nullptr) {
-    Serial.println(F("Display not initialized for partial updates"));
+    LOG_WARN("Display not initialized for partial updates");
     return false;
   }
 
@@ -80,14 +115,14 @@ bool EPDView2::performPartialUpdates() {
 
   // Check for layout changes (node count changed)
   if (previous_model_.getNodeData().size() != model_.getNodeData().size()) {
-    Serial.println(F("Node count changed - need full refresh"));
+    LOG_INFO("Node count changed - need full refresh");
     return false;
   }
 
 #ifdef DISPLAY_TIME
   // Update time if changed
   if (hasTimeChanged()) {
-    Serial.println(F("Time changed, partial update"));
+    LOG_DEBUG("Time changed, partial update");
     ctx.mode = RenderMode::PARTIAL_TIME;
     displayTime(ctx);
     updated = true;
@@ -96,7 +131,7 @@ bool EPDView2::performPartialUpdates() {
 
   // Update date if changed
   if (hasDateChanged()) {
-    Serial.println(F("Date changed, partial update"));
+    LOG_DEBUG("Date changed, partial update");
     ctx.mode = RenderMode::PARTIAL_DATE;
     displayDate(ctx);
     updated = true;
@@ -104,7 +139,7 @@ bool EPDView2::performPartialUpdates() {
 
   // Update sun/moon if changed
   if (haveSunMoonChanged()) {
-    Serial.println(F("Sun/Moon changed, partial update"));
+    LOG_DEBUG("Sun/Moon changed, partial update");
     ctx.mode = RenderMode::PARTIAL_SUN_MOON;
     displaySunAndMoon(ctx);
     updated = true;
@@ -112,7 +147,7 @@ bool EPDView2::performPartialUpdates() {
 
   // Update nodes if changed
   if (haveNodesChanged()) {
-    Serial.println(F("Nodes changed, partial update"));
+    LOG_DEBUG("Nodes changed, partial update");
     ctx.mode = RenderMode::PARTIAL_NODES;
     displayNodes(ctx);
     updated = true;
@@ -121,29 +156,53 @@ bool EPDView2::performPartialUpdates() {
   return updated;
 }
 
+void EPDView2::busyCallback(const void* param) {
+  EPDView2* view = static_cast<EPDView2*>(const_cast<void*>(param));
+  view->onDisplayBusy();
+}
+
+void EPDView2::onDisplayBusy() {
+  // Called by GxEPD2 in a loop for as long as the BUSY pin is active
+  runDeferredWork();
+
+#if defined(ASYNC_DISPLAY_REFRESH) && !defined(UNIT_TEST)
+  // Sleep until the panel releases BUSY (the 750_T7 holds it low while busy)
+  // instead of polling it at full clock. The timer is a safety net, GxEPD2
+  // keeps checking its own busy timeout between calls.
+  Serial.flush();
+  gpio_wakeup_enable(static_cast<gpio_num_t>(EPD_BUSY), GPIO_INTR_HIGH_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup(BUSY_LIGHT_SLEEP_MAX_US);
+  esp_light_sleep_start();
+  gpio_wakeup_disable(static_cast<gpio_num_t>(EPD_BUSY));
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+#endif
+}
+
 // Returns true if full display re-initialisation is needed on next cycle
 bool EPDView2::fullRender() {
   if (display_ == nullptr) {
     display_ = new GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT>(
         GxEPD2_750_T7(EPD_CS, EPD_DC, EPD_RST, EPD_BUSY));
     (*display_).init(115200);
-    Serial.println(F("E-Paper display initialized"));
+    display_->epd2.setBusyCallback(busyCallback, this);
+    LOG_INFO("E-Paper display initialized");
     u8g2_.begin(*display_);
   } else {
-    Serial.println(
-        F("E-Paper display previously initialized (unexpected, display_ should "
-          "be nullptr)"));
+    LOG_WARN(
+        "E-Paper display previously initialized (unexpected, display_ should "
+        "be nullptr)");
   }
 
   bool deepSleepNeeded = fullRenderInternal();
-  Serial.println(F("E-Paper full render completed"));
+  LOG_INFO("E-Paper full render completed");
   return deepSleepNeeded;
 }
 
 bool EPDView2::fullRenderInternal() {
   bool deepSleepNeeded = false;
 
-  Serial.println(F("Performing full window refresh"));
+  LOG_DEBUG("Performing full window refresh");
   (*display_).setFullWindow();
 
   // Create RenderContext for full render
@@ -188,7 +247,7 @@ bool EPDView2::fullRenderInternal() {
   } while ((*display_).nextPage());
 
 #ifdef FORCE_DEEP_SLEEP
-  Serial.println(F("Forcing deep sleep after full render"));
+  LOG_INFO("Forcing deep sleep after full render");
   deepSleepNeeded = true;
 #endif
 
@@ -196,7 +255,7 @@ bool EPDView2::fullRenderInternal() {
 }
 
 void EPDView2::partialRenderInternal() {
-  Serial.printf("Time: %s\n", model_.getTime().c_str());
+  LOG_DEBUG("Time: %s", model_.getTime().c_str());
   int x = 0;
   int y = display_->height() - 10 - font_height_spacing_38pt;
   u8g2_.setFont(largeFont);
@@ -220,10 +279,30 @@ void EPDView2::displayLocalSensorData() {
   } else {
     std::map<std::string, Measurement> measurements =
         sensors_["bme680"]->read();
+    // Same series as the display's own readings in responses
+    const char* node = MeasurementHistory::localNode();
+    time_t now = time(nullptr);
+    bool keep = now > MeasurementHistory::MIN_VALID_EPOCH && node[0] != '\0';
     for (const auto& measurement : measurements) {
       u8g2_.printf("%s: ", measurement.first.c_str());
       Measurement m = measurement.second;
-      u8g2_.printf("%.2f %s\n\n", m.value, m.unit.c_str());
+      u8g2_.printf("%.2f %s\n", m.value, m.unit.c_str());
+
+      // Keep the readings so min/max cover the time without a connection
+      HistoryStats stats;
+      uint32_t key = MeasurementHistory::makeKey(node, "bme680",
+                                                 measurement.first.c_str());
+      bool kept = keep && Model::isHistoryMetric(measurement.first.c_str());
+      if (kept) {
+        MeasurementHistory::add(key, now, m.value);
+      }
+      if (kept && MeasurementHistory::stats(key, now, stats) &&
+          stats.count >= 2) {
+        u8g2_.printf("  24h %.1f / %.1f / %.1f\n", stats.min, stats.max,
+                     stats.mean);
+      } else {
+        u8g2_.printf("\n");
+      }
     }
   }
 }
@@ -239,9 +318,20 @@ void EPDView2::displaySunAndMoon(const RenderContext& ctx) {
   int y = ctx.display_height - (font_height_spacing_38pt + 10) - height;
 
   if (ctx.is_partial) {
-    Serial.printf("displaySunAndMoon partial: window (0,%d) size (%dx%d)\n", y,
-                  ctx.display_width, height);
-    display_->setPartialWindow(0, y, ctx.display_width, height);
+    // y is the first baseline, the window has to cover both lines and the
+    // moon phase glyph at the end of the second one
+    u8g2_.setFont(moon_phases_48pt);
+    int moon_ascent = u8g2_.getFontAscent();
+    u8g2_.setFont(defaultFont);
+    int ascent = u8g2_.getFontAscent();
+    int descent = u8g2_.getFontDescent();
+    int second_baseline = y + ascent - descent;
+    int top = std::max(0, std::min(y - ascent, second_baseline - moon_ascent));
+    int window_height = second_baseline - descent + 1 - top;
+
+    LOG_DEBUG("displaySunAndMoon partial: window (0,%d) size (%dx%d)", top,
+              ctx.display_width, window_height);
+    display_->setPartialWindow(0, top, ctx.display_width, window_height);
     display_->firstPage();
   }
 
@@ -255,8 +345,8 @@ void EPDView2::displaySunAndMoon(const RenderContext& ctx) {
       u8g2_.setFont(defaultFont);
     }
 
-    Serial.printf("displaySunAndMoon at y=%d (height=%d, display_height=%d)\n",
-                  y, height, ctx.display_height);
+    LOG_DEBUG("displaySunAndMoon at y=%d (height=%d, display_height=%d)", y,
+              height, ctx.display_height);
     u8g2_.setCursor(0, y);
     u8g2_.setFont(defaultFont);
     u8g2_.printf("Sun:  %s  %s  %s\n", model_.getSunRise().c_str(),
@@ -271,225 +361,196 @@ void EPDView2::displaySunAndMoon(const RenderContext& ctx) {
 }
 
 uint EPDView2::displayNodes(const RenderContext& ctx) {
-  if (ctx.is_partial && ctx.mode == RenderMode::PARTIAL_NODES) {
-    // Calculate nodes region - limit height to stop just above sun/moon display
+  NodeLayout layout;
+  buildNodeLayout(ctx, layout);
+
+  bool partial = ctx.is_partial && ctx.mode == RenderMode::PARTIAL_NODES;
+  if (partial) {
+    // Only refresh the columns that changed, limited to the area above the
+    // sun/moon display
     int time_sun_moon_height =
         font_height_spacing_24pt * 2 + font_height_spacing_38pt + 10;
-    int height = ctx.display_height - time_sun_moon_height;
+    int max_height = ctx.display_height - time_sun_moon_height;
+
+    LayoutBox box = layout.changedBox(node_layout_);
+    int x = std::max<int>(box.x, 0);
+    int y = std::max<int>(box.y, 0);
+    int width = std::min<int>(box.x + box.w, ctx.display_width) - x;
+    int height = std::min<int>(box.y + box.h, max_height) - y;
+    if (box.empty() || width <= 0 || height <= 0) {
+      LOG_DEBUG("displayNodes partial: no visible change");
+      node_layout_ = layout;
+      return layout.bottom();
+    }
 
-    Serial.printf("displayNodes partial: window (0,0) size (%dx%d)\n",
-                  ctx.display_width, height);
-    display_->setPartialWindow(0, 0, ctx.display_width, height);
+    LOG_DEBUG("displayNodes partial: window (%d,%d) size (%dx%d)", x, y, width,
+              height);
+    display_->setPartialWindow(x, y, width, height);
     display_->firstPage();
   }
 
-  uint max_row_offset = 0;
-
   do {
-    if (ctx.is_partial && ctx.mode == RenderMode::PARTIAL_NODES) {
+    if (partial) {
       display_->fillScreen(GxEPD_WHITE);
       u8g2_.setFontMode(0);
       u8g2_.setFontDirection(0);
       u8g2_.setForegroundColor(GxEPD_BLACK);
       u8g2_.setBackgroundColor(GxEPD_WHITE);
-      u8g2_.setFont(defaultFont);
     }
 
-    JsonObject nodes = model_.getNodeData();
-    int column = 0;
-    max_row_offset = 0;
-
-    for (JsonPair node : nodes) {
-      uint8_t row = 1;
-      uint row_offset = 0;
-      JsonObject nodeData = node.value().as<JsonObject>();
-      displayNodeHeader(node, nodeData, ctx, column, row, row_offset);
-      displayNodeMeasurements(nodeData, ctx, column, row, row_offset);
-      // displayBatteryLevel(nodeData, ctx.node_count, column, row, row_offset);
-      displayBadStatuses(nodeData, ctx.node_count, column, row, row_offset);
-      displayStaleState(nodeData, ctx.node_count, column, row, row_offset);
-      displayNodeVersion(nodeData, ctx.node_count, column, row, row_offset);
-
-      column++;
-      if (row_offset > max_row_offset) {
-        max_row_offset = row_offset;
-      }
-    }
-  } while (ctx.is_partial && ctx.mode == RenderMode::PARTIAL_NODES &&
-           display_->nextPage());
+    layout.draw(u8g2_);
+    layout.drawGraphs(*display_, GxEPD_BLACK);
+    u8g2_.setFont(defaultFont);
+  } while (partial && display_->nextPage());
 
-  return max_row_offset;
+  node_layout_ = layout;
+  return layout.bottom();
 }
 
-void EPDView2::displayNodeHeader(JsonPair& node, JsonObject& nodeData,
-                                 const RenderContext& ctx, int column,
-                                 uint8_t& row, uint& row_offset) {
-  JsonObject node_data = model_.getNodeData()[node.key()].as<JsonObject>();
+void EPDView2::buildNodeLayout(const RenderContext& ctx, NodeLayout& layout) {
+  layout.clear();
+
+  JsonObject nodes = model_.getNodeData();
+  for (JsonPair node : nodes) {
+    uint row_offset = 0;
+    JsonObject nodeData = node.value().as<JsonObject>();
+    layout.addColumn();
+    layoutNodeHeader(nodeData, layout, row_offset);
+    layoutNodeMeasurements(nodeData, layout, row_offset);
+    layoutBadStatuses(nodeData, layout, row_offset);
+    layoutStaleState(nodeData, layout, row_offset);
+    layoutNodeVersion(nodeData, layout, row_offset);
+  }
 
-  std::string display_name = node_data["display_name"].as<String>().c_str();
-  int column_width = ctx.display_width / ctx.node_count;
-  row_offset = row * font_height_spacing_24pt;
-  row++;
-  u8g2_.setCursor(column * column_width, row_offset);
-  u8g2_.printf("%s ", display_name.c_str());
-  displayBatteryLevel(nodeData);
+  if (layout.measure(u8g2_, &node_layout_)) {
+    LOG_DEBUG("Node layout measured (hash %08x)", layout.structuralHash());
+  }
+  layout.pack(ctx.display_width);
+}
+
+void EPDView2::layoutNodeHeader(JsonObject& nodeData, NodeLayout& layout,
+                                uint& row_offset) {
+  std::string display_name = nodeData["display_name"].as<String>().c_str();
+  row_offset = font_height_spacing_24pt;
+  layout.addText(defaultFont, display_name + " ", 0, row_offset);
+  layoutBatteryLevel(nodeData, layout);
 
   // Leave an empty half row after header
   row_offset += font_height_spacing_24pt / 2;
-  row++;
 }
 
-void EPDView2::displayBadStatuses(JsonObject& nodeData, int node_count,
-                                  int column, uint8_t& row, uint& row_offset) {
-  int column_width = display_->width() / node_count;
-  int row_height = font_height_spacing_16pt;
-
-  u8g2_.setFont(smallFont);
-
+void EPDView2::layoutBadStatuses(JsonObject& nodeData, NodeLayout& layout,
+                                 uint& row_offset) {
   if (nodeData["status"].is<JsonObject>()) {
     JsonObject status = nodeData["status"].as<JsonObject>();
     for (JsonPair kvp : status) {
       String value = kvp.value().as<String>();
       if (value != "ok") {
-        row_offset += row_height;
-        row++;
-        u8g2_.setCursor(column * column_width, row_offset);
+        row_offset += font_height_spacing_16pt;
         String key = kvp.key().c_str();
-        u8g2_.printf("%s:%s", key.c_str(), value.c_str());
+        layout.addText(smallFont, fmt::format("{}:{}", key.c_str(), value.c_str()), 0,
+                       row_offset);
       }
     }
   }
-
-  u8g2_.setFont(defaultFont);
 }
 
-void EPDView2::displayStaleState(JsonObject& nodeData, int node_count,
-                                 int column, uint8_t& row, uint& row_offset) {
+void EPDView2::layoutStaleState(JsonObject& nodeData, NodeLayout& layout,
+                                uint& row_offset) {
   std::string node_stale = nodeData["stale_state"].as<String>().c_str();
   if (!node_stale.empty()) {
-    int column_width = display_->width() / node_count;
-    int row_height = font_height_spacing_16pt;
-
-    u8g2_.setFont(smallFont);
-
-    row_offset += row_height;
-    row++;
-    u8g2_.setCursor(column * column_width, row_offset);
-
-    u8g2_.printf("%s", node_stale.c_str());
-
-    u8g2_.setFont(defaultFont);
+    row_offset += font_height_spacing_16pt;
+    layout.addText(smallFont, node_stale, 0, row_offset);
   }
 }
 
-void EPDView2::displayNodeVersion(JsonObject& nodeData, int node_count,
-                                  int column, uint8_t& row, uint& row_offset) {
+void EPDView2::layoutNodeVersion(JsonObject& nodeData, NodeLayout& layout,
+                                 uint& row_offset) {
 #ifdef DISPLAY_NODE_VERSIONS
-  Serial.println(F("Displaying node version"));
   if (!nodeData["version"].is<JsonString>()) {
-    Serial.println(F("Node version is not a string"));
+    LOG_DEBUG("Node version is not a string");
     return;
   }
 
-  int column_width = display_->width() / node_count;
-  int row_height = font_height_spacing_16pt;
-
-  u8g2_.setFont(smallFont);
-
-  row_offset += row_height;
-  row++;
-  u8g2_.setCursor(column * column_width, row_offset);
-
   std::string version = nodeData["version"].as<String>().c_str();
   // Display only first 13 characters of the git SHA1 hash
   if (version.length() > 13) {
     version = version.substr(0, 13);
   }
-  u8g2_.printf("%s", version.c_str());
-  Serial.printf("Displaying node version: %s\n", version.c_str());
-
-  u8g2_.setFont(defaultFont);
+  row_offset += font_height_spacing_16pt;
+  layout.addText(smallFont, version, 0, row_offset);
 #endif
 }
 
-void EPDView2::displayNodeMeasurements(JsonObject& nodeData,
-                                       const RenderContext& ctx, int column,
-                                       uint8_t& row, uint& row_offset) {
+void EPDView2::layoutNodeMeasurements(JsonObject& nodeData,
+                                      NodeLayout& layout, uint& row_offset) {
   if (nodeData["measurements_v2"].is<JsonObject>()) {
     JsonObject measurements_v2 = nodeData["measurements_v2"].as<JsonObject>();
     std::vector<std::string> devices = {"bme680", "sht31d"};
     for (const auto& device : devices) {
-      displayDeviceMeasurements(measurements_v2, device, nodeData,
-                                ctx.node_count, column, row, row_offset);
+      layoutDeviceMeasurements(measurements_v2, device, nodeData, layout,
+                               row_offset);
     }
   }
 }
 
-void EPDView2::displayDeviceMeasurements(JsonObject& measurements_v2,
-                                         const std::string& device,
-                                         JsonObject& nodeData, int node_count,
-                                         int column, uint8_t& row,
-                                         uint& row_offset) {
-  int column_width = display_->width() / node_count;
-
+void EPDView2::layoutDeviceMeasurements(JsonObject& measurements_v2,
+                                        const std::string& device,
+                                        JsonObject& nodeData,
+                                        NodeLayout& layout, uint& row_offset) {
   if (measurements_v2[device].is<JsonObject>()) {
     JsonObject device_map = measurements_v2[device].as<JsonObject>();
     if (device_map["temperature"].is<JsonVariant>()) {
       auto min_max = getDeviceMinMax(nodeData, device, "temperature");
       if (min_max.first) {
-        u8g2_.setFont(smallFont);
         row_offset += font_height_spacing_16pt;
-        row++;
-        u8g2_.setCursor(column * column_width, row_offset);
-        u8g2_.printf("%.1f°C %.1f°C", min_max.second.first,
-                     min_max.second.second);
-        u8g2_.setFont(defaultFont);
+        layout.addText(smallFont,
+                       fmt::format("{:.1f}°C {:.1f}°C", min_max.second.first,
+                                   min_max.second.second),
+                       0, row_offset);
       }
 
-      u8g2_.setFont(largeFont);
       row_offset += font_height_spacing_38pt;
-      row++;
-      u8g2_.setCursor(column * column_width, row_offset);
-      u8g2_.printf("%.1f°C", float(device_map["temperature"]));
-      u8g2_.setFont(defaultFont);
+      layout.addText(largeFont,
+                     fmt::format("{:.1f}°C", float(device_map["temperature"])),
+                     0, row_offset);
+
+      std::string trend = getDeviceTrend(nodeData, device, "temperature");
+      if (!trend.empty()) {
+        row_offset += sparkline_spacing;
+        layout.addGraph(trend, 0, row_offset, sparkline_width,
+                        sparkline_height);
+      }
     }
     if (device_map["humidity"].is<JsonVariant>()) {
       auto min_max = getDeviceMinMax(nodeData, device, "humidity");
       if (min_max.first) {
-        u8g2_.setFont(smallFont);
         row_offset += font_height_spacing_16pt;
-        row++;
-        u8g2_.setCursor(column * column_width, row_offset);
-        u8g2_.printf("%.1f%% %.1f%%", min_max.second.first,
-                     min_max.second.second);
-        u8g2_.setFont(defaultFont);
+        layout.addText(smallFont,
+                       fmt::format("{:.1f}% {:.1f}%", min_max.second.first,
+                                   min_max.second.second),
+                       0, row_offset);
       }
 
-      u8g2_.setFont(largeFont);
       row_offset += font_height_spacing_38pt;
-      row++;
-      u8g2_.setCursor(column * column_width, row_offset);
-      u8g2_.printf("%.1f%%", float(device_map["humidity"]));
-      u8g2_.setFont(defaultFont);
+      layout.addText(largeFont,
+                     fmt::format("{:.1f}%", float(device_map["humidity"])), 0,
+                     row_offset);
     }
     if (device_map["pressure"].is<JsonVariant>()) {
       auto min_max = getDeviceMinMax(nodeData, device, "pressure");
       if (min_max.first) {
-        u8g2_.setFont(smallFont);
         row_offset += font_height_spacing_16pt;
-        row++;
-        u8g2_.setCursor(column * column_width, row_offset);
-        u8g2_.printf("%.0fhPa %.0fhPa", min_max.second.first,
-                     min_max.second.second);
-        u8g2_.setFont(defaultFont);
+        layout.addText(smallFont,
+                       fmt::format("{:.0f}hPa {:.0f}hPa", min_max.second.first,
+                                   min_max.second.second),
+                       0, row_offset);
       }
 
-      u8g2_.setFont(largeFont);
       row_offset += font_height_spacing_38pt;
-      row++;
-      u8g2_.setCursor(column * column_width, row_offset);
-      u8g2_.printf("%.0fhPa ", float(device_map["pressure"]));
-      u8g2_.setFont(defaultFont);
+      layout.addText(largeFont,
+                     fmt::format("{:.0f}hPa ", float(device_map["pressure"])),
+                     0, row_offset);
     }
   }
 }
@@ -518,31 +579,26 @@ std::pair<bool, std::pair<float, float>> EPDView2::getDeviceMinMax(
   return std::make_pair(found, std::make_pair(min, max));
 }
 
-void EPDView2::displayBatteryLevel(JsonObject& nodeData, int node_count,
-                                   int column, uint8_t& row, uint& row_offset) {
-  if (!nodeData["battery_level"].is<JsonString>()) {
-    return;
+std::string EPDView2::getDeviceTrend(JsonObject& nodeData,
+                                     const std::string& device,
+                                     const std::string& measurement) {
+  const char* base64 =
+      nodeData["trend"][device][measurement].as<const char*>();
+  if (base64 == nullptr) {
+    return "";
   }
-
-  int column_width = display_->width() / node_count;
-  int row_height = font_height_spacing_24pt;
-  row_offset += row_height;
-  row++;
-
-  u8g2_.setCursor(column * column_width, row_offset);
-
-  displayBatteryLevel(nodeData);
+  uint8_t points[Trend::POINTS];
+  size_t count = Trend::decode(base64, points, sizeof(points));
+  return std::string(reinterpret_cast<const char*>(points), count);
 }
 
-void EPDView2::displayBatteryLevel(JsonObject& nodeData) {
+void EPDView2::layoutBatteryLevel(JsonObject& nodeData, NodeLayout& layout) {
   if (!nodeData["battery_level"].is<JsonString>()) {
     return;
   }
 
   std::string level = nodeData["battery_level"].as<std::string>();
-  u8g2_.setFont(u8g2_font_battery24_tr);
-  u8g2_.print(level.c_str());
-  u8g2_.setFont(defaultFont);
+  layout.appendText(batteryFont, level);
 }
 
 // Change detection methods
@@ -593,8 +649,8 @@ void EPDView2::displayTime(const RenderContext& ctx) {
     int width = str_width + 20;  // Add padding
     int height = font_height_spacing_38pt;
 
-    Serial.printf("displayTime partial: window (%d,%d) size (%dx%d)\n", x, y,
-                  width, height);
+    LOG_DEBUG("displayTime partial: window (%d,%d) size (%dx%d)", x, y, width,
+              height);
     display_->setPartialWindow(x, y, width, height);
     display_->firstPage();
   }
@@ -628,8 +684,8 @@ void EPDView2::displayDate(const RenderContext& ctx) {
     int width = str_width + 20;  // Add padding
     int height = font_height_spacing_24pt;
 
-    Serial.printf("displayDate partial: window (%d,%d) size (%dx%d)\n", x, y,
-                  width, height);
+    LOG_DEBUG("displayDate partial: window (%d,%d) size (%dx%d)", x, y, width,
+              height);
     display_->setPartialWindow(x - 10, y, width, height);
     display_->firstPage();
   }
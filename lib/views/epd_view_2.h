@@ -15,6 +15,7 @@
 #include "display_view.h"
 #include "u8g2_font_battery24_tr.h"
 #include "model.h"
+#include "node_layout.h"
 #include "sensor.h"
 #include "config.h"
 
@@ -69,6 +70,12 @@ class EPDView2 : public DisplayView {
   uint8_t partial_update_count_;
   static constexpr uint8_t MAX_PARTIAL_UPDATES = 10;
 
+  // Upper bound for one light sleep while waiting for the panel (microseconds)
+  static constexpr uint64_t BUSY_LIGHT_SLEEP_MAX_US = 1000000;
+
+  // Nodes layout of the last render, reused while its structure is unchanged
+  NodeLayout node_layout_;
+
   // Font list and metrics:
   // https://github.com/olikraus/u8g2/wiki/fntlistall
   // https://digitalaccessibility.virginia.edu/accessibility-font-size-conversions
@@ -86,6 +93,15 @@ class EPDView2 : public DisplayView {
   const uint8_t* smallFont = u8g2_font_inb16_mf;
   static const uint8_t font_height_spacing_16pt = 22 + 6;
 
+  // 24h sparklines under temperatures, 3 pixels per Trend point
+  static const uint16_t sparkline_width = 3 * Trend::POINTS;
+  static const uint8_t sparkline_height = 24;
+  static const uint8_t sparkline_spacing = sparkline_height + 6;
+
+  // Busy wait handling, registered with the GxEPD2 driver
+  static void busyCallback(const void* param);
+  void onDisplayBusy();
+
   // Change detection methods
   bool hasTimeChanged() const;
   bool hasDateChanged() const;
@@ -100,28 +116,30 @@ class EPDView2 : public DisplayView {
   void displayDate(const RenderContext& ctx);
   void displaySunAndMoon(const RenderContext& ctx);
   uint displayNodes(const RenderContext& ctx);
-  void displayNodeHeader(JsonPair& node, JsonObject& nodeData,
-                         const RenderContext& ctx, int column, uint8_t& row,
+  void buildNodeLayout(const RenderContext& ctx, NodeLayout& layout);
+  void layoutNodeHeader(JsonObject& nodeData, NodeLayout& layout,
+                        uint& row_offset);
+  void layoutNodeMeasurements(JsonObject& nodeData, NodeLayout& layout,
+                              uint& row_offset);
+  void layoutDeviceMeasurements(JsonObject& measurements_v2,
+                                const std::string& device,
+                                JsonObject& nodeData, NodeLayout& layout,
+                                uint& row_offset);
+  void layoutBatteryLevel(JsonObject& nodeData, NodeLayout& layout);
+  void layoutBadStatuses(JsonObject& nodeData, NodeLayout& layout,
+                         uint& row_offset);
+  void layoutStaleState(JsonObject& nodeData, NodeLayout& layout,
+                        uint& row_offset);
+  void layoutNodeVersion(JsonObject& nodeData, NodeLayout& layout,
                          uint& row_offset);
-  void displayNodeMeasurements(JsonObject& nodeData, const RenderContext& ctx,
-                               int column, uint8_t& row, uint& row_offset);
-  void displayDeviceMeasurements(JsonObject& measurements_v2,
-                                 const std::string& device,
-                                 JsonObject& nodeData, int node_count,
-                                 int column, uint8_t& row, uint& row_offset);
-  void displayBatteryLevel(JsonObject& nodeData, int node_count, int column,
-                           uint8_t& row, uint& row_offset);
-  void displayBatteryLevel(JsonObject& nodeData);
-  void displayBadStatuses(JsonObject& nodeData, int node_count, int column,
-                          uint8_t& row, uint& row_offset);
-  void displayStaleState(JsonObject& nodeData, int node_count, int column,
-                         uint8_t& row, uint& row_offset);
   std::pair<bool, std::pair<float, float>> getDeviceMinMax(
       JsonObject& nodeData, const std::string& device,
       const std::string& measurement);
+  // Decoded Trend points, empty when there are none
+  std::string getDeviceTrend(JsonObject& nodeData, const std::string& device,
+                             const std::string& measurement);
   void displayLocalSensorData();
-  void displayNodeVersion(JsonObject& nodeData, int node_count, int column,
-                          uint8_t& row, uint& row_offset);
+  bool refresh();
   bool fullRender();
   bool fullRenderInternal();
   void partialRenderInternal();
@@ -133,4 +151,6 @@ class EPDView2 : public DisplayView {
   bool render(JsonDocument* doc,
               const std::map<std::string, Sensor*>& sensors) override;
   void cleanup() override;
+  void suspend() override;
+  uint32_t renderedFields() const override;
 };
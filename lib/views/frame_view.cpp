@@ -0,0 +1,156 @@
+#include "frame_view.h"
+
+#include "config.h"
+#include "epd_view_2.h"
+#include "logging.h"
+
+FrameView::FrameView()
+    : epd2_(nullptr),
+      frame_ok_(false),
+      frame_shown_(false),
+      partial_update_count_(0) {
+  decoder_.reset();
+}
+
+FrameView::~FrameView() { cleanup(); }
+
+void FrameView::cleanup() {
+  if (epd2_ != nullptr) {
+    epd2_->hibernate();
+    delete epd2_;
+    epd2_ = nullptr;
+  }
+  releaseFrame();
+  frame_shown_ = false;
+}
+
+void FrameView::suspend() {
+  if (epd2_ != nullptr) {
+    epd2_->powerOff();
+  }
+}
+
+uint32_t FrameView::renderedFields() const {
+  // The server renders frames from whole responses, nothing is left out
+  return 0;
+}
+
+bool FrameView::acceptsTiles() const {
+  return epd2_ != nullptr && frame_shown_ &&
+         partial_update_count_ < MAX_PARTIAL_UPDATES;
+}
+
+bool FrameView::isFullWindow() const {
+  return decoder_.x() == 0 && decoder_.y() == 0 &&
+         decoder_.width() == DISPLAY_WIDTH && decoder_.height() == DISPLAY_HEIGHT;
+}
+
+void FrameView::releaseFrame() {
+  // clear() keeps the capacity
+  std::vector<uint8_t>().swap(frame_);
+}
+
+void FrameView::beginFrame(size_t size) {
+  if (epd2_ == nullptr) {
+    epd2_ = new GxEPD2_750_T7(EPD_CS, EPD_DC, EPD_RST, EPD_BUSY);
+    epd2_->init(115200);
+    LOG_INFO("E-Paper display initialized");
+  }
+  decoder_.reset();
+  frame_.clear();
+  if (size > MAX_FRAME_SIZE) {
+    LOG_ERROR("Frame too large");
+    frame_ok_ = false;
+    return;
+  }
+  // Just what this frame needs, it is then appended without growing
+  frame_.reserve(size);
+  frame_ok_ = true;
+}
+
+bool FrameView::writeFrame(const uint8_t* data, size_t size) {
+  if (!frame_ok_ || epd2_ == nullptr) {
+    return false;
+  }
+  if (frame_.size() + size > MAX_FRAME_SIZE) {
+    LOG_ERROR("Frame too large");
+    frame_ok_ = false;
+    frame_shown_ = false;
+    return false;
+  }
+  frame_.insert(frame_.end(), data, data + size);
+
+  // Frame bits are set for black, the controller's for white
+  frame_ok_ = decoder_.decode(
+      data, size,
+      [this](uint16_t x, uint16_t y, uint16_t width, uint16_t rows,
+             const uint8_t* bits) {
+        if (isFullWindow()) {
+          epd2_->writeImageForFullRefresh(bits, x, y, width, rows, true);
+        } else {
+          epd2_->writeImage(bits, x, y, width, rows, true);
+        }
+        return true;
+      });
+  if (!frame_ok_) {
+    LOG_ERROR("Corrupt frame");
+    // The panel's memory holds part of it
+    frame_shown_ = false;
+  }
+  return frame_ok_;
+}
+
+bool FrameView::frameComplete() const { return frame_ok_ && decoder_.done(); }
+
+// Returns true if deep sleep is needed
+bool FrameView::render(JsonDocument* doc,
+                       const std::map<std::string, Sensor*>& sensors) {
+  if (!frameComplete()) {
+    LOG_WARN("No frame received, the panel keeps the last one");
+    frame_shown_ = false;
+    releaseFrame();
+    return true;
+  }
+  frame_ok_ = false;
+  if (decoder_.width() == 0 || decoder_.height() == 0) {
+    LOG_INFO("Frame unchanged");
+    releaseFrame();
+    return false;
+  }
+
+  bool full = isFullWindow();
+  if (full) {
+    LOG_INFO("Performing full refresh of the frame");
+    epd2_->refresh(false);
+  } else {
+    LOG_INFO("Performing partial refresh of %ux%u at %u,%u", decoder_.width(),
+             decoder_.height(), decoder_.x(), decoder_.y());
+    epd2_->refresh(decoder_.x(), decoder_.y(), decoder_.width(),
+                   decoder_.height());
+  }
+
+  // The controller compares against its copy of the previous image on the
+  // next partial refresh
+  FrameDecoder again;
+  again.reset();
+  again.decode(frame_.data(), frame_.size(),
+               [this](uint16_t x, uint16_t y, uint16_t width, uint16_t rows,
+                      const uint8_t* bits) {
+                 epd2_->writeImageAgain(bits, x, y, width, rows, true);
+                 return true;
+               });
+  releaseFrame();
+  frame_shown_ = true;
+
+  if (!full) {
+    partial_update_count_++;
+    return false;
+  }
+  partial_update_count_ = 0;
+#ifdef FORCE_DEEP_SLEEP
+  LOG_INFO("Forcing deep sleep after full refresh");
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <GxEPD2_BW.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "display_view.h"
+#include "framedecoder.h"
+#include "sensor.h"
+
+/**
+ * Display view for frames rendered by the server (SERVER_RENDERED_FRAME).
+ * The server lays the screen out with EPDView2 built for the host, see
+ * render_frame.cpp, and the device streams the frame into the panel's memory
+ * as it downloads. Nothing is laid out or modelled on the device.
+ */
+class FrameView : public DisplayView {
+ public:
+  FrameView();
+  ~FrameView() override;
+
+  /**
+   * Whether the panel still holds the last frame shown, so that the server
+   * may send only the part of the screen that changed.
+   */
+  bool acceptsTiles() const;
+
+  /**
+   * Stream a frame into the panel's memory: beginFrame() with the size of
+   * the response body, then the body in pieces of any size. render() shows
+   * it once complete.
+   */
+  void beginFrame(size_t size);
+  bool writeFrame(const uint8_t* data, size_t size);
+  bool frameComplete() const;
+
+  bool render(JsonDocument* doc,
+              const std::map<std::string, Sensor*>& sensors) override;
+  void cleanup() override;
+  void suspend() override;
+  uint32_t renderedFields() const override;
+
+ private:
+  // Partial refreshes before a full one is asked for, as in EPDView2
+  static constexpr uint8_t MAX_PARTIAL_UPDATES = 10;
+  // Frames are kept coded until the refresh, for writing them to the
+  // controller's copy of the previous image afterwards, and freed then
+  static const size_t MAX_FRAME_SIZE = 64 * 1024;
+
+  // Driver only, frames go straight to the controller without a frame buffer
+  GxEPD2_750_T7* epd2_;
+  FrameDecoder decoder_;
+  std::vector<uint8_t> frame_;
+  bool frame_ok_;
+  bool frame_shown_;
+  uint8_t partial_update_count_;
+
+  bool isFullWindow() const;
+  void releaseFrame();
+};
@@ -0,0 +1,262 @@
+#include "node_layout.h"
+
+#include <algorithm>
+
+void LayoutBox::add(const LayoutBox& other) {
+  if (other.empty()) {
+    return;
+  }
+  if (empty()) {
+    *this = other;
+    return;
+  }
+  int16_t x1 = std::min(x, other.x);
+  int16_t y1 = std::min(y, other.y);
+  int16_t x2 = std::max(x + w, other.x + other.w);
+  int16_t y2 = std::max(y + h, other.y + other.h);
+  x = x1;
+  y = y1;
+  w = x2 - x1;
+  h = y2 - y1;
+}
+
+void NodeLayout::clear() {
+  columns_.clear();
+  hash_ = FNV_OFFSET_BASIS;
+  measured_ = false;
+}
+
+void NodeLayout::addColumn() {
+  columns_.push_back(LayoutColumn());
+  hashValue(0xC01u);
+}
+
+void NodeLayout::addText(const uint8_t* font, const std::string& text,
+                         int16_t x, int16_t y) {
+  if (columns_.empty()) {
+    addColumn();
+  }
+  LayoutItem item = {font, text, x, y, false, 0, 0, 0};
+  columns_.back().items.push_back(item);
+
+  hashValue(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(font)));
+  hashValue(static_cast<uint16_t>(x));
+  hashValue(static_cast<uint16_t>(y));
+  hashValue(glyphCount(text));
+  measured_ = false;
+}
+
+void NodeLayout::appendText(const uint8_t* font, const std::string& text) {
+  if (columns_.empty() || columns_.back().items.empty()) {
+    addText(font, text, 0, 0);
+    return;
+  }
+  int16_t y = columns_.back().items.back().y;
+  addText(font, text, 0, y);
+  columns_.back().items.back().follows_previous = true;
+  hashValue(1);
+}
+
+void NodeLayout::addGraph(const std::string& points, int16_t x, int16_t y,
+                          uint16_t width, uint8_t height) {
+  if (columns_.empty()) {
+    addColumn();
+  }
+  int8_t ascent = height > 0 ? height - 1 : 0;
+  LayoutItem item = {nullptr, points, x, y, false, width, ascent, 0};
+  columns_.back().items.push_back(item);
+
+  hashValue(0x6A4u);
+  hashValue(static_cast<uint16_t>(x));
+  hashValue(static_cast<uint16_t>(y));
+  hashValue(width);
+  hashValue(height);
+  measured_ = false;
+}
+
+bool NodeLayout::measure(U8G2_FOR_ADAFRUIT_GFX& u8g2,
+                         const NodeLayout* cached) {
+  // A hash collision must not index past the cached items
+  if (cached != nullptr && cached->measured_ && cached->hash_ == hash_ &&
+      sameItemCounts(*cached)) {
+    for (size_t c = 0; c < columns_.size(); c++) {
+      const LayoutColumn& from = cached->columns_[c];
+      LayoutColumn& to = columns_[c];
+      for (size_t i = 0; i < to.items.size(); i++) {
+        to.items[i].x = from.items[i].x;
+        to.items[i].width = from.items[i].width;
+        to.items[i].ascent = from.items[i].ascent;
+        to.items[i].descent = from.items[i].descent;
+      }
+      to.width = from.width;
+    }
+    measured_ = true;
+    return false;
+  }
+
+  const uint8_t* current_font = nullptr;
+  int8_t ascent = 0;
+  int8_t descent = 0;
+  for (LayoutColumn& column : columns_) {
+    column.width = 0;
+    for (size_t i = 0; i < column.items.size(); i++) {
+      LayoutItem& item = column.items[i];
+      if (item.font == nullptr) {
+        // Graphs have a fixed size
+        column.width = std::max<uint16_t>(column.width, item.x + item.width);
+        continue;
+      }
+      if (item.font != current_font) {
+        current_font = item.font;
+        u8g2.setFont(current_font);
+        ascent = u8g2.getFontAscent();
+        descent = u8g2.getFontDescent();
+      }
+      if (item.follows_previous && i > 0) {
+        item.x = column.items[i - 1].x + column.items[i - 1].width;
+      }
+      item.width = u8g2.getUTF8Width(item.text.c_str());
+      item.ascent = ascent;
+      item.descent = descent;
+      column.width = std::max<uint16_t>(column.width, item.x + item.width);
+    }
+  }
+  measured_ = true;
+  return true;
+}
+
+void NodeLayout::pack(uint16_t display_width) {
+  if (columns_.empty()) {
+    return;
+  }
+
+  uint16_t pitch = display_width / columns_.size();
+  int32_t x = 0;
+  for (size_t c = 0; c < columns_.size(); c++) {
+    if (c > 0) {
+      const LayoutColumn& left = columns_[c - 1];
+      x = std::max<int32_t>(c * pitch, left.x + left.width + MIN_COLUMN_GAP);
+    }
+    columns_[c].x = x;
+  }
+
+  const LayoutColumn& last = columns_.back();
+  if (last.x + last.width > display_width) {
+    // Does not fit on an even pitch, share out whatever space is left
+    int32_t total = 0;
+    for (const LayoutColumn& column : columns_) {
+      total += column.width;
+    }
+    int32_t gap = 0;
+    if (columns_.size() > 1 && total < display_width) {
+      gap = (display_width - total) / (columns_.size() - 1);
+    }
+    x = 0;
+    for (LayoutColumn& column : columns_) {
+      column.x = x;
+      x += column.width + gap;
+    }
+  }
+
+  for (LayoutColumn& column : columns_) {
+    column.box = LayoutBox();
+    for (const LayoutItem& item : column.items) {
+      LayoutBox box;
+      box.x = column.x + item.x;
+      box.y = item.y - item.ascent;
+      box.w = item.width;
+      box.h = item.ascent - item.descent + 1;
+      column.box.add(box);
+    }
+  }
+}
+
+int16_t NodeLayout::bottom() const {
+  int16_t bottom = 0;
+  for (const LayoutColumn& column : columns_) {
+    for (const LayoutItem& item : column.items) {
+      bottom = std::max(bottom, item.y);
+    }
+  }
+  return bottom;
+}
+
+LayoutBox NodeLayout::changedBox(const NodeLayout& previous) const {
+  LayoutBox box;
+  bool moved = previous.columns_.size() != columns_.size();
+  for (size_t c = 0; !moved && c < columns_.size(); c++) {
+    moved = previous.columns_[c].x != columns_[c].x;
+  }
+
+  for (size_t c = 0; c < columns_.size(); c++) {
+    if (moved || c >= previous.columns_.size() ||
+        previous.columns_[c].box != columns_[c].box ||
+        !sameText(previous.columns_[c], columns_[c])) {
+      box.add(columns_[c].box);
+      if (c < previous.columns_.size()) {
+        box.add(previous.columns_[c].box);
+      }
+    }
+  }
+  for (size_t c = columns_.size(); c < previous.columns_.size(); c++) {
+    box.add(previous.columns_[c].box);
+  }
+  return box;
+}
+
+void NodeLayout::draw(U8G2_FOR_ADAFRUIT_GFX& u8g2) const {
+  for (const LayoutColumn& column : columns_) {
+    for (const LayoutItem& item : column.items) {
+      if (item.font == nullptr) {
+        continue;
+      }
+      u8g2.setFont(item.font);
+      u8g2.setCursor(column.x + item.x, item.y);
+      u8g2.print(item.text.c_str());
+    }
+  }
+}
+
+void NodeLayout::hashValue(uint32_t value) {
+  // FNV-1a, byte at a time
+  for (int i = 0; i < 4; i++) {
+    hash_ ^= (value >> (i * 8)) & 0xFF;
+    hash_ *= 16777619u;
+  }
+}
+
+uint16_t NodeLayout::glyphCount(const std::string& text) {
+  uint16_t count = 0;
+  for (char c : text) {
+    // Count code points, not UTF-8 continuation bytes
+    if ((c & 0xC0) != 0x80) {
+      count++;
+    }
+  }
+  return count;
+}
+
+bool NodeLayout::sameText(const LayoutColumn& a, const LayoutColumn& b) {
+  if (a.items.size() != b.items.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.items.size(); i++) {
+    if (a.items[i].text != b.items[i].text ||
+        a.items[i].font != b.items[i].font) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool NodeLayout::sameItemCounts(const NodeLayout& other) const {
+  if (other.columns_.size() != columns_.size()) {
+    return false;
+  }
+  for (size_t c = 0; c < columns_.size(); c++) {
+    if (other.columns_[c].items.size() != columns_[c].items.size()) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <U8g2_for_Adafruit_GFX.h>
+
+#include "trend.h"
+
+/**
+ * Screen rectangle, empty when w or h is 0.
+ */
+struct LayoutBox {
+  int16_t x = 0;
+  int16_t y = 0;
+  uint16_t w = 0;
+  uint16_t h = 0;
+
+  bool empty() const { return w == 0 || h == 0; }
+  void add(const LayoutBox& other);
+  bool operator==(const LayoutBox& other) const {
+    return x == other.x && y == other.y && w == other.w && h == other.h;
+  }
+  bool operator!=(const LayoutBox& other) const { return !(*this == other); }
+};
+
+/**
+ * One run of text in a node column. x is relative to the column (or to the
+ * end of the previous item when follows_previous is set) and y is the
+ * baseline, as for U8g2 setCursor().
+ *
+ * Graphs have no font and hold their Trend points in text, y being their
+ * bottom row.
+ */
+struct LayoutItem {
+  const uint8_t* font;
+  std::string text;
+  int16_t x;
+  int16_t y;
+  bool follows_previous;
+  // Filled in by measure()
+  uint16_t width;
+  int8_t ascent;
+  int8_t descent;
+};
+
+struct LayoutColumn {
+  std::vector<LayoutItem> items;
+  // Filled in by measure() and pack()
+  uint16_t width = 0;
+  int16_t x = 0;
+  LayoutBox box;
+};
+
+/**
+ * Column layout for the nodes section of the screen.
+ *
+ * Views describe the rows of each node with addColumn()/addText(), then call
+ * measure() and pack() before drawing. Text is only measured when the
+ * structural hash differs from the cached layout passed to measure(); the
+ * hash covers fonts, positions and glyph counts but not the glyphs, which is
+ * enough as all display fonts are monospaced.
+ */
+class NodeLayout {
+ public:
+  static constexpr uint16_t MIN_COLUMN_GAP = 8;
+
+  NodeLayout() : hash_(FNV_OFFSET_BASIS), measured_(false) {}
+
+  void clear();
+  void addColumn();
+  // Adds text at x within the current column on baseline y
+  void addText(const uint8_t* font, const std::string& text, int16_t x,
+               int16_t y);
+  // Adds text right after the previous item of the current column
+  void appendText(const uint8_t* font, const std::string& text);
+  // Adds a sparkline of Trend points, width by height pixels with its bottom
+  // row on y
+  void addGraph(const std::string& points, int16_t x, int16_t y,
+                uint16_t width, uint8_t height);
+
+  uint32_t structuralHash() const { return hash_; }
+  bool isMeasured() const { return measured_; }
+
+  // Measures widths, reusing those of cached when the structure is unchanged.
+  // Returns true if text had to be measured.
+  bool measure(U8G2_FOR_ADAFRUIT_GFX& u8g2, const NodeLayout* cached);
+
+  // Places columns on an even pitch, pushing a column right when its
+  // neighbour overflows and packing them tightly when they do not fit.
+  void pack(uint16_t display_width);
+
+  const std::vector<LayoutColumn>& columns() const { return columns_; }
+  // Lowest baseline over all columns
+  int16_t bottom() const;
+  // Union of the boxes of columns that differ from previous, or of all
+  // columns if the column positions changed.
+  LayoutBox changedBox(const NodeLayout& previous) const;
+
+  // Draws the text items
+  void draw(U8G2_FOR_ADAFRUIT_GFX& u8g2) const;
+  // Draws the graph items, one vertical span per pixel column from the
+  // previous point to the current one
+  template <typename Display>
+  void drawGraphs(Display& display, uint16_t color) const;
+
+ private:
+  static constexpr uint32_t FNV_OFFSET_BASIS = 2166136261u;
+
+  std::vector<LayoutColumn> columns_;
+  uint32_t hash_;
+  bool measured_;
+
+  void hashValue(uint32_t value);
+  static uint16_t glyphCount(const std::string& text);
+  static bool sameText(const LayoutColumn& a, const LayoutColumn& b);
+  bool sameItemCounts(const NodeLayout& other) const;
+};
+
+template <typename Display>
+void NodeLayout::drawGraphs(Display& display, uint16_t color) const {
+  for (const LayoutColumn& column : columns_) {
+    for (const LayoutItem& item : column.items) {
+      if (item.font != nullptr || item.text.empty()) {
+        continue;
+      }
+      const size_t count = item.text.size();
+      const int16_t left = column.x + item.x;
+      const int16_t top = item.y - item.ascent;
+      const int16_t range = item.ascent;
+      int16_t previous = -1;
+      for (uint16_t x = 0; x < item.width; x++) {
+        uint8_t point = item.text[x * count / item.width];
+        if (point == Trend::GAP) {
+          previous = -1;
+          continue;
+        }
+        int16_t y = range - point * range / Trend::MAX;
+        int16_t from = previous < 0 ? y : std::min(previous, y);
+        int16_t to = previous < 0 ? y : std::max(previous, y);
+        display.drawFastVLine(left + x, top + from, to - from + 1, color);
+        previous = y;
+      }
+    }
+  }
+}
@@ -0,0 +1,268 @@
+#!/usr/bin/env python3
+
+# Firmware patches for delta OTA updates, applied on the node by
+# lib/ota/deltapatch.cpp which documents the format. Matches are found bsdiff
+# style, allowing for mismatches, with a hash index of the old image rather
+# than a suffix array.
+#
+# publish uploads patches from the last few images of the environment found
+# in the firmware bucket (or from the given versions) to the new one, as
+# <env>-<from version>-<to version>.patch, with their SHA-256 as metadata
+# like the full images. send-measurement offers the patch from the version
+# a node reports when there is one.
+
+import hashlib
+import struct
+import subprocess
+import sys
+import tempfile
+
+USAGE = """usage: ota_delta.py diff <old.bin> <new.bin> <out.patch>
+       ota_delta.py apply <old.bin> <in.patch> <out.bin>
+       ota_delta.py publish <env> <new version> <new.bin> [<previous versions>]"""
+
+MAGIC = b'WDP1'
+BUCKET = 'enry-weather-nodes-fmw-update'
+REGION = 'eu-north-1'
+PROFILE = 'eric'
+# Images published before the new one to make patches from
+PATCH_FROM_PREVIOUS = 3
+
+# Bytes hashed to find candidate matches, indexed every INDEX_STEP bytes of
+# the old image
+KEY_SIZE = 12
+INDEX_STEP = 4
+MAX_CANDIDATES = 16
+# Approximate matches stop after this many bytes without improving
+GIVE_UP = 64
+# Zero runs shorter than this stay in the literal run around them
+MIN_ZERO_RUN = 3
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def extend_forward(old, new, old_pos, new_pos):
+    # Length maximising matches - mismatches, as bsdiff does
+    best_len = 0
+    best_score = 0
+    score = 0
+    limit = min(len(old) - old_pos, len(new) - new_pos)
+    i = 0
+    while i < limit and i - best_len <= GIVE_UP:
+        score += 1 if old[old_pos + i] == new[new_pos + i] else -1
+        i += 1
+        if score > best_score:
+            best_score = score
+            best_len = i
+    return best_len
+
+
+def extend_backward(old, new, old_pos, new_pos, limit):
+    best_len = 0
+    best_score = 0
+    score = 0
+    limit = min(limit, old_pos)
+    i = 0
+    while i < limit and i - best_len <= GIVE_UP:
+        i += 1
+        score += 1 if old[old_pos - i] == new[new_pos - i] else -1
+        if score > best_score:
+            best_score = score
+            best_len = i
+    return best_len
+
+
+def encode_differences(old, new, old_pos, new_pos, length):
+    differences = bytes((new[new_pos + i] - old[old_pos + i]) & 0xFF for i in range(length))
+    out = bytearray()
+    i = 0
+    while i < length:
+        zeros = i
+        while zeros < length and differences[zeros] == 0:
+            zeros += 1
+        literals = zeros
+        while literals < length:
+            run = literals
+            while run < length and differences[run] == 0:
+                run += 1
+            if run - literals >= MIN_ZERO_RUN or run == length:
+                break
+            literals = run + 1
+        out += varint(zeros - i) + varint(literals - zeros) + differences[zeros:literals]
+        i = literals
+    return bytes(out)
+
+
+def find_matches(old, new):
+    index = {}
+    for pos in range(0, len(old) - KEY_SIZE + 1, INDEX_STEP):
+        candidates = index.setdefault(old[pos:pos + KEY_SIZE], [])
+        if len(candidates) < MAX_CANDIDATES:
+            candidates.append(pos)
+
+    matches = []  # (new position, old position, length)
+    new_pos = 0
+    last_end = 0
+    last_old_end = 0
+    while new_pos <= len(new) - KEY_SIZE:
+        candidates = list(index.get(new[new_pos:new_pos + KEY_SIZE], []))
+        # Where the old image would be if the code in between only changed
+        aligned = last_old_end + (new_pos - last_end)
+        if aligned + KEY_SIZE <= len(old) and old[aligned:aligned + KEY_SIZE] == new[new_pos:new_pos + KEY_SIZE]:
+            candidates.insert(0, aligned)
+        best = None
+        for old_pos in candidates:
+            length = extend_forward(old, new, old_pos, new_pos)
+            if best is None or length > best[1]:
+                best = (old_pos, length)
+        if best is None or best[1] < KEY_SIZE:
+            new_pos += 1
+            continue
+        old_pos, length = best
+        back = extend_backward(old, new, old_pos, new_pos, new_pos - last_end)
+        matches.append((new_pos - back, old_pos - back, length + back))
+        new_pos += length
+        last_end = new_pos
+        last_old_end = old_pos + length
+    return matches
+
+
+def diff(old, new):
+    out = bytearray(MAGIC)
+    out += struct.pack('<II', len(old), len(new))
+    out += hashlib.sha256(old).digest() + hashlib.sha256(new).digest()
+
+    matches = find_matches(old, new)
+    for i, (match_new, match_old, length) in enumerate(matches):
+        # The first operation only has extra bytes and a seek
+        if i == 0:
+            out += varint(0) + varint(match_new) + varint(zigzag(match_old)) + new[:match_new]
+        next_new = matches[i + 1][0] if i + 1 < len(matches) else len(new)
+        next_old = matches[i + 1][1] if i + 1 < len(matches) else match_old + length
+        extra = next_new - (match_new + length)
+        seek = next_old - (match_old + length)
+        out += varint(length) + varint(extra) + varint(zigzag(seek))
+        out += encode_differences(old, new, match_old, match_new, length)
+        out += new[match_new + length:next_new]
+    if not matches and new:
+        out += varint(0) + varint(len(new)) + varint(0) + new
+    return bytes(out)
+
+
+def apply(old, patch):
+    if patch[:4] != MAGIC:
+        raise ValueError('not a patch')
+    old_size, new_size = struct.unpack('<II', patch[4:12])
+    if old_size != len(old) or hashlib.sha256(old).digest() != patch[12:44]:
+        raise ValueError('patch does not apply to this image')
+    new = bytearray()
+    pos = 76
+    old_pos = 0
+    while len(new) < new_size:
+        copy, pos = read_varint(patch, pos)
+        extra, pos = read_varint(patch, pos)
+        seek, pos = read_varint(patch, pos)
+        seek = (seek >> 1) ^ -(seek & 1)
+        left = copy
+        while left > 0:
+            zeros, pos = read_varint(patch, pos)
+            new += old[old_pos:old_pos + zeros]
+            old_pos += zeros
+            literals, pos = read_varint(patch, pos)
+            for i in range(literals):
+                new.append((old[old_pos + i] + patch[pos + i]) & 0xFF)
+            pos += literals
+            old_pos += literals
+            left -= zeros + literals
+        new += patch[pos:pos + extra]
+        pos += extra
+        old_pos += seek
+    if hashlib.sha256(new).digest() != patch[44:76]:
+        raise ValueError('patched image does not match')
+    return bytes(new)
+
+
+def aws(*args):
+    return subprocess.run(['aws', '--profile', PROFILE, '--region', REGION] + list(args),
+                          check=True, capture_output=True, text=True).stdout
+
+
+def previous_versions(env, new_version):
+    listing = aws('s3api', 'list-objects-v2', '--bucket', BUCKET, '--prefix', f'{env}-',
+                  '--query', "sort_by(Contents, &LastModified)[].Key", '--output', 'text')
+    versions = []
+    for key in listing.split():
+        name = key[len(env) + 1:]
+        if name.endswith('.bin') and '-' not in name[:-4] and name[:-4] != new_version:
+            versions.append(name[:-4])
+    return versions[-PATCH_FROM_PREVIOUS:]
+
+
+def publish(env, new_version, new_path, versions):
+    with open(new_path, 'rb') as f:
+        new = f.read()
+    if not versions:
+        versions = previous_versions(env, new_version)
+    with tempfile.TemporaryDirectory() as tmp:
+        for version in versions:
+            old_path = f'{tmp}/{version}.bin'
+            aws('s3', 'cp', f's3://{BUCKET}/{env}-{version}.bin', old_path)
+            with open(old_path, 'rb') as f:
+                old = f.read()
+            patch = diff(old, new)
+            if apply(old, patch) != new:
+                raise ValueError(f'patch from {version} does not round trip')
+            patch_path = f'{tmp}/{version}.patch'
+            with open(patch_path, 'wb') as f:
+                f.write(patch)
+            aws('s3', 'cp', patch_path, f's3://{BUCKET}/{env}-{version}-{new_version}.patch',
+                '--metadata', f'sha256={hashlib.sha256(patch).hexdigest()}')
+            print(f'Patch from {version}: {len(patch)} bytes, {100 * len(patch) / len(new):.1f}% of the image')
+
+
+def main(argv):
+    if len(argv) == 5 and argv[1] in ('diff', 'apply'):
+        with open(argv[2], 'rb') as f:
+            old = f.read()
+        with open(argv[3], 'rb') as f:
+            second = f.read()
+        result = diff(old, second) if argv[1] == 'diff' else apply(old, second)
+        with open(argv[4], 'wb') as f:
+            f.write(result)
+        print(f'{argv[4]}: {len(result)} bytes')
+    elif len(argv) >= 5 and argv[1] == 'publish':
+        publish(argv[2], argv[3], argv[4], argv[5:])
+    else:
+        print(USAGE)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
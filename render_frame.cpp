@@ -0,0 +1,129 @@
+// Host side of the server rendered frames (SERVER_RENDERED_FRAME): lays a
+// get-display response out with the firmware's own EPDView2 and prints the
+// frame FrameView streams into the panel, see lib/frame/framedecoder.h.
+//
+// usage: render_frame [--previous <frame.pbm>] [--save <frame.pbm>]
+//            < response.json > frame
+//
+// Given the frame the device shows, only the window around what changed is
+// printed. Built by build_frame_renderer.py.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <ArduinoJson.h>
+
+#include "epd_view_2.h"
+#include "framedecoder.h"
+#include "logging.h"
+#include "sensor.h"
+#include "test/mocks/snapshot.h"
+
+typedef GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT> Display;
+
+// Smallest window covering the bytes that differ, empty when none do
+static void changedWindow(const snapshot::Image& previous,
+                          const snapshot::Image& frame, uint16_t& x,
+                          uint16_t& y, uint16_t& width, uint16_t& height) {
+  size_t row_bytes = frame.rowBytes();
+  size_t first_col = row_bytes;
+  size_t last_col = 0;
+  int first_row = -1;
+  int last_row = -1;
+  for (int row = 0; row < frame.height; row++) {
+    for (size_t col = 0; col < row_bytes; col++) {
+      size_t i = row * row_bytes + col;
+      if (frame.bits[i] == previous.bits[i]) {
+        continue;
+      }
+      first_col = std::min(first_col, col);
+      last_col = std::max(last_col, col);
+      if (first_row < 0) {
+        first_row = row;
+      }
+      last_row = row;
+    }
+  }
+  if (first_row < 0) {
+    x = y = width = height = 0;
+    return;
+  }
+  x = first_col * 8;
+  y = first_row;
+  width = (last_col - first_col + 1) * 8;
+  height = last_row - first_row + 1;
+}
+
+int main(int argc, char** argv) {
+  const char* previous_path = nullptr;
+  const char* save_path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--previous") == 0 && i + 1 < argc) {
+      previous_path = argv[++i];
+    } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+      save_path = argv[++i];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--previous <frame.pbm>] [--save <frame.pbm>] "
+              "< response.json > frame\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  // The firmware's logging goes to stdout, keep it for the frame
+  FILE* out = fdopen(dup(STDOUT_FILENO), "wb");
+  dup2(STDERR_FILENO, STDOUT_FILENO);
+
+  std::string response((std::istreambuf_iterator<char>(std::cin)),
+                       std::istreambuf_iterator<char>());
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, response);
+  if (error) {
+    fprintf(stderr, "invalid response: %s\n", error.c_str());
+    return 1;
+  }
+
+  // Local sensors only show when there is no response, which the server
+  // always has
+  EPDView2 view;
+  std::map<std::string, Sensor*> sensors;
+  view.render(&doc, sensors);
+  // The layout's log records, to the lambda's log
+  LogBuffer::flush();
+  Display* display = Display::lastInstance();
+  if (display == nullptr) {
+    fprintf(stderr, "nothing rendered\n");
+    return 1;
+  }
+  snapshot::Image frame = snapshot::capture(*display);
+
+  uint16_t x = 0;
+  uint16_t y = 0;
+  uint16_t width = frame.width;
+  uint16_t height = frame.height;
+  snapshot::Image previous;
+  if (previous_path != nullptr && snapshot::readPBM(previous_path, previous) &&
+      previous.width == frame.width && previous.height == frame.height) {
+    changedWindow(previous, frame, x, y, width, height);
+  }
+
+  if (save_path != nullptr && !snapshot::writePBM(frame, save_path)) {
+    fprintf(stderr, "cannot write %s\n", save_path);
+    return 1;
+  }
+
+  std::vector<uint8_t> coded;
+  FrameDecoder::encode(frame.bits.data(), frame.rowBytes(), x, y, width,
+                       height, coded);
+  bool written = fwrite(coded.data(), 1, coded.size(), out) == coded.size();
+  return fclose(out) == 0 && written ? 0 : 1;
+}
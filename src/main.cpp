@@ -1,3 +1,4 @@
+#include "logging.h"
 #include "nodeapp.h"
 #include "secrets.h"
 
@@ -5,13 +6,13 @@ NodeApp app(WIFI_SSID, WIFI_PASSWORD);
 
 size_t showHeapInfo(const char* msg) {
   size_t free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
-  Serial.printf("%s - Free heap: %d bytes\n", msg, free_heap);
+  LOG_INFO("%s - Free heap: %u bytes", msg, static_cast<unsigned>(free_heap));
   return free_heap;
 }
 
 void setupSerial() {
   if (Serial) {
-    Serial.println(F("Serial already initialized"));
+    LOG_DEBUG("Serial already initialized");
     return;
   }
 
@@ -20,9 +21,7 @@ void setupSerial() {
   while (!Serial) {
     delay(100 / (attempts < 1 ? 1 : attempts));
     if (--attempts <= 0) {
-      Serial.println(
-          F("Gave up waiting for serial monitor, continuing... (so this "
-            "shouldn't appear...)"));
+      LOG_WARN("Gave up waiting for serial monitor, continuing...");
       break;
     }
   }
@@ -31,10 +30,14 @@ void setupSerial() {
 bool runApp() {
   bool deepSleepNeeded = false;
 
+  LogBuffer::startCycle();
   setupSerial();
   showHeapInfo("Initial heap");
   if (!app.setup()) {
     showHeapInfo("Setup failed");
+#ifdef OFFLINE_LOG_ENABLED
+    app.logOffline();
+#endif
     return true;
   }
   showHeapInfo("After setup");
@@ -43,7 +46,7 @@ bool runApp() {
   deepSleepNeeded = !success;
   showHeapInfo("After API calls");
 #else
-  Serial.println(F("No API key, no HTTP calls"));
+  LOG_WARN("No API key, no HTTP calls");
 #endif
 #ifdef HAS_DISPLAY
   deepSleepNeeded |= app.updateDisplay();
@@ -58,25 +61,30 @@ void goToSleep(bool deepSleepNeeded) {
   size_t free_heap = showHeapInfo("Before sleep");
 
   if (free_heap < 100000) {
-    Serial.println(
-        F("Low memory detected, switching to deep sleep mode forced"));
+    LOG_WARN("Low memory detected, switching to deep sleep mode forced");
     isLightSleep = false;
   }
 
 #ifdef LIGHT_SLEEP_ENABLED
   if (isLightSleep) {
-    Serial.println(F("Going to light sleep..."));
+    LOG_INFO("Going to light sleep...");
   } else {
-    Serial.println(F("Going to deep sleep..."));
+    LOG_INFO("Going to deep sleep...");
   }
 #else
-  Serial.println(F("Going to deep sleep..."));
+  LOG_INFO("Going to deep sleep...");
   isLightSleep = false;
 #endif
 
-  Serial.printf("Sleeping for %d seconds...\n", SLEEP_SECONDS);
+  app.prepareSleep(!isLightSleep);
+  LOG_INFO("Sleeping for %d seconds...", SLEEP_SECONDS);
   esp_sleep_enable_timer_wakeup(SLEEP_SECONDS * 1000000ULL);  // microseconds
 
+#ifdef LOG_SERIAL
+  // Once the cycle's work is done, rather than during it
+  LogBuffer::flush();
+#endif
+
 #if !defined(HAS_BATTERY) || defined(HAS_DISPLAY)
   delay(100);  // Let serial print
 #endif
@@ -92,6 +100,7 @@ void setup() {}
 
 void loop() {
   bool deepSleepNeeded = runApp();
+  app.endCycle();
   showHeapInfo("After runApp");
   goToSleep(deepSleepNeeded);
 }
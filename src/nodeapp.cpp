@@ -4,12 +4,21 @@
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 
+#include <algorithm>
+
 #ifdef OTA_UPDATE_ENABLED
-#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#endif
+
+#ifdef OFFLINE_LOG_ENABLED
+#include <sys/time.h>
 #endif
 
 #include "certs.h"
 #include "config.h"
+#include "jsonarena.h"
+#include "logging.h"
 #include "secrets.h"
 #include "wifi_quality.h"
 
@@ -17,6 +26,10 @@
 #include <LittleFS.h>
 
 #include "epd_view_2.h"
+#include "measurementhistory.h"
+#ifndef SERVER_RENDERED_FRAME
+#include "inflater.h"
+#endif
 #endif
 
 #if defined(HAS_BME680) || defined(HAS_SHT31D)
@@ -42,36 +55,43 @@ bool NodeApp::setup() {
   if (!setupWiFi()) {
     return false;
   }
-  registerSensors();
+  // Sensors are set up once per boot, light sleep keeps them
+  if (sensors_.empty()) {
+    registerSensors();
+  } else {
+    resumeSensors();
+  }
 #ifdef HAS_DISPLAY
   if (view_ == nullptr) {
+#ifdef SERVER_RENDERED_FRAME
+    frame_view_ = new FrameView();
+    view_ = frame_view_;
+#else
     view_ = new EPDView2();
+#endif
   } else {
-    Serial.println("Display view already initialized");
+    LOG_DEBUG("Display view already initialized");
   }
 #endif
-  Serial.printf("Weather Node git commit: %s\n", GIT_COMMIT_HASH);
+  LOG_INFO("Weather Node git commit: %s", GIT_COMMIT_HASH);
   return true;
 }
 
 bool NodeApp::setupWiFi() {
   int attempts = 20;
-  Serial.print("Connecting to WiFi");
   if (WiFi.status() != WL_CONNECTED) {
     WiFi.begin(this->ssid_, this->password_);
   }
 
   while (WiFi.status() != WL_CONNECTED) {
     delay(500 / (attempts < 1 ? 1 : attempts));
-    Serial.print(".");
     if (--attempts <= 0) {
-      Serial.println(
-          "\nFailed to connect to WiFi, retrying later, going to sleep...");
+      LOG_ERROR("Failed to connect to WiFi, retrying later, going to sleep...");
       return false;
     }
   }
-  Serial.printf("\nWiFi connected, link quality: %d dBm\n", WiFi.RSSI());
-  Serial.printf("Local IP: %s\n", WiFi.localIP().toString().c_str());
+  LOG_INFO("WiFi connected, link quality: %d dBm", WiFi.RSSI());
+  LOG_DEBUG("Local IP: %s", WiFi.localIP().toString().c_str());
   return true;
 }
 
@@ -79,27 +99,35 @@ void NodeApp::registerSensors() {
 #ifdef HAS_BME680
   sensors_["bme680"] = new BME680Sensor();
   if (!(sensors_["bme680"])->init()) {
-    Serial.println("Failed to initialize BME680 sensor");
+    LOG_ERROR("Failed to initialize BME680 sensor");
   }
 #endif
 
 #ifdef HAS_SHT31D
   sensors_["sht31d"] = new SHT31DSensor();
   if (!sensors_["sht31d"]->init()) {
-    Serial.println("Failed to initialize SHT31D sensor");
+    LOG_ERROR("Failed to initialize SHT31D sensor");
   }
 #endif
 
 #ifdef HAS_BATTERY
   sensors_["battery"] = new BatterySensor();
   if (!sensors_["battery"]->init()) {
-    Serial.println("Failed to initialize Battery sensor");
+    LOG_ERROR("Failed to initialize Battery sensor");
   }
 #endif
 
   sensors_["wifi"] = new WiFiSensor();
   if (!sensors_["wifi"]->init()) {
-    Serial.println("Failed to initialize WiFi sensor");
+    LOG_ERROR("Failed to initialize WiFi sensor");
+  }
+}
+
+void NodeApp::resumeSensors() {
+  for (auto& sensor : sensors_) {
+    if (!sensor.second->resume()) {
+      LOG_WARN("Sensor %s not available", sensor.first.c_str());
+    }
   }
 }
 
@@ -109,6 +137,19 @@ void NodeApp::registerSensors() {
 bool NodeApp::doApiCalls() {
   client_.setCACert(rootCACerts);
   bool success = doPost(client_);
+#if LOG_LEVEL > LOG_LEVEL_NONE
+  if (upload_logs_) {
+    postLogs(client_);
+    upload_logs_ = false;
+  }
+#endif
+#ifdef OFFLINE_LOG_ENABLED
+  if (success) {
+    replayOfflineLog(client_);
+  } else {
+    logOffline();
+  }
+#endif
 #ifdef HAS_DISPLAY
   success |= doGet(client_);
 #endif
@@ -133,23 +174,22 @@ bool NodeApp::doPost(WiFiClientSecure& client) {
   while (attempts-- > 0) {
     HTTPClient httpPost;
     httpPost.addHeader("x-api-key", API_KEY);
-    Serial.println(F("[HTTPS] POST begin..."));
     if (httpPost.begin(client, POST_URL)) {
-      Serial.println(F("[HTTPS] POST..."));
       int httpCode = httpPost.POST(String(payload.c_str()));
       if (httpCode > 0) {
-        Serial.printf("[HTTPS] POST code: %d\n", httpCode);
+        LOG_INFO("[HTTPS] POST code: %d", httpCode);
         String response = httpPost.getString();
-        Serial.printf("[HTTPS] POST response: %s\n", response.c_str());
-#ifdef OTA_UPDATE_ENABLED
+        LOG_DUMP("[HTTPS] POST response", response.c_str());
+#if defined(OTA_UPDATE_ENABLED) || defined(OFFLINE_LOG_ENABLED) || \
+    LOG_LEVEL > LOG_LEVEL_NONE
         handlePostResponse(response);
 #endif
         http_post_error_code_ = httpCode;
         httpPost.end();
         return (httpCode == HTTP_CODE_OK);
       } else {
-        Serial.printf("[HTTPS] POST failed, error: %s\n",
-                      httpPost.errorToString(httpCode).c_str());
+        LOG_ERROR("[HTTPS] POST failed, error: %s",
+                  httpPost.errorToString(httpCode).c_str());
         http_post_error_code_ = httpCode;
       }
     }
@@ -185,7 +225,7 @@ std::string NodeApp::buildPayload() {
   std::string payload =
       fmt::format(R"({{{}, {}, {}}})", measurements_v2, status_str, version);
 
-  Serial.printf("POST data: %s\n", payload.c_str());
+  LOG_DUMP("POST data", payload.c_str());
   return payload;
 }
 
@@ -282,7 +322,6 @@ void NodeApp::formatMeasurementsPayload(
     measurements_v2 += fmt::format(R"({})", measurement);
   }
   measurements_v2 += "}";
-  Serial.println(measurements_v2.c_str());
 }
 
 std::string NodeApp::formatStatusPayload(
@@ -310,34 +349,84 @@ bool NodeApp::doGet(WiFiClientSecure& client) {
   JsonDocument* doc = nullptr;
   int attempts = 3;
   int final_http_code = 0;
+  not_modified_ = false;
+  response_etag_.clear();
+  bool received = false;
+
+  // The server answers 304 without a body when the content of the last
+  // displayed snapshot did not change. POST errors are displayed, so the
+  // content is only enough to go by when the POST succeeded.
+  if (!etag_loaded_) {
+    etag_ = Controller::lastETag();
+    etag_loaded_ = true;
+  }
+  bool send_etag = !etag_.empty() && http_post_error_code_ == HTTP_CODE_OK;
+  const char* response_headers[] = {"ETag", "Content-Encoding"};
+
+  String url = GET_URL;
+  url += url.indexOf('?') < 0 ? "?" : "&";
+  url += "schema=" + String(Model::WIRE_SCHEMA);
+#ifdef SERVER_RENDERED_FRAME
+  // The part of the screen that changed is enough while the panel holds the
+  // frame etag_ stands for
+  bool tiles = send_etag && frame_view_ != nullptr &&
+               frame_view_->acceptsTiles();
+  url += tiles ? "&frame=2" : "&frame=1";
+  frame_received_ = false;
+#else
+  if (view_ != nullptr) {
+    url += "&fields=" + String(view_->renderedFields());
+  }
+  // Once the local history spans a whole day for every series shown, the
+  // server can skip the min/max query over the last 24h of measurements
+  if (MeasurementHistory::coversWindow(time(nullptr))) {
+    url += "&min_max=0";
+  }
+#endif
 
   while (attempts-- > 0) {
     HTTPClient httpGet;
-    httpGet.begin(client, GET_URL);
+    httpGet.begin(client, url);
     httpGet.addHeader("x-api-key", API_KEY);
+    if (send_etag) {
+      httpGet.addHeader("If-None-Match", etag_.c_str());
+    }
+#ifndef SERVER_RENDERED_FRAME
+    // The JSON is read straight off the connection, which chunked transfer
+    // encoding would get in the way of
+    httpGet.useHTTP10(true);
+    httpGet.addHeader("Accept-Encoding", "deflate");
+#endif
+    httpGet.collectHeaders(response_headers, 2);
     int httpCode = httpGet.GET();
     final_http_code = httpCode;
 
-    if (httpCode > 0) {
-      Serial.printf("[HTTPS] GET code: %d\n", httpCode);
-      String payload = httpGet.getString();
-      Serial.println(payload);
-
-      doc = new JsonDocument();
-      DeserializationError error = deserializeJson(*doc, payload);
+    if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+      LOG_INFO("[HTTPS] GET: not modified since %s", etag_.c_str());
+      not_modified_ = true;
+    } else if (httpCode > 0) {
+      LOG_INFO("[HTTPS] GET code: %d", httpCode);
+      response_etag_ = httpGet.header("ETag").c_str();
+#ifdef SERVER_RENDERED_FRAME
+      frame_received_ = httpCode == HTTP_CODE_OK && receiveFrame(httpGet);
+      received = frame_received_;
+#else
+      doc = new JsonDocument(JsonArena::instance());
+      DeserializationError error = receiveJson(httpGet, *doc);
       if (error) {
-        Serial.print(F("JSON parse failed: "));
-        Serial.println(error.f_str());
+        LOG_ERROR("JSON parse failed: %s", error.c_str());
         delete doc;
         doc = nullptr;
       }
+      received = doc != nullptr;
+#endif
     } else {
-      Serial.printf("[HTTPS] GET... failed, error: %s\n",
-                    httpGet.errorToString(httpCode).c_str());
+      LOG_ERROR("[HTTPS] GET failed, error: %s",
+                httpGet.errorToString(httpCode).c_str());
     }
     httpGet.end();
 
-    if (doc != nullptr) {
+    if (received || not_modified_) {
       break;
     }
     delay(1000 * (4 - attempts));  // Wait longer for each retry
@@ -347,7 +436,7 @@ bool NodeApp::doGet(WiFiClientSecure& client) {
     // Extract device_id from the top level of the response
     if ((*doc)["device_id"].is<JsonString>()) {
       device_id_ = (*doc)["device_id"].as<std::string>();
-      Serial.printf("Device ID from response: %s\n", device_id_.c_str());
+      LOG_DEBUG("Device ID from response: %s", device_id_.c_str());
     }
   }
 
@@ -358,83 +447,486 @@ bool NodeApp::doGet(WiFiClientSecure& client) {
   }
   doc_ = doc;
 
-  return (final_http_code == HTTP_CODE_OK && doc != nullptr);
+  return (final_http_code == HTTP_CODE_OK && received) || not_modified_;
+}
+
+#ifdef SERVER_RENDERED_FRAME
+// Streams the frame in the response into the panel as it downloads
+bool NodeApp::receiveFrame(HTTPClient& http) {
+  int left = http.getSize();
+  if (left <= 0) {
+    LOG_ERROR("Frame response without a length");
+    return false;
+  }
+  frame_view_->beginFrame(left);
+  WiFiClient* stream = http.getStreamPtr();
+  uint8_t buffer[FRAME_CHUNK_SIZE];
+  while (left > 0) {
+    size_t received =
+        stream->readBytes(buffer, std::min<int>(sizeof(buffer), left));
+    if (received == 0 || !frame_view_->writeFrame(buffer, received)) {
+      break;
+    }
+    left -= received;
+  }
+  LOG_INFO("Frame of %d bytes %s", http.getSize(),
+           left == 0 && frame_view_->frameComplete() ? "received"
+                                                     : "incomplete");
+  return left == 0 && frame_view_->frameComplete();
 }
+#else
+// Deserializes the response as it downloads, inflating it on the way when
+// the server compressed it, so the body is never held whole
+DeserializationError NodeApp::receiveJson(HTTPClient& http,
+                                          JsonDocument& doc) {
+  if (http.header("Content-Encoding") != "deflate") {
+    return deserializeJson(doc, http.getStream());
+  }
+  int left = http.getSize();
+  WiFiClient* stream = http.getStreamPtr();
+  // Its window is too large for the stack
+  Inflater* inflater =
+      new Inflater([stream, &left](uint8_t* data, size_t size) -> size_t {
+        if (left == 0) {
+          return 0;
+        }
+        // Without a length the body ends with the connection
+        size_t wanted = left > 0 ? std::min<int>(size, left) : size;
+        size_t received = stream->readBytes(data, wanted);
+        if (left > 0) {
+          left -= received;
+        }
+        return received;
+      });
+  DeserializationError error = deserializeJson(doc, *inflater);
+  if (!error && !inflater->finish()) {
+    LOG_ERROR("Compressed response corrupt or incomplete");
+    error = DeserializationError::InvalidInput;
+  }
+  delete inflater;
+  return error;
+}
+#endif
 
 // Returns true if deep sleep is needed
 bool NodeApp::updateDisplay() {
   if (view_ == nullptr) {
-    Serial.println("View not initialized");
+    LOG_ERROR("View not initialized");
     return true;
   }
+  if (not_modified_) {
+    // The panel keeps showing the last snapshot
+    LOG_INFO("Display content not modified, skipping render");
+    return false;
+  }
   view_->setHttpPostErrorCode(http_post_error_code_);
   view_->setCurrentDeviceId(device_id_);
   bool deep_sleep_needed = view_->render(doc_, sensors_);
+
+  // Keep the content version of what was displayed, if it fully describes it
+#ifdef SERVER_RENDERED_FRAME
+  bool displayed_response = frame_received_;
+#else
+  bool displayed_response = doc_ != nullptr;
+#endif
+  std::string etag =
+      displayed_response && http_post_error_code_ == HTTP_CODE_OK
+          ? response_etag_
+          : "";
+  if (etag_loaded_ && etag != etag_) {
+    Controller::saveETag(etag);
+    etag_ = etag;
+  }
   return deep_sleep_needed;
 }
 #endif
 
+void NodeApp::prepareSleep(bool deep_sleep) {
+#ifdef HAS_DISPLAY
+  if (view_ == nullptr) {
+    return;
+  }
+  if (deep_sleep) {
+    // The panel is initialized again after the wake, hibernate it meanwhile
+    view_->cleanup();
+  } else {
+    view_->suspend();
+  }
+#endif
+}
+
+void NodeApp::endCycle() {
+  if (doc_ != nullptr) {
+    delete doc_;
+    doc_ = nullptr;
+  }
+  JsonArena::instance()->reset();
+}
+
 #ifdef OTA_UPDATE_ENABLED
+namespace {
+
+// Writes to a partition being downloaded front to back, erasing sectors as
+// the writes get to them
+bool writePartition(const esp_partition_t* partition, uint32_t offset,
+                    const uint8_t* data, size_t size) {
+  // Sectors before offset were erased when the download got to them
+  uint32_t erase_from = (offset + SPI_FLASH_SEC_SIZE - 1) /
+                        SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+  uint32_t end = offset + size;
+  esp_err_t err = ESP_OK;
+  if (erase_from < end) {
+    uint32_t erase_to = (end + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE *
+                        SPI_FLASH_SEC_SIZE;
+    err = esp_partition_erase_range(partition, erase_from,
+                                    erase_to - erase_from);
+  }
+  if (err == ESP_OK) {
+    err = esp_partition_write(partition, offset, data, size);
+  }
+  if (err != ESP_OK) {
+    LOG_ERROR("OTA flash write failed: %s", esp_err_to_name(err));
+  }
+  return err == ESP_OK;
+}
+
+}  // namespace
+#endif
+
+#if defined(OTA_UPDATE_ENABLED) || defined(OFFLINE_LOG_ENABLED) || \
+    LOG_LEVEL > LOG_LEVEL_NONE
 void NodeApp::handlePostResponse(String response) {
-  JsonDocument doc = JsonDocument();
+  JsonDocument doc(JsonArena::instance());
   DeserializationError error = deserializeJson(doc, response);
   if (error) {
-    Serial.print(F("JSON parse failed: "));
-    Serial.println(error.f_str());
+    LOG_ERROR("JSON parse failed: %s", error.c_str());
     return;
   }
 
+#ifdef OFFLINE_LOG_ENABLED
+  // The RTC keeps counting through deep sleep, so offline readings can be
+  // dated
+  if (doc["timestamp_utc"].is<const char*>()) {
+    DateTime now(doc["timestamp_utc"].as<const char*>());
+    if (now.ok()) {
+      struct timeval tv = {now.epoch(), 0};
+      settimeofday(&tv, nullptr);
+    }
+  }
+#endif
+
+#ifdef OTA_UPDATE_ENABLED
   if (doc["ota_update"].is<JsonObject>()) {
     JsonObject ota_update = doc["ota_update"].as<JsonObject>();
     String url = ota_update["url"] | "";
     if (url.length() > 0) {
-      updateFirmware(url.c_str());
+      updateFirmware(ota_update);
     }
   }
+#endif
+
+#if LOG_LEVEL > LOG_LEVEL_NONE
+  upload_logs_ = (doc["upload_logs"] | 0) != 0;
+#endif
+}
+#endif
+
+#if LOG_LEVEL > LOG_LEVEL_NONE
+// Sends the records kept since the last flush, formatted on the way out
+bool NodeApp::postLogs(WiFiClientSecure& client) {
+#ifdef API_KEY
+  JsonDocument doc(JsonArena::instance());
+  JsonArray logs = doc["logs"].to<JsonArray>();
+  size_t count =
+      LogBuffer::flush([&logs](const char* line) { logs.add(line); });
+  std::string payload;
+  serializeJson(doc, payload);
+
+  HTTPClient httpPost;
+  if (!httpPost.begin(client, POST_URL)) {
+    return false;
+  }
+  httpPost.addHeader("x-api-key", API_KEY);
+  int httpCode = httpPost.POST(String(payload.c_str()));
+  httpPost.end();
+  LOG_INFO("[HTTPS] POST of %u log records, code: %d",
+           static_cast<unsigned>(count), httpCode);
+  return httpCode == HTTP_CODE_OK;
+#else
+  return false;
+#endif
 }
+#endif
 
-void NodeApp::updateFirmware(const char* firmware_url) {
+#ifdef OFFLINE_LOG_ENABLED
+void NodeApp::logOffline() {
+  time_t now = time(nullptr);
+  if (now < OfflineLog::MIN_VALID_EPOCH) {
+    LOG_WARN("Clock never set, reading not logged");
+    return;
+  }
+  if (sensors_.empty()) {
+    registerSensors();
+  }
+
+  uint8_t channels[GorillaCodec::MAX_VALUES];
+  float values[GorillaCodec::MAX_VALUES];
+  uint8_t count = 0;
+#ifdef HAS_BME680
+  if (sensors_.find("bme680") != sensors_.end() && sensors_["bme680"]->ok()) {
+    std::map<std::string, Measurement> measurements =
+        sensors_["bme680"]->read();
+    channels[count] = OfflineLog::BME680_TEMPERATURE;
+    values[count++] = measurements["temperature"].value;
+    channels[count] = OfflineLog::BME680_HUMIDITY;
+    values[count++] = measurements["humidity"].value;
+    channels[count] = OfflineLog::BME680_PRESSURE;
+    values[count++] = measurements["pressure"].value;
+  }
+#endif
+#ifdef HAS_SHT31D
+  if (sensors_.find("sht31d") != sensors_.end() && sensors_["sht31d"]->ok()) {
+    std::map<std::string, Measurement> measurements =
+        sensors_["sht31d"]->read();
+    channels[count] = OfflineLog::SHT31D_TEMPERATURE;
+    values[count++] = measurements["temperature"].value;
+    channels[count] = OfflineLog::SHT31D_HUMIDITY;
+    values[count++] = measurements["humidity"].value;
+  }
+#endif
+#ifdef HAS_BATTERY
+  if (sensors_.find("battery") != sensors_.end() && sensors_["battery"]->ok()) {
+    std::map<std::string, Measurement> measurements =
+        sensors_["battery"]->read();
+    channels[count] = OfflineLog::BATTERY_VOLTAGE;
+    values[count++] = measurements["voltage"].value;
+    channels[count] = OfflineLog::BATTERY_PERCENTAGE;
+    values[count++] = measurements["percent"].value;
+  }
+#endif
+
+  if (count == 0) {
+    return;
+  }
+  if (OfflineLog::append(now, channels, values, count)) {
+    LOG_INFO("Reading added to the offline log");
+  } else {
+    LOG_ERROR("Failed to add reading to the offline log");
+  }
+}
+
+void NodeApp::replayOfflineLog(WiFiClientSecure& client) {
+  if (OfflineLog::empty()) {
+    return;
+  }
+  size_t sent = OfflineLog::replay(
+      [&](const uint8_t* channels, uint8_t channel_count,
+          const OfflineRecord* records, size_t count) {
+        return postBackfill(client, channels, channel_count, records, count);
+      },
+      MAX_REPLAY_SEGMENTS);
+  LOG_INFO("Sent %u readings from the offline log",
+           static_cast<unsigned>(sent));
+}
+
+bool NodeApp::postBackfill(WiFiClientSecure& client, const uint8_t* channels,
+                           uint8_t channel_count, const OfflineRecord* records,
+                           size_t count) {
+#ifdef API_KEY
+  std::string payload = R"({"backfill": [)";
+  for (size_t r = 0; r < count; r++) {
+    char timestamp[32];
+    DateTime(static_cast<time_t>(records[r].timestamp))
+        .format(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S+00:00");
+    payload += fmt::format(
+        R"({}{{"timestamp_utc": "{}", "measurements_v2": {{)",
+        r > 0 ? ", " : "", timestamp);
+    const char* device = nullptr;
+    for (uint8_t c = 0; c < channel_count; c++) {
+      if (channels[c] >= OfflineLog::CHANNEL_COUNT) {
+        continue;
+      }
+      const OfflineChannel& channel = OfflineLog::CHANNELS[channels[c]];
+      if (device == nullptr || strcmp(device, channel.device) != 0) {
+        payload += fmt::format(R"({}"{}": {{)", device != nullptr ? "}, " : "",
+                               channel.device);
+        device = channel.device;
+      } else {
+        payload += ", ";
+      }
+      payload += fmt::format(R"("{}": {:.{}f})", channel.metric,
+                             records[r].values[c], channel.decimals);
+    }
+    payload += device != nullptr ? "}}}" : "}}";
+  }
+  payload += "]}";
+
+  HTTPClient httpPost;
+  if (!httpPost.begin(client, POST_URL)) {
+    return false;
+  }
+  httpPost.addHeader("x-api-key", API_KEY);
+  int httpCode = httpPost.POST(String(payload.c_str()));
+  LOG_INFO("[HTTPS] POST backfill of %u readings, code: %d",
+           static_cast<unsigned>(count), httpCode);
+  httpPost.end();
+  return httpCode == HTTP_CODE_OK;
+#else
+  return false;
+#endif
+}
+#endif
+
+#ifdef OTA_UPDATE_ENABLED
+void NodeApp::updateFirmware(JsonObject ota_update) {
+  const esp_partition_t* partition = esp_ota_get_next_update_partition(nullptr);
+  if (partition == nullptr) {
+    LOG_ERROR("No OTA partition");
+    return;
+  }
+
+  // A patch against the running image is much smaller, the full image is
+  // downloaded when it does not apply
+  JsonObject patch = ota_update["patch"];
+  if (!patch.isNull()) {
+    const char* sha256 = patch["sha256"] | "";
+    if (!OtaProgress::rejected(sha256) &&
+        installUpdate(patch["url"] | "", sha256, patch["size"] | 0, partition,
+                      true)) {
+      return;
+    }
+  }
+  installUpdate(ota_update["url"] | "", ota_update["sha256"] | "",
+                ota_update["size"] | 0, partition, false);
+}
+
+bool NodeApp::installUpdate(const char* url, const char* sha256, uint32_t size,
+                            const esp_partition_t* partition, bool is_patch) {
+  if (size == 0 || (!is_patch && size > partition->size)) {
+    LOG_ERROR("No OTA partition for a %u byte image",
+              static_cast<unsigned>(size));
+    return false;
+  }
+  if (!OtaProgress::begin(sha256, size, partition->address)) {
+    LOG_ERROR("OTA update without a valid sha256, ignored");
+    return false;
+  }
+
+  if (!OtaProgress::complete() && !downloadUpdate(url, partition, is_patch)) {
+    LOG_WARN("OTA patch does not apply to the running image");
+    OtaProgress::reject();
+    OtaProgress::clear();
+    return false;
+  }
+  if (!OtaProgress::complete()) {
+    // Resumed on the next wake
+    return true;
+  }
+
+  if (!OtaProgress::verify() ||
+      (is_patch && !OtaProgress::patch().verify())) {
+    LOG_ERROR("OTA image sha256 mismatch, discarding it");
+    if (is_patch) {
+      OtaProgress::reject();
+    }
+    OtaProgress::clear();
+    return false;
+  }
+  // Checks the image header and segments before switching
+  esp_err_t err = esp_ota_set_boot_partition(partition);
+  OtaProgress::clear();
+  if (err != ESP_OK) {
+    LOG_ERROR("Failed to set the boot partition: %s", esp_err_to_name(err));
+    return false;
+  }
+  LOG_INFO("Update successfully completed. Rebooting.");
+  ESP.restart();
+  return true;
+}
+
+bool NodeApp::downloadUpdate(const char* url, const esp_partition_t* partition,
+                             bool is_patch) {
   WiFiClientSecure client;
   client.setCACert(rootCACerts);
 
   HTTPClient https;
-  Serial.println(F("Starting OTA update"));
-
-  if (https.begin(client, firmware_url)) {
-    int httpCode = https.GET();
-    if (httpCode == HTTP_CODE_OK) {
-      int contentLength = https.getSize();
-      bool canBegin = Update.begin(contentLength);
-      if (canBegin) {
-        Serial.printf("Starting download. OTA size: %u bytes\n", contentLength);
-        WiFiClient* stream = https.getStreamPtr();
-        size_t written = Update.writeStream(*stream);
-        if (written == contentLength) {
-          Serial.println(F("OTA written successfully. Rebooting..."));
-          if (Update.end()) {
-            if (Update.isFinished()) {
-              Serial.println(F("Update successfully completed. Rebooting."));
-              ESP.restart();
-            } else {
-              Serial.println(F("Update not finished? Something went wrong!"));
-            }
-          } else {
-            Serial.printf("Update.end() error: %s\n", Update.errorString());
-          }
-        } else {
-          Serial.printf("OTA written only %u/%u bytes. Aborting.\n", written,
-                        contentLength);
-        }
-      } else {
-        Serial.println(F("Not enough space to begin OTA"));
+  if (!https.begin(client, url)) {
+    LOG_ERROR("Unable to connect to OTA server");
+    return true;
+  }
+  https.setTimeout(OTA_TIMEOUT_MS);
+  uint32_t offset = OtaProgress::offset();
+  if (offset > 0) {
+    LOG_INFO("Resuming OTA %s at %u/%u bytes (resume %u)",
+             is_patch ? "patch" : "image", static_cast<unsigned>(offset),
+             static_cast<unsigned>(OtaProgress::size()),
+             OtaProgress::resumes());
+    https.addHeader("Range", fmt::format("bytes={}-", offset).c_str());
+  } else {
+    LOG_INFO("Starting OTA %s download of %u bytes",
+             is_patch ? "patch" : "image",
+             static_cast<unsigned>(OtaProgress::size()));
+  }
+
+  int httpCode = https.GET();
+  if (httpCode == HTTP_CODE_OK && offset > 0) {
+    LOG_WARN("OTA server ignored the range, starting over");
+    OtaProgress::restart();
+  } else if (httpCode != HTTP_CODE_OK &&
+             httpCode != HTTP_CODE_PARTIAL_CONTENT) {
+    LOG_ERROR("OTA HTTPS GET failed, error: %d %s", httpCode,
+              https.errorToString(httpCode).c_str());
+    https.end();
+    return true;
+  }
+
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  DeltaPatch::ReadOld read_old = [running](uint32_t offset, uint8_t* data,
+                                           size_t size) {
+    return esp_partition_read(running, offset, data, size) == ESP_OK;
+  };
+  DeltaPatch::WriteNew write_new = [partition](uint32_t offset,
+                                               const uint8_t* data,
+                                               size_t size) {
+    return writePartition(partition, offset, data, size);
+  };
+
+  WiFiClient* stream = https.getStreamPtr();
+  uint8_t* buffer = new uint8_t[OtaProgress::CHUNK_SIZE];
+  uint32_t started_at = OtaProgress::offset();
+  unsigned long start_ms = millis();
+  bool applies = true;
+  while (!OtaProgress::complete()) {
+    offset = OtaProgress::offset();
+    size_t wanted = std::min<uint32_t>(OtaProgress::CHUNK_SIZE,
+                                       OtaProgress::size() - offset);
+    size_t received = stream->readBytes(buffer, wanted);
+    if (received == 0) {
+      break;
+    }
+    if (is_patch) {
+      applies = OtaProgress::patch().apply(buffer, received, read_old,
+                                           write_new);
+      if (!applies) {
+        break;
       }
-    } else {
-      Serial.print(F("OTA HTTPS GET failed, error: "));
-      Serial.printf("%d %s\n", httpCode, https.errorToString(httpCode).c_str());
+    } else if (!writePartition(partition, offset, buffer, received)) {
+      break;
     }
-    https.end();
-  } else {
-    Serial.println(F("Unable to connect to OTA server"));
+    OtaProgress::add(buffer, received);
   }
+  delete[] buffer;
+  https.end();
+
+  unsigned long elapsed_ms = millis() - start_ms;
+  uint32_t downloaded = OtaProgress::offset() - started_at;
+  LOG_INFO(
+      "OTA downloaded %u bytes in %lu ms (%.1f KB/s), %u/%u bytes done, "
+      "%u resumes",
+      static_cast<unsigned>(downloaded), elapsed_ms,
+      elapsed_ms > 0 ? downloaded / 1.024 / elapsed_ms : 0.0,
+      static_cast<unsigned>(OtaProgress::offset()),
+      static_cast<unsigned>(OtaProgress::size()), OtaProgress::resumes());
+  return applies;
 }
 #endif
@@ -12,12 +12,28 @@
 
 #include "config.h"
 #include "datetime.h"
+#include "logging.h"
 #include "sensor.h"
 
 // Display view system
 #ifdef HAS_DISPLAY
 #include "display_view.h"
+#ifdef SERVER_RENDERED_FRAME
+#include "frame_view.h"
 #endif
+#endif
+
+#ifdef OFFLINE_LOG_ENABLED
+#include "offlinelog.h"
+#endif
+
+#ifdef OTA_UPDATE_ENABLED
+#include <esp_ota_ops.h>
+
+#include "otaprogress.h"
+#endif
+
+class HTTPClient;
 
 class NodeApp {
  public:
@@ -33,7 +49,7 @@ class NodeApp {
   }
 
   ~NodeApp() {
-    Serial.println("Cleaning up NodeApp...");
+    LOG_DEBUG("Cleaning up NodeApp...");
     for (auto& sensor : sensors_) {
       delete sensor.second;
       sensor.second = nullptr;
@@ -56,8 +72,17 @@ class NodeApp {
 
   bool setup();
   bool updateDisplay();
+  // Light sleep keeps the drivers and the panel as they are for the next
+  // wake, deep sleep loses them so the panel is put to sleep first
+  void prepareSleep(bool deep_sleep);
+  // Frees what only the wake cycle needed: the response and the JSON arena
+  void endCycle();
   void setJsonDoc(JsonDocument* d) { doc_ = d; }
   bool doApiCalls();
+#ifdef OFFLINE_LOG_ENABLED
+  // Keeps the current readings until the server can be reached
+  void logOffline();
+#endif
 
  private:
   const char* ssid_;
@@ -65,6 +90,10 @@ class NodeApp {
   WiFiClientSecure client_;
 #ifdef HAS_DISPLAY
   DisplayView* view_;
+#ifdef SERVER_RENDERED_FRAME
+  // view_, for streaming frames into
+  FrameView* frame_view_ = nullptr;
+#endif
 #endif
 
   std::map<std::string, Sensor*> sensors_;
@@ -72,8 +101,21 @@ class NodeApp {
   JsonDocument* doc_;
   int http_post_error_code_ = 0;
   std::string device_id_;
+#ifdef HAS_DISPLAY
+  // Content version of the displayed snapshot and of the last response
+  std::string etag_;
+  bool etag_loaded_ = false;
+  std::string response_etag_;
+  // Set when the server found nothing changed since etag_
+  bool not_modified_ = false;
+#ifdef SERVER_RENDERED_FRAME
+  // Set when a whole frame was streamed into the panel
+  bool frame_received_ = false;
+#endif
+#endif
 
   void registerSensors();
+  void resumeSensors();
   bool setupWiFi();
   std::string buildPayload();
   void registerResultsBME680(
@@ -98,10 +140,41 @@ class NodeApp {
   bool doPost(WiFiClientSecure& client);
 #ifdef HAS_DISPLAY
   bool doGet(WiFiClientSecure& client);
+#ifdef SERVER_RENDERED_FRAME
+  static const size_t FRAME_CHUNK_SIZE = 512;
+  bool receiveFrame(HTTPClient& http);
+#else
+  DeserializationError receiveJson(HTTPClient& http, JsonDocument& doc);
 #endif
-#ifdef OTA_UPDATE_ENABLED
+#endif
+#if defined(OTA_UPDATE_ENABLED) || defined(OFFLINE_LOG_ENABLED) || \
+    LOG_LEVEL > LOG_LEVEL_NONE
   void handlePostResponse(String response);
-  void updateFirmware(const char* firmware_url);
+#endif
+#if LOG_LEVEL > LOG_LEVEL_NONE
+  // Set when the server asked for the log of the last wake cycles
+  bool upload_logs_ = false;
+  bool postLogs(WiFiClientSecure& client);
+#endif
+#ifdef OTA_UPDATE_ENABLED
+  // Read timeout of the firmware download, a stall ends it until next wake
+  static const uint16_t OTA_TIMEOUT_MS = 10000;
+  void updateFirmware(JsonObject ota_update);
+  // Returns false when the update cannot complete, e.g. a patch that does
+  // not apply, so another can be tried
+  bool installUpdate(const char* url, const char* sha256, uint32_t size,
+                     const esp_partition_t* partition, bool is_patch);
+  // Returns false when the patch does not apply
+  bool downloadUpdate(const char* url, const esp_partition_t* partition,
+                      bool is_patch);
+#endif
+#ifdef OFFLINE_LOG_ENABLED
+  // Segments sent per wake, to bound the time spent catching up
+  static const uint8_t MAX_REPLAY_SEGMENTS = 2;
+  void replayOfflineLog(WiFiClientSecure& client);
+  bool postBackfill(WiFiClientSecure& client, const uint8_t* channels,
+                    uint8_t channel_count, const OfflineRecord* records,
+                    size_t count);
 #endif
 };
 
@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstdarg>
+#include <chrono>
 #include <string>
 
 #include <math.h>
@@ -28,6 +29,19 @@
 
 #define F(string_literal) (string_literal)
 
+// RTC slow memory placement, plain globals on the host
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+// Milliseconds since the program started
+inline unsigned long millis() {
+  static const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
 // Basic Arduino types
 typedef uint8_t byte;
 
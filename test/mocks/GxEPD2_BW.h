@@ -4,7 +4,10 @@
 
 #ifdef UNIT_TEST
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <vector>
 
 // Mock color constants
 #define GxEPD_BLACK 0x0000
@@ -16,27 +19,172 @@ class GxEPD2_750_T7 {
   static const uint16_t WIDTH = 800;
   static const uint16_t HEIGHT = 480;
   static const uint16_t WIDTH_VISIBLE = 800;
+  // Number of times the busy callback is polled per simulated refresh
+  static const uint8_t BUSY_POLLS = 3;
 
   GxEPD2_750_T7(int8_t cs, int8_t dc, int8_t rst, int8_t busy)
       : cs_(cs), dc_(dc), rst_(rst), busy_(busy) {}
 
+  ~GxEPD2_750_T7() {
+    if (lastInitialized() == this) {
+      lastInitialized() = nullptr;
+    }
+  }
+
+  void init(uint32_t serial_diag_bitrate = 0) {
+    inits_++;
+    lastInitialized() = this;
+  }
+  void hibernate() { hibernated_ = true; }
+  // Keeps the controller's memory, unlike hibernate()
+  void powerOff() { power_offs_++; }
+
+  void setBusyCallback(void (*busyCallback)(const void*),
+                       const void* busy_callback_parameter = 0) {
+    busy_callback_ = busyCallback;
+    busy_callback_parameter_ = busy_callback_parameter;
+  }
+
+  // Called by the mock GxEPD2_BW when a refresh is started, polls the busy
+  // callback like the real driver does while the BUSY pin is active
+  void waitWhileBusy() {
+    busy_waits_++;
+    for (uint8_t i = 0; i < BUSY_POLLS && busy_callback_ != nullptr; i++) {
+      busy_callback_calls_++;
+      busy_callback_(busy_callback_parameter_);
+    }
+  }
+
+  // Most recently initialized driver, for tests to reach the panel of a view
+  // that drives it without GxEPD2_BW. Drivers are copied into GxEPD2_BW, so
+  // construction is not tracked.
+  static GxEPD2_750_T7*& lastInitialized() {
+    static GxEPD2_750_T7* instance = nullptr;
+    return instance;
+  }
+
+  // Controller memory, written directly by FrameView. Bit set = white as in
+  // the real controller, invert flips the bitmap on its way in.
+  void writeImage(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w,
+                  int16_t h, bool invert = false, bool mirror_y = false,
+                  bool pgm = false) {
+    image_writes_++;
+    writeRam(bitmap, x, y, w, h, invert);
+  }
+
+  void writeImageForFullRefresh(const uint8_t bitmap[], int16_t x, int16_t y,
+                                int16_t w, int16_t h, bool invert = false,
+                                bool mirror_y = false, bool pgm = false) {
+    image_writes_++;
+    writeRam(bitmap, x, y, w, h, invert);
+  }
+
+  // Brings the controller's copy of the previous image up to date after a
+  // refresh
+  void writeImageAgain(const uint8_t bitmap[], int16_t x, int16_t y,
+                       int16_t w, int16_t h, bool invert = false,
+                       bool mirror_y = false, bool pgm = false) {
+    image_again_writes_++;
+  }
+
+  void refresh(bool partial_update_mode = false) {
+    waitWhileBusy();
+    full_refreshes_++;
+    shown_ = ram_;
+  }
+
+  void refresh(int16_t x, int16_t y, int16_t w, int16_t h) {
+    waitWhileBusy();
+    partial_refreshes_++;
+    for (int16_t row = y; row < y + h; row++) {
+      for (int16_t col = x / 8; col < (x + w) / 8; col++) {
+        shown_[row * (WIDTH / 8) + col] = ram_[row * (WIDTH / 8) + col];
+      }
+    }
+  }
+
+  // Mock methods to access internal state for testing
+  uint32_t getBusyWaits() const { return busy_waits_; }
+  uint32_t getBusyCallbackCalls() const { return busy_callback_calls_; }
+  uint32_t getInits() const { return inits_; }
+  bool isHibernated() const { return hibernated_; }
+  uint32_t getPowerOffs() const { return power_offs_; }
+  uint32_t getImageWrites() const { return image_writes_; }
+  uint32_t getImageAgainWrites() const { return image_again_writes_; }
+  uint32_t getFullRefreshes() const { return full_refreshes_; }
+  uint32_t getPartialRefreshes() const { return partial_refreshes_; }
+  // Pixel on the panel as of the last refresh
+  bool isShownBlack(int16_t x, int16_t y) const {
+    return !(shown_[y * (WIDTH / 8) + x / 8] & (0x80 >> (x & 7)));
+  }
+
  private:
+  std::vector<uint8_t> ram_ = std::vector<uint8_t>(WIDTH / 8 * HEIGHT, 0xFF);
+  std::vector<uint8_t> shown_ =
+      std::vector<uint8_t>(WIDTH / 8 * HEIGHT, 0xFF);
+  uint32_t inits_ = 0;
+  bool hibernated_ = false;
+  uint32_t power_offs_ = 0;
+  uint32_t image_writes_ = 0;
+  uint32_t image_again_writes_ = 0;
+  uint32_t full_refreshes_ = 0;
+  uint32_t partial_refreshes_ = 0;
+
+  void writeRam(const uint8_t bitmap[], int16_t x, int16_t y, int16_t w,
+                int16_t h, bool invert) {
+    for (int16_t row = 0; row < h; row++) {
+      for (int16_t col = 0; col < w / 8; col++) {
+        uint8_t data = bitmap[row * (w / 8) + col];
+        ram_[(y + row) * (WIDTH / 8) + x / 8 + col] = invert ? ~data : data;
+      }
+    }
+  }
+
   int8_t cs_;
   int8_t dc_;
   int8_t rst_;
   int8_t busy_;
+  void (*busy_callback_)(const void*) = nullptr;
+  const void* busy_callback_parameter_ = nullptr;
+  uint32_t busy_waits_ = 0;
+  uint32_t busy_callback_calls_ = 0;
 };
 
 // Mock GxEPD2_BW template class
+//
+// Drawing goes into a 1 bit per pixel frame buffer covering the whole panel
+// (bit set = black, rows padded to whole bytes) so that rendered output can
+// be inspected and written out as an image on the host. Partial windows clip
+// drawing the same way the real driver does.
 template <typename GxEPD2_Type, uint16_t page_height>
 class GxEPD2_BW {
  public:
   GxEPD2_BW(GxEPD2_Type display)
-      : display_(display),
+      : epd2(display),
         width_(GxEPD2_Type::WIDTH_VISIBLE),
         height_(GxEPD2_Type::HEIGHT),
         page_index_(0),
-        in_page_loop_(false) {}
+        in_page_loop_(false),
+        frame_((GxEPD2_Type::WIDTH_VISIBLE + 7) / 8 * GxEPD2_Type::HEIGHT,
+               0) {
+    lastInstance() = this;
+  }
+
+  ~GxEPD2_BW() {
+    if (lastInstance() == this) {
+      lastInstance() = nullptr;
+    }
+  }
+
+  // Most recently constructed display, for tests to reach the frame buffer
+  // of a display owned by a view.
+  static GxEPD2_BW*& lastInstance() {
+    static GxEPD2_BW* instance = nullptr;
+    return instance;
+  }
+
+  // Panel driver, public as in the real library
+  GxEPD2_Type epd2;
 
   void init(uint32_t serial_diag_bitrate = 0, bool initial = true,
             uint16_t reset_duration = 10, bool pulldown_rst_mode = false) {
@@ -48,7 +196,13 @@ class GxEPD2_BW {
     // For simplicity, don't swap width/height in mock
   }
 
-  void setFullWindow() { full_window_ = true; }
+  void setFullWindow() {
+    full_window_ = true;
+    partial_x_ = 0;
+    partial_y_ = 0;
+    partial_w_ = width_;
+    partial_h_ = height_;
+  }
 
   void setPartialWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
     full_window_ = false;
@@ -59,6 +213,8 @@ class GxEPD2_BW {
   }
 
   void firstPage() {
+    // The real driver starts every page loop from a white window
+    fillScreen(GxEPD_WHITE);
     page_index_ = 0;
     in_page_loop_ = true;
   }
@@ -71,6 +227,12 @@ class GxEPD2_BW {
     // For mock, simulate only 1 page
     if (page_index_ >= 1) {
       in_page_loop_ = false;
+      epd2.waitWhileBusy();
+      if (full_window_) {
+        full_refresh_count_++;
+      } else {
+        partial_refresh_count_++;
+      }
       return false;
     }
     return true;
@@ -83,21 +245,62 @@ class GxEPD2_BW {
     // Mock hibernate - do nothing
   }
 
+  void powerOff() { epd2.powerOff(); }
+
   // Mock methods to access internal state for testing
   bool isInPageLoop() const { return in_page_loop_; }
   bool isFullWindow() const { return full_window_; }
   uint8_t getRotation() const { return rotation_; }
+  uint16_t getPartialX() const { return partial_x_; }
+  uint16_t getPartialY() const { return partial_y_; }
+  uint16_t getPartialW() const { return partial_w_; }
+  uint16_t getPartialH() const { return partial_h_; }
+  uint32_t getFullRefreshCount() const { return full_refresh_count_; }
+  uint32_t getPartialRefreshCount() const { return partial_refresh_count_; }
 
   uint16_t getTextColor() const { return text_color_; }
   void setTextColor(uint16_t color) { text_color_ = color; }
 
+  void drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if (!inWindow(x, y)) return;
+    uint8_t& byte = frame_[y * rowBytes() + x / 8];
+    uint8_t bit = 0x80 >> (x & 7);
+    if (color == GxEPD_WHITE) {
+      byte &= ~bit;
+    } else {
+      byte |= bit;
+    }
+  }
+
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    for (int16_t i = 0; i < w; i++) drawPixel(x + i, y, color);
+  }
+
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    for (int16_t i = 0; i < h; i++) drawPixel(x, y + i, color);
+  }
+
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    for (int16_t j = 0; j < h; j++) drawFastHLine(x, y + j, w, color);
+  }
+
   void fillScreen(uint16_t color) {
-    // Mock fillScreen - do nothing
     screen_color_ = color;
+    // Like the real driver, only the current window is cleared
+    fillRect(full_window_ ? 0 : partial_x_, full_window_ ? 0 : partial_y_,
+             full_window_ ? width_ : partial_w_,
+             full_window_ ? height_ : partial_h_, color);
+  }
+
+  // Frame buffer access for snapshot tests
+  bool getPixel(int16_t x, int16_t y) const {
+    if (x < 0 || y < 0 || x >= width_ || y >= height_) return false;
+    return frame_[y * rowBytes() + x / 8] & (0x80 >> (x & 7));
   }
+  const std::vector<uint8_t>& getFrameBuffer() const { return frame_; }
+  void clearFrameBuffer() { std::fill(frame_.begin(), frame_.end(), 0); }
 
  private:
-  GxEPD2_Type display_;
   uint16_t width_;
   uint16_t height_;
   uint8_t rotation_ = 0;
@@ -110,6 +313,18 @@ class GxEPD2_BW {
   bool in_page_loop_ = false;
   uint16_t text_color_ = GxEPD_BLACK;
   uint16_t screen_color_ = GxEPD_WHITE;
+  uint32_t full_refresh_count_ = 0;
+  uint32_t partial_refresh_count_ = 0;
+  std::vector<uint8_t> frame_;
+
+  size_t rowBytes() const { return (width_ + 7) / 8; }
+
+  bool inWindow(int16_t x, int16_t y) const {
+    if (x < 0 || y < 0 || x >= width_ || y >= height_) return false;
+    if (full_window_) return true;
+    return x >= partial_x_ && x < partial_x_ + partial_w_ && y >= partial_y_ &&
+           y < partial_y_ + partial_h_;
+  }
 };
 
 #endif  // UNIT_TEST
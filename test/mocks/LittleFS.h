@@ -5,6 +5,7 @@
 #ifdef UNIT_TEST
 
 #include "Arduino.h"
+#include <cstring>
 #include <string>
 #include <map>
 
@@ -12,32 +13,58 @@
 class LittleFSClass;
 
 // Mock File class
+//
+// Files opened for writing append to the file system's in-memory contents,
+// so data written through one File can be read back through another.
 class File {
  public:
-  File() : valid_(false), data_(""), pos_(0) {}
-  explicit File(bool valid, const std::string& data = "") : valid_(valid), data_(data), pos_(0) {}
+  File() : valid_(false), data_(""), pos_(0), target_(nullptr) {}
+  explicit File(bool valid, const std::string& data = "",
+                std::string* target = nullptr)
+      : valid_(valid), data_(data), pos_(0), target_(target) {}
   
   operator bool() const { return valid_; }
   bool available() const { return pos_ < data_.size(); }
   int read() { 
     if (pos_ < data_.size()) {
-      return data_[pos_++];
+      return static_cast<uint8_t>(data_[pos_++]);
     }
     return -1; 
   }
-  size_t write(uint8_t) { return 0; }
-  size_t write(const uint8_t* buf, size_t size) { return size; }
-  size_t print(const char* str) { return 0; }
+  size_t read(uint8_t* buf, size_t size) {
+    size_t n = 0;
+    while (n < size && pos_ < data_.size()) {
+      buf[n++] = static_cast<uint8_t>(data_[pos_++]);
+    }
+    return n;
+  }
+  bool seek(size_t pos) {
+    if (pos > data_.size()) return false;
+    pos_ = pos;
+    return true;
+  }
+  size_t position() const { return target_ ? target_->size() : pos_; }
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t size) {
+    if (target_ == nullptr) return 0;
+    target_->append(reinterpret_cast<const char*>(buf), size);
+    return size;
+  }
+  size_t print(const char* str) {
+    return write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+  }
+  void flush() {}
   void close() {}
   
   File openNextFile() { return File(false); }
   const char* name() const { return "mock_file"; }
-  size_t size() const { return data_.size(); }
+  size_t size() const { return target_ ? target_->size() : data_.size(); }
   
  private:
   bool valid_;
   std::string data_;
   mutable size_t pos_;
+  std::string* target_;
 };
 
 // Mock LittleFS class
@@ -66,10 +93,25 @@ class LittleFSClass {
       return File(false);
     }
     if (mode[0] == 'w') {
-      // Create file entry
+      // Create or truncate file entry
       files_[path] = "";
     }
-    return File(true);
+    std::string& contents = files_[path];
+    return File(true, contents, &contents);
+  }
+
+  bool rename(const char* from, const char* to) {
+    if (!exists(from)) return false;
+    files_[to] = files_[from];
+    files_.erase(from);
+    return true;
+  }
+
+  // Mock methods to access internal state for testing
+  const std::string& contents(const char* path) { return files_[path]; }
+  void reset() {
+    files_.clear();
+    files_["/last-displayed.json"] = "{}";
   }
   
   bool remove(const char* path) {
@@ -87,8 +129,12 @@ class LittleFSClass {
   std::map<std::string, std::string> files_;
 };
 
-// Global instance
-static LittleFSClass LittleFS;
+// Global instance, shared by all translation units like the real one
+inline LittleFSClass& mockLittleFS() {
+  static LittleFSClass instance;
+  return instance;
+}
+static LittleFSClass& LittleFS = mockLittleFS();
 
 #endif  // UNIT_TEST
 
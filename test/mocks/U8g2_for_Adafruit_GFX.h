@@ -7,25 +7,89 @@
 #include <cstdint>
 #include <cstdarg>
 #include <cstdio>
+#include <functional>
 #include <string>
 #include <vector>
 
 // Mock u8g2 font type
 typedef const uint8_t* u8g2_font_t;
 
-// Mock font definitions - just use nullptr for testing
-static const uint8_t u8g2_font_inb38_mf_data[] = {0};
-static const uint8_t u8g2_font_inb24_mf_data[] = {0};
-static const uint8_t u8g2_font_inb16_mf_data[] = {0};
+// Mock font definitions. The first byte is the pixel scale applied to the
+// built-in 5x7 glyphs below, chosen so that text occupies roughly the same
+// area as the real font on the panel.
+static const uint8_t u8g2_font_inb38_mf_data[] = {5};
+static const uint8_t u8g2_font_inb24_mf_data[] = {3};
+static const uint8_t u8g2_font_inb16_mf_data[] = {2};
 static const uint8_t* u8g2_font_inb38_mf = u8g2_font_inb38_mf_data;
 static const uint8_t* u8g2_font_inb24_mf = u8g2_font_inb24_mf_data;
 static const uint8_t* u8g2_font_inb16_mf = u8g2_font_inb16_mf_data;
 
+// Classic 5x7 column-major glyphs for ASCII 0x20..0x7E, LSB at the top.
+static const uint8_t mock_u8g2_glyphs_5x7[][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00},
+    {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14},
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00},
+    {0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00},
+    {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08},
+    {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31},
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39},
+    {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E},
+    {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00},
+    {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x41, 0x22, 0x14, 0x08, 0x00}, {0x02, 0x01, 0x51, 0x09, 0x06},
+    {0x32, 0x49, 0x79, 0x41, 0x3E}, {0x7E, 0x11, 0x11, 0x11, 0x7E},
+    {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41},
+    {0x7F, 0x09, 0x09, 0x01, 0x01}, {0x3E, 0x41, 0x41, 0x51, 0x32},
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41},
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x04, 0x02, 0x7F},
+    {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E},
+    {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31},
+    {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F},
+    {0x63, 0x14, 0x08, 0x14, 0x63}, {0x03, 0x04, 0x78, 0x04, 0x03},
+    {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x00, 0x7F, 0x41, 0x41},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x41, 0x41, 0x7F, 0x00, 0x00},
+    {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40},
+    {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20},
+    {0x38, 0x44, 0x44, 0x48, 0x7F}, {0x38, 0x54, 0x54, 0x54, 0x18},
+    {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x08, 0x14, 0x54, 0x54, 0x3C},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00},
+    {0x20, 0x40, 0x44, 0x3D, 0x00}, {0x00, 0x7F, 0x10, 0x28, 0x44},
+    {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38},
+    {0x7C, 0x14, 0x14, 0x14, 0x08}, {0x08, 0x14, 0x14, 0x18, 0x7C},
+    {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C},
+    {0x1C, 0x20, 0x40, 0x20, 0x1C}, {0x3C, 0x40, 0x30, 0x40, 0x3C},
+    {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00},
+    {0x00, 0x00, 0x7F, 0x00, 0x00}, {0x00, 0x41, 0x36, 0x08, 0x00},
+    {0x10, 0x08, 0x08, 0x10, 0x08}};
+
+// Used for the degree sign and any other non-ASCII code point
+static const uint8_t mock_u8g2_glyph_degree[5] = {0x00, 0x06, 0x09, 0x09,
+                                                  0x06};
+static const uint8_t mock_u8g2_glyph_unknown[5] = {0x7F, 0x41, 0x41, 0x41,
+                                                   0x7F};
+
 // Mock U8G2_FOR_ADAFRUIT_GFX class
+//
+// Text is rasterized with the 5x7 glyphs above into whatever display was
+// passed to begin(), so snapshot tests see real pixels at the positions the
+// view code asked for.
 class U8G2_FOR_ADAFRUIT_GFX {
  public:
-  U8G2_FOR_ADAFRUIT_GFX() 
-      : cursor_x_(0), 
+  U8G2_FOR_ADAFRUIT_GFX()
+      : cursor_x_(0),
         cursor_y_(0),
         font_mode_(0),
         font_direction_(0),
@@ -35,8 +99,11 @@ class U8G2_FOR_ADAFRUIT_GFX {
 
   template<typename T>
   void begin(T& display) {
-    // Mock begin - store reference if needed
     display_initialized_ = true;
+    T* target = &display;
+    draw_pixel_ = [target](int16_t x, int16_t y, uint16_t color) {
+      target->drawPixel(x, y, color);
+    };
   }
 
   void setFont(const uint8_t* font) {
@@ -66,15 +133,18 @@ class U8G2_FOR_ADAFRUIT_GFX {
 
   void print(const char* str) {
     output_buffer_ += str;
+    drawUTF8(str);
   }
 
   void print(char c) {
     output_buffer_ += c;
+    char str[2] = {c, 0};
+    drawUTF8(str);
   }
 
   void println(const char* str) {
-    output_buffer_ += str;
-    output_buffer_ += '\n';
+    print(str);
+    print('\n');
   }
 
   void printf(const char* format, ...) {
@@ -83,20 +153,24 @@ class U8G2_FOR_ADAFRUIT_GFX {
     va_start(args, format);
     vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args);
-    output_buffer_ += buffer;
+    print(buffer);
   }
 
   uint16_t getUTF8Width(const char* str) {
-    // Mock: return simple character count * 10 as approximate width
+    width_calls_++;
     if (!str) return 0;
     uint16_t count = 0;
     while (*str) {
-      count++;
+      // Count code points, not continuation bytes
+      if ((*str & 0xC0) != 0x80) count++;
       str++;
     }
-    return count * 10;
+    return count * advance();
   }
 
+  int8_t getFontAscent() const { return 7 * scale(); }
+  int8_t getFontDescent() const { return -static_cast<int8_t>(scale()); }
+
   // Mock methods to access internal state for testing
   int16_t getCursorX() const { return cursor_x_; }
   int16_t getCursorY() const { return cursor_y_; }
@@ -106,6 +180,7 @@ class U8G2_FOR_ADAFRUIT_GFX {
   const std::string& getOutputBuffer() const { return output_buffer_; }
   void clearOutputBuffer() { output_buffer_.clear(); }
   bool isInitialized() const { return display_initialized_; }
+  uint32_t getUTF8WidthCalls() const { return width_calls_; }
 
  private:
   int16_t cursor_x_;
@@ -117,6 +192,68 @@ class U8G2_FOR_ADAFRUIT_GFX {
   const uint8_t* current_font_;
   std::string output_buffer_;
   bool display_initialized_ = false;
+  uint32_t width_calls_ = 0;
+  std::function<void(int16_t, int16_t, uint16_t)> draw_pixel_;
+
+  // Mock fonts store the scale in their first byte. Real u8g2 fonts (such as
+  // the ones in lib/fonts) start with the glyph count instead, for those the
+  // scale comes from the maximum glyph height in the font header.
+  uint8_t scale() const {
+    if (current_font_ == nullptr || current_font_[0] == 0) return 1;
+    if (current_font_[0] <= 8) return current_font_[0];
+    uint8_t height_scale = current_font_[10] / 8;
+    return height_scale > 0 ? height_scale : 1;
+  }
+
+  uint16_t advance() const { return 6 * scale(); }
+
+  void drawUTF8(const char* str) {
+    while (*str) {
+      uint32_t code = static_cast<uint8_t>(*str++);
+      if (code >= 0x80) {
+        // Decode 2 and 3 byte sequences, enough for "°"
+        int extra = (code >= 0xE0) ? 2 : 1;
+        code &= (extra == 2) ? 0x0F : 0x1F;
+        while (extra-- > 0 && (*str & 0xC0) == 0x80) {
+          code = (code << 6) | (static_cast<uint8_t>(*str++) & 0x3F);
+        }
+      }
+      if (code == '\n') {
+        cursor_x_ = 0;
+        cursor_y_ += getFontAscent() - getFontDescent();
+        continue;
+      }
+      drawGlyph(code);
+      cursor_x_ += advance();
+    }
+  }
+
+  void drawGlyph(uint32_t code) {
+    if (!draw_pixel_) return;
+    const uint8_t* columns = mock_u8g2_glyph_unknown;
+    if (code >= 0x20 && code <= 0x7E) {
+      columns = mock_u8g2_glyphs_5x7[code - 0x20];
+    } else if (code == 0xB0) {
+      columns = mock_u8g2_glyph_degree;
+    }
+
+    int s = scale();
+    int top = cursor_y_ - getFontAscent();
+    // Solid mode (0) paints the glyph cell background, like u8g2 does
+    for (int cx = 0; cx < 6; cx++) {
+      uint8_t bits = cx < 5 ? columns[cx] : 0;
+      for (int cy = 0; cy < 8; cy++) {
+        bool on = (bits >> cy) & 0x01;
+        if (!on && font_mode_ != 0) continue;
+        uint16_t color = on ? foreground_color_ : background_color_;
+        for (int dx = 0; dx < s; dx++) {
+          for (int dy = 0; dy < s; dy++) {
+            draw_pixel_(cursor_x_ + cx * s + dx, top + cy * s + dy, color);
+          }
+        }
+      }
+    }
+  }
 };
 
 #endif  // UNIT_TEST
@@ -9,8 +9,8 @@
 #define U8G2_FONT_SECTION(name)
 #endif
 
-// Mock moon phases font
-static const uint8_t moon_phases_48pt_data[] = {0};
+// Mock moon phases font (first byte is the glyph scale, see U8g2 mock)
+static const uint8_t moon_phases_48pt_data[] = {6};
 static const uint8_t* moon_phases_48pt = moon_phases_48pt_data;
 
 #endif  // UNIT_TEST
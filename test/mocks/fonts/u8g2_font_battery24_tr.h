@@ -11,8 +11,8 @@
 #define U8G2_FONT_SECTION(name)
 #endif
 
-// Mock battery font
-static const uint8_t u8g2_font_battery24_tr_data[] = {0};
+// Mock battery font (first byte is the glyph scale, see U8g2 mock)
+static const uint8_t u8g2_font_battery24_tr_data[] = {3};
 static const uint8_t* u8g2_font_battery24_tr = u8g2_font_battery24_tr_data;
 
 #endif  // UNIT_TEST
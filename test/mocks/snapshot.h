@@ -0,0 +1,210 @@
+// Snapshot helpers for native testing
+//
+// Writes and compares the 1 bit per pixel frame buffer kept by the GxEPD2_BW
+// mock, so rendered screens can be checked against golden images on a
+// workstation. PBM (P4) is used for goldens as it maps directly onto the
+// frame buffer layout, PNG is written for viewing.
+#ifndef MOCK_SNAPSHOT_H
+#define MOCK_SNAPSHOT_H
+
+#ifdef UNIT_TEST
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace snapshot {
+
+// Frame buffer layout: rows padded to whole bytes, MSB first, bit set = black
+struct Image {
+  uint16_t width = 0;
+  uint16_t height = 0;
+  std::vector<uint8_t> bits;
+
+  size_t rowBytes() const { return (width + 7) / 8; }
+  bool pixel(int x, int y) const {
+    return bits[y * rowBytes() + x / 8] & (0x80 >> (x & 7));
+  }
+};
+
+template <typename Display>
+Image capture(const Display& display) {
+  Image image;
+  image.width = display.width();
+  image.height = display.height();
+  image.bits = display.getFrameBuffer();
+  return image;
+}
+
+inline bool writePBM(const Image& image, const std::string& path) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if (f == nullptr) return false;
+  fprintf(f, "P4\n%u %u\n", image.width, image.height);
+  size_t written = fwrite(image.bits.data(), 1, image.bits.size(), f);
+  fclose(f);
+  return written == image.bits.size();
+}
+
+inline bool readPBM(const std::string& path, Image& image) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == nullptr) return false;
+  unsigned width = 0;
+  unsigned height = 0;
+  bool ok = fscanf(f, "P4 %u %u", &width, &height) == 2 && fgetc(f) != EOF;
+  if (ok) {
+    image.width = width;
+    image.height = height;
+    image.bits.assign(image.rowBytes() * height, 0);
+    ok = fread(image.bits.data(), 1, image.bits.size(), f) ==
+         image.bits.size();
+  }
+  fclose(f);
+  return ok;
+}
+
+inline uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+inline void putBE32(std::vector<uint8_t>& out, uint32_t v) {
+  out.push_back(v >> 24);
+  out.push_back(v >> 16);
+  out.push_back(v >> 8);
+  out.push_back(v);
+}
+
+inline void writeChunk(FILE* f, const char* type,
+                       const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> chunk;
+  putBE32(chunk, data.size());
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+  uint32_t crc = crc32(chunk.data() + 4, chunk.size() - 4);
+  putBE32(chunk, crc);
+  fwrite(chunk.data(), 1, chunk.size(), f);
+}
+
+// 1 bit greyscale PNG using stored (uncompressed) deflate blocks, so no zlib
+// is needed. Files are ~50KB for the full panel, which is fine for a test
+// artifact.
+inline bool writePNG(const Image& image, const std::string& path) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if (f == nullptr) return false;
+
+  static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A,
+                                      '\n'};
+  fwrite(signature, 1, sizeof(signature), f);
+
+  std::vector<uint8_t> ihdr;
+  putBE32(ihdr, image.width);
+  putBE32(ihdr, image.height);
+  ihdr.push_back(1);  // bit depth
+  ihdr.push_back(0);  // greyscale
+  ihdr.push_back(0);  // deflate
+  ihdr.push_back(0);  // adaptive filtering
+  ihdr.push_back(0);  // no interlace
+  writeChunk(f, "IHDR", ihdr);
+
+  // Raw scanlines: filter byte 0, then pixels with 1 = white in PNG
+  std::vector<uint8_t> raw;
+  raw.reserve((image.rowBytes() + 1) * image.height);
+  for (uint16_t y = 0; y < image.height; y++) {
+    raw.push_back(0);
+    for (size_t b = 0; b < image.rowBytes(); b++) {
+      raw.push_back(~image.bits[y * image.rowBytes() + b]);
+    }
+  }
+
+  std::vector<uint8_t> zlib = {0x78, 0x01};
+  size_t pos = 0;
+  do {
+    size_t len = raw.size() - pos;
+    if (len > 65535) len = 65535;
+    bool last = pos + len == raw.size();
+    zlib.push_back(last ? 1 : 0);
+    zlib.push_back(len & 0xFF);
+    zlib.push_back(len >> 8);
+    zlib.push_back(~len & 0xFF);
+    zlib.push_back((~len >> 8) & 0xFF);
+    zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+    pos += len;
+  } while (pos < raw.size());
+
+  uint32_t a = 1;
+  uint32_t b = 0;
+  for (uint8_t byte : raw) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  putBE32(zlib, (b << 16) | a);
+  writeChunk(f, "IDAT", zlib);
+  writeChunk(f, "IEND", std::vector<uint8_t>());
+
+  bool ok = !ferror(f);
+  fclose(f);
+  return ok;
+}
+
+// Number of differing pixels, every pixel counts if the sizes differ
+inline long diffPixels(const Image& a, const Image& b) {
+  if (a.width != b.width || a.height != b.height) {
+    return static_cast<long>(a.width) * a.height;
+  }
+  long diff = 0;
+  for (size_t i = 0; i < a.bits.size(); i++) {
+    diff += __builtin_popcount(a.bits[i] ^ b.bits[i]);
+  }
+  return diff;
+}
+
+inline std::string dirName(const std::string& path) {
+  size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+// Compares an image against golden/<name>.pbm next to the test source.
+// Setting UPDATE_SNAPSHOTS=1 (re)writes the golden instead, and SNAPSHOT_DIR
+// dumps every rendered image there as PNG. On mismatch the actual image is
+// written next to the golden as <name>.actual.pbm/.png for inspection.
+// Returns the differing pixel count, 0 when matching, -1 when the golden is
+// missing and -2 when it could not be written.
+inline long compareWithGolden(const Image& actual, const std::string& name,
+                              const char* test_file) {
+  std::string golden_dir = dirName(test_file) + "/golden";
+  std::string golden_path = golden_dir + "/" + name + ".pbm";
+
+  const char* dump_dir = getenv("SNAPSHOT_DIR");
+  if (dump_dir != nullptr && dump_dir[0] != '\0') {
+    writePNG(actual, std::string(dump_dir) + "/" + name + ".png");
+  }
+
+  const char* update = getenv("UPDATE_SNAPSHOTS");
+  if (update != nullptr && update[0] == '1') {
+    return writePBM(actual, golden_path) ? 0 : -2;
+  }
+
+  Image golden;
+  if (!readPBM(golden_path, golden)) return -1;
+
+  long diff = diffPixels(actual, golden);
+  if (diff != 0) {
+    writePBM(actual, golden_dir + "/" + name + ".actual.pbm");
+    writePNG(actual, golden_dir + "/" + name + ".actual.png");
+  }
+  return diff;
+}
+
+}  // namespace snapshot
+
+#endif  // UNIT_TEST
+
+#endif  // MOCK_SNAPSHOT_H
@@ -0,0 +1,121 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <string.h>
+
+#include <string>
+
+#include "jsonarena.h"
+#include "model.h"
+
+static const char* SNAPSHOT =
+    "{\"date\":\"Monday 3 November 2025\",\"sun\":{\"rise\":\"07:45\","
+    "\"transit\":\"12:35\",\"set\":\"17:25\"},\"nodes\":{\"node1\":"
+    "{\"display_name\":\"Indoor\",\"measurements_v2\":{\"bme680\":"
+    "{\"temperature\":21.3,\"humidity\":45.2}},\"status\":[\"ok\"]}}}";
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_arena_bumps_and_aligns(void) {
+  JsonArena arena(1024);
+  TEST_ASSERT_EQUAL(1024, arena.capacity());
+  void* a = arena.allocate(3);
+  void* b = arena.allocate(10);
+  TEST_ASSERT_NOT_NULL(a);
+  TEST_ASSERT_EQUAL(0, reinterpret_cast<uintptr_t>(a) % JsonArena::ALIGNMENT);
+  TEST_ASSERT_EQUAL(0, reinterpret_cast<uintptr_t>(b) % JsonArena::ALIGNMENT);
+  TEST_ASSERT_TRUE(static_cast<uint8_t*>(b) > static_cast<uint8_t*>(a));
+  TEST_ASSERT_EQUAL(2, arena.live());
+  size_t used = arena.used();
+
+  // The last allocation grows and is undone in place
+  memset(b, 0x5A, 10);
+  TEST_ASSERT_TRUE(arena.reallocate(b, 100) == b);
+  TEST_ASSERT_TRUE(arena.used() > used);
+  TEST_ASSERT_EQUAL(0x5A, static_cast<uint8_t*>(b)[9]);
+  arena.deallocate(b);
+  TEST_ASSERT_TRUE(arena.used() < used);
+  TEST_ASSERT_EQUAL(1, arena.live());
+
+  // Others move, with their contents
+  memcpy(a, "abc", 3);
+  void* c = arena.allocate(8);
+  void* moved = arena.reallocate(a, 50);
+  TEST_ASSERT_TRUE(moved != a);
+  TEST_ASSERT_EQUAL_MEMORY("abc", moved, 3);
+  TEST_ASSERT_TRUE(arena.reallocate(c, 4) == c);
+  TEST_ASSERT_EQUAL(2, arena.live());
+  TEST_ASSERT_EQUAL(0, arena.heapAllocations());
+  arena.deallocate(c);
+  arena.deallocate(moved);
+  TEST_ASSERT_TRUE(arena.reset());
+  TEST_ASSERT_EQUAL(0, arena.used());
+}
+
+void test_arena_falls_back_to_heap(void) {
+  JsonArena arena(256);
+  void* small = arena.allocate(100);
+  void* large = arena.allocate(300);
+  TEST_ASSERT_NOT_NULL(large);
+  TEST_ASSERT_EQUAL(1, arena.heapAllocations());
+  TEST_ASSERT_EQUAL(1, arena.live());
+
+  // Out of room to grow, moved to the heap
+  memset(small, 7, 100);
+  void* grown = arena.reallocate(small, 250);
+  TEST_ASSERT_EQUAL(7, static_cast<uint8_t*>(grown)[99]);
+  TEST_ASSERT_EQUAL(2, arena.heapAllocations());
+  TEST_ASSERT_EQUAL(0, arena.live());
+  large = arena.reallocate(large, 400);
+
+  arena.deallocate(grown);
+  arena.deallocate(large);
+  TEST_ASSERT_TRUE(arena.reset());
+  TEST_ASSERT_EQUAL(0, arena.heapAllocations());
+}
+
+void test_arena_reset_waits_for_documents(void) {
+  JsonArena arena(4096);
+  JsonDocument* doc = new JsonDocument(&arena);
+  deserializeJson(*doc, SNAPSHOT);
+  TEST_ASSERT_TRUE(arena.live() > 0);
+  TEST_ASSERT_FALSE(arena.reset());
+  std::string name = (*doc)["nodes"]["node1"]["display_name"].as<std::string>();
+  TEST_ASSERT_EQUAL_STRING("Indoor", name.c_str());
+  delete doc;
+  TEST_ASSERT_EQUAL(0, arena.live());
+  TEST_ASSERT_TRUE(arena.reset());
+}
+
+void test_arena_models_across_cycles(void) {
+  JsonArena arena(16 * 1024);
+  Model current(SNAPSHOT);
+  size_t high_water = 0;
+  for (int cycle = 0; cycle < 50; cycle++) {
+    // What the Controller does with the last displayed snapshot
+    Model* last_displayed = new Model(SNAPSHOT, &arena);
+    TEST_ASSERT_TRUE(last_displayed->jsonLoadOK());
+    TEST_ASSERT_TRUE(*last_displayed == current);
+    delete last_displayed;
+
+    TEST_ASSERT_EQUAL(0, arena.live());
+    TEST_ASSERT_EQUAL(0, arena.heapAllocations());
+    if (cycle == 0) {
+      high_water = arena.highWater();
+      TEST_ASSERT_TRUE(high_water > 0);
+    }
+    TEST_ASSERT_EQUAL(high_water, arena.highWater());
+    TEST_ASSERT_TRUE(arena.reset());
+    TEST_ASSERT_EQUAL(0, arena.used());
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_arena_bumps_and_aligns);
+  RUN_TEST(test_arena_falls_back_to_heap);
+  RUN_TEST(test_arena_reset_waits_for_documents);
+  RUN_TEST(test_arena_models_across_cycles);
+  return UNITY_END();
+}
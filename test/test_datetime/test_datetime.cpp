@@ -1,4 +1,6 @@
 #include <unity.h>
+#include <chrono>
+#include <cstdlib>
 #include <string>
 #include "datetime.h"
 
@@ -78,6 +80,299 @@ void test_datetime_diff(void) {
   TEST_ASSERT_FLOAT_WITHIN(0.1, 30.0, diff);
 }
 
+void test_datetime_days_from_civil(void) {
+  TEST_ASSERT_EQUAL(0, DateTime::daysFromCivil(1970, 1, 1));
+  TEST_ASSERT_EQUAL(20089, DateTime::daysFromCivil(2025, 1, 1));
+  TEST_ASSERT_EQUAL(20148, DateTime::daysFromCivil(2025, 3, 1));
+  TEST_ASSERT_EQUAL(20513, DateTime::daysFromCivil(2026, 3, 1));
+  TEST_ASSERT_EQUAL(-1, DateTime::daysFromCivil(1969, 12, 31));
+}
+
+void test_datetime_epoch(void) {
+  DateTime dt("2025-10-21T15:30:45");
+  TEST_ASSERT_EQUAL(1761060645, dt.epoch());
+  TEST_ASSERT_EQUAL(0, dt.utcOffset());
+  TEST_ASSERT_EQUAL(1761060645, DateTime(dt.epoch()).epoch());
+}
+
+void test_datetime_parsing_utc_offset(void) {
+  DateTime paris("2025-10-21T17:30:45+02:00");
+  TEST_ASSERT_TRUE(paris.ok());
+  TEST_ASSERT_EQUAL(17, paris.hour());
+  TEST_ASSERT_EQUAL(7200, paris.utcOffset());
+  TEST_ASSERT_EQUAL(1761060645, paris.epoch());
+
+  DateTime india("2025-10-21T21:00:45.250+0530");
+  TEST_ASSERT_EQUAL(19800, india.utcOffset());
+  TEST_ASSERT_EQUAL(1761060645, india.epoch());
+
+  DateTime newfoundland("2025-10-21T12:00:45-03:30");
+  TEST_ASSERT_EQUAL(-12600, newfoundland.utcOffset());
+  TEST_ASSERT_EQUAL(1761060645, newfoundland.epoch());
+
+  DateTime zulu("2025-10-21T15:30:45Z");
+  TEST_ASSERT_EQUAL(0, zulu.utcOffset());
+  TEST_ASSERT_EQUAL(1761060645, zulu.epoch());
+
+  // Malformed offsets are ignored like strptime did
+  DateTime malformed("2025-10-21T15:30:45+2");
+  TEST_ASSERT_TRUE(malformed.ok());
+  TEST_ASSERT_EQUAL(0, malformed.utcOffset());
+}
+
+void test_datetime_diff_across_offsets(void) {
+  DateTime utc("2025-10-21T12:00:00Z");
+  DateTime local("2025-10-21T14:00:30+02:00");
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 30.0, local.diff(utc));
+  TEST_ASSERT_FLOAT_WITHIN(0.1, -30.0, utc.diff(local));
+}
+
+void test_datetime_weekday_and_day_of_year(void) {
+  DateTime dt("2024-12-31T08:00:00");
+  TEST_ASSERT_EQUAL_STRING("Tuesday 366", dt.format("%A %j").c_str());
+  DateTime leap("2024-02-29T08:00:00");
+  TEST_ASSERT_EQUAL_STRING("Thursday February", leap.format("%A %B").c_str());
+}
+
+static uint32_t fuzz_state = 12345;
+
+static int fuzzRandom(int n) {
+  fuzz_state = fuzz_state * 1103515245 + 12345;
+  return (fuzz_state >> 16) % n;
+}
+
+static void appendField(std::string& s, int value, int width, bool padded) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), padded ? "%0*d" : "%d", width, value);
+  s += buf;
+}
+
+// Random timestamps, in and out of range, with and without zero padding,
+// offsets and corruption, parsed by DateTime and by strptime. Whatever
+// DateTime accepts strptime accepts with the same fields, and timestamps of
+// the shape the server sends are accepted by both.
+void test_datetime_parse_fuzz_against_strptime(void) {
+  static const char* suffixes[] = {"",       "Z",      "+01:00", "-0530",
+                                   ".250Z",  "+14",    "junk",   "+1",
+                                   "-00:00", ".5-12:00"};
+  int accepted = 0;
+  for (int i = 0; i < 200000; i++) {
+    int year = fuzzRandom(10) == 0 ? fuzzRandom(10000) : 1990 + fuzzRandom(60);
+    int month = fuzzRandom(14);
+    int day = fuzzRandom(33);
+    int hour = fuzzRandom(25);
+    int minute = fuzzRandom(61);
+    int second = fuzzRandom(62);
+    bool padded = fuzzRandom(8) != 0;
+
+    std::string s;
+    appendField(s, year, 4, padded);
+    s += '-';
+    appendField(s, month, 2, padded);
+    s += '-';
+    appendField(s, day, 2, padded);
+    s += 'T';
+    appendField(s, hour, 2, padded);
+    s += ':';
+    appendField(s, minute, 2, padded);
+    s += ':';
+    appendField(s, second, 2, padded);
+    s += suffixes[fuzzRandom(10)];
+
+    bool mutated = fuzzRandom(3) == 0;
+    if (mutated) {
+      size_t at = fuzzRandom(s.size());
+      if (fuzzRandom(4) == 0) {
+        s.resize(at);
+      } else {
+        s[at] = static_cast<char>(' ' + fuzzRandom(95));
+      }
+    }
+
+    DateTime dt(s);
+    struct tm tm = {};
+    bool reference = strptime(s.c_str(), "%Y-%m-%dT%H:%M:%S", &tm) != nullptr;
+
+    if (dt.ok()) {
+      accepted++;
+      TEST_ASSERT_TRUE_MESSAGE(reference, s.c_str());
+      TEST_ASSERT_EQUAL_MESSAGE(tm.tm_year + 1900, dt.year(), s.c_str());
+      TEST_ASSERT_EQUAL_MESSAGE(tm.tm_mon + 1, dt.month(), s.c_str());
+      TEST_ASSERT_EQUAL_MESSAGE(tm.tm_mday, dt.day(), s.c_str());
+      TEST_ASSERT_EQUAL_MESSAGE(tm.tm_hour, dt.hour(), s.c_str());
+      TEST_ASSERT_EQUAL_MESSAGE(tm.tm_min, dt.minute(), s.c_str());
+      TEST_ASSERT_EQUAL_MESSAGE(tm.tm_sec, dt.second(), s.c_str());
+      TEST_ASSERT_EQUAL_MESSAGE(timegm(&tm), dt.epoch() + dt.utcOffset(),
+                                s.c_str());
+      // timegm() filled in the day of the week and of the year, of the next
+      // day for 23:59:60
+      if (dt.second() < 60) {
+        char expected[16];
+        strftime(expected, sizeof(expected), "%a %j", &tm);
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(expected, dt.format("%a %j").c_str(),
+                                         s.c_str());
+      }
+    } else if (reference && !mutated && padded && year != 0 && second < 61) {
+      TEST_FAIL_MESSAGE(s.c_str());
+    }
+  }
+  TEST_ASSERT_TRUE(accepted > 10000);
+}
+
+// Times parsing and diff of node timestamps against strptime and mktime as
+// used before. Iterations can be raised with DATETIME_BENCHMARK_ITERATIONS.
+void test_datetime_parse_benchmark(void) {
+  int iterations = 100000;
+  const char* env = getenv("DATETIME_BENCHMARK_ITERATIONS");
+  if (env != nullptr && atoi(env) > 0) {
+    iterations = atoi(env);
+  }
+  const char* now = "2025-11-03T20:00:00";
+  const char* node = "2025-11-03T19:55:00";
+
+  double total = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    total += DateTime(now).diff(DateTime(node));
+  }
+  auto parser = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+  double reference_total = 0;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    struct tm a = {};
+    struct tm b = {};
+    strptime(now, "%Y-%m-%dT%H:%M:%S", &a);
+    strptime(node, "%Y-%m-%dT%H:%M:%S", &b);
+    reference_total += difftime(mktime(&a), mktime(&b));
+  }
+  auto reference = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  char message[128];
+  snprintf(message, sizeof(message),
+           "Parse and diff: %.0f ns, strptime and mktime: %.0f ns",
+           static_cast<double>(parser) / iterations,
+           static_cast<double>(reference) / iterations);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, reference_total, total);
+}
+
+// DateTime from epoch seconds against gmtime, and the formatting fast paths
+// and niceDate() against strftime
+void test_datetime_format_matches_strftime(void) {
+  static const char* formats[] = {"%H:%M", "%H:%M:%S", "%A %d %B %Y",
+                                  "%Y-%m-%dT%H:%M:%S"};
+  for (int i = 0; i < 100000; i++) {
+    time_t epoch = static_cast<time_t>(fuzzRandom(40000)) * 86400 -
+                   static_cast<time_t>(2000) * 86400 + fuzzRandom(86400);
+    DateTime dt(epoch);
+    struct tm tm;
+    gmtime_r(&epoch, &tm);
+    TEST_ASSERT_EQUAL(tm.tm_year + 1900, dt.year());
+    TEST_ASSERT_EQUAL(tm.tm_mon + 1, dt.month());
+    TEST_ASSERT_EQUAL(tm.tm_mday, dt.day());
+    TEST_ASSERT_EQUAL(tm.tm_hour, dt.hour());
+    TEST_ASSERT_EQUAL(tm.tm_min, dt.minute());
+    TEST_ASSERT_EQUAL(tm.tm_sec, dt.second());
+
+    char expected[64];
+    char actual[64];
+    const char* format = formats[i % 4];
+    strftime(expected, sizeof(expected), format, &tm);
+    TEST_ASSERT_EQUAL(strlen(expected),
+                      dt.format(actual, sizeof(actual), format));
+    TEST_ASSERT_EQUAL_STRING(expected, actual);
+    TEST_ASSERT_EQUAL_STRING(expected, dt.format(format).c_str());
+
+    char weekday[16];
+    char month[16];
+    strftime(weekday, sizeof(weekday), "%A", &tm);
+    strftime(month, sizeof(month), "%B", &tm);
+    std::string nice = std::string(weekday) + " " +
+                       std::to_string(tm.tm_mday);
+    TEST_ASSERT_EQUAL(0, dt.niceDate().find(nice));
+    TEST_ASSERT_TRUE(dt.niceDate().find(std::string(" ") + month + " " +
+                                        std::to_string(tm.tm_year + 1900)) !=
+                     std::string::npos);
+  }
+}
+
+void test_datetime_format_into_small_buffer(void) {
+  DateTime dt("2025-09-30T07:05:09");
+  char buffer[DateTime::NICE_DATE_SIZE];
+  TEST_ASSERT_EQUAL(0, dt.format(buffer, 5, "%H:%M"));
+  TEST_ASSERT_EQUAL_STRING("", buffer);
+  TEST_ASSERT_EQUAL(5, dt.format(buffer, 6, "%H:%M"));
+  TEST_ASSERT_EQUAL_STRING("07:05", buffer);
+  TEST_ASSERT_EQUAL(0, dt.format(buffer, 4, "%Y-%m"));
+  TEST_ASSERT_EQUAL(0, dt.niceDate(buffer, DateTime::NICE_DATE_SIZE - 1));
+  TEST_ASSERT_EQUAL(27, dt.niceDate(buffer, sizeof(buffer)));
+  TEST_ASSERT_EQUAL_STRING("Tuesday 30th September 2025", buffer);
+  TEST_ASSERT_EQUAL_STRING("", dt.format("").c_str());
+
+  // Longer than the stack buffer
+  std::string long_format(100, 'x');
+  long_format += "%Y";
+  TEST_ASSERT_EQUAL_STRING((std::string(100, 'x') + "2025").c_str(),
+                           dt.format(long_format.c_str()).c_str());
+}
+
+void test_datetime_nice_date_of_invalid_timestamp(void) {
+  DateTime dt("invalid-date");
+  TEST_ASSERT_EQUAL_STRING("Sunday 0th January 0", dt.niceDate().c_str());
+}
+
+// Times the six "%H:%M" of the sun and moon events and the nice date of a wake
+// against strftime. Iterations can be raised with
+// DATETIME_BENCHMARK_ITERATIONS.
+void test_datetime_format_benchmark(void) {
+  int iterations = 100000;
+  const char* env = getenv("DATETIME_BENCHMARK_ITERATIONS");
+  if (env != nullptr && atoi(env) > 0) {
+    iterations = atoi(env);
+  }
+  DateTime dt("2025-11-03T21:00:00");
+  struct tm tm = {};
+  strptime("2025-11-03T21:00:00", "%Y-%m-%dT%H:%M:%S", &tm);
+
+  size_t total = 0;
+  char buffer[DateTime::NICE_DATE_SIZE];
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    total += dt.format(buffer, sizeof(buffer), "%H:%M");
+    total += dt.niceDate(buffer, sizeof(buffer));
+  }
+  auto fast = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+
+  size_t reference_total = 0;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    // The weekday and month niceDate() used to get from strftime
+    reference_total += strftime(buffer, sizeof(buffer), "%H:%M", &tm);
+    reference_total += strftime(buffer, sizeof(buffer), "%A", &tm);
+    reference_total += strftime(buffer, sizeof(buffer), "%B", &tm);
+  }
+  auto reference = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  char message[128];
+  snprintf(message, sizeof(message),
+           "Time and nice date: %.0f ns, strftime: %.0f ns",
+           static_cast<double>(fast) / iterations,
+           static_cast<double>(reference) / iterations);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL(iterations * strlen("21:00Monday 3rd November 2025"),
+                    total);
+  TEST_ASSERT_TRUE(reference_total > 0);
+}
+
 int main(int argc, char** argv) {
   UNITY_BEGIN();
   RUN_TEST(test_datetime_default_constructor);
@@ -89,6 +384,17 @@ int main(int argc, char** argv) {
   RUN_TEST(test_datetime_date_suffix_eleventh);
   RUN_TEST(test_datetime_date_suffix_twenty_first);
   RUN_TEST(test_datetime_diff);
+  RUN_TEST(test_datetime_days_from_civil);
+  RUN_TEST(test_datetime_epoch);
+  RUN_TEST(test_datetime_parsing_utc_offset);
+  RUN_TEST(test_datetime_diff_across_offsets);
+  RUN_TEST(test_datetime_weekday_and_day_of_year);
+  RUN_TEST(test_datetime_parse_fuzz_against_strptime);
+  RUN_TEST(test_datetime_parse_benchmark);
+  RUN_TEST(test_datetime_format_matches_strftime);
+  RUN_TEST(test_datetime_format_into_small_buffer);
+  RUN_TEST(test_datetime_nice_date_of_invalid_timestamp);
+  RUN_TEST(test_datetime_format_benchmark);
   UNITY_END();
 
   return 0;
@@ -2,6 +2,7 @@
 #include <ArduinoJson.h>
 #include <string>
 #include <map>
+#include <LittleFS.h>
 #include "epd_view_2.h"
 #include "sensor.h"
 
@@ -222,6 +223,93 @@ void test_epdview2_render_with_stale_state(void) {
   TEST_ASSERT_TRUE(result || !result);
 }
 
+void test_epdview2_persists_model_while_busy(void) {
+  LittleFS.reset();
+  EPDView2 view;
+  std::map<std::string, Sensor*> sensors;
+
+  JsonDocument doc;
+  doc["timestamp_utc"] = "2025-11-03T20:00:00";
+  doc["timestamp_local"] = "2025-11-03T21:00:00";
+  JsonObject nodes = doc["nodes"].to<JsonObject>();
+  JsonObject node1 = nodes["node1"].to<JsonObject>();
+  node1["display_name"] = "Indoor";
+
+  view.render(&doc, sensors);
+
+  GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT>* display =
+      GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT>::lastInstance();
+  TEST_ASSERT_NOT_NULL(display);
+  // The driver polled the view while the panel was busy
+  TEST_ASSERT_TRUE(display->epd2.getBusyCallbackCalls() > 0);
+  const std::string& saved = LittleFS.contents("/last-displayed.json");
+  TEST_ASSERT_TRUE(saved.find("Indoor") != std::string::npos);
+}
+
+void test_epdview2_unchanged_model_not_rewritten(void) {
+  LittleFS.reset();
+  std::map<std::string, Sensor*> sensors;
+  JsonDocument doc;
+  doc["timestamp_utc"] = "2025-11-03T20:00:00";
+  doc["timestamp_local"] = "2025-11-03T21:00:00";
+  JsonObject nodes = doc["nodes"].to<JsonObject>();
+  nodes["node1"]["display_name"] = "Indoor";
+
+  EPDView2 first;
+  first.render(&doc, sensors);
+  std::string saved = LittleFS.contents("/last-displayed.json");
+  TEST_ASSERT_FALSE(saved.empty());
+
+  // Same data on the next wake: nothing to persist
+  LittleFS.open("/last-displayed.json", "a").print(" ");
+  EPDView2 second;
+  second.render(&doc, sensors);
+  TEST_ASSERT_EQUAL_STRING((saved + " ").c_str(),
+                           LittleFS.contents("/last-displayed.json").c_str());
+}
+
+void test_epdview2_suspend_keeps_display(void) {
+  LittleFS.reset();
+  EPDView2 view;
+  std::map<std::string, Sensor*> sensors;
+  JsonDocument doc;
+  doc["timestamp_utc"] = "2025-11-03T20:00:00";
+  doc["timestamp_local"] = "2025-11-03T21:00:00";
+  JsonObject node = doc["nodes"]["node1"].to<JsonObject>();
+  node["display_name"] = "Indoor";
+  node["measurements_v2"]["bme680"]["temperature"] = 21.3;
+  view.render(&doc, sensors);
+
+  typedef GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT> Display;
+  Display* display = Display::lastInstance();
+  TEST_ASSERT_NOT_NULL(display);
+  uint32_t full_refreshes = display->getFullRefreshCount();
+  view.suspend();
+  TEST_ASSERT_EQUAL(1, display->epd2.getPowerOffs());
+
+  // The next wake from light sleep updates the same panel in place
+  node["measurements_v2"]["bme680"]["temperature"] = 19.9;
+  view.render(&doc, sensors);
+  TEST_ASSERT_TRUE(Display::lastInstance() == display);
+  TEST_ASSERT_EQUAL(full_refreshes, display->getFullRefreshCount());
+  TEST_ASSERT_TRUE(display->getPartialRefreshCount() > 0);
+  TEST_ASSERT_FALSE(display->epd2.isHibernated());
+}
+
+void test_epdview2_rendered_fields(void) {
+  EPDView2 view;
+  uint32_t fields = view.renderedFields();
+  // What the node columns show
+  TEST_ASSERT_TRUE(fields & Model::FIELD_BME680);
+  TEST_ASSERT_TRUE(fields & Model::FIELD_SHT31D);
+  TEST_ASSERT_TRUE(fields & Model::FIELD_BATTERY);
+  TEST_ASSERT_TRUE(fields & Model::FIELD_MIN_MAX);
+  TEST_ASSERT_TRUE(fields & Model::FIELD_TREND);
+  TEST_ASSERT_TRUE(fields & Model::FIELD_BAD_STATUS);
+  // Only statuses that are not ok are shown
+  TEST_ASSERT_FALSE(fields & Model::FIELD_STATUS);
+}
+
 int main(int argc, char** argv) {
   UNITY_BEGIN();
   RUN_TEST(test_epdview2_constructor);
@@ -234,6 +322,10 @@ int main(int argc, char** argv) {
   RUN_TEST(test_epdview2_render_with_min_max);
   RUN_TEST(test_epdview2_render_with_bad_status);
   RUN_TEST(test_epdview2_render_with_stale_state);
+  RUN_TEST(test_epdview2_persists_model_while_busy);
+  RUN_TEST(test_epdview2_unchanged_model_not_rewritten);
+  RUN_TEST(test_epdview2_suspend_keeps_display);
+  RUN_TEST(test_epdview2_rendered_fields);
   UNITY_END();
 
   return 0;
@@ -0,0 +1,150 @@
+#include <unity.h>
+#include <SunMoonCalc.h>
+#include <math.h>
+#include <vector>
+#include "datetime.h"
+#include "ephemeristable.h"
+#include "sunmooncache.h"
+
+static const double PARIS_LAT = 48.866667;
+static const double PARIS_LON = 2.333333;
+static const double TROMSO_LAT = 69.6496;
+static const double TROMSO_LON = 18.956;
+
+static std::vector<EphemerisDay> entries;
+
+void setUp(void) {
+  // set stuff up here
+}
+
+void tearDown(void) {
+  // clean stuff up here
+}
+
+static EphemerisTableData makeTable(double latitude, double longitude,
+                                    int year) {
+  int32_t first_day = DateTime::daysFromCivil(year, 1, 1);
+  uint16_t days = DateTime::daysFromCivil(year + 1, 1, 1) - first_day;
+  EphemerisTable::generate(latitude, longitude, first_day, days, entries);
+  EphemerisTableData table = {
+      static_cast<int32_t>(lround(latitude * 1e6)),
+      static_cast<int32_t>(lround(longitude * 1e6)), first_day, days,
+      entries.data()};
+  return table;
+}
+
+// Rounded down to the minute like the table, except for missing events
+static void assertSameMinute(time_t expected, double jd, time_t actual) {
+  if (jd == -1) {
+    TEST_ASSERT_EQUAL(EphemerisTable::NO_EVENT, actual);
+    return;
+  }
+  TEST_ASSERT_EQUAL(expected - ((expected % 60) + 60) % 60, actual);
+}
+
+// Every day of the table gives the events of a calculation at midnight
+static void assertTableMatchesCalculation(double latitude, double longitude) {
+  EphemerisTableData table = makeTable(latitude, longitude, 2025);
+  TEST_ASSERT_EQUAL(365, table.days);
+  TEST_ASSERT_EQUAL(366, entries.size());
+
+  for (int month = 1; month <= 12; month++) {
+    for (int day = 1; day <= 31; day++) {
+      SunMoonKey key =
+          SunMoonCache::makeKey(2025, month, day, latitude, longitude, 3600);
+      if (DateTime::daysFromCivil(2025, month, day) !=
+          DateTime::daysFromCivil(2025, month, 1) + day - 1) {
+        continue;  // no such day
+      }
+      SunMoonEvents events;
+      double moon_age;
+      TEST_ASSERT_TRUE(EphemerisTable::lookup(table, key, 0, 0, 0, events,
+                                              moon_age));
+
+      SunMoonCalc calc(2025, month, day, 0, 0, 0, latitude, longitude);
+      SunMoonCalc::Result result = calc.calculateSunAndMoonData();
+      assertSameMinute(result.sun.rise, result.sun.riseJd, events.sun_rise);
+      assertSameMinute(result.sun.transit, result.sun.transitJd,
+                       events.sun_transit);
+      assertSameMinute(result.sun.set, result.sun.setJd, events.sun_set);
+      assertSameMinute(result.moon.rise, result.moon.riseJd, events.moon_rise);
+      assertSameMinute(result.moon.transit, result.moon.transitJd,
+                       events.moon_transit);
+      assertSameMinute(result.moon.set, result.moon.setJd, events.moon_set);
+      TEST_ASSERT_TRUE(fabs(result.moon.age - moon_age) < 0.001);
+    }
+  }
+}
+
+void test_table_matches_calculation(void) {
+  assertTableMatchesCalculation(PARIS_LAT, PARIS_LON);
+}
+
+void test_table_matches_calculation_polar(void) {
+  assertTableMatchesCalculation(TROMSO_LAT, TROMSO_LON);
+}
+
+void test_moon_age_interpolated_during_the_day(void) {
+  EphemerisTableData table = makeTable(PARIS_LAT, PARIS_LON, 2025);
+
+  double worst = 0;
+  for (int day = 1; day <= 31; day++) {
+    for (int hour = 0; hour < 24; hour += 5) {
+      SunMoonKey key =
+          SunMoonCache::makeKey(2025, 7, day, PARIS_LAT, PARIS_LON, 7200);
+      SunMoonEvents events;
+      double moon_age;
+      TEST_ASSERT_TRUE(EphemerisTable::lookup(table, key, hour, 17, 30, events,
+                                              moon_age));
+      SunMoonCalc calc(2025, 7, day, hour, 17, 30, PARIS_LAT, PARIS_LON);
+      double error = fabs(calc.calculateMoonAge() - moon_age);
+      // Either side of a new moon
+      error = fmin(error, 29.530588853 - error);
+      worst = fmax(worst, error);
+    }
+  }
+  // Within a quarter of an hour
+  TEST_ASSERT_TRUE(worst < 0.01);
+}
+
+void test_lookup_outside_table(void) {
+  EphemerisTableData table = makeTable(PARIS_LAT, PARIS_LON, 2025);
+  SunMoonEvents events;
+  double moon_age;
+
+  SunMoonKey key =
+      SunMoonCache::makeKey(2024, 12, 31, PARIS_LAT, PARIS_LON, 3600);
+  TEST_ASSERT_FALSE(
+      EphemerisTable::lookup(table, key, 12, 0, 0, events, moon_age));
+  key = SunMoonCache::makeKey(2026, 1, 1, PARIS_LAT, PARIS_LON, 3600);
+  TEST_ASSERT_FALSE(
+      EphemerisTable::lookup(table, key, 12, 0, 0, events, moon_age));
+  key = SunMoonCache::makeKey(2025, 6, 1, 52.52, 13.405, 3600);
+  TEST_ASSERT_FALSE(
+      EphemerisTable::lookup(table, key, 12, 0, 0, events, moon_age));
+  key = SunMoonCache::makeKey(2025, 12, 31, PARIS_LAT, PARIS_LON, 3600);
+  TEST_ASSERT_TRUE(
+      EphemerisTable::lookup(table, key, 23, 59, 59, events, moon_age));
+}
+
+void test_builtin_table_empty_without_generator(void) {
+  const EphemerisTableData& table = EphemerisTable::builtin();
+  TEST_ASSERT_EQUAL(0, table.days);
+  SunMoonKey key = SunMoonCache::makeKey(2025, 6, 1, 0, 0, 0);
+  SunMoonEvents events;
+  double moon_age;
+  TEST_ASSERT_FALSE(
+      EphemerisTable::lookup(table, key, 12, 0, 0, events, moon_age));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_table_matches_calculation);
+  RUN_TEST(test_table_matches_calculation_polar);
+  RUN_TEST(test_moon_age_interpolated_during_the_day);
+  RUN_TEST(test_lookup_outside_table);
+  RUN_TEST(test_builtin_table_empty_without_generator);
+  UNITY_END();
+
+  return 0;
+}
@@ -0,0 +1,292 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "epd_view_2.h"
+#include "frame_view.h"
+#include "framedecoder.h"
+#include "measurementhistory.h"
+#include "sensor.h"
+#include "snapshot.h"
+
+typedef GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT> Display;
+
+struct Band {
+  uint16_t x;
+  uint16_t y;
+  uint16_t width;
+  uint16_t rows;
+};
+
+// Decodes a frame fed in pieces of chunk bytes into a whole panel buffer
+static bool decodeInto(const std::vector<uint8_t>& frame, size_t chunk,
+                       std::vector<uint8_t>& bits,
+                       std::vector<Band>* bands = nullptr) {
+  const size_t row_bytes = DISPLAY_WIDTH / 8;
+  bits.assign(row_bytes * DISPLAY_HEIGHT, 0);
+  FrameDecoder decoder;
+  decoder.reset();
+  FrameDecoder::WriteBand write = [&](uint16_t x, uint16_t y, uint16_t width,
+                                      uint16_t rows, const uint8_t* data) {
+    for (uint16_t row = 0; row < rows; row++) {
+      memcpy(&bits[(y + row) * row_bytes + x / 8], data + row * width / 8,
+             width / 8);
+    }
+    if (bands != nullptr) {
+      bands->push_back({x, y, width, rows});
+    }
+    return true;
+  };
+  for (size_t i = 0; i < frame.size(); i += chunk) {
+    if (!decoder.decode(frame.data() + i, std::min(chunk, frame.size() - i),
+                        write)) {
+      return false;
+    }
+  }
+  return decoder.done();
+}
+
+static void buildDoc(JsonDocument& doc, float temperature) {
+  doc["timestamp_utc"] = "2025-11-03T20:00:00";
+  doc["timestamp_local"] = "2025-11-03T21:00:00";
+  JsonObject location = doc["config"]["location"].to<JsonObject>();
+  location["latitude"] = 48.866667;
+  location["longitude"] = 2.333333;
+  location["utc_offset_seconds"] = 3600;
+
+  JsonObject node = doc["nodes"]["node1"].to<JsonObject>();
+  node["display_name"] = "Indoor";
+  node["timestamp_utc"] = "2025-11-03T19:55:00";
+  JsonObject values = node["measurements_v2"]["bme680"].to<JsonObject>();
+  values["temperature"] = temperature;
+  values["humidity"] = 45.2;
+  values["pressure"] = 1012.0;
+  node["status"]["bme680"] = "ok";
+}
+
+// What render_frame does: lays the response out with EPDView2
+static snapshot::Image renderOnHost(float temperature) {
+  EPDView2 view;
+  std::map<std::string, Sensor*> sensors;
+  JsonDocument doc;
+  buildDoc(doc, temperature);
+  view.render(&doc, sensors);
+  return snapshot::capture(*Display::lastInstance());
+}
+
+static void sendFrame(FrameView& view, const std::vector<uint8_t>& frame,
+                      size_t chunk) {
+  view.beginFrame(frame.size());
+  for (size_t i = 0; i < frame.size(); i += chunk) {
+    TEST_ASSERT_TRUE(view.writeFrame(frame.data() + i,
+                                     std::min(chunk, frame.size() - i)));
+  }
+  TEST_ASSERT_TRUE(view.frameComplete());
+}
+
+static void assertShown(const snapshot::Image& expected) {
+  GxEPD2_750_T7* epd2 = GxEPD2_750_T7::lastInitialized();
+  TEST_ASSERT_NOT_NULL(epd2);
+  long diff = 0;
+  for (int y = 0; y < expected.height; y++) {
+    for (int x = 0; x < expected.width; x++) {
+      diff += epd2->isShownBlack(x, y) != expected.pixel(x, y);
+    }
+  }
+  TEST_ASSERT_EQUAL(0, diff);
+}
+
+void setUp(void) { MeasurementHistory::clear(); }
+
+void tearDown(void) {}
+
+void test_frame_round_trip(void) {
+  snapshot::Image image = renderOnHost(21.3);
+  std::vector<uint8_t> frame;
+  FrameDecoder::encode(image.bits.data(), image.rowBytes(), 0, 0, image.width,
+                       image.height, frame);
+  // A mostly white screen codes to a fraction of its size
+  TEST_ASSERT_TRUE(frame.size() < image.bits.size() / 4);
+
+  for (size_t chunk : {size_t(1), size_t(7), size_t(512), frame.size()}) {
+    std::vector<uint8_t> bits;
+    TEST_ASSERT_TRUE(decodeInto(frame, chunk, bits));
+    TEST_ASSERT_TRUE(bits == image.bits);
+  }
+}
+
+void test_frame_bands(void) {
+  // Literal rows and runs longer than a row, in a window off the origin
+  std::vector<uint8_t> bits(DISPLAY_WIDTH / 8 * DISPLAY_HEIGHT, 0);
+  for (size_t i = 0; i < bits.size(); i++) {
+    bits[i] = (i / 300) % 2 ? 0xFF : i * 37;
+  }
+  std::vector<uint8_t> frame;
+  FrameDecoder::encode(bits.data(), DISPLAY_WIDTH / 8, 16, 40, 96, 35, frame);
+
+  std::vector<uint8_t> decoded;
+  std::vector<Band> bands;
+  TEST_ASSERT_TRUE(decodeInto(frame, 5, decoded, &bands));
+  TEST_ASSERT_EQUAL(3, bands.size());
+  TEST_ASSERT_EQUAL(16, bands[0].x);
+  TEST_ASSERT_EQUAL(40, bands[0].y);
+  TEST_ASSERT_EQUAL(96, bands[0].width);
+  TEST_ASSERT_EQUAL(FrameDecoder::BAND_ROWS, bands[0].rows);
+  TEST_ASSERT_EQUAL(40 + 2 * FrameDecoder::BAND_ROWS, bands[2].y);
+  TEST_ASSERT_EQUAL(35 - 2 * FrameDecoder::BAND_ROWS, bands[2].rows);
+  for (int y = 40; y < 75; y++) {
+    for (int col = 2; col < 14; col++) {
+      size_t i = y * DISPLAY_WIDTH / 8 + col;
+      TEST_ASSERT_EQUAL(bits[i], decoded[i]);
+    }
+  }
+}
+
+void test_frame_rejects_corrupt_frames(void) {
+  std::vector<uint8_t> bits(DISPLAY_WIDTH / 8 * DISPLAY_HEIGHT, 0);
+  std::vector<uint8_t> frame;
+  FrameDecoder::encode(bits.data(), DISPLAY_WIDTH / 8, 0, 0, 64, 8, frame);
+  std::vector<uint8_t> decoded;
+
+  std::vector<uint8_t> bad_magic = frame;
+  bad_magic[3] = '2';
+  TEST_ASSERT_FALSE(decodeInto(bad_magic, 64, decoded));
+
+  // Windows must start and end on whole bytes
+  std::vector<uint8_t> unaligned = frame;
+  unaligned[4] = 4;
+  TEST_ASSERT_FALSE(decodeInto(unaligned, 64, decoded));
+
+  std::vector<uint8_t> trailing = frame;
+  trailing.push_back(0);
+  TEST_ASSERT_FALSE(decodeInto(trailing, 64, decoded));
+
+  // A run past the end of the window
+  std::vector<uint8_t> overflow = frame;
+  overflow[overflow.size() - 2] = 257 - 128;
+  TEST_ASSERT_FALSE(decodeInto(overflow, 64, decoded));
+
+  std::vector<uint8_t> truncated(frame.begin(), frame.end() - 1);
+  TEST_ASSERT_FALSE(decodeInto(truncated, 64, decoded));
+}
+
+void test_frame_view_full_frame(void) {
+  snapshot::Image image = renderOnHost(21.3);
+  std::vector<uint8_t> frame;
+  FrameDecoder::encode(image.bits.data(), image.rowBytes(), 0, 0, image.width,
+                       image.height, frame);
+
+  FrameView view;
+  std::map<std::string, Sensor*> sensors;
+  TEST_ASSERT_FALSE(view.acceptsTiles());
+  sendFrame(view, frame, 256);
+  view.render(nullptr, sensors);
+
+  GxEPD2_750_T7* epd2 = GxEPD2_750_T7::lastInitialized();
+  TEST_ASSERT_NOT_NULL(epd2);
+  TEST_ASSERT_EQUAL(1, epd2->getFullRefreshes());
+  TEST_ASSERT_EQUAL(0, epd2->getPartialRefreshes());
+  // Written once before the refresh and again after it, a band at a time
+  TEST_ASSERT_EQUAL(epd2->getImageWrites(), epd2->getImageAgainWrites());
+  assertShown(image);
+  TEST_ASSERT_TRUE(view.acceptsTiles());
+}
+
+void test_frame_view_tile(void) {
+  snapshot::Image before = renderOnHost(21.3);
+  snapshot::Image after = renderOnHost(19.9);
+  std::vector<uint8_t> frame;
+  FrameDecoder::encode(before.bits.data(), before.rowBytes(), 0, 0,
+                       before.width, before.height, frame);
+
+  FrameView view;
+  std::map<std::string, Sensor*> sensors;
+  sendFrame(view, frame, 1024);
+  view.render(nullptr, sensors);
+
+  // Only the rows of the changed temperature
+  int first = -1;
+  int last = -1;
+  for (int y = 0; y < after.height; y++) {
+    for (size_t col = 0; col < after.rowBytes(); col++) {
+      if (after.bits[y * after.rowBytes() + col] !=
+          before.bits[y * before.rowBytes() + col]) {
+        first = first < 0 ? y : first;
+        last = y;
+      }
+    }
+  }
+  TEST_ASSERT_TRUE(first > 0);
+  frame.clear();
+  FrameDecoder::encode(after.bits.data(), after.rowBytes(), 0, first,
+                       after.width, last - first + 1, frame);
+  sendFrame(view, frame, 100);
+  TEST_ASSERT_FALSE(view.render(nullptr, sensors));
+
+  GxEPD2_750_T7* epd2 = GxEPD2_750_T7::lastInitialized();
+  TEST_ASSERT_EQUAL(1, epd2->getFullRefreshes());
+  TEST_ASSERT_EQUAL(1, epd2->getPartialRefreshes());
+  TEST_ASSERT_EQUAL(1, epd2->getInits());
+  assertShown(after);
+
+  // Nothing changed
+  frame.clear();
+  FrameDecoder::encode(after.bits.data(), after.rowBytes(), 0, 0, 0, 0, frame);
+  sendFrame(view, frame, 100);
+  TEST_ASSERT_FALSE(view.render(nullptr, sensors));
+  TEST_ASSERT_EQUAL(1, epd2->getPartialRefreshes());
+}
+
+void test_frame_view_failed_download(void) {
+  snapshot::Image image = renderOnHost(21.3);
+  std::vector<uint8_t> frame;
+  FrameDecoder::encode(image.bits.data(), image.rowBytes(), 0, 0, image.width,
+                       image.height, frame);
+
+  FrameView view;
+  std::map<std::string, Sensor*> sensors;
+  sendFrame(view, frame, 4096);
+  view.render(nullptr, sensors);
+  TEST_ASSERT_TRUE(view.acceptsTiles());
+
+  // Cut short, the panel's memory holds part of the frame
+  view.beginFrame(frame.size());
+  TEST_ASSERT_TRUE(view.writeFrame(frame.data(), frame.size() / 2));
+  TEST_ASSERT_FALSE(view.frameComplete());
+  TEST_ASSERT_TRUE(view.render(nullptr, sensors));
+  TEST_ASSERT_FALSE(view.acceptsTiles());
+  TEST_ASSERT_EQUAL(1, GxEPD2_750_T7::lastInitialized()->getFullRefreshes());
+}
+
+void test_frame_view_too_large(void) {
+  snapshot::Image image = renderOnHost(21.3);
+  std::vector<uint8_t> frame;
+  FrameDecoder::encode(image.bits.data(), image.rowBytes(), 0, 0, image.width,
+                       image.height, frame);
+
+  // Refused before any of it reaches the panel
+  FrameView view;
+  std::map<std::string, Sensor*> sensors;
+  view.beginFrame(64 * 1024 + 1);
+  TEST_ASSERT_FALSE(view.writeFrame(frame.data(), frame.size()));
+  TEST_ASSERT_FALSE(view.frameComplete());
+  TEST_ASSERT_TRUE(view.render(nullptr, sensors));
+
+  sendFrame(view, frame, 4096);
+  view.render(nullptr, sensors);
+  assertShown(image);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frame_round_trip);
+  RUN_TEST(test_frame_bands);
+  RUN_TEST(test_frame_rejects_corrupt_frames);
+  RUN_TEST(test_frame_view_full_frame);
+  RUN_TEST(test_frame_view_tile);
+  RUN_TEST(test_frame_view_failed_download);
+  RUN_TEST(test_frame_view_too_large);
+  return UNITY_END();
+}
@@ -0,0 +1,143 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "inflater.h"
+
+// A get-display response and the same compressed as the lambda does, with
+// Python's zlib.compressobj(level, zlib.DEFLATED, wbits, 8, strategy), in
+// fixtures/ next to this file:
+//   response.zlib  level 9, wbits 11, dynamic codes
+//   fixed.zlib     level 9, wbits 11, Z_FIXED
+//   stored.zlib    level 0, wbits 11
+//   wide.zlib      level 9, wbits 15
+static std::vector<uint8_t> fixture(const char* name) {
+  std::string path = __FILE__;
+  path = path.substr(0, path.rfind('/') + 1) + "fixtures/" + name;
+  std::vector<uint8_t> data;
+  FILE* file = fopen(path.c_str(), "rb");
+  TEST_ASSERT_TRUE_MESSAGE(file != nullptr, path.c_str());
+  uint8_t buffer[1024];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + size);
+  }
+  fclose(file);
+  return data;
+}
+
+// Hands the compressed data over at most piece bytes at a time, as a
+// stream would
+static Inflater::ReadInput pieces(const std::vector<uint8_t>& data,
+                                  size_t piece, size_t* position) {
+  return [&data, piece, position](uint8_t* buffer, size_t size) {
+    size_t count = std::min(std::min(size, piece), data.size() - *position);
+    if (count > 0) {
+      memcpy(buffer, data.data() + *position, count);
+      *position += count;
+    }
+    return count;
+  };
+}
+
+static bool inflateAll(const std::vector<uint8_t>& compressed, size_t piece,
+                       size_t read_size, std::vector<uint8_t>& out) {
+  size_t position = 0;
+  Inflater inflater(pieces(compressed, piece, &position));
+  out.clear();
+  char buffer[64];
+  size_t size;
+  while ((size = inflater.readBytes(buffer, read_size)) > 0) {
+    out.insert(out.end(), buffer, buffer + size);
+  }
+  return inflater.finish();
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_inflate_dynamic_codes(void) {
+  std::vector<uint8_t> expected = fixture("response.json");
+  std::vector<uint8_t> compressed = fixture("response.zlib");
+  // Longer than the window, so back references wrap around it
+  TEST_ASSERT_TRUE(expected.size() > 2 * Inflater::WINDOW_SIZE);
+
+  for (size_t piece : std::vector<size_t>{1, 7, 256, compressed.size()}) {
+    for (size_t read_size : std::vector<size_t>{1, 13, 64}) {
+      std::vector<uint8_t> out;
+      TEST_ASSERT_TRUE(inflateAll(compressed, piece, read_size, out));
+      TEST_ASSERT_EQUAL(expected.size(), out.size());
+      TEST_ASSERT_EQUAL_MEMORY(expected.data(), out.data(), expected.size());
+    }
+  }
+}
+
+void test_inflate_fixed_and_stored(void) {
+  std::vector<uint8_t> expected = fixture("response.json");
+  for (const char* name : {"fixed.zlib", "stored.zlib"}) {
+    std::vector<uint8_t> out;
+    TEST_ASSERT_TRUE_MESSAGE(inflateAll(fixture(name), 100, 64, out), name);
+    TEST_ASSERT_EQUAL(expected.size(), out.size());
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), out.data(), expected.size());
+  }
+}
+
+void test_inflate_finish_reads_the_rest(void) {
+  std::vector<uint8_t> expected = fixture("response.json");
+  std::vector<uint8_t> compressed = fixture("response.zlib");
+  size_t position = 0;
+  Inflater inflater(pieces(compressed, 256, &position));
+  for (size_t i = 0; i < 100; i++) {
+    TEST_ASSERT_EQUAL(expected[i], inflater.read());
+  }
+  TEST_ASSERT_TRUE(inflater.finish());
+  TEST_ASSERT_EQUAL(compressed.size(), position);
+  TEST_ASSERT_EQUAL(-1, inflater.read());
+}
+
+void test_inflate_rejects_wide_window(void) {
+  std::vector<uint8_t> compressed = fixture("wide.zlib");
+  size_t position = 0;
+  Inflater inflater(pieces(compressed, 256, &position));
+  TEST_ASSERT_EQUAL(-1, inflater.read());
+  TEST_ASSERT_TRUE(inflater.failed());
+  TEST_ASSERT_FALSE(inflater.finish());
+}
+
+void test_inflate_rejects_corrupt_data(void) {
+  std::vector<uint8_t> compressed = fixture("response.zlib");
+  std::vector<uint8_t> out;
+
+  std::vector<uint8_t> bad_checksum = compressed;
+  bad_checksum.back() ^= 1;
+  TEST_ASSERT_FALSE(inflateAll(bad_checksum, 256, 64, out));
+
+  std::vector<uint8_t> truncated(compressed.begin(), compressed.end() - 10);
+  TEST_ASSERT_FALSE(inflateAll(truncated, 256, 64, out));
+
+  std::vector<uint8_t> bad_header = compressed;
+  bad_header[1] ^= 1;
+  TEST_ASSERT_FALSE(inflateAll(bad_header, 256, 64, out));
+  TEST_ASSERT_EQUAL(0, out.size());
+
+  std::vector<uint8_t> flipped = compressed;
+  flipped[compressed.size() / 2] ^= 0x10;
+  TEST_ASSERT_FALSE(inflateAll(flipped, 256, 64, out));
+
+  TEST_ASSERT_FALSE(inflateAll(std::vector<uint8_t>(), 256, 64, out));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_inflate_dynamic_codes);
+  RUN_TEST(test_inflate_fixed_and_stored);
+  RUN_TEST(test_inflate_finish_reads_the_rest);
+  RUN_TEST(test_inflate_rejects_wide_window);
+  RUN_TEST(test_inflate_rejects_corrupt_data);
+  return UNITY_END();
+}
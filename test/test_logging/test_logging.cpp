@@ -0,0 +1,133 @@
+// Debug records are compiled out here, as in a production build
+#define LOG_LEVEL 3
+
+#include <unity.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "logging.h"
+
+static std::vector<std::string> flushed() {
+  std::vector<std::string> lines;
+  LogBuffer::flush([&lines](const char* line) {
+    // Without the cycle and the milliseconds
+    std::string text = line;
+    lines.push_back(text.substr(text.find(' ', text.find(' ') + 1) + 1));
+  });
+  return lines;
+}
+
+static int evaluations = 0;
+
+static int counted(int value) {
+  evaluations++;
+  return value;
+}
+
+void setUp(void) { LogBuffer::clear(); }
+
+void tearDown(void) {}
+
+void test_logging_formats_when_flushed(void) {
+  const char* name = "bme680";
+  std::string id = "display";
+  LOG_INFO("Sensor %s at %d: %.1f%%, %u/%zu bytes", name, -3, 21.3,
+           static_cast<unsigned>(7), static_cast<size_t>(40000));
+  LOG_WARN("Hash %08x, id %s, big %lld", 0xBEEFu, id.c_str(), -5000000000LL);
+  LOG_ERROR("No arguments\n");
+  TEST_ASSERT_EQUAL(3, LogBuffer::count());
+
+  // The string was copied
+  id = "changed";
+  std::vector<std::string> lines = flushed();
+  TEST_ASSERT_EQUAL(3, lines.size());
+  TEST_ASSERT_EQUAL_STRING("I Sensor bme680 at -3: 21.3%, 7/40000 bytes",
+                           lines[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("W Hash 0000beef, id display, big -5000000000",
+                           lines[1].c_str());
+  TEST_ASSERT_EQUAL_STRING("E No arguments", lines[2].c_str());
+  TEST_ASSERT_EQUAL(0, LogBuffer::count());
+}
+
+void test_logging_prefixes_cycle_and_time(void) {
+  LogBuffer::startCycle();
+  LOG_INFO("First");
+  LogBuffer::startCycle();
+  LOG_INFO("Second");
+  std::vector<std::string> lines;
+  LogBuffer::flush([&lines](const char* line) { lines.push_back(line); });
+  TEST_ASSERT_EQUAL(2, lines.size());
+  unsigned first_cycle, second_cycle, ms;
+  char level;
+  TEST_ASSERT_EQUAL(3, sscanf(lines[0].c_str(), "%u %u %c", &first_cycle,
+                              &ms, &level));
+  TEST_ASSERT_EQUAL(3, sscanf(lines[1].c_str(), "%u %u %c", &second_cycle,
+                              &ms, &level));
+  TEST_ASSERT_EQUAL((first_cycle + 1) % 256, second_cycle);
+  TEST_ASSERT_EQUAL('I', level);
+}
+
+void test_logging_strips_levels_at_compile_time(void) {
+  evaluations = 0;
+  LOG_DEBUG("Not kept %d", counted(1));
+  LOG_INFO("Kept %d", counted(2));
+  TEST_ASSERT_EQUAL(1, evaluations);
+  TEST_ASSERT_EQUAL(1, LogBuffer::count());
+}
+
+void test_logging_cuts_long_strings(void) {
+  std::string payload(500, 'x');
+  LOG_INFO("Payload %s, then %d and %s", payload.c_str(), 42, "end");
+  std::vector<std::string> lines = flushed();
+  TEST_ASSERT_EQUAL(1, lines.size());
+  std::string expected = "I Payload " +
+                         std::string(LogRecord::MAX_STRING, 'x') +
+                         ", then 42 and end";
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), lines[0].c_str());
+}
+
+void test_logging_overwrites_oldest(void) {
+  const int written = 200;
+  for (int i = 0; i < written; i++) {
+    LOG_INFO("Record %d of %s", i, "the test");
+  }
+  size_t kept = LogBuffer::count();
+  TEST_ASSERT_TRUE(kept > 10);
+  TEST_ASSERT_TRUE(kept < written);
+  TEST_ASSERT_EQUAL(written - kept, LogBuffer::dropped());
+
+  std::vector<std::string> lines = flushed();
+  TEST_ASSERT_EQUAL(kept + 1, lines.size());
+  char expected[64];
+  snprintf(expected, sizeof(expected), "W %u older records overwritten",
+           static_cast<unsigned>(written - kept));
+  TEST_ASSERT_EQUAL_STRING(expected, lines[0].c_str());
+  // The newest ones, in order
+  for (size_t i = 1; i < lines.size(); i++) {
+    snprintf(expected, sizeof(expected), "I Record %u of the test",
+             static_cast<unsigned>(written - kept + i - 1));
+    TEST_ASSERT_EQUAL_STRING(expected, lines[i].c_str());
+  }
+  TEST_ASSERT_EQUAL(0, LogBuffer::dropped());
+}
+
+void test_logging_mismatched_arguments(void) {
+  // Checked at compile time with the macros, write() is not
+  LogBuffer::write(LOG_LEVEL_WARN, "%s %d %f %d", 1, "two", 3);
+  std::vector<std::string> lines = flushed();
+  TEST_ASSERT_EQUAL(1, lines.size());
+  TEST_ASSERT_EQUAL_STRING("W ? ? ? ?", lines[0].c_str());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_logging_formats_when_flushed);
+  RUN_TEST(test_logging_prefixes_cycle_and_time);
+  RUN_TEST(test_logging_strips_levels_at_compile_time);
+  RUN_TEST(test_logging_cuts_long_strings);
+  RUN_TEST(test_logging_overwrites_oldest);
+  RUN_TEST(test_logging_mismatched_arguments);
+  return UNITY_END();
+}
@@ -0,0 +1,340 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "measurementhistory.h"
+#include "model.h"
+#include "trend.h"
+
+// 2025-10-21T12:00:00Z
+static const time_t START = 1761048000;
+
+void setUp(void) { MeasurementHistory::clear(); }
+
+void tearDown(void) {
+  // clean stuff up here
+}
+
+// Min/max/mean of the last count values, in tenths
+static void assertStatsOfLast(const std::vector<int>& tenths, size_t count,
+                              const HistoryStats& stats) {
+  TEST_ASSERT_EQUAL(count, stats.count);
+  int min = tenths.back();
+  int max = tenths.back();
+  long sum = 0;
+  for (size_t i = tenths.size() - count; i < tenths.size(); i++) {
+    min = std::min(min, tenths[i]);
+    max = std::max(max, tenths[i]);
+    sum += tenths[i];
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, min / 10.0f, stats.min);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, max / 10.0f, stats.max);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, sum / (10.0f * count), stats.mean);
+}
+
+// Random walk in steps the deltas hold, compared to brute force after every
+// sample
+static void assertRollingStats(int interval_seconds, size_t expected_count) {
+  MeasurementSeries series;
+  series.clear();
+  std::vector<int> tenths;
+  srand(42);
+  int value = 200;
+  for (int i = 0; i < 1000; i++) {
+    value += rand() % 41 - 20;
+    tenths.push_back(value);
+    time_t when = START + i * interval_seconds;
+    TEST_ASSERT_TRUE(series.add(when, value / 10.0f));
+
+    HistoryStats stats;
+    TEST_ASSERT_TRUE(series.stats(stats));
+    assertStatsOfLast(tenths, std::min(tenths.size(), expected_count), stats);
+  }
+}
+
+void test_rolling_stats_over_window(void) {
+  // 24h of samples every 15 minutes, both ends included
+  assertRollingStats(15 * 60, 97);
+}
+
+void test_rolling_stats_over_capacity(void) {
+  assertRollingStats(5 * 60, MeasurementSeries::CAPACITY);
+}
+
+void test_large_change_carried_over(void) {
+  MeasurementSeries series;
+  series.clear();
+  series.add(START, 10.0f);
+  series.add(START + 600, 30.0f);
+
+  HistoryStats stats;
+  series.stats(stats);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 22.7f, stats.max);
+
+  series.add(START + 1200, 30.0f);
+  series.stats(stats);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 30.0f, stats.max);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 10.0f, stats.min);
+}
+
+void test_repeated_sample_ignored(void) {
+  MeasurementSeries series;
+  series.clear();
+  TEST_ASSERT_TRUE(series.add(START, 20.0f));
+  TEST_ASSERT_FALSE(series.add(START, 20.0f));
+  TEST_ASSERT_FALSE(series.add(START + 60, 21.0f));
+  TEST_ASSERT_FALSE(series.add(START - 3600, 21.0f));
+  TEST_ASSERT_EQUAL(1, series.count());
+}
+
+void test_old_samples_expire(void) {
+  MeasurementSeries series;
+  series.clear();
+  series.add(START, 5.0f);
+  series.add(START + 12 * 3600, 15.0f);
+
+  HistoryStats stats;
+  series.expire(START + 25 * 3600);
+  TEST_ASSERT_TRUE(series.stats(stats));
+  TEST_ASSERT_EQUAL(1, stats.count);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 15.0f, stats.min);
+
+  // After a day without samples the series starts over
+  series.add(START + 40 * 3600, 25.0f);
+  TEST_ASSERT_TRUE(series.stats(stats));
+  TEST_ASSERT_EQUAL(1, stats.count);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 25.0f, stats.max);
+}
+
+void test_least_recent_series_replaced(void) {
+  for (int i = 0; i <= MeasurementHistory::MAX_SERIES; i++) {
+    std::string node = "node" + std::to_string(i);
+    uint32_t key =
+        MeasurementHistory::makeKey(node.c_str(), "bme680", "temperature");
+    MeasurementHistory::add(key, START + i * 600, i);
+  }
+
+  HistoryStats stats;
+  time_t now = START + 2 * 3600;
+  uint32_t first = MeasurementHistory::makeKey("node0", "bme680", "temperature");
+  uint32_t second =
+      MeasurementHistory::makeKey("node1", "bme680", "temperature");
+  TEST_ASSERT_FALSE(MeasurementHistory::stats(first, now, stats));
+  TEST_ASSERT_TRUE(MeasurementHistory::stats(second, now, stats));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 1.0f, stats.min);
+  TEST_ASSERT_NOT_EQUAL(
+      MeasurementHistory::makeKey("node1", "bme680", "humidity"), second);
+}
+
+void test_covers_window(void) {
+  uint32_t key = MeasurementHistory::makeKey("node", "bme680", "temperature");
+  uint32_t other = MeasurementHistory::makeKey("node", "bme680", "humidity");
+  TEST_ASSERT_FALSE(MeasurementHistory::coversWindow(START));
+  for (int minutes = 0; minutes < 24 * 60; minutes += 15) {
+    MeasurementHistory::add(key, START + minutes * 60, 20.0f);
+  }
+  time_t now = START + 24 * 3600 - 60;
+  // Nothing shown yet
+  TEST_ASSERT_FALSE(MeasurementHistory::coversWindow(now));
+  MeasurementHistory::markShown(key);
+  TEST_ASSERT_TRUE(MeasurementHistory::coversWindow(now));
+
+  // Every series shown has to span the window
+  MeasurementHistory::add(other, now - 3600, 50.0f);
+  MeasurementHistory::add(other, now, 50.0f);
+  MeasurementHistory::markShown(other);
+  TEST_ASSERT_FALSE(MeasurementHistory::coversWindow(now));
+  MeasurementHistory::clearShown();
+  MeasurementHistory::markShown(key);
+  TEST_ASSERT_TRUE(MeasurementHistory::coversWindow(now));
+  MeasurementHistory::markShown(
+      MeasurementHistory::makeKey("other", "bme680", "temperature"));
+  TEST_ASSERT_FALSE(MeasurementHistory::coversWindow(now));
+
+  MeasurementHistory::clear();
+  TEST_ASSERT_FALSE(MeasurementHistory::coversWindow(now));
+}
+
+// All the nodes of a full display, as get-display sends them when asked to
+// leave min/max out
+static void addReadings(Model& model, time_t when, int nodes) {
+  JsonDocument doc;
+  char timestamp[32];
+  DateTime(when).format(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ");
+  for (int n = 0; n < nodes; n++) {
+    std::string name = "node" + std::to_string(n);
+    JsonObject node = doc[name].to<JsonObject>();
+    node["timestamp_utc"] = timestamp;
+    JsonObject bme680 = node["measurements_v2"]["bme680"].to<JsonObject>();
+    bme680["temperature"] = 20 + n + (when / 900) % 7;
+    bme680["humidity"] = 50 - n;
+    bme680["pressure"] = 1010 + n;
+  }
+  DateTime now(when);
+  model.addNodes(doc.as<JsonObject>(), now);
+}
+
+void test_history_keeps_every_node(void) {
+  Model model;
+  const int nodes = HISTORY_NODES;
+  time_t when = START;
+  for (; when < START + 25 * 3600; when += 15 * 60) {
+    if (when < START + 23 * 3600) {
+      TEST_ASSERT_FALSE(MeasurementHistory::coversWindow(when));
+    }
+    addReadings(model, when, nodes);
+  }
+  TEST_ASSERT_TRUE(MeasurementHistory::coversWindow(when));
+
+  JsonObject data = model.getNodeData();
+  TEST_ASSERT_EQUAL(nodes, data.size());
+  for (JsonPair node : data) {
+    JsonObject min_max = node.value()["measurements_min_max"]["bme680"];
+    for (const char* metric : {"temperature", "humidity", "pressure"}) {
+      TEST_ASSERT_TRUE_MESSAGE(min_max[metric]["min"].is<float>(), metric);
+    }
+    TEST_ASSERT_TRUE(
+        node.value()["trend"]["bme680"]["temperature"].is<const char*>());
+  }
+
+  // One node more than the store holds, the history no longer covers what
+  // is shown
+  addReadings(model, when, nodes + 1);
+  TEST_ASSERT_FALSE(MeasurementHistory::coversWindow(when + 60));
+}
+
+static void addNodes(Model& model, const char* timestamp,
+                     const char* temperature, bool with_min_max) {
+  JsonDocument doc;
+  JsonObject node = doc["node1"].to<JsonObject>();
+  node["timestamp_utc"] = timestamp;
+  node["measurements_v2"]["bme680"]["temperature"] = temperature;
+  node["measurements_v2"]["bme680"]["humidity"] = "50.0";
+  if (with_min_max) {
+    node["measurements_min_max"]["bme680"]["temperature"]["min"] = "1.0";
+    node["measurements_min_max"]["bme680"]["temperature"]["max"] = "2.0";
+  }
+  DateTime now(timestamp);
+  model.addNodes(doc.as<JsonObject>(), now);
+}
+
+void test_model_min_max_from_history(void) {
+  Model model;
+  addNodes(model, "2025-10-21T12:00:00Z", "18.5", false);
+  JsonObject node = model.getNodeData()["node1"];
+  TEST_ASSERT_FALSE(node["measurements_min_max"].is<JsonObject>());
+
+  addNodes(model, "2025-10-21T12:10:00Z", "20.5", false);
+  node = model.getNodeData()["node1"];
+  JsonObject temperature = node["measurements_min_max"]["bme680"]["temperature"];
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 18.5f, float(temperature["min"]));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 20.5f, float(temperature["max"]));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 19.5f, float(temperature["mean"]));
+  JsonObject humidity = node["measurements_min_max"]["bme680"]["humidity"];
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 50.0f, float(humidity["max"]));
+
+  // What the server sends is used as is
+  addNodes(model, "2025-10-21T12:20:00Z", "19.0", true);
+  node = model.getNodeData()["node1"];
+  temperature = node["measurements_min_max"]["bme680"]["temperature"];
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 1.0f, float(temperature["min"]));
+  TEST_ASSERT_TRUE(temperature["mean"].isNull());
+  TEST_ASSERT_TRUE(node["measurements_min_max"]["bme680"]["humidity"].isNull());
+}
+
+void test_trend_base64_round_trip(void) {
+  srand(7);
+  for (size_t count = 0; count <= Trend::POINTS; count++) {
+    uint8_t points[Trend::POINTS];
+    for (size_t i = 0; i < count; i++) {
+      points[i] = rand() % 256;
+    }
+    std::string base64 = Trend::encode(points, count);
+    TEST_ASSERT_EQUAL((count + 2) / 3 * 4, base64.size());
+
+    uint8_t decoded[Trend::POINTS];
+    TEST_ASSERT_EQUAL(count,
+                      Trend::decode(base64.c_str(), decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL_MEMORY(points, decoded, count);
+  }
+
+  uint8_t decoded[4];
+  // As sent by get-display, Python's base64.b64encode(bytes([255, 0, 254]))
+  TEST_ASSERT_EQUAL(3, Trend::decode("/wD+", decoded, sizeof(decoded)));
+  TEST_ASSERT_EQUAL(255, decoded[0]);
+  TEST_ASSERT_EQUAL(0, decoded[1]);
+  TEST_ASSERT_EQUAL(254, decoded[2]);
+  TEST_ASSERT_EQUAL(0, Trend::decode("/w D+", decoded, sizeof(decoded)));
+  TEST_ASSERT_EQUAL(0, Trend::decode("AAAAAAAA", decoded, sizeof(decoded)));
+}
+
+void test_series_trend(void) {
+  MeasurementSeries series;
+  series.clear();
+  time_t now = START + 24 * 3600;
+  // At each wake, rising over the first 12 hours, nothing for 2 hours, then
+  // flat
+  for (int minutes = 0; minutes <= 24 * 60; minutes += 15) {
+    if (minutes >= 12 * 60 && minutes < 14 * 60) {
+      continue;
+    }
+    float value = minutes < 12 * 60 ? minutes / 60.0f : 12.0f;
+    series.add(START + minutes * 60, value);
+  }
+
+  uint8_t points[Trend::POINTS];
+  TEST_ASSERT_TRUE(series.trend(now, points, Trend::POINTS));
+  TEST_ASSERT_EQUAL(0, points[0]);
+  for (int i = 1; i < 24; i++) {
+    TEST_ASSERT_TRUE(points[i] > points[i - 1]);
+  }
+  TEST_ASSERT_EQUAL(Trend::GAP, points[24]);
+  TEST_ASSERT_EQUAL(Trend::GAP, points[27]);
+  TEST_ASSERT_EQUAL(Trend::MAX, points[28]);
+  TEST_ASSERT_EQUAL(Trend::MAX, points[47]);
+
+  series.clear();
+  series.add(START, 20.0f);
+  TEST_ASSERT_FALSE(series.trend(now, points, Trend::POINTS));
+}
+
+void test_model_trend_from_history(void) {
+  Model model;
+  addNodes(model, "2025-10-21T12:00:00Z", "18.5", false);
+  addNodes(model, "2025-10-21T13:00:00Z", "20.5", false);
+  JsonObject node = model.getNodeData()["node1"];
+  const char* base64 =
+      node["trend"]["bme680"]["temperature"].as<const char*>();
+  TEST_ASSERT_NOT_NULL(base64);
+  uint8_t points[Trend::POINTS];
+  TEST_ASSERT_EQUAL(Trend::POINTS,
+                    Trend::decode(base64, points, sizeof(points)));
+  TEST_ASSERT_EQUAL(Trend::GAP, points[45]);
+  TEST_ASSERT_EQUAL(0, points[46]);
+  TEST_ASSERT_EQUAL(Trend::MAX, points[47]);
+  TEST_ASSERT_TRUE(node["trend"]["bme680"]["humidity"].isNull());
+
+  // Trends come with the server's min/max
+  addNodes(model, "2025-10-21T14:00:00Z", "19.0", true);
+  node = model.getNodeData()["node1"];
+  TEST_ASSERT_FALSE(node["trend"].is<JsonObject>());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_rolling_stats_over_window);
+  RUN_TEST(test_rolling_stats_over_capacity);
+  RUN_TEST(test_large_change_carried_over);
+  RUN_TEST(test_repeated_sample_ignored);
+  RUN_TEST(test_old_samples_expire);
+  RUN_TEST(test_least_recent_series_replaced);
+  RUN_TEST(test_covers_window);
+  RUN_TEST(test_history_keeps_every_node);
+  RUN_TEST(test_model_min_max_from_history);
+  RUN_TEST(test_trend_base64_round_trip);
+  RUN_TEST(test_series_trend);
+  RUN_TEST(test_model_trend_from_history);
+  UNITY_END();
+
+  return 0;
+}
@@ -92,6 +92,67 @@ void test_model_inequality_operator(void) {
   TEST_ASSERT_TRUE(model1 != model2);
 }
 
+// The same response, with numbers as strings and as JSON numbers
+static const char* LEGACY_RESPONSE = R"({
+  "config": {"location": {"latitude": "48.866667", "longitude": "2.333333",
+                          "utc_offset_seconds": 3600}},
+  "nodes": {"node1": {
+    "display_name": "Garden",
+    "timestamp_utc": "2025-11-03T19:55:00",
+    "measurements_v2": {"sht31d": {"temperature": "7.84", "humidity": "82.1"},
+                        "battery": {"battery_percentage": "63.0"}},
+    "measurements_min_max": {"sht31d": {"temperature": {"min": "4.3",
+                                                        "max": "9.3"}}}}}
+})";
+static const char* TYPED_RESPONSE = R"({
+  "schema": 2,
+  "config": {"location": {"latitude": 48.866667, "longitude": 2.333333,
+                          "utc_offset_seconds": 3600}},
+  "nodes": {"node1": {
+    "display_name": "Garden",
+    "timestamp_utc": "2025-11-03T19:55:00",
+    "measurements_v2": {"sht31d": {"temperature": 7.84, "humidity": 82.1},
+                        "battery": {"battery_percentage": 63}},
+    "measurements_min_max": {"sht31d": {"temperature": {"min": 4.3,
+                                                        "max": 9.3}}}}}
+})";
+
+static void buildModel(Model& model, const char* response) {
+  JsonDocument doc;
+  TEST_ASSERT_FALSE(deserializeJson(doc, response));
+  model.buildFromJson(&doc, DateTime("2025-11-03T20:00:00"),
+                      DateTime("2025-11-03T21:00:00"));
+}
+
+void test_model_typed_response(void) {
+  Model model;
+  buildModel(model, TYPED_RESPONSE);
+
+  JsonObject node = model.getNodeData()["node1"];
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 7.84,
+                           node["measurements_v2"]["sht31d"]["temperature"]
+                               .as<double>());
+  TEST_ASSERT_FLOAT_WITHIN(
+      1e-6, 9.3,
+      node["measurements_min_max"]["sht31d"]["temperature"]["max"]
+          .as<double>());
+  TEST_ASSERT_EQUAL_STRING("9", node["battery_level"].as<const char*>());
+  TEST_ASSERT_FALSE(model.getSunRise().empty());
+}
+
+void test_model_legacy_response_matches_typed(void) {
+  Model legacy;
+  buildModel(legacy, LEGACY_RESPONSE);
+  Model typed;
+  buildModel(typed, TYPED_RESPONSE);
+
+  TEST_ASSERT_TRUE(legacy == typed);
+  TEST_ASSERT_EQUAL_STRING(typed.getSunRise().c_str(),
+                           legacy.getSunRise().c_str());
+  TEST_ASSERT_EQUAL_STRING(typed.getMoonSet().c_str(),
+                           legacy.getMoonSet().c_str());
+}
+
 int main(int argc, char** argv) {
   UNITY_BEGIN();
   RUN_TEST(test_model_default_constructor);
@@ -103,6 +164,8 @@ int main(int argc, char** argv) {
   RUN_TEST(test_model_from_invalid_json);
   RUN_TEST(test_model_equality_operator);
   RUN_TEST(test_model_inequality_operator);
+  RUN_TEST(test_model_typed_response);
+  RUN_TEST(test_model_legacy_response_matches_typed);
   UNITY_END();
 
   return 0;
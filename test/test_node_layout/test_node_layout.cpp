@@ -0,0 +1,237 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "node_layout.h"
+#include "u8g2_font_battery24_tr.h"
+
+static U8G2_FOR_ADAFRUIT_GFX u8g2;
+
+void setUp(void) {
+  // set stuff up here
+}
+
+void tearDown(void) {
+  // clean stuff up here
+}
+
+static void buildColumn(NodeLayout& layout, const std::string& name,
+                        const std::string& temperature) {
+  layout.addColumn();
+  layout.addText(u8g2_font_inb24_mf, name + " ", 0, 34);
+  layout.appendText(u8g2_font_battery24_tr, "3");
+  layout.addText(u8g2_font_inb38_mf, temperature, 0, 101);
+}
+
+void test_measure_skipped_when_structure_unchanged(void) {
+  NodeLayout previous;
+  buildColumn(previous, "Indoor", "21.3°C");
+  TEST_ASSERT_TRUE(previous.measure(u8g2, nullptr));
+
+  uint32_t calls = u8g2.getUTF8WidthCalls();
+  NodeLayout layout;
+  buildColumn(layout, "Indoor", "19.9°C");
+  TEST_ASSERT_EQUAL(previous.structuralHash(), layout.structuralHash());
+  TEST_ASSERT_FALSE(layout.measure(u8g2, &previous));
+  TEST_ASSERT_EQUAL(calls, u8g2.getUTF8WidthCalls());
+  TEST_ASSERT_EQUAL(previous.columns()[0].width, layout.columns()[0].width);
+}
+
+void test_measure_when_structure_changed(void) {
+  NodeLayout previous;
+  buildColumn(previous, "Garden", "7.8°C");
+  previous.measure(u8g2, nullptr);
+
+  NodeLayout layout;
+  buildColumn(layout, "Garden", "17.8°C");
+  TEST_ASSERT_NOT_EQUAL(previous.structuralHash(), layout.structuralHash());
+  TEST_ASSERT_TRUE(layout.measure(u8g2, &previous));
+  TEST_ASSERT_TRUE(layout.columns()[0].width > previous.columns()[0].width);
+}
+
+void test_append_follows_previous_item(void) {
+  NodeLayout layout;
+  buildColumn(layout, "Attic", "14.2°C");
+  layout.measure(u8g2, nullptr);
+
+  const LayoutColumn& column = layout.columns()[0];
+  TEST_ASSERT_EQUAL(column.items[0].width, column.items[1].x);
+  TEST_ASSERT_EQUAL(column.items[0].y, column.items[1].y);
+}
+
+void test_pack_even_pitch(void) {
+  NodeLayout layout;
+  buildColumn(layout, "A", "1.0°C");
+  buildColumn(layout, "B", "2.0°C");
+  buildColumn(layout, "C", "3.0°C");
+  layout.measure(u8g2, nullptr);
+  layout.pack(800);
+
+  TEST_ASSERT_EQUAL(0, layout.columns()[0].x);
+  TEST_ASSERT_EQUAL(266, layout.columns()[1].x);
+  TEST_ASSERT_EQUAL(532, layout.columns()[2].x);
+}
+
+void test_pack_pushes_wide_column_neighbour(void) {
+  NodeLayout layout;
+  buildColumn(layout, "A very long name", "1.0°C");
+  buildColumn(layout, "B", "2.0°C");
+  buildColumn(layout, "C", "3.0°C");
+  layout.measure(u8g2, nullptr);
+  layout.pack(800);
+
+  const LayoutColumn& first = layout.columns()[0];
+  TEST_ASSERT_TRUE(first.width > 266);
+  TEST_ASSERT_EQUAL(first.width + NodeLayout::MIN_COLUMN_GAP,
+                    layout.columns()[1].x);
+  TEST_ASSERT_EQUAL(532, layout.columns()[2].x);
+}
+
+void test_pack_tight_when_columns_overflow(void) {
+  NodeLayout layout;
+  buildColumn(layout, "Living room north", "21.0°C");
+  buildColumn(layout, "Bedroom upstairs", "19.0°C");
+  buildColumn(layout, "Shed", "9°C");
+  layout.measure(u8g2, nullptr);
+  layout.pack(800);
+
+  const std::vector<LayoutColumn>& columns = layout.columns();
+  TEST_ASSERT_TRUE(columns[0].width + columns[1].width + columns[2].width <
+                   800);
+  TEST_ASSERT_EQUAL(0, columns[0].x);
+  TEST_ASSERT_TRUE(columns[1].x >= columns[0].x + columns[0].width);
+  TEST_ASSERT_TRUE(columns[2].x >= columns[1].x + columns[1].width);
+  TEST_ASSERT_TRUE(columns[2].x + columns[2].width <= 800);
+}
+
+void test_box_covers_text(void) {
+  NodeLayout layout;
+  buildColumn(layout, "A", "1.0°C");
+  layout.measure(u8g2, nullptr);
+  layout.pack(800);
+
+  const LayoutColumn& column = layout.columns()[0];
+  u8g2.setFont(u8g2_font_inb24_mf);
+  TEST_ASSERT_EQUAL(34 - u8g2.getFontAscent(), column.box.y);
+  u8g2.setFont(u8g2_font_inb38_mf);
+  TEST_ASSERT_EQUAL(101 - u8g2.getFontDescent() + 1,
+                    column.box.y + column.box.h);
+  TEST_ASSERT_EQUAL(column.width, column.box.w);
+  TEST_ASSERT_EQUAL(101, layout.bottom());
+}
+
+void test_changed_box_only_covers_changed_column(void) {
+  NodeLayout previous;
+  buildColumn(previous, "A", "1.0°C");
+  buildColumn(previous, "B", "2.0°C");
+  previous.measure(u8g2, nullptr);
+  previous.pack(800);
+
+  NodeLayout layout;
+  buildColumn(layout, "A", "1.0°C");
+  buildColumn(layout, "B", "2.5°C");
+  layout.measure(u8g2, &previous);
+  layout.pack(800);
+
+  LayoutBox box = layout.changedBox(previous);
+  TEST_ASSERT_TRUE(box == layout.columns()[1].box);
+
+  TEST_ASSERT_TRUE(previous.changedBox(previous).empty());
+}
+
+void test_changed_box_covers_all_when_columns_move(void) {
+  NodeLayout previous;
+  buildColumn(previous, "A", "1.0°C");
+  buildColumn(previous, "B", "2.0°C");
+  previous.measure(u8g2, nullptr);
+  previous.pack(800);
+
+  NodeLayout layout;
+  buildColumn(layout, "Kitchen by the back door", "1.0°C");
+  buildColumn(layout, "B", "2.0°C");
+  layout.measure(u8g2, &previous);
+  layout.pack(800);
+
+  LayoutBox expected = previous.columns()[0].box;
+  expected.add(previous.columns()[1].box);
+  expected.add(layout.columns()[0].box);
+  expected.add(layout.columns()[1].box);
+  TEST_ASSERT_TRUE(layout.changedBox(previous) == expected);
+}
+
+// Records the spans drawGraphs() draws
+struct SpanRecorder {
+  struct Span {
+    int16_t x, y, h;
+  };
+  std::vector<Span> spans;
+
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    spans.push_back({x, y, h});
+  }
+};
+
+void test_graph_box_and_spans(void) {
+  NodeLayout layout;
+  buildColumn(layout, "Indoor", "21.3°C");
+  std::string points = {0, static_cast<char>(Trend::MAX),
+                        static_cast<char>(Trend::GAP),
+                        static_cast<char>(Trend::MAX / 2)};
+  layout.addGraph(points, 0, 131, 8, 25);
+  layout.measure(u8g2, nullptr);
+  layout.pack(800);
+
+  const LayoutItem& graph = layout.columns()[0].items.back();
+  TEST_ASSERT_EQUAL(8, graph.width);
+  TEST_ASSERT_EQUAL(131, layout.bottom());
+  TEST_ASSERT_EQUAL(131 + 1, layout.columns()[0].box.y + layout.columns()[0].box.h);
+
+  SpanRecorder recorder;
+  layout.drawGraphs(recorder, 1);
+  // Two pixel columns per point, none for the gap
+  TEST_ASSERT_EQUAL(6, recorder.spans.size());
+  // Bottom row, then the rise to the top row in one span
+  TEST_ASSERT_EQUAL(0, recorder.spans[0].x);
+  TEST_ASSERT_EQUAL(131, recorder.spans[0].y);
+  TEST_ASSERT_EQUAL(1, recorder.spans[0].h);
+  TEST_ASSERT_EQUAL(2, recorder.spans[2].x);
+  TEST_ASSERT_EQUAL(107, recorder.spans[2].y);
+  TEST_ASSERT_EQUAL(25, recorder.spans[2].h);
+  // After the gap the line starts over in the middle
+  TEST_ASSERT_EQUAL(6, recorder.spans[4].x);
+  TEST_ASSERT_EQUAL(119, recorder.spans[4].y);
+  TEST_ASSERT_EQUAL(1, recorder.spans[4].h);
+}
+
+void test_graph_points_change_text_not_structure(void) {
+  NodeLayout previous;
+  previous.addColumn();
+  previous.addGraph(std::string(48, 10), 0, 100, 144, 24);
+  previous.measure(u8g2, nullptr);
+  previous.pack(800);
+
+  NodeLayout layout;
+  layout.addColumn();
+  layout.addGraph(std::string(48, 20), 0, 100, 144, 24);
+  TEST_ASSERT_EQUAL(previous.structuralHash(), layout.structuralHash());
+  TEST_ASSERT_FALSE(layout.measure(u8g2, &previous));
+  layout.pack(800);
+  TEST_ASSERT_FALSE(layout.changedBox(previous).empty());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_measure_skipped_when_structure_unchanged);
+  RUN_TEST(test_measure_when_structure_changed);
+  RUN_TEST(test_append_follows_previous_item);
+  RUN_TEST(test_pack_even_pitch);
+  RUN_TEST(test_pack_pushes_wide_column_neighbour);
+  RUN_TEST(test_pack_tight_when_columns_overflow);
+  RUN_TEST(test_box_covers_text);
+  RUN_TEST(test_changed_box_only_covers_changed_column);
+  RUN_TEST(test_changed_box_covers_all_when_columns_move);
+  RUN_TEST(test_graph_box_and_spans);
+  RUN_TEST(test_graph_points_change_text_not_structure);
+  UNITY_END();
+
+  return 0;
+}
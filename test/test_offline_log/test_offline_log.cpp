@@ -0,0 +1,282 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "gorilla.h"
+#include "offlinelog.h"
+
+// 2025-10-21T12:00:00Z
+static const uint32_t START = 1761048000;
+static const uint8_t CHANNELS[] = {OfflineLog::SHT31D_TEMPERATURE,
+                                   OfflineLog::SHT31D_HUMIDITY,
+                                   OfflineLog::BATTERY_VOLTAGE,
+                                   OfflineLog::BATTERY_PERCENTAGE};
+static const uint8_t CHANNEL_COUNT = sizeof(CHANNELS);
+
+struct Sent {
+  std::vector<uint8_t> channels;
+  std::vector<OfflineRecord> records;
+  size_t batches = 0;
+};
+
+void setUp(void) {
+  OfflineLog::clear();
+  srand(1);
+}
+
+void tearDown(void) {
+  // clean stuff up here
+}
+
+// Readings as a sensor node takes them: fixed decimals and slow drift
+static void reading(int i, float* values) {
+  values[0] = (1500 + (i * 7) % 300 + rand() % 5) / 100.0f;
+  values[1] = (6000 + (i * 13) % 900) / 100.0f;
+  values[2] = (400 - i / 50) / 100.0f;
+  values[3] = 90 - i / 100;
+}
+
+static OfflineLog::ReplayBatch collect(Sent& sent) {
+  return [&sent](const uint8_t* channels, uint8_t count,
+                 const OfflineRecord* records, size_t n) {
+    sent.channels.assign(channels, channels + count);
+    sent.records.insert(sent.records.end(), records, records + n);
+    sent.batches++;
+    return true;
+  };
+}
+
+static void assertSentRecord(uint32_t timestamp, int i,
+                             const OfflineRecord& record) {
+  float values[CHANNEL_COUNT];
+  srand(1);
+  for (int j = 0; j <= i; j++) {
+    reading(j, values);
+  }
+  TEST_ASSERT_EQUAL_UINT32(timestamp, record.timestamp);
+  TEST_ASSERT_EQUAL_MEMORY(values, record.values, sizeof(values));
+}
+
+static size_t roundTrip(const std::vector<uint32_t>& timestamps,
+                        const std::vector<std::vector<float>>& values) {
+  uint8_t count = values[0].size();
+  GorillaCodec encoder;
+  encoder.reset(count);
+  std::vector<uint8_t> data(timestamps.size() * GorillaCodec::MAX_RECORD_SIZE);
+  size_t size = 0;
+  for (size_t i = 0; i < timestamps.size(); i++) {
+    size_t used = encoder.encode(timestamps[i], values[i].data(),
+                                 data.data() + size, data.size() - size);
+    TEST_ASSERT_TRUE(used > 0);
+    size += used;
+  }
+
+  GorillaCodec decoder;
+  decoder.reset(count);
+  size_t offset = 0;
+  for (size_t i = 0; i < timestamps.size(); i++) {
+    uint32_t timestamp;
+    float decoded[GorillaCodec::MAX_VALUES];
+    size_t used =
+        decoder.decode(data.data() + offset, size - offset, timestamp, decoded);
+    TEST_ASSERT_TRUE(used > 0);
+    offset += used;
+    TEST_ASSERT_EQUAL_UINT32(timestamps[i], timestamp);
+    TEST_ASSERT_EQUAL_MEMORY(values[i].data(), decoded, count * sizeof(float));
+  }
+  TEST_ASSERT_EQUAL(size, offset);
+  return size;
+}
+
+void test_gorilla_round_trip_is_exact(void) {
+  std::vector<uint32_t> timestamps;
+  std::vector<std::vector<float>> values;
+  uint32_t timestamp = START;
+  for (int i = 0; i < 500; i++) {
+    // Regular wakes with jitter, occasional long gaps
+    timestamp += 600 + rand() % 7 - 3 + (i % 97 == 0 ? 86400 * 3 : 0);
+    timestamps.push_back(timestamp);
+    values.push_back({static_cast<float>(rand()) / RAND_MAX * 80 - 40,
+                      (rand() % 10000) / 100.0f, 3.7f, -0.0f,
+                      i % 2 ? 1e30f : -1e-30f});
+  }
+  roundTrip(timestamps, values);
+}
+
+void test_gorilla_compresses_steady_readings(void) {
+  std::vector<uint32_t> timestamps;
+  std::vector<std::vector<float>> values;
+  for (int i = 0; i < 400; i++) {
+    timestamps.push_back(START + i * 600);
+    float reading_values[CHANNEL_COUNT];
+    reading(i, reading_values);
+    values.push_back(std::vector<float>(reading_values,
+                                        reading_values + CHANNEL_COUNT));
+  }
+  size_t size = roundTrip(timestamps, values);
+  size_t raw = timestamps.size() * (4 + 4 * CHANNEL_COUNT);
+  printf("Gorilla: %u records in %u bytes, %.1f%% of raw\n",
+         static_cast<unsigned>(timestamps.size()), static_cast<unsigned>(size),
+         100.0 * size / raw);
+  TEST_ASSERT_TRUE(size * 2 < raw);
+}
+
+void test_gorilla_rejects_bad_input(void) {
+  GorillaCodec codec;
+  codec.reset(2);
+  float values[] = {21.5f, 50.0f};
+  uint8_t data[2 * GorillaCodec::MAX_RECORD_SIZE];
+  size_t first = codec.encode(START, values, data, sizeof(data));
+  TEST_ASSERT_EQUAL(12, first);
+  TEST_ASSERT_EQUAL(0, codec.encode(START, values, data + first,
+                                    sizeof(data) - first));
+  TEST_ASSERT_EQUAL(0, codec.encode(START + 600, values, data + first, 0));
+  values[0] = 21.25f;
+  size_t second =
+      codec.encode(START + 600, values, data + first, sizeof(data) - first);
+  TEST_ASSERT_TRUE(second > 0);
+  TEST_ASSERT_EQUAL(2, codec.records());
+
+  GorillaCodec decoder;
+  decoder.reset(2);
+  uint32_t timestamp;
+  float decoded[2];
+  TEST_ASSERT_EQUAL(0, decoder.decode(data, first - 1, timestamp, decoded));
+  TEST_ASSERT_EQUAL(first, decoder.decode(data, first, timestamp, decoded));
+  TEST_ASSERT_EQUAL(0, decoder.decode(data + first, second - 1, timestamp,
+                                      decoded));
+  TEST_ASSERT_EQUAL(second,
+                    decoder.decode(data + first, second, timestamp, decoded));
+  TEST_ASSERT_EQUAL_UINT32(START + 600, timestamp);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 21.25f, decoded[0]);
+}
+
+void test_log_replays_in_order(void) {
+  TEST_ASSERT_TRUE(OfflineLog::empty());
+  float values[CHANNEL_COUNT];
+  for (int i = 0; i < 100; i++) {
+    reading(i, values);
+    TEST_ASSERT_TRUE(
+        OfflineLog::append(START + i * 600, CHANNELS, values, CHANNEL_COUNT));
+  }
+  TEST_ASSERT_FALSE(OfflineLog::empty());
+
+  Sent sent;
+  TEST_ASSERT_EQUAL(100, OfflineLog::replay(collect(sent), 4));
+  TEST_ASSERT_EQUAL(3, sent.batches);
+  TEST_ASSERT_EQUAL_MEMORY(CHANNELS, sent.channels.data(), CHANNEL_COUNT);
+  for (int i = 0; i < 100; i++) {
+    assertSentRecord(START + i * 600, i, sent.records[i]);
+  }
+  TEST_ASSERT_TRUE(OfflineLog::empty());
+  TEST_ASSERT_FALSE(LittleFS.exists("/offline-0.log"));
+}
+
+void test_log_rolls_over_segments(void) {
+  float values[CHANNEL_COUNT];
+  int appended = 0;
+  while (!LittleFS.exists("/offline-2.log")) {
+    reading(appended, values);
+    TEST_ASSERT_TRUE(OfflineLog::append(START + appended * 600, CHANNELS,
+                                        values, CHANNEL_COUNT));
+    appended++;
+  }
+  TEST_ASSERT_TRUE(LittleFS.contents("/offline-0.log").size() <=
+                   OfflineLog::SEGMENT_SIZE);
+
+  // Only the first segments this time, the rest on the next wake
+  Sent sent;
+  size_t first = OfflineLog::replay(collect(sent), 2);
+  TEST_ASSERT_TRUE(first > 0 && first < static_cast<size_t>(appended));
+  TEST_ASSERT_FALSE(OfflineLog::empty());
+  TEST_ASSERT_EQUAL(appended - first, OfflineLog::replay(collect(sent), 2));
+  TEST_ASSERT_TRUE(OfflineLog::empty());
+  for (int i = 0; i < appended; i++) {
+    assertSentRecord(START + i * 600, i, sent.records[i]);
+  }
+}
+
+void test_log_drops_oldest_when_full(void) {
+  float values[CHANNEL_COUNT] = {20.0f, 50.0f, 3.9f, 80.0f};
+  // A channel change starts a new segment, so each append takes one
+  for (uint8_t i = 0; i < OfflineLog::MAX_SEGMENTS + 2; i++) {
+    TEST_ASSERT_TRUE(OfflineLog::append(START + i * 600, CHANNELS, values,
+                                        1 + i % 2));
+  }
+  Sent sent;
+  TEST_ASSERT_EQUAL(OfflineLog::MAX_SEGMENTS,
+                    OfflineLog::replay(collect(sent), 255));
+  TEST_ASSERT_EQUAL_UINT32(START + 2 * 600, sent.records[0].timestamp);
+  TEST_ASSERT_EQUAL(OfflineLog::MAX_SEGMENTS, sent.batches);
+}
+
+void test_log_recovers_after_power_loss(void) {
+  float values[CHANNEL_COUNT];
+  for (int i = 0; i < 10; i++) {
+    reading(i, values);
+    OfflineLog::append(START + i * 600, CHANNELS, values, CHANNEL_COUNT);
+  }
+  // RTC memory lost, files kept
+  std::string segment = LittleFS.contents("/offline-0.log");
+  OfflineLog::clear();
+  File file = LittleFS.open("/offline-0.log", "w");
+  file.write(reinterpret_cast<const uint8_t*>(segment.data()), segment.size());
+  file.close();
+
+  for (int i = 10; i < 20; i++) {
+    reading(i, values);
+    TEST_ASSERT_TRUE(
+        OfflineLog::append(START + i * 600, CHANNELS, values, CHANNEL_COUNT));
+  }
+  TEST_ASSERT_TRUE(LittleFS.exists("/offline-1.log"));
+  TEST_ASSERT_EQUAL_STRING(segment.c_str(),
+                           LittleFS.contents("/offline-0.log").c_str());
+
+  Sent sent;
+  TEST_ASSERT_EQUAL(20, OfflineLog::replay(collect(sent), 4));
+  for (int i = 0; i < 20; i++) {
+    assertSentRecord(START + i * 600, i, sent.records[i]);
+  }
+}
+
+void test_log_keeps_segment_when_send_fails(void) {
+  float values[CHANNEL_COUNT];
+  for (int i = 0; i < 60; i++) {
+    reading(i, values);
+    OfflineLog::append(START + i * 600, CHANNELS, values, CHANNEL_COUNT);
+  }
+
+  size_t calls = 0;
+  size_t sent_count = OfflineLog::replay(
+      [&calls](const uint8_t*, uint8_t, const OfflineRecord*, size_t) {
+        return ++calls == 1;
+      },
+      4);
+  TEST_ASSERT_EQUAL(OfflineLog::REPLAY_BATCH, sent_count);
+  TEST_ASSERT_FALSE(OfflineLog::empty());
+
+  // Readings taken meanwhile go after the unsent ones
+  reading(60, values);
+  TEST_ASSERT_TRUE(
+      OfflineLog::append(START + 60 * 600, CHANNELS, values, CHANNEL_COUNT));
+
+  Sent sent;
+  TEST_ASSERT_EQUAL(61, OfflineLog::replay(collect(sent), 4));
+  for (int i = 0; i <= 60; i++) {
+    assertSentRecord(START + i * 600, i, sent.records[i]);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_gorilla_round_trip_is_exact);
+  RUN_TEST(test_gorilla_compresses_steady_readings);
+  RUN_TEST(test_gorilla_rejects_bad_input);
+  RUN_TEST(test_log_replays_in_order);
+  RUN_TEST(test_log_rolls_over_segments);
+  RUN_TEST(test_log_drops_oldest_when_full);
+  RUN_TEST(test_log_recovers_after_power_loss);
+  RUN_TEST(test_log_keeps_segment_when_send_fails);
+  return UNITY_END();
+}
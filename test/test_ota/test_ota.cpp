@@ -0,0 +1,288 @@
+#include <unity.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "deltapatch.h"
+#include "otaprogress.h"
+#include "sha256stream.h"
+
+static const uint32_t PARTITION = 0x1F0000;
+
+void setUp(void) { OtaProgress::clear(); }
+
+void tearDown(void) {
+  // clean stuff up here
+}
+
+static std::string hex(const uint8_t* digest) {
+  char text[2 * Sha256::DIGEST_SIZE + 1];
+  for (size_t i = 0; i < Sha256::DIGEST_SIZE; i++) {
+    snprintf(text + 2 * i, 3, "%02x", digest[i]);
+  }
+  return text;
+}
+
+static std::string sha256(const std::string& data) {
+  Sha256 hash;
+  hash.reset();
+  hash.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+  uint8_t digest[Sha256::DIGEST_SIZE];
+  hash.finish(digest);
+  return hex(digest);
+}
+
+// Bytes standing in for a firmware image
+static std::vector<uint8_t> image(size_t size) {
+  std::vector<uint8_t> data(size);
+  uint32_t x = 12345;
+  for (size_t i = 0; i < size; i++) {
+    x = x * 1103515245 + 12345;
+    data[i] = x >> 16;
+  }
+  return data;
+}
+
+// Images and the patch between them made by ota_delta.py, in fixtures/ next
+// to this file
+static std::vector<uint8_t> fixture(const char* name) {
+  std::string path = __FILE__;
+  path = path.substr(0, path.rfind('/') + 1) + "fixtures/" + name;
+  std::vector<uint8_t> data;
+  FILE* file = fopen(path.c_str(), "rb");
+  TEST_ASSERT_TRUE_MESSAGE(file != nullptr, path.c_str());
+  uint8_t buffer[1024];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + size);
+  }
+  fclose(file);
+  return data;
+}
+
+// Applies the patch in pieces of the given size, copying the applier
+// between pieces as when it is kept in RTC memory across deep sleep
+static bool applyPatch(const std::vector<uint8_t>& old_image,
+                       const std::vector<uint8_t>& patch, size_t piece,
+                       std::vector<uint8_t>& new_image, DeltaPatch& applier) {
+  DeltaPatch::ReadOld read_old = [&old_image](uint32_t offset, uint8_t* data,
+                                              size_t size) {
+    if (offset + size > old_image.size()) return false;
+    memcpy(data, old_image.data() + offset, size);
+    return true;
+  };
+  DeltaPatch::WriteNew write_new = [&new_image](uint32_t offset,
+                                                const uint8_t* data,
+                                                size_t size) {
+    // Front to back as to flash
+    if (offset != new_image.size()) return false;
+    new_image.insert(new_image.end(), data, data + size);
+    return true;
+  };
+  applier.reset();
+  for (size_t offset = 0; offset < patch.size(); offset += piece) {
+    DeltaPatch resumed = applier;
+    if (!resumed.apply(patch.data() + offset,
+                       std::min(piece, patch.size() - offset), read_old,
+                       write_new)) {
+      return false;
+    }
+    applier = resumed;
+  }
+  return true;
+}
+
+static std::string imageDigest(const std::vector<uint8_t>& data) {
+  return sha256(std::string(data.begin(), data.end()));
+}
+
+void test_sha256_known_digests(void) {
+  TEST_ASSERT_EQUAL_STRING(
+      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+      sha256("").c_str());
+  TEST_ASSERT_EQUAL_STRING(
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+      sha256("abc").c_str());
+  // Padding spills into a second block
+  TEST_ASSERT_EQUAL_STRING(
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+      sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")
+          .c_str());
+  TEST_ASSERT_EQUAL_STRING(
+      "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+      sha256(std::string(1000000, 'a')).c_str());
+}
+
+void test_sha256_pieces_match_whole(void) {
+  std::vector<uint8_t> data = image(10000);
+  std::string whole = imageDigest(data);
+  for (size_t piece : {1, 63, 64, 65, 1000, 4096}) {
+    Sha256 hash;
+    hash.reset();
+    for (size_t offset = 0; offset < data.size(); offset += piece) {
+      hash.update(data.data() + offset,
+                  std::min(piece, data.size() - offset));
+    }
+    uint8_t digest[Sha256::DIGEST_SIZE];
+    hash.finish(digest);
+    TEST_ASSERT_EQUAL_STRING(whole.c_str(), hex(digest).c_str());
+  }
+}
+
+void test_parse_digest(void) {
+  uint8_t digest[Sha256::DIGEST_SIZE];
+  std::string text = sha256("abc");
+  TEST_ASSERT_TRUE(OtaProgress::parseDigest(text.c_str(), digest));
+  TEST_ASSERT_EQUAL_STRING(text.c_str(), hex(digest).c_str());
+  for (char& c : text) c = toupper(c);
+  TEST_ASSERT_TRUE(OtaProgress::parseDigest(text.c_str(), digest));
+  TEST_ASSERT_FALSE(OtaProgress::parseDigest(nullptr, digest));
+  TEST_ASSERT_FALSE(OtaProgress::parseDigest("", digest));
+  TEST_ASSERT_FALSE(OtaProgress::parseDigest(text.substr(1).c_str(), digest));
+  text[10] = 'g';
+  TEST_ASSERT_FALSE(OtaProgress::parseDigest(text.c_str(), digest));
+}
+
+void test_download_resumes_across_wakes(void) {
+  std::vector<uint8_t> data = image(3 * OtaProgress::CHUNK_SIZE + 100);
+  std::string digest = imageDigest(data);
+  TEST_ASSERT_FALSE(OtaProgress::complete());
+
+  // Each wake gets a fresh URL but the same image and writes 5000 bytes
+  size_t wakes = 0;
+  while (!OtaProgress::complete()) {
+    TEST_ASSERT_TRUE(
+        OtaProgress::begin(digest.c_str(), data.size(), PARTITION));
+    TEST_ASSERT_EQUAL(wakes, OtaProgress::resumes());
+    TEST_ASSERT_EQUAL(wakes * 5000, OtaProgress::offset());
+    for (size_t chunk = 0; chunk < 5000 && !OtaProgress::complete();) {
+      size_t size = std::min<size_t>(
+          {OtaProgress::CHUNK_SIZE, 5000 - chunk,
+           data.size() - OtaProgress::offset()});
+      OtaProgress::add(data.data() + OtaProgress::offset(), size);
+      chunk += size;
+    }
+    wakes++;
+  }
+  TEST_ASSERT_EQUAL(3, wakes);
+  TEST_ASSERT_EQUAL(data.size(), OtaProgress::offset());
+  TEST_ASSERT_TRUE(OtaProgress::verify());
+
+  // Already complete, not counted as a resume
+  TEST_ASSERT_TRUE(OtaProgress::begin(digest.c_str(), data.size(), PARTITION));
+  TEST_ASSERT_EQUAL(2, OtaProgress::resumes());
+  TEST_ASSERT_TRUE(OtaProgress::complete());
+}
+
+void test_new_image_starts_over(void) {
+  std::vector<uint8_t> data = image(10000);
+  std::string digest = imageDigest(data);
+  TEST_ASSERT_TRUE(OtaProgress::begin(digest.c_str(), data.size(), PARTITION));
+  OtaProgress::add(data.data(), 4000);
+
+  // Same image bound for the other partition, after an update elsewhere
+  TEST_ASSERT_TRUE(OtaProgress::begin(digest.c_str(), data.size(), 0x10000));
+  TEST_ASSERT_EQUAL(0, OtaProgress::offset());
+  OtaProgress::add(data.data(), 4000);
+
+  data[0] ^= 1;
+  std::string other = imageDigest(data);
+  TEST_ASSERT_TRUE(OtaProgress::begin(other.c_str(), data.size(), 0x10000));
+  TEST_ASSERT_EQUAL(0, OtaProgress::offset());
+  TEST_ASSERT_EQUAL(0, OtaProgress::resumes());
+
+  TEST_ASSERT_FALSE(OtaProgress::begin("not a digest", data.size(), 0x10000));
+}
+
+void test_corrupt_download_fails_verification(void) {
+  std::vector<uint8_t> data = image(10000);
+  std::string digest = imageDigest(data);
+  TEST_ASSERT_TRUE(OtaProgress::begin(digest.c_str(), data.size(), PARTITION));
+  OtaProgress::add(data.data(), 5000);
+  TEST_ASSERT_FALSE(OtaProgress::verify());
+  data[6000] ^= 0x80;
+  OtaProgress::add(data.data() + 5000, 5000);
+  TEST_ASSERT_TRUE(OtaProgress::complete());
+  TEST_ASSERT_FALSE(OtaProgress::verify());
+
+  // Server ignored the range
+  data[6000] ^= 0x80;
+  OtaProgress::restart();
+  TEST_ASSERT_EQUAL(0, OtaProgress::offset());
+  OtaProgress::add(data.data(), data.size());
+  TEST_ASSERT_TRUE(OtaProgress::verify());
+}
+
+void test_patch_rebuilds_new_image(void) {
+  std::vector<uint8_t> old_image = fixture("old.bin");
+  std::vector<uint8_t> new_image = fixture("new.bin");
+  std::vector<uint8_t> patch = fixture("delta.patch");
+  TEST_ASSERT_TRUE(patch.size() * 5 < new_image.size());
+
+  for (size_t piece : std::vector<size_t>{1, 7, 76, 1000, 4096}) {
+    std::vector<uint8_t> patched;
+    DeltaPatch applier;
+    TEST_ASSERT_TRUE(applyPatch(old_image, patch, piece, patched, applier));
+    TEST_ASSERT_TRUE(applier.done());
+    TEST_ASSERT_TRUE(applier.verify());
+    TEST_ASSERT_EQUAL(new_image.size(), applier.written());
+    TEST_ASSERT_EQUAL(new_image.size(), patched.size());
+    TEST_ASSERT_EQUAL_MEMORY(new_image.data(), patched.data(),
+                             new_image.size());
+  }
+}
+
+void test_patch_rejects_other_images(void) {
+  std::vector<uint8_t> old_image = fixture("old.bin");
+  std::vector<uint8_t> patch = fixture("delta.patch");
+  std::vector<uint8_t> patched;
+  DeltaPatch applier;
+
+  old_image[5000] ^= 1;
+  TEST_ASSERT_FALSE(applyPatch(old_image, patch, 4096, patched, applier));
+  TEST_ASSERT_EQUAL(0, patched.size());
+  old_image[5000] ^= 1;
+
+  // Corruption is caught either while applying or by the final hash
+  for (size_t at :
+       std::vector<size_t>{0, 100, 800, patch.size() / 2, patch.size() - 1}) {
+    std::vector<uint8_t> corrupt = patch;
+    corrupt[at] ^= 0x55;
+    patched.clear();
+    bool applied = applyPatch(old_image, corrupt, 4096, patched, applier);
+    TEST_ASSERT_FALSE(applied && applier.verify());
+  }
+
+  // Trailing data
+  patch.push_back(0);
+  patched.clear();
+  TEST_ASSERT_FALSE(applyPatch(old_image, patch, 4096, patched, applier));
+}
+
+void test_rejected_patch_is_remembered(void) {
+  std::vector<uint8_t> patch = fixture("delta.patch");
+  std::string digest = imageDigest(patch);
+  TEST_ASSERT_FALSE(OtaProgress::rejected(digest.c_str()));
+  TEST_ASSERT_TRUE(OtaProgress::begin(digest.c_str(), patch.size(), PARTITION));
+  OtaProgress::reject();
+  OtaProgress::clear();
+  TEST_ASSERT_TRUE(OtaProgress::rejected(digest.c_str()));
+  TEST_ASSERT_FALSE(OtaProgress::rejected(sha256("abc").c_str()));
+  TEST_ASSERT_FALSE(OtaProgress::rejected(""));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sha256_known_digests);
+  RUN_TEST(test_sha256_pieces_match_whole);
+  RUN_TEST(test_parse_digest);
+  RUN_TEST(test_download_resumes_across_wakes);
+  RUN_TEST(test_new_image_starts_over);
+  RUN_TEST(test_corrupt_download_fails_verification);
+  RUN_TEST(test_patch_rebuilds_new_image);
+  RUN_TEST(test_patch_rejects_other_images);
+  RUN_TEST(test_rejected_patch_is_remembered);
+  return UNITY_END();
+}
@@ -0,0 +1,217 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include "epd_view_2.h"
+#include "measurementhistory.h"
+#include "trend.h"
+#include "sensor.h"
+#include "snapshot.h"
+
+typedef GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT> Display;
+
+// Mock sensor for testing
+class MockSensor : public Sensor {
+ public:
+  bool init() override { return true; }
+
+  bool ok() const override { return true; }
+
+  std::map<std::string, Measurement> read() override {
+    std::map<std::string, Measurement> measurements;
+    measurements["temperature"] = {21.5f, "°C"};
+    measurements["humidity"] = {48.0f, "%"};
+    measurements["pressure"] = {1009.0f, "hPa"};
+    return measurements;
+  }
+};
+
+void setUp(void) {
+  // Goldens are of a device without local history
+  MeasurementHistory::clear();
+}
+
+void tearDown(void) {
+  // clean stuff up here
+}
+
+static void addNode(JsonObject& nodes, const char* id, const char* name,
+                    const char* device, float temperature, float humidity,
+                    bool with_min_max) {
+  JsonObject node = nodes[id].to<JsonObject>();
+  node["display_name"] = name;
+  node["timestamp_utc"] = "2025-11-03T19:55:00";
+  node["version"] = "0123456789abcdef";
+
+  JsonObject measurements = node["measurements_v2"].to<JsonObject>();
+  JsonObject values = measurements[device].to<JsonObject>();
+  values["temperature"] = temperature;
+  values["humidity"] = humidity;
+  if (std::string(device) == "bme680") {
+    values["pressure"] = 1012.0;
+  }
+
+  if (with_min_max) {
+    JsonObject min_max = node["measurements_min_max"].to<JsonObject>();
+    JsonObject device_min_max = min_max[device].to<JsonObject>();
+    JsonObject temp = device_min_max["temperature"].to<JsonObject>();
+    temp["min"] = temperature - 3.5;
+    temp["max"] = temperature + 1.5;
+    JsonObject hum = device_min_max["humidity"].to<JsonObject>();
+    hum["min"] = humidity - 10;
+    hum["max"] = humidity + 5;
+  }
+
+  JsonObject status = node["status"].to<JsonObject>();
+  status[device] = "ok";
+}
+
+static void buildDoc(JsonDocument& doc, int node_count) {
+  doc["timestamp_utc"] = "2025-11-03T20:00:00";
+  doc["timestamp_local"] = "2025-11-03T21:00:00";
+  JsonObject location = doc["config"]["location"].to<JsonObject>();
+  location["latitude"] = "48.866667";
+  location["longitude"] = "2.333333";
+  location["utc_offset_seconds"] = 3600;
+
+  JsonObject nodes = doc["nodes"].to<JsonObject>();
+  addNode(nodes, "node1", "Indoor", "bme680", 21.3, 45.2, true);
+  if (node_count > 1) {
+    addNode(nodes, "node2", "Garden", "sht31d", 7.8, 82.1, true);
+  }
+  if (node_count > 2) {
+    addNode(nodes, "node3", "Attic", "sht31d", 14.2, 60.0, false);
+  }
+}
+
+static void assertMatchesGolden(const std::string& name) {
+  Display* display = Display::lastInstance();
+  TEST_ASSERT_NOT_NULL(display);
+  long diff = snapshot::compareWithGolden(snapshot::capture(*display), name,
+                                          __FILE__);
+  if (diff == -1) {
+    TEST_IGNORE_MESSAGE("Golden missing, run with UPDATE_SNAPSHOTS=1");
+  }
+  TEST_ASSERT_EQUAL_MESSAGE(0, diff, name.c_str());
+}
+
+void test_snapshot_single_node(void) {
+  EPDView2 view;
+  std::map<std::string, Sensor*> sensors;
+  JsonDocument doc;
+  buildDoc(doc, 1);
+
+  view.render(&doc, sensors);
+  assertMatchesGolden("single_node");
+}
+
+void test_snapshot_three_nodes(void) {
+  EPDView2 view;
+  std::map<std::string, Sensor*> sensors;
+  JsonDocument doc;
+  buildDoc(doc, 3);
+  doc["nodes"]["node2"]["status"]["battery"] = "error";
+  doc["nodes"]["node3"]["timestamp_utc"] = "2025-11-03T18:00:00";
+
+  view.render(&doc, sensors);
+  assertMatchesGolden("three_nodes");
+}
+
+void test_snapshot_sparkline(void) {
+  EPDView2 view;
+  std::map<std::string, Sensor*> sensors;
+  JsonDocument doc;
+  buildDoc(doc, 2);
+  // A day with a warm afternoon and a few missed readings
+  uint8_t points[Trend::POINTS];
+  for (int i = 0; i < Trend::POINTS; i++) {
+    int distance = abs(i - 30);
+    points[i] = distance > 20 ? 0 : Trend::MAX - distance * Trend::MAX / 20;
+  }
+  points[10] = points[11] = Trend::GAP;
+  doc["nodes"]["node1"]["trend"]["bme680"]["temperature"] =
+      Trend::encode(points, Trend::POINTS);
+
+  view.render(&doc, sensors);
+  assertMatchesGolden("sparkline");
+}
+
+void test_snapshot_no_data(void) {
+  EPDView2 view;
+  std::map<std::string, Sensor*> sensors;
+  MockSensor sensor;
+  sensors["bme680"] = &sensor;
+
+  view.render(nullptr, sensors);
+  assertMatchesGolden("no_data");
+}
+
+void test_snapshot_partial_update(void) {
+  EPDView2 view;
+  std::map<std::string, Sensor*> sensors;
+  JsonDocument doc;
+  buildDoc(doc, 2);
+  view.render(&doc, sensors);
+
+  // Second wake on a later day with a new reading on one node
+  doc["timestamp_local"] = "2025-11-04T09:00:00";
+  doc["timestamp_utc"] = "2025-11-04T08:00:00";
+  doc["nodes"]["node1"]["timestamp_utc"] = "2025-11-04T07:55:00";
+  doc["nodes"]["node2"]["timestamp_utc"] = "2025-11-04T07:55:00";
+  doc["nodes"]["node1"]["measurements_v2"]["bme680"]["temperature"] = 19.9;
+  view.render(&doc, sensors);
+
+  Display* display = Display::lastInstance();
+  TEST_ASSERT_NOT_NULL(display);
+  TEST_ASSERT_EQUAL(1, display->getFullRefreshCount());
+  TEST_ASSERT_TRUE(display->getPartialRefreshCount() > 0);
+  // Nodes are refreshed last and only the first column changed
+  TEST_ASSERT_EQUAL(0, display->getPartialX());
+  TEST_ASSERT_TRUE(display->getPartialW() < display->width() / 2);
+  assertMatchesGolden("partial_update");
+}
+
+// Times full renders of a three node screen. Iterations can be raised with
+// RENDER_BENCHMARK_ITERATIONS to get stable numbers when working on the
+// render path.
+void test_render_benchmark(void) {
+  int iterations = 5;
+  const char* env = getenv("RENDER_BENCHMARK_ITERATIONS");
+  if (env != nullptr && atoi(env) > 0) {
+    iterations = atoi(env);
+  }
+
+  std::map<std::string, Sensor*> sensors;
+  JsonDocument doc;
+  buildDoc(doc, 3);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    EPDView2 view;
+    view.render(&doc, sensors);
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  char message[96];
+  snprintf(message, sizeof(message), "Full render: %d iterations, %.1f us each",
+           iterations, static_cast<double>(elapsed) / iterations);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_TRUE(elapsed >= 0);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_snapshot_single_node);
+  RUN_TEST(test_snapshot_three_nodes);
+  RUN_TEST(test_snapshot_sparkline);
+  RUN_TEST(test_snapshot_no_data);
+  RUN_TEST(test_snapshot_partial_update);
+  RUN_TEST(test_render_benchmark);
+  UNITY_END();
+
+  return 0;
+}
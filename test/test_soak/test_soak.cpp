@@ -0,0 +1,436 @@
+// Soak test of the display node's wake cycle: runs what runApp() does on the
+// device (parse the get-display response into the JSON arena, render it with
+// the view kept across light sleep, free the cycle's memory) thousands of
+// times, with node counts, failed requests, corrupt responses, POST errors
+// and deep sleeps varying from cycle to cycle.
+//
+// Every C++ allocation goes through the counting operator new below, the
+// allocations, bytes and high water mark of each cycle are recorded, and
+// the test fails when what is left allocated after a cycle keeps growing.
+// Built with AddressSanitizer (make soak), malloc'd memory such as the JSON
+// pools is counted too and leaks fail the test.
+//
+// SOAK_CYCLES sets the number of cycles, SOAK_REPORT a CSV file to write the
+// figures of every cycle to.
+
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SOAK_ASAN
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) && !defined(SOAK_ASAN)
+#define SOAK_ASAN
+#endif
+#ifdef SOAK_ASAN
+#include <sanitizer/lsan_interface.h>
+// From sanitizer/allocator_interface.h, which GCC does not ship
+extern "C" size_t __sanitizer_get_current_allocated_bytes();
+#endif
+
+#include "epd_view_2.h"
+#include "jsonarena.h"
+#include "measurementhistory.h"
+#include "sensor.h"
+
+namespace {
+
+struct HeapCounters {
+  size_t allocations;
+  size_t bytes;
+  size_t live;
+  size_t high_water;
+};
+
+HeapCounters counters = {0, 0, 0, 0};
+
+size_t usableSize(void* pointer) {
+#ifdef __APPLE__
+  return malloc_size(pointer);
+#else
+  return malloc_usable_size(pointer);
+#endif
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  void* pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  size_t usable = usableSize(pointer);
+  counters.allocations++;
+  counters.bytes += usable;
+  counters.live += usable;
+  if (counters.live > counters.high_water) {
+    counters.high_water = counters.live;
+  }
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+  if (pointer != nullptr) {
+    counters.live -= usableSize(pointer);
+    free(pointer);
+  }
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete[](void* pointer) noexcept { operator delete(pointer); }
+
+namespace {
+
+// The schedule repeats every PERIOD cycles, so the memory left after cycles
+// of the same phase can be compared
+const int PERIOD = 40;
+const int WARM_UP_PERIODS = 2;
+// Slack for strings that change length with the date
+const size_t MAX_GROWTH_BYTES = 1024;
+const int CYCLE_SECONDS = 5 * 60;
+const time_t START_EPOCH = 1762200000;  // 2025-11-03T20:00:00Z
+
+struct Cycle {
+  int nodes;
+  bool get_failed;
+  bool corrupt_response;
+  bool post_failed;
+  bool deep_sleep;
+};
+
+struct CycleFigures {
+  size_t allocations;
+  size_t bytes;
+  size_t high_water;
+  size_t live;
+  size_t heap;  // All of the heap in use, with AddressSanitizer only
+  size_t arena_high_water;
+};
+
+Cycle cycleAt(int index) {
+  int phase = index % PERIOD;
+  Cycle cycle;
+  cycle.nodes = 1 + phase % 8;
+  cycle.get_failed = phase == 7 || phase == 23;
+  cycle.corrupt_response = phase == 15;
+  cycle.post_failed = phase == 31;
+  cycle.deep_sleep = phase == PERIOD - 1;
+  return cycle;
+}
+
+class FakeSensor : public Sensor {
+ public:
+  bool init() override { return true; }
+  bool ok() const override { return true; }
+  std::map<std::string, Measurement> read() override {
+    std::map<std::string, Measurement> data;
+    data["temperature"] = {20.5, "C"};
+    data["humidity"] = {48.0, "%"};
+    return data;
+  }
+};
+
+// The get-display response recorded in fixtures/ next to this file
+std::string recordedResponse() {
+  std::string path = __FILE__;
+  path = path.substr(0, path.rfind('/') + 1) + "fixtures/response.json";
+  std::string data;
+  FILE* file = fopen(path.c_str(), "rb");
+  TEST_ASSERT_TRUE_MESSAGE(file != nullptr, path.c_str());
+  char buffer[1024];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.append(buffer, size);
+  }
+  fclose(file);
+  return data;
+}
+
+std::string isoTime(time_t when, const char* offset) {
+  char buffer[32];
+  struct tm parts;
+  gmtime_r(&when, &parts);
+  strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &parts);
+  return std::string(buffer) + offset;
+}
+
+// What the server answers for the cycle, made from the recorded response
+std::string responseFor(const JsonDocument& recorded, int index,
+                        const Cycle& cycle) {
+  time_t now = START_EPOCH + index * CYCLE_SECONDS;
+  JsonDocument doc = recorded;
+  doc["timestamp_utc"] = isoTime(now, "+00:00");
+  doc["timestamp_local"] = isoTime(now + 3600, "+01:00");
+  JsonObject nodes = doc["nodes"].as<JsonObject>();
+  for (int i = 1; i <= 8; i++) {
+    std::string name = "node" + std::to_string(i);
+    if (i > cycle.nodes) {
+      nodes.remove(name.c_str());
+      continue;
+    }
+    nodes[name]["timestamp_utc"] = isoTime(now - 60, "");
+    nodes[name]["measurements_v2"]["bme680"]["temperature"] =
+        18.5 + (index % 5) * 0.5 + i;
+  }
+  std::string response;
+  serializeJson(doc, response);
+  if (cycle.corrupt_response) {
+    response.resize(response.size() / 2);
+  }
+  return response;
+}
+
+// Keeps the firmware's logging out of the report
+class QuietStdout {
+ public:
+  QuietStdout() {
+    fflush(stdout);
+    saved_ = dup(STDOUT_FILENO);
+    FILE* null = fopen("/dev/null", "w");
+    dup2(fileno(null), STDOUT_FILENO);
+    fclose(null);
+  }
+  ~QuietStdout() {
+    fflush(stdout);
+    dup2(saved_, STDOUT_FILENO);
+    close(saved_);
+  }
+
+ private:
+  int saved_;
+};
+
+struct Soak {
+  EPDView2* view = nullptr;
+  FakeSensor sensor;
+  std::map<std::string, Sensor*> sensors;
+  std::vector<CycleFigures> figures;
+  // Allocations kept on purpose every cycle, to check that growth is caught
+  size_t leak_bytes = 0;
+  std::vector<char*> leaked;
+  size_t arena_high_water = 0;
+
+  ~Soak() {
+    delete view;
+    for (char* block : leaked) {
+      delete[] block;
+    }
+  }
+
+  // One wake: NodeApp::setup(), doGet(), updateDisplay(), endCycle() and
+  // prepareSleep()
+  bool run(const std::string& response, const Cycle& cycle) {
+    if (view == nullptr) {
+      view = new EPDView2();
+      sensors["bme680"] = &sensor;
+    }
+    JsonDocument* doc = nullptr;
+    if (!cycle.get_failed) {
+      doc = new JsonDocument(JsonArena::instance());
+      if (deserializeJson(*doc, response)) {
+        delete doc;
+        doc = nullptr;
+      }
+    }
+    view->setHttpPostErrorCode(cycle.post_failed ? 500 : 200);
+    view->setCurrentDeviceId("display");
+    view->render(doc, sensors);
+    delete doc;
+    if (leak_bytes > 0) {
+      leaked.push_back(new char[leak_bytes]);
+    }
+    arena_high_water = JsonArena::instance()->highWater();
+    bool reset = JsonArena::instance()->reset();
+
+    if (cycle.deep_sleep) {
+      // Nothing survives but RTC memory and the file system
+      view->cleanup();
+      delete view;
+      view = nullptr;
+    } else {
+      view->suspend();
+    }
+    return reset;
+  }
+
+  void runCycles(int count, FILE* report) {
+    std::string recorded_text = recordedResponse();
+    JsonDocument recorded;
+    TEST_ASSERT_FALSE(deserializeJson(recorded, recorded_text));
+    // Allocated up front, so it does not count as growth
+    figures.reserve(figures.size() + count);
+    for (int index = 0; index < count; index++) {
+      Cycle cycle = cycleAt(index);
+      std::string response = responseFor(recorded, index, cycle);
+
+      HeapCounters start = counters;
+      counters.high_water = counters.live;
+      bool reset;
+      {
+        QuietStdout quiet;
+        reset = run(response, cycle);
+      }
+      CycleFigures cycle_figures;
+      cycle_figures.allocations = counters.allocations - start.allocations;
+      cycle_figures.bytes = counters.bytes - start.bytes;
+      cycle_figures.high_water = counters.high_water;
+      cycle_figures.live = counters.live;
+#ifdef SOAK_ASAN
+      cycle_figures.heap = __sanitizer_get_current_allocated_bytes();
+#else
+      cycle_figures.heap = 0;
+#endif
+      cycle_figures.arena_high_water = arena_high_water;
+      figures.push_back(cycle_figures);
+      TEST_ASSERT_TRUE_MESSAGE(reset, "JSON arena still in use after a cycle");
+
+      if (report != nullptr) {
+        fprintf(report, "%d,%d,%d,%d,%d,%d,%zu,%zu,%zu,%zu,%zu\n", index,
+                cycle.nodes, cycle.get_failed, cycle.corrupt_response,
+                cycle.post_failed, cycle.deep_sleep, cycle_figures.allocations,
+                cycle_figures.bytes, cycle_figures.high_water,
+                cycle_figures.live, cycle_figures.heap);
+      }
+    }
+  }
+};
+
+int soakCycles() {
+  int cycles = 400;
+  const char* env = getenv("SOAK_CYCLES");
+  if (env != nullptr && atoi(env) > 0) {
+    cycles = atoi(env);
+  }
+  // Whole periods, enough to compare some after warming up
+  cycles = (cycles + PERIOD - 1) / PERIOD * PERIOD;
+  int minimum = (WARM_UP_PERIODS + 2) * PERIOD;
+  return cycles < minimum ? minimum : cycles;
+}
+
+// Growth of what is left after the last cycle of a period, and of the high
+// water mark over a period, between the first period after warming up and
+// the last one
+struct Growth {
+  long live;
+  long high_water;
+  long heap;
+};
+
+Growth growthOf(const std::vector<CycleFigures>& figures) {
+  size_t first = WARM_UP_PERIODS * PERIOD;
+  size_t last = figures.size() - PERIOD;
+  size_t first_high_water = 0;
+  size_t last_high_water = 0;
+  for (int i = 0; i < PERIOD; i++) {
+    first_high_water =
+        std::max(first_high_water, figures[first + i].high_water);
+    last_high_water = std::max(last_high_water, figures[last + i].high_water);
+  }
+  Growth growth;
+  growth.live = static_cast<long>(figures[last + PERIOD - 1].live) -
+                static_cast<long>(figures[first + PERIOD - 1].live);
+  growth.high_water =
+      static_cast<long>(last_high_water) - static_cast<long>(first_high_water);
+  growth.heap = static_cast<long>(figures[last + PERIOD - 1].heap) -
+                static_cast<long>(figures[first + PERIOD - 1].heap);
+  return growth;
+}
+
+}  // namespace
+
+void setUp(void) {
+  LittleFS.reset();
+  MeasurementHistory::clear();
+}
+
+void tearDown(void) {}
+
+void test_soak_wake_cycles(void) {
+  int cycles = soakCycles();
+  FILE* report = nullptr;
+  const char* report_path = getenv("SOAK_REPORT");
+  if (report_path != nullptr) {
+    report = fopen(report_path, "w");
+    TEST_ASSERT_TRUE_MESSAGE(report != nullptr, report_path);
+    fprintf(report,
+            "cycle,nodes,get_failed,corrupt_response,post_failed,deep_sleep,"
+            "allocations,bytes,high_water,live,heap\n");
+  }
+
+  std::vector<CycleFigures> figures;
+  {
+    Soak soak;
+    soak.runCycles(cycles, report);
+    figures = soak.figures;
+  }
+  if (report != nullptr) {
+    fclose(report);
+  }
+
+  size_t allocations = 0;
+  size_t bytes = 0;
+  size_t high_water = 0;
+  size_t arena_high_water = 0;
+  for (const CycleFigures& cycle : figures) {
+    allocations += cycle.allocations;
+    bytes += cycle.bytes;
+    high_water = std::max(high_water, cycle.high_water);
+    arena_high_water = std::max(arena_high_water, cycle.arena_high_water);
+  }
+  Growth growth = growthOf(figures);
+  char message[200];
+  snprintf(message, sizeof(message),
+           "%d cycles: %zu allocations, %zu bytes per cycle, high water %zu "
+           "bytes, JSON arena %zu of %zu bytes, growth %ld bytes live, %ld "
+           "high water, %ld heap",
+           cycles, allocations / cycles, bytes / cycles, high_water,
+           arena_high_water, JsonArena::instance()->capacity(), growth.live,
+           growth.high_water, growth.heap);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_TRUE_MESSAGE(growth.live <= (long)MAX_GROWTH_BYTES,
+                           "Memory left after a cycle keeps growing");
+  TEST_ASSERT_TRUE_MESSAGE(growth.high_water <= (long)MAX_GROWTH_BYTES,
+                           "Memory used within a cycle keeps growing");
+  TEST_ASSERT_TRUE_MESSAGE(growth.heap <= (long)MAX_GROWTH_BYTES,
+                           "Heap left after a cycle keeps growing");
+#ifdef SOAK_ASAN
+  TEST_ASSERT_EQUAL(0, __lsan_do_recoverable_leak_check());
+#endif
+}
+
+void test_soak_catches_growth(void) {
+  // A few bytes kept per wake, as a forgotten delete would
+  Soak soak;
+  soak.leak_bytes = 24;
+  soak.runCycles((WARM_UP_PERIODS + 3) * PERIOD, nullptr);
+  Growth growth = growthOf(soak.figures);
+  TEST_ASSERT_TRUE(growth.live > (long)MAX_GROWTH_BYTES);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_soak_wake_cycles);
+  RUN_TEST(test_soak_catches_growth);
+  return UNITY_END();
+}
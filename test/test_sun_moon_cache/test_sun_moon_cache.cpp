@@ -0,0 +1,145 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include <string>
+#include "controller.h"
+#include "model.h"
+#include "sunandmoon.h"
+#include "sunmooncache.h"
+
+static const double PARIS_LAT = 48.866667;
+static const double PARIS_LON = 2.333333;
+
+void setUp(void) { SunMoonCache::clear(); }
+
+void tearDown(void) {
+  // clean stuff up here
+}
+
+static void assertSameEvents(const SunMoonEvents& a, const SunMoonEvents& b) {
+  TEST_ASSERT_EQUAL(a.sun_rise, b.sun_rise);
+  TEST_ASSERT_EQUAL(a.sun_transit, b.sun_transit);
+  TEST_ASSERT_EQUAL(a.sun_set, b.sun_set);
+  TEST_ASSERT_EQUAL(a.moon_rise, b.moon_rise);
+  TEST_ASSERT_EQUAL(a.moon_transit, b.moon_transit);
+  TEST_ASSERT_EQUAL(a.moon_set, b.moon_set);
+}
+
+void test_first_calculation_fills_cache(void) {
+  SunAndMoon first(2025, 11, 3, 21, 0, 0, PARIS_LAT, PARIS_LON, 3600);
+  TEST_ASSERT_FALSE(first.fromCache());
+  TEST_ASSERT_TRUE(SunMoonCache::isValid());
+  TEST_ASSERT_EQUAL(1, SunMoonCache::misses());
+
+  SunAndMoon second(2025, 11, 3, 21, 15, 0, PARIS_LAT, PARIS_LON, 3600);
+  TEST_ASSERT_TRUE(second.fromCache());
+  TEST_ASSERT_EQUAL(1, SunMoonCache::hits());
+  assertSameEvents(first.getEvents(), second.getEvents());
+  TEST_ASSERT_EQUAL_STRING(first.getSunrise().c_str(),
+                           second.getSunrise().c_str());
+}
+
+void test_cache_hit_recomputes_moon_age(void) {
+  SunAndMoon morning(2025, 11, 3, 6, 0, 0, PARIS_LAT, PARIS_LON, 3600);
+  SunAndMoon evening(2025, 11, 3, 22, 0, 0, PARIS_LAT, PARIS_LON, 3600);
+  TEST_ASSERT_TRUE(evening.fromCache());
+
+  // Same moon age as a full calculation at that time
+  SunMoonCalc calc(2025, 11, 3, 22, 0, 0, PARIS_LAT, PARIS_LON);
+  SunMoonCalc::Result full = calc.calculateSunAndMoonData();
+  TEST_ASSERT_TRUE(fabs(full.moon.age - evening.getMoonPhaseAge()) < 1e-9);
+  TEST_ASSERT_TRUE(evening.getMoonPhaseAge() > morning.getMoonPhaseAge());
+  TEST_ASSERT_EQUAL_STRING(full.moon.phase.name,
+                           evening.getMoonPhase().c_str());
+}
+
+void test_cache_keyed_by_date_and_location(void) {
+  SunAndMoon paris(2025, 11, 3, 21, 0, 0, PARIS_LAT, PARIS_LON, 3600);
+  SunAndMoon next_day(2025, 11, 4, 9, 0, 0, PARIS_LAT, PARIS_LON, 3600);
+  TEST_ASSERT_FALSE(next_day.fromCache());
+  SunAndMoon elsewhere(2025, 11, 4, 9, 0, 0, 52.52, 13.405, 3600);
+  TEST_ASSERT_FALSE(elsewhere.fromCache());
+  SunAndMoon other_offset(2025, 11, 4, 9, 0, 0, 52.52, 13.405, 7200);
+  TEST_ASSERT_FALSE(other_offset.fromCache());
+  TEST_ASSERT_EQUAL(4, SunMoonCache::misses());
+}
+
+void test_ephemeris_round_trips_through_snapshot(void) {
+  SunAndMoon sun_and_moon(2025, 11, 3, 21, 0, 0, PARIS_LAT, PARIS_LON, 3600);
+  Model model;
+  model.setEphemeris(sun_and_moon.getKey(), sun_and_moon.getEvents());
+
+  Model restored(model.toJsonString());
+  SunMoonKey key;
+  SunMoonEvents events;
+  TEST_ASSERT_TRUE(restored.getEphemeris(key, events));
+  TEST_ASSERT_TRUE(key == sun_and_moon.getKey());
+  assertSameEvents(sun_and_moon.getEvents(), events);
+}
+
+void test_controller_restores_cache_from_snapshot(void) {
+  LittleFS.reset();
+  SunAndMoon sun_and_moon(2025, 11, 3, 21, 0, 0, PARIS_LAT, PARIS_LON, 3600);
+  Model model;
+  model.setEphemeris(sun_and_moon.getKey(), sun_and_moon.getEvents());
+  LittleFS.open("/last-displayed.json", "w")
+      .print(model.toJsonString().c_str());
+
+  // Power cycle: RTC memory is gone
+  SunMoonCache::clear();
+  Model* last_displayed = Controller::loadLastDisplayed();
+  TEST_ASSERT_TRUE(Controller::restoreSunMoonCache(last_displayed));
+  delete last_displayed;
+
+  SunAndMoon after_boot(2025, 11, 3, 21, 15, 0, PARIS_LAT, PARIS_LON, 3600);
+  TEST_ASSERT_TRUE(after_boot.fromCache());
+  assertSameEvents(sun_and_moon.getEvents(), after_boot.getEvents());
+}
+
+void test_controller_restore_without_ephemeris(void) {
+  LittleFS.reset();
+  Model* last_displayed = Controller::loadLastDisplayed();
+  TEST_ASSERT_FALSE(Controller::restoreSunMoonCache(last_displayed));
+  delete last_displayed;
+  TEST_ASSERT_FALSE(SunMoonCache::isValid());
+}
+
+void test_controller_etag_round_trips(void) {
+  LittleFS.reset();
+  TEST_ASSERT_EQUAL_STRING("", Controller::lastETag().c_str());
+
+  Controller::saveETag("\"4780e0503ab9692f\"");
+  TEST_ASSERT_EQUAL_STRING("\"4780e0503ab9692f\"",
+                           Controller::lastETag().c_str());
+
+  // Replaced, not appended to
+  Controller::saveETag("\"0840beee810eb975\"");
+  TEST_ASSERT_EQUAL_STRING("\"0840beee810eb975\"",
+                           Controller::lastETag().c_str());
+
+  // The snapshot is left alone
+  TEST_ASSERT_EQUAL_STRING("{}",
+                           LittleFS.contents("/last-displayed.json").c_str());
+}
+
+void test_controller_etag_cleared(void) {
+  LittleFS.reset();
+  Controller::saveETag("\"4780e0503ab9692f\"");
+  Controller::saveETag("");
+  TEST_ASSERT_EQUAL_STRING("", Controller::lastETag().c_str());
+  TEST_ASSERT_FALSE(LittleFS.exists("/last-displayed.etag"));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_calculation_fills_cache);
+  RUN_TEST(test_cache_hit_recomputes_moon_age);
+  RUN_TEST(test_cache_keyed_by_date_and_location);
+  RUN_TEST(test_ephemeris_round_trips_through_snapshot);
+  RUN_TEST(test_controller_restores_cache_from_snapshot);
+  RUN_TEST(test_controller_restore_without_ephemeris);
+  RUN_TEST(test_controller_etag_round_trips);
+  RUN_TEST(test_controller_etag_cleared);
+  UNITY_END();
+
+  return 0;
+}
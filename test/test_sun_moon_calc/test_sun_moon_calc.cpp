@@ -0,0 +1,311 @@
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "SunMoonBatch.h"
+#include "SunMoonCalc.h"
+#include "legacy_sun_moon_calc.h"
+
+// Paris, the equator, Cape Town, Helsinki and Tromsø, the latter to cover
+// days without sunrise or sunset
+static const double LATITUDES[] = {48.866667, 0.0, -33.92, 60.17, 69.65};
+static const double LONGITUDES[] = {2.333333, -78.5, 18.42, 24.94, 18.96};
+static const int LOCATIONS = sizeof(LATITUDES) / sizeof(LATITUDES[0]);
+
+// 2025-01-01T21:00:00Z, the evening wake of the display node
+static const time_t START = 1735765200;
+static const time_t DAY = 24 * 60 * 60;
+
+void setUp(void) {
+  // set stuff up here
+}
+
+void tearDown(void) {
+  // clean stuff up here
+}
+
+// Ten years of days by default, can be changed with SUNMOON_BENCHMARK_DAYS
+static int benchmarkDays() {
+  const char* env = getenv("SUNMOON_BENCHMARK_DAYS");
+  if (env != nullptr && atoi(env) > 0) {
+    return atoi(env);
+  }
+  return 3653;
+}
+
+// Bitwise equality, the refactoring must not change the order of operations
+static bool same(double a, double b) {
+  return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+static bool sameResult(const legacy::SunMoonCalc::Result& a,
+                       const SunMoonCalc::Result& b) {
+  return same(a.sun.azimuth, b.sun.azimuth) &&
+         same(a.sun.elevation, b.sun.elevation) &&
+         same(a.sun.riseJd, b.sun.riseJd) && same(a.sun.setJd, b.sun.setJd) &&
+         same(a.sun.transitJd, b.sun.transitJd) &&
+         a.sun.rise == b.sun.rise && a.sun.set == b.sun.set &&
+         a.sun.transit == b.sun.transit &&
+         same(a.sun.transitElevation, b.sun.transitElevation) &&
+         same(a.sun.distance, b.sun.distance) &&
+         same(a.moon.azimuth, b.moon.azimuth) &&
+         same(a.moon.elevation, b.moon.elevation) &&
+         same(a.moon.riseJd, b.moon.riseJd) &&
+         same(a.moon.setJd, b.moon.setJd) &&
+         same(a.moon.transitJd, b.moon.transitJd) &&
+         a.moon.rise == b.moon.rise && a.moon.set == b.moon.set &&
+         a.moon.transit == b.moon.transit && same(a.moon.age, b.moon.age) &&
+         same(a.moon.transitElevation, b.moon.transitElevation) &&
+         same(a.moon.distance, b.moon.distance) &&
+         same(a.moon.illumination, b.moon.illumination) &&
+         same(a.moon.axisPositionAngle, b.moon.axisPositionAngle) &&
+         same(a.moon.brightLimbAngle, b.moon.brightLimbAngle) &&
+         same(a.moon.parallacticAngle, b.moon.parallacticAngle) &&
+         a.moon.phase.index == b.moon.phase.index &&
+         strcmp(a.moon.phase.name.c_str(), b.moon.phase.name) == 0;
+}
+
+void test_matches_legacy_implementation(void) {
+  int days = benchmarkDays();
+  int compared = 0;
+  for (int l = 0; l < LOCATIONS; l++) {
+    for (int d = 0; d < days; d++) {
+      time_t timestamp = START + d * DAY;
+      legacy::SunMoonCalc before(timestamp, LATITUDES[l], LONGITUDES[l]);
+      SunMoonCalc after(timestamp, LATITUDES[l], LONGITUDES[l]);
+      if (!sameResult(before.calculateSunAndMoonData(),
+                      after.calculateSunAndMoonData())) {
+        char message[96];
+        snprintf(message, sizeof(message), "Differs at %ld, latitude %.2f",
+                 static_cast<long>(timestamp), LATITUDES[l]);
+        TEST_FAIL_MESSAGE(message);
+      }
+      compared++;
+    }
+  }
+  TEST_ASSERT_EQUAL(days * LOCATIONS, compared);
+}
+
+void test_moon_phase_names(void) {
+  SunMoonCalc calc(START, LATITUDES[0], LONGITUDES[0]);
+  struct {
+    double age;
+    uint8_t index;
+    const char* name;
+  } expected[] = {{0, 0, "New Moon"},
+                  {1, 1, "Waxing Crescent"},
+                  {6.4, 2, "First Quarter"},
+                  {8.4, 3, "Waxing Gibbous"},
+                  {13.8, 4, "Full Moon"},
+                  {15.8, 5, "Waning Gibbous"},
+                  {21.1, 6, "Last/Third Quarter"},
+                  {23.1, 7, "Waning Crescent"},
+                  {29.2, 0, "New Moon"},
+                  // Out of range ages used to give an empty String
+                  {-1, 0, ""},
+                  {30, 0, ""}};
+  for (const auto& e : expected) {
+    SunMoonCalc::MoonPhase phase = calc.calculateMoonPhase(e.age);
+    TEST_ASSERT_EQUAL(e.index, phase.index);
+    TEST_ASSERT_NOT_NULL(phase.name);
+    TEST_ASSERT_EQUAL_STRING(e.name, phase.name);
+  }
+}
+
+template <typename Calc>
+static double timeCalculations(int days) {
+  // Accumulated so the optimiser cannot drop the work
+  volatile double sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int l = 0; l < LOCATIONS; l++) {
+    for (int d = 0; d < days; d++) {
+      Calc calc(START + d * DAY, LATITUDES[l], LONGITUDES[l]);
+      sink = sink + calc.calculateSunAndMoonData().moon.age;
+    }
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  return static_cast<double>(elapsed) / (days * LOCATIONS);
+}
+
+// Times a day's calculation with both implementations
+void test_benchmark(void) {
+  int days = benchmarkDays();
+  double before = timeCalculations<legacy::SunMoonCalc>(days);
+  double after = timeCalculations<SunMoonCalc>(days);
+
+  char message[128];
+  snprintf(message, sizeof(message),
+           "%d days x %d locations: legacy %.2f us, current %.2f us per day",
+           days, LOCATIONS, before, after);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_TRUE(after > 0);
+}
+
+// Largest difference between the float and double calculators in seconds,
+// over rise, transit and set of both bodies. Events missing in one are
+// counted as a day off.
+static long floatError(const SunMoonCalc::Result& expected,
+                       const SunMoonCalcT<float>::Result& actual) {
+  const double expectedJd[] = {expected.sun.riseJd,  expected.sun.transitJd,
+                               expected.sun.setJd,   expected.moon.riseJd,
+                               expected.moon.transitJd, expected.moon.setJd};
+  const double actualJd[] = {actual.sun.riseJd,  actual.sun.transitJd,
+                             actual.sun.setJd,   actual.moon.riseJd,
+                             actual.moon.transitJd, actual.moon.setJd};
+  const time_t expectedTime[] = {expected.sun.rise,  expected.sun.transit,
+                                 expected.sun.set,   expected.moon.rise,
+                                 expected.moon.transit, expected.moon.set};
+  const time_t actualTime[] = {actual.sun.rise,  actual.sun.transit,
+                               actual.sun.set,   actual.moon.rise,
+                               actual.moon.transit, actual.moon.set};
+  long worst = 0;
+  for (int e = 0; e < 6; e++) {
+    if ((expectedJd[e] == -1) != (actualJd[e] == -1)) {
+      worst = std::max(worst, static_cast<long>(DAY));
+    } else {
+      worst = std::max(worst, labs(static_cast<long>(expectedTime[e] -
+                                                     actualTime[e])));
+    }
+  }
+  return worst;
+}
+
+// The display shows "%H:%M", so single precision has to stay within a minute
+void test_float_precision_within_a_minute(void) {
+  int days = benchmarkDays();
+  long worst = 0;
+  for (int l = 0; l < LOCATIONS; l++) {
+    for (int d = 0; d < days; d++) {
+      time_t timestamp = START + d * DAY;
+      SunMoonCalcT<double> reference(timestamp, LATITUDES[l], LONGITUDES[l]);
+      SunMoonCalcT<float> single(timestamp, LATITUDES[l], LONGITUDES[l]);
+      SunMoonCalc::Result expected = reference.calculateSunAndMoonData();
+      SunMoonCalcT<float>::Result actual = single.calculateSunAndMoonData();
+      long error = floatError(expected, actual);
+      if (error > 60) {
+        char message[96];
+        snprintf(message, sizeof(message), "%lds off at %ld, latitude %.2f",
+                 error, static_cast<long>(timestamp), LATITUDES[l]);
+        TEST_FAIL_MESSAGE(message);
+      }
+      worst = std::max(worst, error);
+      TEST_ASSERT_EQUAL(expected.moon.phase.index, actual.moon.phase.index);
+    }
+  }
+
+  char message[64];
+  snprintf(message, sizeof(message), "Largest float error %lds", worst);
+  TEST_MESSAGE(message);
+}
+
+static std::vector<time_t> dailyInstants(int days) {
+  std::vector<time_t> instants;
+  for (int d = 0; d < days; d++) {
+    instants.push_back(START + d * DAY);
+  }
+  return instants;
+}
+
+static long eventDifference(time_t expected, time_t actual) {
+  return labs(static_cast<long>(expected - actual));
+}
+
+void test_batch_matches_per_object(void) {
+  int days = benchmarkDays();
+  std::vector<time_t> instants = dailyInstants(days);
+  SunMoonTable table;
+  SunMoonBatch::calculate(instants.data(), days, LATITUDES, LONGITUDES,
+                          LOCATIONS, table);
+  TEST_ASSERT_EQUAL(days * LOCATIONS, table.sunRise.size());
+
+  long worst = 0;
+  for (int d = 0; d < days; d++) {
+    for (int l = 0; l < LOCATIONS; l++) {
+      SunMoonCalc calc(instants[d], LATITUDES[l], LONGITUDES[l]);
+      SunMoonCalc::Result expected = calc.calculateSunAndMoonData();
+      size_t i = table.index(d, l);
+      long diff = eventDifference(expected.sun.rise, table.sunRise[i]);
+      diff = std::max(diff, eventDifference(expected.sun.transit,
+                                            table.sunTransit[i]));
+      diff = std::max(diff, eventDifference(expected.sun.set, table.sunSet[i]));
+      diff = std::max(diff, eventDifference(expected.moon.rise,
+                                            table.moonRise[i]));
+      diff = std::max(diff, eventDifference(expected.moon.transit,
+                                            table.moonTransit[i]));
+      diff = std::max(diff, eventDifference(expected.moon.set,
+                                            table.moonSet[i]));
+      if (diff > 1) {
+        char message[96];
+        snprintf(message, sizeof(message), "%lds off at %ld, latitude %.2f",
+                 diff, static_cast<long>(instants[d]), LATITUDES[l]);
+        TEST_FAIL_MESSAGE(message);
+      }
+      worst = std::max(worst, diff);
+      TEST_ASSERT_TRUE(same(expected.moon.age, table.moonAge[d]));
+      TEST_ASSERT_EQUAL(expected.moon.phase.index, table.moonPhase[d]);
+    }
+  }
+
+  char message[64];
+  snprintf(message, sizeof(message), "Largest difference %lds", worst);
+  TEST_MESSAGE(message);
+}
+
+// Times a year of days at many observers, per object and batched
+void test_batch_benchmark(void) {
+  int days = std::min(benchmarkDays(), 366);
+  std::vector<time_t> instants = dailyInstants(days);
+  std::vector<double> latitudes;
+  std::vector<double> longitudes;
+  for (int l = 0; l < 16; l++) {
+    latitudes.push_back(-60 + l * 8.0);
+    longitudes.push_back(-170 + l * 21.0);
+  }
+  size_t locations = latitudes.size();
+
+  volatile long sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int d = 0; d < days; d++) {
+    for (size_t l = 0; l < locations; l++) {
+      SunMoonCalc calc(instants[d], latitudes[l], longitudes[l]);
+      sink = sink + calc.calculateSunAndMoonData().sun.rise;
+    }
+  }
+  auto middle = std::chrono::steady_clock::now();
+  SunMoonTable table;
+  SunMoonBatch::calculate(instants.data(), days, latitudes.data(),
+                          longitudes.data(), locations, table);
+  auto end = std::chrono::steady_clock::now();
+
+  double perObject = std::chrono::duration_cast<std::chrono::microseconds>(
+                         middle - start)
+                         .count();
+  double batch =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - middle)
+          .count();
+  char message[128];
+  snprintf(message, sizeof(message),
+           "%d days x %u locations: per object %.0f ms, batch %.0f ms (x%.1f)",
+           days, static_cast<unsigned>(locations), perObject / 1000,
+           batch / 1000, perObject / std::max(batch, 1.0));
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL(days * locations, table.sunRise.size());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_legacy_implementation);
+  RUN_TEST(test_moon_phase_names);
+  RUN_TEST(test_benchmark);
+  RUN_TEST(test_batch_matches_per_object);
+  RUN_TEST(test_batch_benchmark);
+  RUN_TEST(test_float_precision_within_a_minute);
+  UNITY_END();
+
+  return 0;
+}